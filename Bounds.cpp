@@ -0,0 +1,457 @@
+/*
+William Duprey
+12/10/24
+Bounds Implementation
+*/
+
+#include "Bounds.h"
+
+#include <cmath>
+#include <cstring>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Minimal vector math, so this file doesn't need DirectXMath
+	struct Float3 { float x, y, z; };
+
+	Float3 Add(Float3 a, Float3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	Float3 Sub(Float3 a, Float3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	Float3 Scale(Float3 a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+	float Dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Float3 Cross(Float3 a, Float3 b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	Float3 Load(const float* f) { return { f[0], f[1], f[2] }; }
+	void Store(float* f, Float3 v) { f[0] = v.x; f[1] = v.y; f[2] = v.z; }
+
+	Float3 LoadPosition(const float* positions, size_t stride, size_t index)
+	{
+		const float* p = (const float*)((const char*)positions + stride * index);
+		return { p[0], p[1], p[2] };
+	}
+
+	// Row vector times the upper 3x3 of a row major matrix
+	Float3 TransformDirection(Float3 v, const float m[16])
+	{
+		return {
+			v.x * m[0] + v.y * m[4] + v.z * m[8],
+			v.x * m[1] + v.y * m[5] + v.z * m[9],
+			v.x * m[2] + v.y * m[6] + v.z * m[10] };
+	}
+
+	Float3 TransformPoint(Float3 p, const float m[16])
+	{
+		return Add(TransformDirection(p, m), { m[12], m[13], m[14] });
+	}
+
+	// Volume first, then surface area, so flat boxes still compare
+	bool SmallerBox(const float a[3], const float b[3])
+	{
+		float volumeA = a[0] * a[1] * a[2];
+		float volumeB = b[0] * b[1] * b[2];
+		if (volumeA != volumeB)
+			return volumeA < volumeB;
+		return a[0] * a[1] + a[1] * a[2] + a[2] * a[0] <
+			b[0] * b[1] + b[1] * b[2] + b[2] * b[0];
+	}
+
+	// --------------------------------------------------------
+	// Ritter's bounding sphere: start from the most distant
+	// pair of extreme points along x, y and z, then grow just
+	// enough to take in every point left outside
+	// --------------------------------------------------------
+	void RitterSphere(const float* positions, size_t count, size_t stride,
+		Float3& center, float& radius)
+	{
+		Float3 lows[3], highs[3];
+		for (int axis = 0; axis < 3; axis++)
+			lows[axis] = highs[axis] = LoadPosition(positions, stride, 0);
+		for (size_t i = 1; i < count; i++)
+		{
+			Float3 p = LoadPosition(positions, stride, i);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if ((&p.x)[axis] < (&lows[axis].x)[axis])
+					lows[axis] = p;
+				if ((&p.x)[axis] > (&highs[axis].x)[axis])
+					highs[axis] = p;
+			}
+		}
+
+		Float3 a = lows[0];
+		Float3 b = highs[0];
+		float farthest = -1.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			Float3 low = lows[axis];
+			Float3 high = highs[axis];
+			float distanceSquared = Dot(Sub(high, low), Sub(high, low));
+			if (distanceSquared > farthest)
+			{
+				farthest = distanceSquared;
+				a = low;
+				b = high;
+			}
+		}
+
+		center = Scale(Add(a, b), 0.5f);
+		radius = sqrtf(farthest) * 0.5f;
+		for (size_t i = 0; i < count; i++)
+		{
+			Float3 offset = Sub(LoadPosition(positions, stride, i), center);
+			float distanceSquared = Dot(offset, offset);
+			if (distanceSquared <= radius * radius)
+				continue;
+
+			// Move toward the point by half of how far out it is
+			float distance = sqrtf(distanceSquared);
+			float grownRadius = (radius + distance) * 0.5f;
+			center = Add(center, Scale(offset, (grownRadius - radius) / distance));
+			radius = grownRadius;
+		}
+	}
+
+	// Farthest distance from center to any point, which also
+	// takes care of rounding in however the center was found
+	float RadiusAround(const float* positions, size_t count, size_t stride, Float3 center)
+	{
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			Float3 offset = Sub(LoadPosition(positions, stride, i), center);
+			radiusSquared = fmaxf(radiusSquared, Dot(offset, offset));
+		}
+		return sqrtf(radiusSquared);
+	}
+
+	// --------------------------------------------------------
+	// Eigenvectors of a symmetric 3x3 matrix by cyclic Jacobi
+	// rotations. The vectors end up in the columns of v.
+	// --------------------------------------------------------
+	void SymmetricEigenvectors(double a[3][3], double v[3][3])
+	{
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				v[i][j] = (i == j) ? 1.0 : 0.0;
+
+		for (int sweep = 0; sweep < 32; sweep++)
+		{
+			double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+			if (off < 1e-30)
+				break;
+
+			for (int p = 0; p < 2; p++)
+			{
+				for (int q = p + 1; q < 3; q++)
+				{
+					if (a[p][q] == 0.0)
+						continue;
+
+					// Rotation that zeroes a[p][q]
+					double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+					double t = (theta >= 0.0 ? 1.0 : -1.0) /
+						(fabs(theta) + sqrt(theta * theta + 1.0));
+					double c = 1.0 / sqrt(t * t + 1.0);
+					double s = t * c;
+
+					for (int k = 0; k < 3; k++)
+					{
+						double akp = a[k][p];
+						double akq = a[k][q];
+						a[k][p] = c * akp - s * akq;
+						a[k][q] = s * akp + c * akq;
+					}
+					for (int k = 0; k < 3; k++)
+					{
+						double apk = a[p][k];
+						double aqk = a[q][k];
+						a[p][k] = c * apk - s * aqk;
+						a[q][k] = s * apk + c * aqk;
+					}
+					for (int k = 0; k < 3; k++)
+					{
+						double vkp = v[k][p];
+						double vkq = v[k][q];
+						v[k][p] = c * vkp - s * vkq;
+						v[k][q] = s * vkp + c * vkq;
+					}
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Box along the principal axes of the points (the
+	// eigenvectors of their covariance)
+	// --------------------------------------------------------
+	void PrincipalAxesBox(const float* positions, size_t count, size_t stride,
+		BoundingVolumes& bounds)
+	{
+		// Double precision, since big meshes sum a lot of squares
+		double mean[3] = { 0, 0, 0 };
+		for (size_t i = 0; i < count; i++)
+		{
+			Float3 p = LoadPosition(positions, stride, i);
+			mean[0] += p.x;
+			mean[1] += p.y;
+			mean[2] += p.z;
+		}
+		for (int k = 0; k < 3; k++)
+			mean[k] /= (double)count;
+
+		double covariance[3][3] = {};
+		for (size_t i = 0; i < count; i++)
+		{
+			Float3 p = LoadPosition(positions, stride, i);
+			double d[3] = { p.x - mean[0], p.y - mean[1], p.z - mean[2] };
+			for (int r = 0; r < 3; r++)
+				for (int c = r; c < 3; c++)
+					covariance[r][c] += d[r] * d[c];
+		}
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < r; c++)
+				covariance[r][c] = covariance[c][r];
+
+		double vectors[3][3];
+		SymmetricEigenvectors(covariance, vectors);
+
+		// Right handed and exactly perpendicular
+		Float3 axes[3];
+		for (int k = 0; k < 2; k++)
+		{
+			Float3 axis = { (float)vectors[0][k], (float)vectors[1][k], (float)vectors[2][k] };
+			axes[k] = Scale(axis, 1.0f / sqrtf(Dot(axis, axis)));
+		}
+		axes[1] = Sub(axes[1], Scale(axes[0], Dot(axes[0], axes[1])));
+		axes[1] = Scale(axes[1], 1.0f / sqrtf(Dot(axes[1], axes[1])));
+		axes[2] = Cross(axes[0], axes[1]);
+
+		float low[3], high[3];
+		for (int k = 0; k < 3; k++)
+		{
+			low[k] = high[k] = Dot(LoadPosition(positions, stride, 0), axes[k]);
+		}
+		for (size_t i = 1; i < count; i++)
+		{
+			Float3 p = LoadPosition(positions, stride, i);
+			for (int k = 0; k < 3; k++)
+			{
+				float d = Dot(p, axes[k]);
+				low[k] = fminf(low[k], d);
+				high[k] = fmaxf(high[k], d);
+			}
+		}
+
+		Float3 center = { 0, 0, 0 };
+		for (int k = 0; k < 3; k++)
+		{
+			center = Add(center, Scale(axes[k], (low[k] + high[k]) * 0.5f));
+			Store(bounds.OrientedAxes[k], axes[k]);
+			bounds.OrientedExtents[k] = (high[k] - low[k]) * 0.5f;
+		}
+		Store(bounds.OrientedCenter, center);
+	}
+}
+
+// --------------------------------------------------------
+// Fits the box, the sphere, and optionally the oriented box
+// --------------------------------------------------------
+void Bounds::Calculate(BoundingVolumes& bounds,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	bool orientedBox)
+{
+	memset(&bounds, 0, sizeof(bounds));
+	if (vertexCount == 0)
+		return;
+
+	Float3 boxMin = LoadPosition(positions, positionStride, 0);
+	Float3 boxMax = boxMin;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		Float3 p = LoadPosition(positions, positionStride, i);
+		boxMin = { fminf(boxMin.x, p.x), fminf(boxMin.y, p.y), fminf(boxMin.z, p.z) };
+		boxMax = { fmaxf(boxMax.x, p.x), fmaxf(boxMax.y, p.y), fmaxf(boxMax.z, p.z) };
+	}
+	Store(bounds.BoxMin, boxMin);
+	Store(bounds.BoxMax, boxMax);
+
+	// Ritter's sphere is usually the tighter one, but
+	// not always (e.g. for a box's own corners)
+	Float3 center;
+	float radius;
+	RitterSphere(positions, vertexCount, positionStride, center, radius);
+	radius = RadiusAround(positions, vertexCount, positionStride, center);
+
+	Float3 boxCenter = Scale(Add(boxMin, boxMax), 0.5f);
+	float boxRadius = RadiusAround(positions, vertexCount, positionStride, boxCenter);
+	if (boxRadius < radius)
+	{
+		center = boxCenter;
+		radius = boxRadius;
+	}
+	Store(bounds.SphereCenter, center);
+	bounds.SphereRadius = radius;
+
+	if (!orientedBox)
+		return;
+	bounds.HasOrientedBox = 1;
+
+	PrincipalAxesBox(positions, vertexCount, positionStride, bounds);
+	float boxExtents[3] = {
+		(boxMax.x - boxMin.x) * 0.5f,
+		(boxMax.y - boxMin.y) * 0.5f,
+		(boxMax.z - boxMin.z) * 0.5f };
+	if (!SmallerBox(bounds.OrientedExtents, boxExtents))
+	{
+		Store(bounds.OrientedCenter, boxCenter);
+		for (int k = 0; k < 3; k++)
+		{
+			Float3 axis = { k == 0 ? 1.0f : 0.0f, k == 1 ? 1.0f : 0.0f, k == 2 ? 1.0f : 0.0f };
+			Store(bounds.OrientedAxes[k], axis);
+			bounds.OrientedExtents[k] = boxExtents[k];
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Moves every volume into world space. Boxes use Arvo's
+// method (each new extent is the sum of the old extents
+// projected onto it), and the sphere grows by the largest
+// scale along any axis.
+// --------------------------------------------------------
+void Bounds::ToWorld(const BoundingVolumes& bounds, const float world[16],
+	BoundingVolumes& result)
+{
+	BoundingVolumes out;
+	memset(&out, 0, sizeof(out));
+
+	// Axis-aligned box
+	Float3 boxMin = Load(bounds.BoxMin);
+	Float3 boxMax = Load(bounds.BoxMax);
+	Float3 center = TransformPoint(Scale(Add(boxMin, boxMax), 0.5f), world);
+	Float3 extents = Scale(Sub(boxMax, boxMin), 0.5f);
+	Float3 worldExtents;
+	for (int c = 0; c < 3; c++)
+	{
+		(&worldExtents.x)[c] =
+			fabsf(world[c]) * extents.x +
+			fabsf(world[4 + c]) * extents.y +
+			fabsf(world[8 + c]) * extents.z;
+	}
+	Store(out.BoxMin, Sub(center, worldExtents));
+	Store(out.BoxMax, Add(center, worldExtents));
+
+	// Sphere
+	float scaleSquared = 0.0f;
+	for (int r = 0; r < 3; r++)
+	{
+		Float3 row = Load(&world[r * 4]);
+		scaleSquared = fmaxf(scaleSquared, Dot(row, row));
+	}
+	Store(out.SphereCenter, TransformPoint(Load(bounds.SphereCenter), world));
+	out.SphereRadius = bounds.SphereRadius * sqrtf(scaleSquared);
+
+	// Oriented box. Non-uniform scale can shear the box's axes,
+	// so new perpendicular axes are built from the transformed
+	// half-size vectors, longest first (exact when nothing is
+	// sheared), and everything is projected onto them.
+	if (bounds.HasOrientedBox)
+	{
+		out.HasOrientedBox = 1;
+		Store(out.OrientedCenter, TransformPoint(Load(bounds.OrientedCenter), world));
+
+		Float3 halves[3];
+		float lengths[3];
+		int order[3] = { 0, 1, 2 };
+		for (int k = 0; k < 3; k++)
+		{
+			halves[k] = Scale(TransformDirection(Load(bounds.OrientedAxes[k]), world),
+				bounds.OrientedExtents[k]);
+			lengths[k] = Dot(halves[k], halves[k]);
+		}
+		for (int i = 0; i < 2; i++)
+			for (int j = i + 1; j < 3; j++)
+				if (lengths[order[j]] > lengths[order[i]])
+				{
+					int swap = order[i];
+					order[i] = order[j];
+					order[j] = swap;
+				}
+
+		// First axis along the longest, falling back on x for a point
+		Float3 axes[3];
+		axes[0] = lengths[order[0]] > 0.0f
+			? Scale(halves[order[0]], 1.0f / sqrtf(lengths[order[0]]))
+			: Float3{ 1, 0, 0 };
+
+		// Second axis from whichever of the others is left longer
+		// after removing the first, or anything perpendicular
+		axes[1] = { 0, 0, 0 };
+		float best = 0.0f;
+		for (int i = 1; i < 3; i++)
+		{
+			Float3 rest = Sub(halves[order[i]], Scale(axes[0], Dot(axes[0], halves[order[i]])));
+			float restLength = Dot(rest, rest);
+			if (restLength > best)
+			{
+				best = restLength;
+				axes[1] = Scale(rest, 1.0f / sqrtf(restLength));
+			}
+		}
+		if (best <= 0.0f)
+		{
+			Float3 other = fabsf(axes[0].x) < 0.9f ? Float3{ 1, 0, 0 } : Float3{ 0, 1, 0 };
+			axes[1] = Cross(axes[0], other);
+			axes[1] = Scale(axes[1], 1.0f / sqrtf(Dot(axes[1], axes[1])));
+		}
+		axes[2] = Cross(axes[0], axes[1]);
+
+		for (int k = 0; k < 3; k++)
+		{
+			Store(out.OrientedAxes[k], axes[k]);
+			out.OrientedExtents[k] =
+				fabsf(Dot(halves[0], axes[k])) +
+				fabsf(Dot(halves[1], axes[k])) +
+				fabsf(Dot(halves[2], axes[k]));
+		}
+	}
+
+	result = out;
+}
+
+// --------------------------------------------------------
+// Frustum planes (xyz normal pointing in, w distance),
+// pulled from the columns of a row-vector matrix. With a
+// world * view * projection matrix they're in object space.
+// --------------------------------------------------------
+void Bounds::ExtractPlanes(const float m[16], float planes[6][4])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		float c0 = m[i * 4 + 0];
+		float c1 = m[i * 4 + 1];
+		float c2 = m[i * 4 + 2];
+		float c3 = m[i * 4 + 3];
+		planes[0][i] = c3 + c0;	// Left
+		planes[1][i] = c3 - c0;	// Right
+		planes[2][i] = c3 + c1;	// Bottom
+		planes[3][i] = c3 - c1;	// Top
+		planes[4][i] = c2;		// Near (D3D depth starts at 0)
+		planes[5][i] = c3 - c2;	// Far
+	}
+
+	// Normalized, so plane distances are real distances
+	for (int p = 0; p < 6; p++)
+	{
+		float length = sqrtf(planes[p][0] * planes[p][0] +
+			planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		if (length > 0.0f)
+		{
+			for (int i = 0; i < 4; i++)
+				planes[p][i] /= length;
+		}
+	}
+}
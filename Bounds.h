@@ -0,0 +1,60 @@
+/*
+William Duprey
+12/10/24
+Bounds Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Every bounding volume kept for a mesh, either in its own
+// object space or (after Bounds::ToWorld) in world space.
+// Stored as is in the mesh cache, so it's all fixed size.
+// --------------------------------------------------------
+struct BoundingVolumes
+{
+	// Axis-aligned box
+	float BoxMin[3];
+	float BoxMax[3];
+
+	// Sphere, much tighter than the one around the box
+	float SphereCenter[3];
+	float SphereRadius;
+
+	// Oriented box: unit axes, and half sizes along each.
+	// Only filled in when HasOrientedBox isn't 0.
+	float OrientedCenter[3];
+	float OrientedAxes[3][3];
+	float OrientedExtents[3];
+	uint32_t HasOrientedBox;
+};
+
+// --------------------------------------------------------
+// Computing and transforming bounding volumes.
+// --------------------------------------------------------
+namespace Bounds
+{
+	// Fits every volume around the given points. The sphere
+	// is Ritter's, or the one around the box if that's smaller.
+	// The oriented box follows the principal axes of the points
+	// (only if orientedBox is true), and falls back to the
+	// axis-aligned box when that's smaller.
+	// "positions" are strided like in MeshOptimizer.
+	void Calculate(BoundingVolumes& bounds,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		bool orientedBox);
+
+	// Transforms object space bounds by a world matrix (row major,
+	// row vector convention, like DirectXMath). The results are
+	// exact for rotation, translation and uniform scale, and still
+	// contain everything under non-uniform scale.
+	void ToWorld(const BoundingVolumes& bounds, const float world[16],
+		BoundingVolumes& result);
+
+	// Frustum planes (xyz normal pointing in, w distance) of a
+	// view * projection matrix, in the same convention. With a
+	// world matrix in front, they're in object space instead.
+	void ExtractPlanes(const float viewProjection[16], float planes[6][4]);
+}
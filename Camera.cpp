@@ -6,6 +6,8 @@ Camera Implementation
 
 #include "Camera.h"
 #include "Input.h"
+
+#include <cstring>
 using namespace DirectX;
 
 Camera::Camera(
@@ -19,6 +21,8 @@ Camera::Camera(
     float _moveSpeed,
     float _lookSpeed) :
         aspectRatio(_aspectRatio),
+        version(0),
+        id(UploadStamps::NextId()),
         fov(_fov),
         nearClip(_nearClip),
         farClip(_farClip),
@@ -86,13 +90,14 @@ void Camera::Update(float dt)
         float mouseX = Input::GetMouseXDelta() * lookSpeed;
         float mouseY = Input::GetMouseYDelta() * lookSpeed;
 
-        // Rotate, mouseY = pitch, mouseX = yaw
-        transform->Rotate(mouseY, mouseX, 0);
+        // Rotate, mouseY = pitch, mouseX = yaw. Done on the
+        // angles (not with Rotate(), which spins around the
+        // world's axes) so looking up stays looking up.
+        XMFLOAT3 rotate = transform->GetRotation();
+        rotate.x += mouseY;
+        rotate.y += mouseX;
 
         // Clamp the pitch values
-        // (There's probably a way to do this that doesn't
-        // involve making a second call to the transform)
-        XMFLOAT3 rotate = transform->GetRotation();
         float pitch = rotate.x;
         if (pitch < LOWER_LOOK_LIMIT)
         {
@@ -121,12 +126,21 @@ void Camera::UpdateViewMatrix()
     XMFLOAT3 pos = transform->GetPosition();
     XMFLOAT3 forward = transform->GetForward();
 
-    // Create and save the view matrix
-    XMStoreFloat4x4(&viewMatrix, 
+    // Create the view matrix
+    XMFLOAT4X4 view;
+    XMStoreFloat4x4(&view, 
         XMMatrixLookToLH(
             XMLoadFloat3(&pos),         // Camera position
             XMLoadFloat3(&forward),     // Camera forward direction
             XMVectorSet(0, 1, 0, 0)));  // World up direction
+
+    // Only save it (and count it as a change) if it's different,
+    // since this gets called every frame whether we moved or not
+    if (memcmp(&view, &viewMatrix, sizeof(XMFLOAT4X4)) != 0)
+    {
+        viewMatrix = view;
+        version++;
+    }
 }
 
 // --------------------------------------------------------
@@ -159,6 +173,7 @@ void Camera::UpdateProjectionMatrix(float _aspectRatio)
     
     // Store the result back in the projMatrix field
     XMStoreFloat4x4(&projMatrix, proj);
+    version++;
 }
 
 
@@ -176,6 +191,23 @@ float Camera::GetFarClip() { return farClip; }
 float Camera::GetMoveSpeed() { return moveSpeed; }
 float Camera::GetLookSpeed() { return lookSpeed; }
 bool Camera::DoingPerspective() { return doPerspective; }
+unsigned int Camera::GetVersion() { return version; }
+uint64_t Camera::GetId() { return id; }
+
+float Camera::GetPixelsPerUnit(XMFLOAT3 center, float radius, float screenHeight)
+{
+    // Orthographic view height doesn't change with distance
+    if (!doPerspective)
+        return screenHeight * aspectRatio / orthoWidth;
+
+    // Nothing is closer than the near clip plane
+    XMFLOAT3 position = transform->GetPosition();
+    float distance = XMVectorGetX(XMVector3Length(
+        XMLoadFloat3(&center) - XMLoadFloat3(&position))) - radius;
+    if (distance < nearClip)
+        distance = nearClip;
+    return screenHeight / (2.0f * tanf(fov * 0.5f) * distance);
+}
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -48,6 +48,16 @@ public:
 	float GetLookSpeed();
 	bool DoingPerspective();
 
+	// Bumped every time the view or projection matrix changes,
+	// so whoever uploads them can tell when they don't need to
+	unsigned int GetVersion();
+	uint64_t GetId();	// Never reused (see UploadStamps)
+
+	// How many pixels one world unit covers on a screen this
+	// many pixels tall, at the near side of the given sphere
+	// (the same everywhere for orthographic projection)
+	float GetPixelsPerUnit(DirectX::XMFLOAT3 center, float radius, float screenHeight);
+
 	// Setters
 	void SetFieldOfView(float _fov);
 	void SetOrthographicWidth(float _orthoWidth);
@@ -63,6 +73,8 @@ private:
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projMatrix;
 	float aspectRatio;
+	unsigned int version;
+	uint64_t id;
 
 	// Extra customization
 	float fov;		// in radians
@@ -9,8 +9,10 @@
 #include "Input.h"
 #include "PathHelpers.h"
 #include "Window.h"
+#include "GeometryArena.h"
 
 #include <DirectXMath.h>
+#include <filesystem>
 #include <WICTextureLoader.h>
 
 // Needed for a helper function to load pre-compiled shader files
@@ -49,6 +51,7 @@ void Game::Initialize()
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
 	LoadShadersMaterialsMeshes();
+	staticBatcher = std::make_shared<StaticBatcher>();
 	CreateEntities();
 	CreateLights();
 	CreateShadowMapResources();
@@ -106,6 +109,8 @@ void Game::Initialize()
 	activeCam = cameras[0];
 
 	moveEntities = true;
+	lodPixelError = 1.0f;
+	impostorPixelSize = 48.0f;
 }
 
 
@@ -137,6 +142,10 @@ void Game::LoadShadersMaterialsMeshes()
 		std::make_shared<SimpleVertexShader>(
 			Graphics::Device, Graphics::Context, 
 			FixPath(L"VertexShader.cso").c_str());
+	std::shared_ptr<SimpleVertexShader> packedVertexShader =
+		std::make_shared<SimpleVertexShader>(
+			Graphics::Device, Graphics::Context,
+			FixPath(L"PackedVertexShader.cso").c_str());
 	std::shared_ptr<SimplePixelShader> pixelShader = 
 		std::make_shared<SimplePixelShader>(
 			Graphics::Device, Graphics::Context,
@@ -158,6 +167,9 @@ void Game::LoadShadersMaterialsMeshes()
 	shadowVS = std::make_shared<SimpleVertexShader>(
 		Graphics::Device, Graphics::Context,
 		FixPath(L"ShadowMapVS.cso").c_str());
+	packedShadowVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context,
+		FixPath(L"PackedShadowMapVS.cso").c_str());
 
 	// Load post process (blur and pixelize) shaders
 	ppVS = std::make_shared<SimpleVertexShader>(
@@ -325,21 +337,62 @@ void Game::LoadShadersMaterialsMeshes()
 	mat->AddSampler("BasicSampler", sampler);
 	materials.push_back(mat);
 
+	// Every material can also draw meshes with packed vertices
+	for (auto& m : materials)
+	{
+		m->SetPackedVertexShader(packedVertexShader);
+	}
+
 	// --- Load meshes from files ---
+	// Everything casts shadows, so everything keeps a position
+	// stream. The curved meshes use packed vertices, meshlets,
+	// levels of detail and oriented boxes.
+	// The cube stays full size, since the sky draws it with its
+	// own shader. The full size meshes are small, so they keep
+	// their geometry for static batching. The helix and torus
+	// also keep theirs to bake impostors from. Nothing casts
+	// rays at them yet, so none of them build a BVH (set
+	// MeshOptions::BuildBvh on the ones a ray query needs).
+	MeshOptions options;
+	options.KeepPositionStream = true;
+	MeshOptions packed = options;
+	options.KeepGeometry = true;
+	packed.PackVertices = true;
+	packed.BuildMeshlets = true;
+	packed.LodCount = MeshSimplifier::MaxLods;
+	packed.BuildOrientedBox = true;
+	MeshOptions baked = packed;
+	baked.KeepGeometry = true;
 	meshes.push_back(std::make_shared<Mesh>("Cube",
-		FixPath("../../Assets/Models/cube.obj").c_str()));
+		FixPath("../../Assets/Models/cube.obj").c_str(), options));
 	meshes.push_back(std::make_shared<Mesh>("Cylinder",
-		FixPath("../../Assets/Models/cylinder.obj").c_str()));
+		FixPath("../../Assets/Models/cylinder.obj").c_str(), packed));
 	meshes.push_back(std::make_shared<Mesh>("Helix",
-		FixPath("../../Assets/Models/helix.obj").c_str()));
+		FixPath("../../Assets/Models/helix.obj").c_str(), baked));
 	meshes.push_back(std::make_shared<Mesh>("Sphere",
-		FixPath("../../Assets/Models/sphere.obj").c_str()));
+		FixPath("../../Assets/Models/sphere.obj").c_str(), packed));
 	meshes.push_back(std::make_shared<Mesh>("Torus",
-		FixPath("../../Assets/Models/torus.obj").c_str()));
+		FixPath("../../Assets/Models/torus.obj").c_str(), baked));
 	meshes.push_back(std::make_shared<Mesh>("Quad",
-		FixPath("../../Assets/Models/quad.obj").c_str()));
+		FixPath("../../Assets/Models/quad.obj").c_str(), options));
 	meshes.push_back(std::make_shared<Mesh>("Quad Double Sided",
-		FixPath("../../Assets/Models/quad_double_sided.obj").c_str()));
+		FixPath("../../Assets/Models/quad_double_sided.obj").c_str(), options));
+
+	// --- Bake impostors ---
+	// Helix with the floor material and torus with the rough
+	// one, matching the entities made in CreateEntities()
+	std::shared_ptr<SimpleVertexShader> impostorVS =
+		std::make_shared<SimpleVertexShader>(
+			Graphics::Device, Graphics::Context,
+			FixPath(L"ImpostorVS.cso").c_str());
+	std::shared_ptr<SimplePixelShader> impostorPS =
+		std::make_shared<SimplePixelShader>(
+			Graphics::Device, Graphics::Context,
+			FixPath(L"ImpostorPS.cso").c_str());
+	impostors.push_back(std::make_shared<Impostor>(meshes[2], materials[2],
+		FixPath(L"../../Assets/Textures/PBR/floor_albedo.png").c_str(), impostorVS, impostorPS));
+	impostors.push_back(std::make_shared<Impostor>(meshes[4], materials[4],
+		FixPath(L"../../Assets/Textures/PBR/rough_albedo.png").c_str(), impostorVS, impostorPS));
 
 	// --- Set up the sky ---
 	std::shared_ptr<SimpleVertexShader> skyVS =
@@ -357,6 +410,30 @@ void Game::LoadShadersMaterialsMeshes()
 		FixPath(L"../../Assets/Textures/Skies/Planet/front.png").c_str(),
 		FixPath(L"../../Assets/Textures/Skies/Planet/back.png").c_str(),
 		skyVS, skyPS, meshes[0], sampler);
+
+	// --- Load a point cloud, if there is one ---
+	// Scans are far too big to keep in the repo, so this is
+	// just the first .ply dropped into Assets/PointClouds
+	std::error_code folderError;
+	std::filesystem::directory_iterator cloudFolder(
+		FixPath("../../Assets/PointClouds/"), folderError);
+	for (const std::filesystem::directory_entry& entry : cloudFolder)
+	{
+		if (entry.path().extension() != ".ply")
+			continue;
+
+		std::shared_ptr<SimpleVertexShader> pointVS =
+			std::make_shared<SimpleVertexShader>(
+				Graphics::Device, Graphics::Context,
+				FixPath(L"PointVS.cso").c_str());
+		std::shared_ptr<SimplePixelShader> pointPS =
+			std::make_shared<SimplePixelShader>(
+				Graphics::Device, Graphics::Context,
+				FixPath(L"PointPS.cso").c_str());
+		pointCloud = std::make_shared<PointCloud>(
+			entry.path().string().c_str(), pointVS, pointPS);
+		break;
+	}
 }
 
 void Game::CreateEntities()
@@ -366,8 +443,9 @@ void Game::CreateEntities()
 	entities.push_back(std::make_shared<GameEntity>(
 		meshes[6], materials[6]));
 
-	// Scale the floor up
+	// Scale the floor up, and batch it since it never moves
 	entities[0]->GetTransform()->SetScale(20, 1, 20);
+	entities[0]->SetStatic(true);
 
 	// Various 3D shapes for fun shadow things
 	entities.push_back(std::make_shared<GameEntity>(
@@ -386,9 +464,17 @@ void Game::CreateEntities()
 	entities[1]->GetTransform()->MoveAbsolute(-6, 0, -1);
 	entities[2]->GetTransform()->MoveAbsolute(-3, 1.5f, 1);
 	entities[3]->GetTransform()->MoveAbsolute(1.5f, 1.5f, -3);
-	entities[4]->GetTransform()->MoveAbsolute(1.5f, 1.5f, 0);
 	entities[5]->GetTransform()->MoveAbsolute(6, 1.5f, 0);	
 	entities[5]->GetTransform()->Rotate(-XM_PIDIV4, 0, 0);
+
+	// The sphere is attached to the torus, so the torus' spin
+	// carries it around in an orbit
+	entities[4]->GetTransform()->SetParent(entities[5]->GetTransform().get());
+	entities[4]->GetTransform()->SetPosition(-2.5f, 0, 0);
+
+	// Far away, the helix and torus draw their impostors
+	entities[3]->SetImpostor(impostors[0]);
+	entities[5]->SetImpostor(impostors[1]);
 }
 
 void Game::CreateLights()
@@ -640,6 +726,9 @@ void Game::Update(float deltaTime, float totalTime)
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
 
+	// Re-batch static entities changed above or in the UI
+	staticBatcher->Update(entities);
+
 	// Update the camera last
 	activeCam->Update(deltaTime);
 }
@@ -656,6 +745,17 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Clear the back buffer (erase what's on screen) and depth buffer
 	Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(), bgColor.get());
 	Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+	// Last frame ended with ImGui, which may leave other buffers bound
+	GeometryArena::ResetBindings();
+
+	// Start counting constant buffer uploads for this frame
+	ISimpleShader::ResetUploadCounts();
+	Material::ResetSkippedSets();
+
+	// Rebuild every world matrix that changed this frame in one batch,
+	// so drawing doesn't rebuild them one at a time
+	Transform::GetStore().UpdateDirty();
 	
 	// --- Shadow map draw setup ---
 	RenderShadowMap();
@@ -668,28 +768,23 @@ void Game::Draw(float deltaTime, float totalTime)
 	Graphics::Context->OMSetRenderTargets(1, blurRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
 
 	// --- Draw entities ---
+	// Static entities are drawn through their batches instead
 	for (int i = 0; i < entities.size(); ++i)
 	{
-		// Set vertex shader values
-		std::shared_ptr<SimpleVertexShader> vs = entities[i]->GetMaterial()->GetVertexShader();
-		vs->SetMatrix4x4("lightView", lightViewMatrix);
-		vs->SetMatrix4x4("lightProjection", lightProjectionMatrix);
-
-		// Set pixel shader values (these statements could probably
-		// go in the Entity draw method, but I don't know)
-		std::shared_ptr<SimplePixelShader> ps = entities[i]->GetMaterial()->GetPixelShader();
-		ps->SetFloat("time", totalTime);
-		ps->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-		ps->SetInt("lightCount", (int)lights.size());
-		ps->SetShaderResourceView("ShadowMap", shadowSRV);
-		ps->SetSamplerState("ShadowSampler", shadowSampler);
-		entities[i]->Draw(activeCam);
+		if (!staticBatcher->IsBatched(entities[i].get()))
+			DrawEntity(entities[i], totalTime);
 	}
+	for (auto& batch : staticBatcher->GetBatches())
+		DrawEntity(batch, totalTime);
 
 	// Draw the sky after entities, as depth buffer will 
 	// ensure redundant pixels are not rendered
 	sky->Draw(activeCam);
 
+	// Points last, since they bind their own vertex buffers
+	if (pointCloud)
+		pointCloud->Draw(activeCam);
+
 	// Frame END
 	// - These should happen exactly ONCE PER FRAME
 	// - At the very end of the frame (after drawing *everything*)
@@ -781,19 +876,19 @@ void Game::RenderShadowMap()
 	Graphics::Context->RSSetViewports(1, &viewport);
 
 	// Render entities
-	shadowVS->SetShader();
 	shadowVS->SetMatrix4x4("view", lightViewMatrix);
 	shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
+	packedShadowVS->SetMatrix4x4("view", lightViewMatrix);
+	packedShadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
 
-	// Loop and draw all entities
+	// Loop and draw all entities, with static ones in batches
 	for (auto& e : entities)
 	{
-		shadowVS->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
-
-		// Draw the mesh directly to avoid the entity's material
-		e->GetMesh()->SetBuffersAndDraw();
+		if (!staticBatcher->IsBatched(e.get()))
+			DrawShadowCaster(e);
 	}
+	for (auto& batch : staticBatcher->GetBatches())
+		DrawShadowCaster(batch);
 
 	// Reset the pipeline
 	viewport.Width = (float)Window::Width();
@@ -806,6 +901,69 @@ void Game::RenderShadowMap()
 	Graphics::Context->RSSetState(0);
 }
 
+// --------------------------------------------------------
+// Sets up the shader data the main pass needs (on whichever
+// variant of the shader the entity's mesh needs), then has
+// the entity draw itself.
+// --------------------------------------------------------
+void Game::DrawEntity(std::shared_ptr<GameEntity> entity, float totalTime)
+{
+	// Set vertex shader values
+	std::shared_ptr<SimpleVertexShader> vs =
+		entity->GetMaterial()->GetVertexShader(entity->GetMesh());
+	vs->SetMatrix4x4("lightView", lightViewMatrix);
+	vs->SetMatrix4x4("lightProjection", lightProjectionMatrix);
+
+	// Set pixel shader values (these statements could probably
+	// go in the Entity draw method, but I don't know)
+	std::shared_ptr<SimplePixelShader> ps = entity->GetMaterial()->GetPixelShader();
+	ps->SetFloat("time", totalTime);
+	ps->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
+	ps->SetInt("lightCount", (int)lights.size());
+	ps->SetShaderResourceView("ShadowMap", shadowSRV);
+	ps->SetSamplerState("ShadowSampler", shadowSampler);
+
+	// Impostors are lit the same way, but work out their
+	// shadow map positions per pixel
+	std::shared_ptr<Impostor> impostor = entity->GetImpostor();
+	if (impostor)
+	{
+		std::shared_ptr<SimplePixelShader> impostorPS = impostor->GetPixelShader();
+		impostorPS->SetMatrix4x4("lightView", lightViewMatrix);
+		impostorPS->SetMatrix4x4("lightProjection", lightProjectionMatrix);
+		impostorPS->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
+		impostorPS->SetInt("lightCount", (int)lights.size());
+		impostorPS->SetShaderResourceView("ShadowMap", shadowSRV);
+		impostorPS->SetSamplerState("ShadowSampler", shadowSampler);
+	}
+	entity->Draw(activeCam, lodPixelError, impostorPixelSize);
+}
+
+// --------------------------------------------------------
+// Draws one entity into the shadow map, with the shadow
+// shaders rather than its material
+// --------------------------------------------------------
+void Game::DrawShadowCaster(std::shared_ptr<GameEntity> entity)
+{
+	// Packed meshes need the decoding variant
+	std::shared_ptr<Mesh> mesh = entity->GetMesh();
+	std::shared_ptr<SimpleVertexShader> vs = shadowVS;
+	if (mesh->GetPackedVertices())
+	{
+		vs = packedShadowVS;
+		vs->SetFloat3("positionScale", mesh->GetPositionScale());
+		vs->SetFloat3("positionOffset", mesh->GetPositionOffset());
+	}
+
+	vs->SetShader();
+	vs->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+	vs->CopyAllBufferData();
+
+	// Draw the mesh directly to avoid the entity's material,
+	// binding only positions since that's all the shader reads
+	mesh->SetPositionsAndDraw();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // ------------------------ UPDATE HELPER METHODS -------------------------- //
 ///////////////////////////////////////////////////////////////////////////////
@@ -855,6 +1013,25 @@ void Game::BuildUI()
 		ImGui::Text("Total Pixels: %d", Window::Width() * Window::Height());
 		ImGui::ColorEdit4("Background Color", bgColor.get());
 
+		// Shared geometry buffers, and how much rebinding they saved last frame
+		ArenaStats arena = GeometryArena::GetStats();
+		ImGui::Text("Geometry Buffers: %d (%.2f / %.2f MB, %.0f%% fragmented)",
+			arena.BufferCount, arena.BytesUsed / 1048576.0f,
+			arena.BytesReserved / 1048576.0f, arena.Fragmentation * 100.0f);
+		ImGui::Text("Buffer Binds: %d (%d skipped)", arena.Binds, arena.BindsSkipped);
+
+		// World matrices rebuilt in the batch at the start of the frame
+		TransformStore& transforms = Transform::GetStore();
+		ImGui::Text("Transforms: %d (%d rebuilt in %.3f ms)", (int)transforms.GetCount(),
+			(int)transforms.GetLastUpdateCount(), transforms.GetLastUpdateTime());
+		ImGui::Text("Transform Hierarchy: %d (%d re-parented)", (int)transforms.GetHierarchyCount(),
+			(int)transforms.GetLastHierarchyCount());
+
+		// Constant buffers copied last frame, and the work skipped
+		// because the values were already on the GPU
+		ImGui::Text("Constant Buffer Uploads: %d (%d skipped, %d material sets skipped)",
+			ISimpleShader::Uploads, ISimpleShader::UploadsSkipped, Material::GetSkippedSets());
+
 		// Fully admit to copying this straight from the Demo code, 
 		// since it's just really nice having it so compact
 		if (ImGui::Button(showDemoUI ? "Hide ImGui Demo Window" : "Show ImGui Demo Window"))
@@ -868,6 +1045,8 @@ void Game::BuildUI()
 	// Create a collapsible header for Mesh Details
 	if (ImGui::TreeNode("Meshes"))
 	{
+		ImGui::SliderFloat("LOD Pixel Error", &lodPixelError, 0.0f, 8.0f);
+
 		// For every mesh, make a collapsible header
 		for (int i = 0; i < meshes.size(); ++i)
 		{
@@ -879,7 +1058,52 @@ void Game::BuildUI()
 				// Get triangle count by dividing index buffer size by 3
 				ImGui::Text("Triangles: %d", (meshes[i]->GetIndexCount() / 3));
 				ImGui::Text("Vertices: %d", meshes[i]->GetVertexCount());
+				ImGui::Text("Vertices Before Welding: %d", meshes[i]->GetUnweldedVertexCount());
 				ImGui::Text("Indices: %d", meshes[i]->GetIndexCount());
+				ImGui::Text("Vertex Size: %d bytes%s", meshes[i]->GetVertexStride(),
+					meshes[i]->GetPackedVertices() ? " (packed)" : "");
+				ImGui::Text("Position Stream: %d bytes", meshes[i]->GetPositionStride());
+				ImGui::Text("Index Size: %d bytes",
+					meshes[i]->GetIndexFormat() == DXGI_FORMAT_R16_UINT ? 2 : 4);
+				ImGui::Text("Load Time: %.3f ms (%s)", meshes[i]->GetLoadTime(),
+					meshes[i]->GetLoadedFromCache() ? "binary cache" : ".obj");
+
+				// Vertex cache efficiency (lower is better for all of
+				// these), before -> after the load-time optimization
+				MeshMetrics metrics = meshes[i]->GetMetrics();
+				VertexCacheStats before = meshes[i]->GetCacheStatsBefore();
+				VertexCacheStats lruBefore = meshes[i]->GetLruStatsBefore();
+				ImGui::Text("ACMR (FIFO): %.3f -> %.3f", before.ACMR, metrics.FifoCache.ACMR);
+				ImGui::Text("ATVR (FIFO): %.3f -> %.3f", before.ATVR, metrics.FifoCache.ATVR);
+				ImGui::Text("ACMR (LRU): %.3f -> %.3f", lruBefore.ACMR, metrics.LruCache.ACMR);
+				ImGui::Text("ATVR (LRU): %.3f -> %.3f", lruBefore.ATVR, metrics.LruCache.ATVR);
+				ImGui::Text("Overdraw: %.3f -> %.3f",
+					meshes[i]->GetOverdrawStatsBefore().Overdraw, metrics.Overdraw.Overdraw);
+				ImGui::Text("Vertex Reuse: %.2f corners per vertex", metrics.VertexReuse);
+				ImGui::Text("Bytes / Triangle: %.1f (%.1f vertex, %.1f index)",
+					metrics.VertexBytesPerTriangle + metrics.IndexBytesPerTriangle,
+					metrics.VertexBytesPerTriangle, metrics.IndexBytesPerTriangle);
+				ImGui::Text("Meshlets: %d", (int)meshes[i]->GetMeshlets().size());
+				const TriangleBvh& bvh = meshes[i]->GetBvh();
+				if (bvh.IsBuilt())
+				{
+					ImGui::Text("BVH: %d nodes, %.1f KB, built in %.3f ms",
+						(int)bvh.GetNodeCount(), bvh.GetMemoryBytes() / 1024.0f, bvh.GetBuildTime());
+				}
+				const BoundingVolumes& bounds = meshes[i]->GetBounds();
+				ImGui::Text("Bounding Sphere: %.3f radius", bounds.SphereRadius);
+				if (bounds.HasOrientedBox)
+				{
+					ImGui::Text("Oriented Box: %.3f x %.3f x %.3f",
+						bounds.OrientedExtents[0] * 2, bounds.OrientedExtents[1] * 2,
+						bounds.OrientedExtents[2] * 2);
+				}
+				const std::vector<LodLevel>& lods = meshes[i]->GetLods();
+				for (size_t l = 1; l < lods.size(); l++)
+				{
+					ImGui::Text("LOD %d: %d triangles, error %.4f / %.4f", (int)l,
+						(int)(lods[l].IndexCount / 3), lods[l].Error, lods[l].TargetError);
+				}
 				ImGui::Spacing();
 				ImGui::TreePop();
 			}
@@ -888,10 +1112,41 @@ void Game::BuildUI()
 		ImGui::TreePop();
 	}
 
+	// Create a collapsible header for the point cloud
+	if (pointCloud && ImGui::TreeNode("Point Cloud"))
+	{
+		float targetSpacing = pointCloud->GetTargetSpacing();
+		if (ImGui::SliderFloat("Target Spacing (px)", &targetSpacing, 0.5f, 16.0f))
+			pointCloud->SetTargetSpacing(targetSpacing);
+		int pointBudget = (int)(pointCloud->GetPointBudget() / 1000000);
+		if (ImGui::SliderInt("Point Budget (millions)", &pointBudget, 1, 16))
+			pointCloud->SetPointBudget((uint64_t)pointBudget * 1000000);
+
+		const PointCloudStats& stats = pointCloud->GetStats();
+		if (!pointCloud->IsLoaded())
+			ImGui::Text("Failed to load (binary .ply files only)");
+		ImGui::Text("Points: %llu in %u nodes", (unsigned long long)stats.SourcePoints, stats.NodeCount);
+		if (stats.BuildTime > 0.0)
+			ImGui::Text("Octree Build Time: %.0f ms", stats.BuildTime);
+		ImGui::Text("Selected: %llu points in %u nodes",
+			(unsigned long long)stats.SelectedPoints, stats.SelectedNodes);
+		ImGui::Text("Drawn: %llu points in %u nodes",
+			(unsigned long long)stats.DrawnPoints, stats.DrawnNodes);
+		ImGui::Text("Resident: %u nodes, %.1f MB", stats.ResidentNodes,
+			stats.ResidentBytes / (1024.0 * 1024.0));
+		ImGui::Text("Loads: %u, Evictions: %u", stats.Loads, stats.Evictions);
+		ImGui::TreePop();
+	}
+
 	// Create a collapsible header for the Game Entities
 	if (ImGui::TreeNode("Game Entities"))
 	{
 		ImGui::Checkbox("Move Entities", &moveEntities);
+		ImGui::SliderFloat("Impostor Size (px)", &impostorPixelSize, 0.0f, 256.0f);
+		ImGui::Text("Static Batches: %d (%d entities, %d rebuilt last frame)",
+			(int)staticBatcher->GetBatches().size(),
+			(int)staticBatcher->GetBatchedEntityCount(),
+			(int)staticBatcher->GetRebuildCount());
 
 		// For every entity, make a collapsible header
 		for (int i = 0; i < entities.size(); ++i) 
@@ -906,6 +1161,33 @@ void Game::BuildUI()
 					entities[i].get()->GetMesh().get()->GetName());
 				ImGui::Text("Material: %s",
 					entities[i]->GetMaterial()->GetName());
+
+				// Static entities get re-batched when edited below
+				bool isStatic = entities[i]->IsStatic();
+				if (ImGui::Checkbox("Static", &isStatic))
+					entities[i]->SetStatic(isStatic);
+				if (isStatic && !staticBatcher->IsBatched(entities[i].get()))
+					ImGui::Text("(Not batched: mesh didn't keep its geometry)");
+				if (!entities[i]->GetMesh()->GetMeshlets().empty())
+				{
+					ImGui::Text("Meshlets Drawn: %d / %d",
+						(int)entities[i]->GetVisibleMeshlets(),
+						(int)entities[i]->GetMesh()->GetMeshlets().size());
+				}
+				if (entities[i]->GetMesh()->GetLods().size() > 1)
+					ImGui::Text("LOD: %d", (int)entities[i]->GetCurrentLod());
+				std::shared_ptr<Impostor> impostor = entities[i]->GetImpostor();
+				if (impostor && impostor->IsBaked())
+				{
+					ImGui::Text("Impostor: %s (%dx%d, %.1f KB, baked in %.1f ms)",
+						entities[i]->IsDrawingImpostor() ? "drawn" : "not drawn",
+						(int)impostor->GetAtlasSize(), (int)impostor->GetAtlasSize(),
+						impostor->GetMemoryBytes() / 1024.0f, impostor->GetBakeTime());
+				}
+				const BoundingVolumes& worldBounds = entities[i]->GetWorldBounds();
+				ImGui::Text("World Sphere: (%.2f, %.2f, %.2f) r %.2f",
+					worldBounds.SphereCenter[0], worldBounds.SphereCenter[1],
+					worldBounds.SphereCenter[2], worldBounds.SphereRadius);
 				ImGui::Spacing();
 
 				// Get pointer to transform and each field of it
@@ -14,8 +14,11 @@
 #include "GameEntity.h"
 #include "Camera.h"
 #include "Material.h"
+#include "Impostor.h"
 #include "Lights.h"
+#include "PointCloud.h"
 #include "Sky.h"
+#include "StaticBatcher.h"
 #include "SimpleShader.h"
 
 class Game
@@ -44,6 +47,8 @@ private:
 
 	// Draw helper methods
 	void RenderShadowMap();
+	void DrawEntity(std::shared_ptr<GameEntity> entity, float totalTime);
+	void DrawShadowCaster(std::shared_ptr<GameEntity> entity);
 
 	// ImGui helper methods
 	void NewFrameUI(float deltaTime);
@@ -54,6 +59,8 @@ private:
 
 	// Whether to move entities around (for shadow mapping testing)
 	bool moveEntities;	
+	float lodPixelError;	// Screen space error allowed for LODs
+	float impostorPixelSize;	// Entities smaller than this draw impostors
 
 	// 4-element array of floats for holding the background color
 	// TODO: Use XMFLOAT4 instead of being weird like this
@@ -66,8 +73,17 @@ private:
 	std::vector<std::shared_ptr<Material>> materials;
 	std::vector<Light> lights;
 
+	// Baked stand-ins for the detailed meshes, when they're far away
+	std::vector<std::shared_ptr<Impostor>> impostors;
+
 	std::shared_ptr<Sky> sky;
 
+	// Optional scan from Assets/PointClouds, null if there isn't one
+	std::shared_ptr<PointCloud> pointCloud;
+
+	// Merged scenery, drawn in place of the static entities
+	std::shared_ptr<StaticBatcher> staticBatcher;
+
 	// One camera to rule them all
 	// One camera to find them		
 	// One camera to bring them all 
@@ -85,6 +101,7 @@ private:
 	DirectX::XMFLOAT4X4 lightViewMatrix;
 	DirectX::XMFLOAT4X4 lightProjectionMatrix;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	std::shared_ptr<SimpleVertexShader> packedShadowVS;
 	
 	UINT shadowMapResolution;
 	float lightProjectionSize;
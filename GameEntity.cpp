@@ -5,6 +5,7 @@ GameEntity Implementation
 */
 
 #include "GameEntity.h"
+#include "Window.h"
 using namespace DirectX;
 
 // --------------------------------------------------------
@@ -17,6 +18,13 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> _mesh,
 	transform = std::make_shared<Transform>();
 	mesh = _mesh;
 	material = _material;
+	isStatic = false;
+	visibleMeshlets = 0;
+	currentLod = 0;
+	drawingImpostor = false;
+	worldBounds = {};
+	boundsVersion = 0;
+	boundsValid = false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -33,13 +41,46 @@ std::shared_ptr<Transform> GameEntity::GetTransform()
 
 std::shared_ptr<Mesh> GameEntity::GetMesh() { return mesh; }
 std::shared_ptr<Material> GameEntity::GetMaterial() { return material; }
+size_t GameEntity::GetVisibleMeshlets() { return visibleMeshlets; }
+size_t GameEntity::GetCurrentLod() { return currentLod; }
+bool GameEntity::IsStatic() { return isStatic; }
+std::shared_ptr<Impostor> GameEntity::GetImpostor() { return impostor; }
+bool GameEntity::IsDrawingImpostor() { return drawingImpostor; }
+
+// --------------------------------------------------------
+// Returns the world space bounds, transforming the mesh's
+// object space ones again only if something has moved
+// --------------------------------------------------------
+const BoundingVolumes& GameEntity::GetWorldBounds()
+{
+	uint64_t version = transform->GetVersion();
+	if (!boundsValid || version != boundsVersion)
+	{
+		XMFLOAT4X4 world = transform->GetWorldMatrix();
+		Bounds::ToWorld(mesh->GetBounds(), &world._11, worldBounds);
+		boundsVersion = version;
+		boundsValid = true;
+	}
+	return worldBounds;
+}
 
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------------------------------- SETTERS --------------------------------- //
 ///////////////////////////////////////////////////////////////////////////////
-void GameEntity::SetMesh(std::shared_ptr<Mesh> _mesh) { mesh = _mesh; }
-void GameEntity::SetMaterial(std::shared_ptr<Material> _material) { material = _material; }
+void GameEntity::SetMesh(std::shared_ptr<Mesh> _mesh)
+{
+	mesh = _mesh;
+	impostor = nullptr;
+	boundsValid = false;
+}
+void GameEntity::SetMaterial(std::shared_ptr<Material> _material)
+{
+	material = _material;
+	impostor = nullptr;
+}
+void GameEntity::SetStatic(bool _isStatic) { isStatic = _isStatic; }
+void GameEntity::SetImpostor(std::shared_ptr<Impostor> _impostor) { impostor = _impostor; }
 
 
 // --------------------------------------------------------
@@ -48,10 +89,57 @@ void GameEntity::SetMaterial(std::shared_ptr<Material> _material) { material = _
 // Note: this code could go in a separate "Renderer" class,
 //		 if I felt like doing that way
 // --------------------------------------------------------
-void GameEntity::Draw(std::shared_ptr<Camera> camera)
+void GameEntity::Draw(std::shared_ptr<Camera> camera, float lodPixelError,
+	float impostorPixelSize)
 {
+	// Once the whole mesh only covers a few pixels, the baked
+	// quad looks the same and costs far less
+	drawingImpostor = false;
+	if (impostor && impostor->IsBaked() && impostorPixelSize > 0.0f)
+	{
+		const BoundingVolumes& bounds = GetWorldBounds();
+		float pixelsPerUnit = camera->GetPixelsPerUnit(XMFLOAT3(bounds.SphereCenter),
+			bounds.SphereRadius, (float)Window::Height());
+		if (bounds.SphereRadius * 2.0f * pixelsPerUnit < impostorPixelSize)
+		{
+			drawingImpostor = true;
+			visibleMeshlets = 0;
+			impostor->Draw(transform, bounds, camera);
+			return;
+		}
+	}
+
+	currentLod = mesh->SelectLod(transform->GetWorldMatrix(), camera,
+		(float)Window::Height(), lodPixelError);
+
+	// Meshes split into meshlets only draw the ones the
+	// camera might see, and nothing at all if none survive.
+	// Meshlets only cover the full detail level.
+	if (currentLod == 0 && !mesh->GetMeshlets().empty())
+	{
+		visibleMeshlets = mesh->CullMeshlets(transform->GetWorldMatrix(), camera, drawRanges);
+		if (drawRanges.empty())
+			return;
+
+		material->PrepareMaterial(transform, camera, mesh);
+		mesh->SetBuffersAndDraw(drawRanges);
+		return;
+	}
+	visibleMeshlets = 0;
+
+	// Simplified levels are a single run of the index buffer
+	if (currentLod != 0)
+	{
+		const LodLevel& lod = mesh->GetLods()[currentLod];
+		drawRanges.assign(1, { lod.IndexOffset, lod.IndexCount });
+
+		material->PrepareMaterial(transform, camera, mesh);
+		mesh->SetBuffersAndDraw(drawRanges);
+		return;
+	}
+
 	// Set up shaders and shader data
-	material->PrepareMaterial(transform, camera);
+	material->PrepareMaterial(transform, camera, mesh);
 
 	// Set vertex / index buffers and draw using the mesh
 	mesh->SetBuffersAndDraw();
@@ -8,11 +8,13 @@ GameEntity Header
 #include <wrl/client.h>
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 
 #include "Mesh.h"
 #include "Transform.h"
 #include "Camera.h"
 #include "Material.h"
+#include "Impostor.h"
 
 // --------------------------------------------------------
 // A class representing an entity in a game. 
@@ -31,15 +33,55 @@ public:
 	std::shared_ptr<Transform> GetTransform();
 	std::shared_ptr<Mesh> GetMesh();
 	std::shared_ptr<Material> GetMaterial();
+	size_t GetVisibleMeshlets();
+	size_t GetCurrentLod();
+	bool IsStatic();
+	std::shared_ptr<Impostor> GetImpostor();
+	bool IsDrawingImpostor();
+
+	// The mesh's bounding volumes in world space, only
+	// recalculated when the transform or mesh has changed
+	const BoundingVolumes& GetWorldBounds();
 
 	void SetMesh(std::shared_ptr<Mesh> _mesh);
 	void SetMaterial(std::shared_ptr<Material> _material);
 
-	void Draw(std::shared_ptr<Camera> camera);
+	// Static entities aren't expected to move, so they can be
+	// merged into static batches (see StaticBatcher.h)
+	void SetStatic(bool _isStatic);
+
+	// Drawn instead of the mesh once it's small enough on
+	// screen. Must be baked from this entity's mesh and
+	// material, so changing either drops it.
+	void SetImpostor(std::shared_ptr<Impostor> _impostor);
+
+	// lodPixelError: how many pixels off a simplified level
+	// of detail may be on screen before a finer one is used
+	// impostorPixelSize: how many pixels across the bounding
+	// sphere must be on screen to draw the mesh rather than
+	// the impostor (0 never draws the impostor)
+	void Draw(std::shared_ptr<Camera> camera, float lodPixelError = 1.0f,
+		float impostorPixelSize = 0.0f);
 
 private:
 	std::shared_ptr<Transform> transform;
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+	std::shared_ptr<Impostor> impostor;
+	bool isStatic;
+
+	// What the last Draw() drew (the meshlets that survived
+	// culling, or a level of detail), kept around so drawing
+	// doesn't allocate every frame
+	std::vector<MeshletRange> drawRanges;
+	size_t visibleMeshlets;
+	size_t currentLod;
+	bool drawingImpostor;
+
+	// Cached world space bounds, and the transform version
+	// they were made from (boundsValid is false after SetMesh)
+	BoundingVolumes worldBounds;
+	uint64_t boundsVersion;
+	bool boundsValid;
 };
 
@@ -0,0 +1,241 @@
+/*
+William Duprey
+12/10/24
+GeometryArena Implementation
+*/
+
+#include "GeometryArena.h"
+#include "Graphics.h"
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace GeometryArena
+{
+	// Anonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		// One shared buffer, and what's allocated in it
+		struct Pool
+		{
+			UINT BindFlags;			// Vertex or index buffer
+			UINT Stride;			// Bytes per element
+			DXGI_FORMAT Format;		// Index format, or unknown for vertices
+			Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+			RangeAllocator Allocator;
+		};
+		std::vector<Pool> pools;
+
+		// What's currently bound, so Bind() can skip it
+		ID3D11Buffer* boundVertexBuffer = nullptr;
+		UINT boundStride = 0;
+		ID3D11Buffer* boundIndexBuffer = nullptr;
+		DXGI_FORMAT boundFormat = DXGI_FORMAT_UNKNOWN;
+		unsigned int binds = 0;
+		unsigned int bindsSkipped = 0;
+
+		// --------------------------------------------------------
+		// Makes a DEFAULT usage buffer (not IMMUTABLE, since
+		// ranges are filled in one at a time)
+		// --------------------------------------------------------
+		Microsoft::WRL::ComPtr<ID3D11Buffer> CreatePoolBuffer(UINT bindFlags, size_t bytes)
+		{
+			D3D11_BUFFER_DESC desc = {};
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.ByteWidth = (UINT)bytes;
+			desc.BindFlags = bindFlags;
+
+			Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+			Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+			return buffer;
+		}
+
+		// --------------------------------------------------------
+		// Replaces a pool's buffer with a bigger one, copying
+		// everything over on the GPU
+		// --------------------------------------------------------
+		void GrowPool(Pool& pool, size_t elementCount)
+		{
+			size_t oldCount = pool.Allocator.GetCapacity();
+			Microsoft::WRL::ComPtr<ID3D11Buffer> buffer =
+				CreatePoolBuffer(pool.BindFlags, elementCount * pool.Stride);
+
+			if (pool.Buffer)
+			{
+				D3D11_BOX box = {};
+				box.right = (UINT)(oldCount * pool.Stride);
+				box.bottom = 1;
+				box.back = 1;
+				Graphics::Context->CopySubresourceRegion(buffer.Get(), 0, 0, 0, 0,
+					pool.Buffer.Get(), 0, &box);
+			}
+
+			// The old buffer might be bound, and its address
+			// could be reused by the next buffer made
+			boundVertexBuffer = nullptr;
+			boundIndexBuffer = nullptr;
+
+			pool.Buffer = buffer;
+			pool.Allocator.Grow(elementCount);
+		}
+
+		// --------------------------------------------------------
+		// Finds the pool for this kind of data (or makes one),
+		// allocates the range, and uploads the data into it
+		// --------------------------------------------------------
+		ArenaRange Allocate(const void* data, unsigned int count,
+			UINT bindFlags, UINT stride, DXGI_FORMAT format)
+		{
+			ArenaRange range;
+			if (count == 0 || stride == 0)
+				return range;
+
+			auto match = std::find_if(pools.begin(), pools.end(), [&](const Pool& pool)
+				{
+					return pool.BindFlags == bindFlags && pool.Stride == stride && pool.Format == format;
+				});
+			if (match == pools.end())
+			{
+				pools.push_back({ bindFlags, stride, format, nullptr, RangeAllocator() });
+				match = pools.end() - 1;
+			}
+			Pool& pool = *match;
+
+			// Out of room: double (or more, for a huge mesh), which
+			// also joins the new space to any free space at the end
+			size_t offset = pool.Allocator.Allocate(count);
+			if (offset == RangeAllocator::InvalidOffset)
+			{
+				size_t capacity = pool.Allocator.GetCapacity();
+				size_t grown = std::max(
+					std::max(capacity * 2, InitialBufferBytes / stride),
+					capacity + count);
+				GrowPool(pool, grown);
+				offset = pool.Allocator.Allocate(count);
+			}
+
+			range.Pool = (unsigned int)(match - pools.begin());
+			range.Offset = (unsigned int)offset;
+			range.Count = count;
+			if (data)
+				Upload(range, 0, data, count);
+			return range;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Copies into part of a range, for data that's too big to
+// hand over in one piece (or isn't ready yet when allocated)
+// --------------------------------------------------------
+void GeometryArena::Upload(const ArenaRange& range, unsigned int first,
+	const void* data, unsigned int count)
+{
+	if (range.Pool >= pools.size() || first + count > range.Count || count == 0)
+		return;
+
+	const Pool& pool = pools[range.Pool];
+	D3D11_BOX box = {};
+	box.left = (UINT)((range.Offset + first) * pool.Stride);
+	box.right = (UINT)((range.Offset + first + count) * pool.Stride);
+	box.bottom = 1;
+	box.back = 1;
+	Graphics::Context->UpdateSubresource(pool.Buffer.Get(), 0, &box, data, 0, 0);
+}
+
+ArenaRange GeometryArena::AllocateVertices(const void* data, unsigned int count, unsigned int stride)
+{
+	return Allocate(data, count, D3D11_BIND_VERTEX_BUFFER, stride, DXGI_FORMAT_UNKNOWN);
+}
+
+ArenaRange GeometryArena::AllocateIndices(const void* data, unsigned int count, DXGI_FORMAT format)
+{
+	UINT stride = (format == DXGI_FORMAT_R16_UINT) ? sizeof(uint16_t) : sizeof(UINT);
+	return Allocate(data, count, D3D11_BIND_INDEX_BUFFER, stride, format);
+}
+
+// --------------------------------------------------------
+// Frees the range and clears it, so freeing twice is harmless
+// --------------------------------------------------------
+void GeometryArena::Free(ArenaRange& range)
+{
+	if (range.Pool < pools.size())
+		pools[range.Pool].Allocator.Free(range.Offset, range.Count);
+	range = ArenaRange();
+}
+
+// --------------------------------------------------------
+// Vertex and index buffers are checked separately, since
+// meshes with the same vertex size often share only one
+// --------------------------------------------------------
+void GeometryArena::Bind(const ArenaRange& vertices, const ArenaRange& indices)
+{
+	if (vertices.Pool < pools.size())
+	{
+		const Pool& pool = pools[vertices.Pool];
+		if (pool.Buffer.Get() != boundVertexBuffer || pool.Stride != boundStride)
+		{
+			UINT stride = pool.Stride;
+			UINT offset = 0;
+			Graphics::Context->IASetVertexBuffers(0, 1, pool.Buffer.GetAddressOf(), &stride, &offset);
+			boundVertexBuffer = pool.Buffer.Get();
+			boundStride = pool.Stride;
+			binds++;
+		}
+		else
+			bindsSkipped++;
+	}
+
+	if (indices.Pool < pools.size())
+	{
+		const Pool& pool = pools[indices.Pool];
+		if (pool.Buffer.Get() != boundIndexBuffer || pool.Format != boundFormat)
+		{
+			Graphics::Context->IASetIndexBuffer(pool.Buffer.Get(), pool.Format, 0);
+			boundIndexBuffer = pool.Buffer.Get();
+			boundFormat = pool.Format;
+			binds++;
+		}
+		else
+			bindsSkipped++;
+	}
+}
+
+void GeometryArena::ResetBindings()
+{
+	boundVertexBuffer = nullptr;
+	boundStride = 0;
+	boundIndexBuffer = nullptr;
+	boundFormat = DXGI_FORMAT_UNKNOWN;
+	binds = 0;
+	bindsSkipped = 0;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> GeometryArena::GetBuffer(const ArenaRange& range)
+{
+	return range.Pool < pools.size() ? pools[range.Pool].Buffer : nullptr;
+}
+
+ArenaStats GeometryArena::GetStats()
+{
+	ArenaStats stats = {};
+	stats.BufferCount = (unsigned int)pools.size();
+	for (const Pool& pool : pools)
+	{
+		stats.BytesUsed += pool.Allocator.GetUsed() * pool.Stride;
+		stats.BytesReserved += pool.Allocator.GetCapacity() * pool.Stride;
+		stats.Fragmentation = std::max(stats.Fragmentation, pool.Allocator.GetFragmentation());
+	}
+	stats.Binds = binds;
+	stats.BindsSkipped = bindsSkipped;
+	return stats;
+}
+
+void GeometryArena::ShutDown()
+{
+	ResetBindings();
+	pools.clear();
+}
@@ -0,0 +1,74 @@
+/*
+William Duprey
+12/10/24
+GeometryArena Header
+*/
+
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+// --------------------------------------------------------
+// Where some vertices or indices live in the arena: which
+// shared buffer, and the range of elements within it
+// --------------------------------------------------------
+struct ArenaRange
+{
+	unsigned int Pool = (unsigned int)-1;	// -1 if nothing was allocated
+	unsigned int Offset = 0;				// In vertices or indices
+	unsigned int Count = 0;
+};
+
+// --------------------------------------------------------
+// Numbers for ImGui about the whole arena
+// --------------------------------------------------------
+struct ArenaStats
+{
+	unsigned int BufferCount;
+	size_t BytesUsed;
+	size_t BytesReserved;
+	float Fragmentation;		// Worst of any buffer (see RangeAllocator)
+	unsigned int Binds;			// IASet* calls since ResetBindings()
+	unsigned int BindsSkipped;	// Calls avoided since the buffer was bound
+};
+
+// --------------------------------------------------------
+// Every mesh's vertices and indices, sub-allocated out of
+// a few big shared buffers: one per vertex size, and one
+// per index format. Meshes are just ranges within them, so
+// drawing one is a DrawIndexed() with offsets, and buffers
+// only get rebound when the next mesh is in another one.
+// Buffers grow (by copying on the GPU) when they run out.
+// --------------------------------------------------------
+namespace GeometryArena
+{
+	// Starting size of each buffer, before any growth
+	constexpr size_t InitialBufferBytes = 4 << 20;
+
+	// Copy data into the arena (Graphics must be initialized).
+	// With null data, the range is only reserved, for Upload().
+	ArenaRange AllocateVertices(const void* data, unsigned int count, unsigned int stride);
+	ArenaRange AllocateIndices(const void* data, unsigned int count, DXGI_FORMAT format);
+
+	// Copies count elements into a range, starting "first" elements in
+	void Upload(const ArenaRange& range, unsigned int first, const void* data, unsigned int count);
+
+	// Gives a range back, so the space can be reused
+	void Free(ArenaRange& range);
+
+	// Binds the buffers the ranges are in, skipping
+	// whatever is already bound from an earlier call
+	void Bind(const ArenaRange& vertices, const ArenaRange& indices);
+
+	// Forgets what's bound, for when something outside the
+	// arena may have bound buffers (call once per frame)
+	void ResetBindings();
+
+	// Getters
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetBuffer(const ArenaRange& range);
+	ArenaStats GetStats();
+
+	// Releases every buffer, before Graphics shuts down
+	void ShutDown();
+}
@@ -0,0 +1,588 @@
+/*
+William Duprey
+12/10/24
+Geometry Codec Implementation
+*/
+
+#include "GeometryCodec.h"
+#include "SseSupport.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	///////////////////////////////////////////////////////////////////////////////
+	// -------------------------------- VERTICES ------------------------------- //
+	///////////////////////////////////////////////////////////////////////////////
+
+	// Vertices coded at a time. Every byte of the vertex gets a
+	// header of 2 bits per group, then the groups' packed deltas.
+	const size_t BlockVertices = 256;
+	const size_t GroupSize = 16;
+
+	// Bits per delta for each 2 bit group code
+	const unsigned int GroupBits[4] = { 0, 2, 4, 8 };
+
+	// Small signed deltas become small unsigned ones
+	unsigned char ZigZag(unsigned char delta)
+	{
+		return (unsigned char)((delta << 1) ^ (unsigned char)((signed char)delta >> 7));
+	}
+
+	// (The SSE path does this 16 at a time)
+#ifndef USE_SSE2
+	unsigned char UnZigZag(unsigned char value)
+	{
+		return (unsigned char)((value >> 1) ^ (unsigned char)(0 - (value & 1)));
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Packs 16 values at the smallest width that fits them
+	// all, lowest bits first. Returns the group's code.
+	// --------------------------------------------------------
+	unsigned int PackGroup(std::vector<unsigned char>& out, const unsigned char* values)
+	{
+		unsigned char all = 0;
+		for (size_t i = 0; i < GroupSize; i++)
+			all |= values[i];
+
+		unsigned int code = (all == 0) ? 0 : (all < 4) ? 1 : (all < 16) ? 2 : 3;
+		unsigned int bits = GroupBits[code];
+		if (bits == 8)
+			out.insert(out.end(), values, values + GroupSize);
+		else if (bits > 0)
+		{
+			unsigned int perByte = 8 / bits;
+			for (size_t i = 0; i < GroupSize; i += perByte)
+			{
+				unsigned char packed = 0;
+				for (unsigned int j = 0; j < perByte; j++)
+					packed |= (unsigned char)(values[i + j] << (j * bits));
+				out.push_back(packed);
+			}
+		}
+		return code;
+	}
+
+	// Decoding unpacks 16 bytes of the vertex (16 streams) at a
+	// time into a tile of one row per stream, 16 deltas wide
+	const size_t TileBytes = GroupSize * GroupSize;
+
+	// --------------------------------------------------------
+	// Reverses PackGroup(), always writing all 16 values.
+	// Fails if the data runs out.
+	// --------------------------------------------------------
+	bool UnpackGroup(const unsigned char*& data, const unsigned char* end,
+		unsigned int code, unsigned char* values)
+	{
+		switch (code)
+		{
+		case 0:
+			memset(values, 0, GroupSize);
+			return true;
+
+		case 1:
+		{
+			if (end - data < 4)
+				return false;
+#ifdef USE_SSE2
+			// Each shift's masked bytes are every 4th value, so
+			// interleaving them puts the values back in order
+			uint32_t packed;
+			memcpy(&packed, data, sizeof(packed));
+			__m128i bits = _mm_cvtsi32_si128((int)packed);
+			__m128i mask = _mm_set1_epi8(3);
+			__m128i v0 = _mm_and_si128(bits, mask);
+			__m128i v1 = _mm_and_si128(_mm_srli_epi16(bits, 2), mask);
+			__m128i v2 = _mm_and_si128(_mm_srli_epi16(bits, 4), mask);
+			__m128i v3 = _mm_and_si128(_mm_srli_epi16(bits, 6), mask);
+			_mm_storeu_si128((__m128i*)values, _mm_unpacklo_epi16(
+				_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3)));
+#else
+			for (size_t i = 0; i < GroupSize; i++)
+				values[i] = (data[i / 4] >> ((i % 4) * 2)) & 3;
+#endif
+			data += 4;
+			return true;
+		}
+
+		case 2:
+		{
+			if (end - data < 8)
+				return false;
+#ifdef USE_SSE2
+			__m128i bits = _mm_loadl_epi64((const __m128i*)data);
+			__m128i mask = _mm_set1_epi8(15);
+			_mm_storeu_si128((__m128i*)values, _mm_unpacklo_epi8(
+				_mm_and_si128(bits, mask), _mm_and_si128(_mm_srli_epi16(bits, 4), mask)));
+#else
+			for (size_t i = 0; i < GroupSize; i++)
+				values[i] = (data[i / 2] >> ((i % 2) * 4)) & 15;
+#endif
+			data += 8;
+			return true;
+		}
+
+		default:
+			if (end - data < (ptrdiff_t)GroupSize)
+				return false;
+			memcpy(values, data, GroupSize);
+			data += GroupSize;
+			return true;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Turns one tile (16 byte streams, 16 deltas each) back
+	// into 16 bytes of up to 16 vertices. "last" holds those
+	// bytes of the vertex before, and gets the final vertex's.
+	//
+	// Writing all 16 bytes can spill past the vertex's end into
+	// the next one; tiles are done last to first so the next
+	// vertex's own first tile overwrites that. Nothing is ever
+	// written at or past "outEnd", though.
+	// --------------------------------------------------------
+	void SumTile(const unsigned char* tile, unsigned char* last,
+		unsigned char* out, size_t vertexSize, size_t count, const unsigned char* outEnd)
+	{
+		unsigned char values[GroupSize];
+#ifdef USE_SSE2
+		// Interleaving row i with row i + 8, four times over,
+		// is a full 16x16 transpose
+		__m128i a[16];
+		__m128i b[16];
+		for (size_t i = 0; i < 16; i++)
+			a[i] = _mm_loadu_si128((const __m128i*)(tile + i * 16));
+		for (size_t pass = 0; pass < 4; pass += 2)
+		{
+			for (size_t i = 0; i < 8; i++)
+			{
+				b[i * 2 + 0] = _mm_unpacklo_epi8(a[i], a[i + 8]);
+				b[i * 2 + 1] = _mm_unpackhi_epi8(a[i], a[i + 8]);
+			}
+			for (size_t i = 0; i < 8; i++)
+			{
+				a[i * 2 + 0] = _mm_unpacklo_epi8(b[i], b[i + 8]);
+				a[i * 2 + 1] = _mm_unpackhi_epi8(b[i], b[i + 8]);
+			}
+		}
+
+		// Then each vertex is the last plus its unzigzagged
+		// deltas: (d >> 1) ^ -(d & 1), with no 8 bit shifts in SSE2
+		__m128i low7 = _mm_set1_epi8(0x7F);
+		__m128i one = _mm_set1_epi8(1);
+		__m128i sum = _mm_loadu_si128((const __m128i*)last);
+		for (size_t i = 0; i < count; i++)
+		{
+			__m128i half = _mm_and_si128(_mm_srli_epi16(a[i], 1), low7);
+			__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(a[i], one));
+			sum = _mm_add_epi8(sum, _mm_xor_si128(half, sign));
+			_mm_storeu_si128((__m128i*)values, sum);
+#else
+		memcpy(values, last, GroupSize);
+		for (size_t i = 0; i < count; i++)
+		{
+			for (size_t k = 0; k < GroupSize; k++)
+				values[k] += UnZigZag(tile[k * GroupSize + i]);
+#endif
+			unsigned char* vertex = out + i * vertexSize;
+			if (outEnd - vertex >= (ptrdiff_t)GroupSize)
+				memcpy(vertex, values, GroupSize);
+			else
+				memcpy(vertex, values, outEnd - vertex);
+		}
+#ifdef USE_SSE2
+		_mm_storeu_si128((__m128i*)last, sum);
+#else
+		memcpy(last, values, GroupSize);
+#endif
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// -------------------------------- INDICES -------------------------------- //
+	///////////////////////////////////////////////////////////////////////////////
+
+	// Codes for one vertex of a triangle (4 bits):
+	//  - 0: the next vertex never used before
+	//  - 1 to 13: in the vertex FIFO, this many back (1 = newest)
+	//  - 14: a varint delta from the last explicit vertex
+	const unsigned int NextCode = 0;
+	const unsigned int MaxFifoCode = 13;
+	const unsigned int ExplicitCode = 14;
+
+	// A triangle's code byte has the edge FIFO distance (0 to
+	// 14) in its high 4 bits, and its third vertex's code in the
+	// low 4. NoEdge in the high bits means it shares no edge,
+	// the low 4 bits code its first vertex, and one more byte in
+	// the data codes the other two.
+	const unsigned int MaxEdgeDistance = 14;
+	const unsigned int NoEdge = 15;
+
+	const unsigned int FifoSize = 16;	// Power of two
+	const unsigned int InvalidIndex = ~0u;
+
+	// --------------------------------------------------------
+	// What the encoder and decoder both track, updated the
+	// exact same way by both, so codes can refer to it
+	// --------------------------------------------------------
+	struct IndexState
+	{
+		// Edges are stored reversed, the way a neighboring
+		// triangle with the same winding would walk them
+		unsigned int Edges[FifoSize][2];
+		unsigned int EdgeHead;
+		unsigned int Vertices[FifoSize];
+		unsigned int VertexHead;
+		unsigned int Next;		// Next vertex never used before
+		unsigned int Last;		// Last explicitly coded vertex
+
+		IndexState() : EdgeHead(0), VertexHead(0), Next(0), Last(0)
+		{
+			for (unsigned int i = 0; i < FifoSize; i++)
+			{
+				Edges[i][0] = Edges[i][1] = InvalidIndex;
+				Vertices[i] = InvalidIndex;
+			}
+		}
+
+		void PushEdge(unsigned int a, unsigned int b)
+		{
+			Edges[EdgeHead & (FifoSize - 1)][0] = a;
+			Edges[EdgeHead & (FifoSize - 1)][1] = b;
+			EdgeHead++;
+		}
+
+		void PushVertex(unsigned int v)
+		{
+			Vertices[VertexHead & (FifoSize - 1)] = v;
+			VertexHead++;
+		}
+
+		// After a triangle (a, b, c), its reversed edges
+		void PushTriangleEdges(unsigned int a, unsigned int b, unsigned int c)
+		{
+			PushEdge(b, a);
+			PushEdge(c, b);
+			PushEdge(a, c);
+		}
+	};
+
+	// Reads an index of either size
+	unsigned int LoadIndex(const void* indices, size_t i, size_t indexSize)
+	{
+		return (indexSize == sizeof(uint16_t))
+			? ((const uint16_t*)indices)[i]
+			: ((const uint32_t*)indices)[i];
+	}
+
+	void WriteVarint(std::vector<unsigned char>& out, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+
+	bool ReadVarint(const unsigned char*& data, const unsigned char* end, uint32_t& value)
+	{
+		value = 0;
+		for (unsigned int shift = 0; shift < 35; shift += 7)
+		{
+			if (data == end)
+				return false;
+			unsigned char byte = *data++;
+			value |= (uint32_t)(byte & 0x7F) << shift;
+			if (byte < 0x80)
+				return true;
+		}
+		return false;
+	}
+
+	// --------------------------------------------------------
+	// Codes one vertex, writing its delta to "data" if it
+	// needs one, and updates the state
+	// --------------------------------------------------------
+	unsigned int EncodeVertex(IndexState& state, unsigned int v, std::vector<unsigned char>& data)
+	{
+		if (v == state.Next)
+		{
+			state.Next++;
+			state.PushVertex(v);
+			return NextCode;
+		}
+
+		for (unsigned int code = 1; code <= MaxFifoCode; code++)
+		{
+			if (state.Vertices[(state.VertexHead - code) & (FifoSize - 1)] == v)
+				return code;
+		}
+
+		int32_t delta = (int32_t)(v - state.Last);
+		WriteVarint(data, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+		state.Last = v;
+		state.PushVertex(v);
+		return ExplicitCode;
+	}
+
+	// --------------------------------------------------------
+	// The rare (and slow) part of DecodeVertex(), kept out of
+	// it so the common part can be inlined
+	// --------------------------------------------------------
+	bool DecodeExplicitVertex(IndexState& state,
+		const unsigned char*& data, const unsigned char* end, unsigned int& v)
+	{
+		uint32_t zigzag;
+		if (!ReadVarint(data, end, zigzag))
+			return false;
+		v = state.Last + ((zigzag >> 1) ^ (0u - (zigzag & 1)));
+		state.Last = v;
+		state.PushVertex(v);
+		return true;
+	}
+
+	inline bool DecodeVertex(IndexState& state, unsigned int code,
+		const unsigned char*& data, const unsigned char* end, unsigned int& v)
+	{
+		if (code == NextCode)
+		{
+			v = state.Next++;
+			state.PushVertex(v);
+			return true;
+		}
+		if (code <= MaxFifoCode)
+		{
+			v = state.Vertices[(state.VertexHead - code) & (FifoSize - 1)];
+			return true;
+		}
+		return code == ExplicitCode && DecodeExplicitVertex(state, data, end, v);
+	}
+
+	// --------------------------------------------------------
+	// GeometryCodec::DecodeIndices() for one index size, so
+	// there's no size check per triangle
+	// --------------------------------------------------------
+	template<typename Index>
+	bool DecodeTriangles(Index* out, size_t triangleCount, size_t vertexCount,
+		const unsigned char* data, size_t size)
+	{
+		if (size < triangleCount)
+			return false;
+		const unsigned char* codes = data;
+		const unsigned char* end = data + size;
+		data += triangleCount;
+
+		IndexState state;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			unsigned int code = codes[t];
+			unsigned int a, b, c;
+			if ((code >> 4) != NoEdge)
+			{
+				const unsigned int* edge = state.Edges[(state.EdgeHead - 1 - (code >> 4)) & (FifoSize - 1)];
+				a = edge[0];
+				b = edge[1];
+				if (!DecodeVertex(state, code & 15, data, end, c))
+					return false;
+				state.PushEdge(c, b);
+				state.PushEdge(a, c);
+			}
+			else
+			{
+				if (!DecodeVertex(state, code & 15, data, end, a) || data == end)
+					return false;
+				unsigned int rest = *data++;
+				if (!DecodeVertex(state, rest >> 4, data, end, b) ||
+					!DecodeVertex(state, rest & 15, data, end, c))
+					return false;
+				state.PushTriangleEdges(a, b, c);
+			}
+
+			if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+				return false;
+			out[t * 3 + 0] = (Index)a;
+			out[t * 3 + 1] = (Index)b;
+			out[t * 3 + 2] = (Index)c;
+		}
+		return data == end;
+	}
+}
+
+// --------------------------------------------------------
+// Deltas carry over from one block to the next, so only
+// the first vertex is coded against zero
+// --------------------------------------------------------
+void GeometryCodec::EncodeVertices(std::vector<unsigned char>& out,
+	const void* vertices, size_t vertexCount, size_t vertexSize)
+{
+	const unsigned char* bytes = (const unsigned char*)vertices;
+	std::vector<unsigned char> last(vertexSize, 0);
+	unsigned char deltas[BlockVertices];
+
+	for (size_t first = 0; first < vertexCount; first += BlockVertices)
+	{
+		size_t blockCount = std::min(BlockVertices, vertexCount - first);
+		size_t groups = (blockCount + GroupSize - 1) / GroupSize;
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			unsigned char previous = last[k];
+			for (size_t i = 0; i < blockCount; i++)
+			{
+				unsigned char value = bytes[(first + i) * vertexSize + k];
+				deltas[i] = ZigZag((unsigned char)(value - previous));
+				previous = value;
+			}
+			memset(deltas + blockCount, 0, groups * GroupSize - blockCount);
+			last[k] = previous;
+
+			size_t header = out.size();
+			out.resize(out.size() + (groups + 3) / 4, 0);
+			for (size_t g = 0; g < groups; g++)
+			{
+				unsigned int code = PackGroup(out, deltas + g * GroupSize);
+				out[header + g / 4] |= (unsigned char)(code << ((g % 4) * 2));
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Each group of 16 vertices is unpacked into 16x16 tiles
+// (16 byte streams at a time) and transposed back into
+// vertex order, so summing the deltas up is a 16 byte add
+// per tile per vertex, rather than one per byte
+// --------------------------------------------------------
+bool GeometryCodec::DecodeVertices(void* destination, size_t vertexCount, size_t vertexSize,
+	const unsigned char* data, size_t size)
+{
+	unsigned char* bytes = (unsigned char*)destination;
+	unsigned char* bytesEnd = bytes + vertexCount * vertexSize;
+	const unsigned char* end = data + size;
+
+	// Streams past the end of the vertex (filling out the last
+	// tile) are never unpacked, so they stay zero
+	size_t tileCount = (vertexSize + GroupSize - 1) / GroupSize;
+	size_t groupBytes = tileCount * TileBytes;
+	std::vector<unsigned char> last(tileCount * GroupSize, 0);
+	std::vector<unsigned char> tiles(BlockVertices / GroupSize * groupBytes, 0);
+
+	for (size_t first = 0; first < vertexCount; first += BlockVertices)
+	{
+		size_t blockCount = std::min(BlockVertices, vertexCount - first);
+		size_t groups = (blockCount + GroupSize - 1) / GroupSize;
+		size_t headerBytes = (groups + 3) / 4;
+
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			if ((size_t)(end - data) < headerBytes)
+				return false;
+			const unsigned char* header = data;
+			data += headerBytes;
+
+			unsigned char* row = &tiles[(k / GroupSize) * TileBytes + (k % GroupSize) * GroupSize];
+			for (size_t g = 0; g < groups; g++)
+			{
+				unsigned int code = (header[g / 4] >> ((g % 4) * 2)) & 3;
+				if (!UnpackGroup(data, end, code, row + g * groupBytes))
+					return false;
+			}
+		}
+
+		for (size_t g = 0; g < groups; g++)
+		{
+			size_t count = std::min(GroupSize, blockCount - g * GroupSize);
+			unsigned char* out = bytes + (first + g * GroupSize) * vertexSize;
+			for (size_t t = tileCount; t-- > 0;)
+			{
+				SumTile(&tiles[g * groupBytes + t * TileBytes], &last[t * GroupSize],
+					out + t * GroupSize, vertexSize, count, bytesEnd);
+			}
+		}
+	}
+	return data == end;
+}
+
+// --------------------------------------------------------
+// The code bytes (one per triangle) come first, then the
+// data (extra code bytes and varints) in triangle order
+// --------------------------------------------------------
+void GeometryCodec::EncodeIndices(std::vector<unsigned char>& out,
+	const void* indices, size_t indexCount, size_t indexSize)
+{
+	size_t triangleCount = indexCount / 3;
+	std::vector<unsigned char> codes;
+	std::vector<unsigned char> data;
+	std::vector<unsigned char> rest;
+	codes.reserve(triangleCount);
+
+	IndexState state;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned int tri[3] = {
+			LoadIndex(indices, t * 3 + 0, indexSize),
+			LoadIndex(indices, t * 3 + 1, indexSize),
+			LoadIndex(indices, t * 3 + 2, indexSize) };
+
+		// Rotated so a shared edge (if there is one) comes first
+		unsigned int distance = NoEdge;
+		unsigned int rotation = 0;
+		for (unsigned int r = 0; r < 3 && distance == NoEdge; r++)
+		{
+			unsigned int a = tri[r];
+			unsigned int b = tri[(r + 1) % 3];
+			for (unsigned int d = 0; d <= MaxEdgeDistance; d++)
+			{
+				const unsigned int* edge = state.Edges[(state.EdgeHead - 1 - d) & (FifoSize - 1)];
+				if (edge[0] == a && edge[1] == b)
+				{
+					distance = d;
+					rotation = r;
+					break;
+				}
+			}
+		}
+
+		if (distance != NoEdge)
+		{
+			unsigned int a = tri[rotation];
+			unsigned int b = tri[(rotation + 1) % 3];
+			unsigned int c = tri[(rotation + 2) % 3];
+			unsigned int code = EncodeVertex(state, c, data);
+			codes.push_back((unsigned char)((distance << 4) | code));
+			state.PushEdge(c, b);
+			state.PushEdge(a, c);
+		}
+		else
+		{
+			// The second and third vertex's codes go in the data
+			// before their own varints, so those wait in "rest"
+			codes.push_back((unsigned char)((NoEdge << 4) | EncodeVertex(state, tri[0], data)));
+			rest.clear();
+			unsigned int codeB = EncodeVertex(state, tri[1], rest);
+			unsigned int codeC = EncodeVertex(state, tri[2], rest);
+			data.push_back((unsigned char)((codeB << 4) | codeC));
+			data.insert(data.end(), rest.begin(), rest.end());
+			state.PushTriangleEdges(tri[0], tri[1], tri[2]);
+		}
+	}
+
+	out.insert(out.end(), codes.begin(), codes.end());
+	out.insert(out.end(), data.begin(), data.end());
+}
+
+bool GeometryCodec::DecodeIndices(void* destination, size_t indexCount, size_t indexSize,
+	size_t vertexCount, const unsigned char* data, size_t size)
+{
+	if (indexCount % 3 != 0)
+		return false;
+	if (indexSize == sizeof(uint16_t))
+		return DecodeTriangles((uint16_t*)destination, indexCount / 3, vertexCount, data, size);
+	if (indexSize == sizeof(uint32_t))
+		return DecodeTriangles((uint32_t*)destination, indexCount / 3, vertexCount, data, size);
+	return false;
+}
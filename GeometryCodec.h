@@ -0,0 +1,61 @@
+/*
+William Duprey
+12/10/24
+Geometry Codec Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// Lossless compression for vertex and index buffers, built
+// for decoding speed (over 1 GB/s on one core) so a
+// compressed mesh cache loads faster than a raw one would
+// come off the disk.
+//
+// Vertices: each byte of the vertex struct is its own
+// stream, delta coded against the same byte of the vertex
+// before it. Quantized attributes (see VertexPacking.h) of
+// neighboring vertices are close, so the zigzagged deltas
+// are small, and are bit packed 0, 2, 4 or 8 bits at a time
+// in groups of 16.
+//
+// Indices: triangles are coded against a FIFO of recently
+// seen edges and one of recently seen vertices, so most
+// triangles take one byte. Vertices that aren't in either
+// are usually the next one never used before (after vertex
+// fetch optimization), which is free to code; the rest are
+// varint deltas. Triangles may come back rotated (same
+// winding, different first corner).
+//
+// Decoding checks every read against the data's size and
+// every index against the vertex count, so corrupt data
+// never reads or writes out of bounds, or hands back an
+// index that's out of range (see tests/GeometryCodecTests).
+// --------------------------------------------------------
+namespace GeometryCodec
+{
+	// Appends the encoded vertices to "out"
+	void EncodeVertices(std::vector<unsigned char>& out,
+		const void* vertices, size_t vertexCount, size_t vertexSize);
+
+	// Fills "destination" (vertexCount * vertexSize bytes).
+	// Fails if the data runs out before vertexCount vertices, or
+	// has bytes left over. Every byte decodes to some value, so
+	// corrupt data (or a count off from what was encoded) isn't
+	// always caught, but never reads or writes out of bounds.
+	bool DecodeVertices(void* destination, size_t vertexCount, size_t vertexSize,
+		const unsigned char* data, size_t size);
+
+	// Appends the encoded indices to "out". indexSize is 2 or 4,
+	// and indexCount must be a multiple of 3.
+	void EncodeIndices(std::vector<unsigned char>& out,
+		const void* indices, size_t indexCount, size_t indexSize);
+
+	// Fills "destination" (indexCount * indexSize bytes). Fails
+	// if the data is corrupt, isn't exactly indexCount indices,
+	// or has an index of vertexCount or more.
+	bool DecodeIndices(void* destination, size_t indexCount, size_t indexSize,
+		size_t vertexCount, const unsigned char* data, size_t size);
+}
@@ -0,0 +1,700 @@
+/*
+William Duprey
+12/10/24
+glTF Parser Implementation
+*/
+
+#include "GltfParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// .glb header and chunk identifiers
+	const uint32_t GlbMagic = 0x46546C67;		// "glTF"
+	const uint32_t JsonChunk = 0x4E4F534A;		// "JSON"
+	const uint32_t BinChunk = 0x004E4942;		// "BIN\0"
+
+	// Component types (GL enums)
+	const unsigned int Byte = 5120;
+	const unsigned int UnsignedByte = 5121;
+	const unsigned int Short = 5122;
+	const unsigned int UnsignedShort = 5123;
+	const unsigned int UnsignedInt = 5125;
+	const unsigned int Float = 5126;
+
+	// Deeper than any sensible file, and keeps a malicious
+	// one from recursing until the stack runs out
+	const int MaxDepth = 64;
+
+	// --------------------------------------------------------
+	// Just enough of a JSON document model for the glTF
+	// header: numbers are doubles, and objects keep their keys
+	// in order alongside their values.
+	// --------------------------------------------------------
+	struct JsonValue
+	{
+		enum class Type { Null, Bool, Number, String, Array, Object };
+		Type Kind = Type::Null;
+		bool Bool = false;
+		double Number = 0.0;
+		std::string String;
+		std::vector<JsonValue> Items;		// Array elements, or object values
+		std::vector<std::string> Keys;		// Object keys, one per item
+
+		// Missing members and elements come back as this null
+		const JsonValue& operator[](const char* key) const;
+		const JsonValue& operator[](size_t index) const;
+
+		size_t Size() const { return Items.size(); }
+		bool IsNull() const { return Kind == Type::Null; }
+		double GetNumber(double fallback = 0.0) const { return Kind == Type::Number ? Number : fallback; }
+	};
+	const JsonValue NullValue;
+
+	const JsonValue& JsonValue::operator[](const char* key) const
+	{
+		if (Kind != Type::Object)
+			return NullValue;
+		for (size_t i = 0; i < Keys.size(); i++)
+		{
+			if (Keys[i] == key)
+				return Items[i];
+		}
+		return NullValue;
+	}
+
+	const JsonValue& JsonValue::operator[](size_t index) const
+	{
+		return (Kind == Type::Array && index < Items.size()) ? Items[index] : NullValue;
+	}
+
+	inline void SkipWhitespace(const char*& cursor, const char* end)
+	{
+		while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+			cursor++;
+	}
+
+	// --------------------------------------------------------
+	// Reads a quoted string (cursor on the opening quote).
+	// \u escapes are turned into UTF-8.
+	// --------------------------------------------------------
+	bool ParseString(const char*& cursor, const char* end, std::string& out)
+	{
+		if (cursor >= end || *cursor != '"')
+			return false;
+		cursor++;
+
+		out.clear();
+		while (cursor < end && *cursor != '"')
+		{
+			char c = *cursor++;
+			if (c != '\\')
+			{
+				out.push_back(c);
+				continue;
+			}
+			if (cursor >= end)
+				return false;
+
+			char escape = *cursor++;
+			switch (escape)
+			{
+			case 'b': out.push_back('\b'); break;
+			case 'f': out.push_back('\f'); break;
+			case 'n': out.push_back('\n'); break;
+			case 'r': out.push_back('\r'); break;
+			case 't': out.push_back('\t'); break;
+			case 'u':
+			{
+				if (end - cursor < 4)
+					return false;
+				char hex[5] = { cursor[0], cursor[1], cursor[2], cursor[3], 0 };
+				unsigned long code = strtoul(hex, nullptr, 16);
+				cursor += 4;
+				if (code < 0x80)
+					out.push_back((char)code);
+				else if (code < 0x800)
+				{
+					out.push_back((char)(0xC0 | (code >> 6)));
+					out.push_back((char)(0x80 | (code & 0x3F)));
+				}
+				else
+				{
+					out.push_back((char)(0xE0 | (code >> 12)));
+					out.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+					out.push_back((char)(0x80 | (code & 0x3F)));
+				}
+				break;
+			}
+			default: out.push_back(escape); break;	// \" \\ and \/
+			}
+		}
+		if (cursor >= end)
+			return false;
+		cursor++;
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Numbers go through strtod for full double precision
+	// (byte offsets can be bigger than a float holds exactly)
+	// --------------------------------------------------------
+	bool ParseNumber(const char*& cursor, const char* end, double& out)
+	{
+		char buffer[64];
+		size_t length = 0;
+		while (cursor + length < end && length < sizeof(buffer) - 1 &&
+			strchr("+-0123456789.eE", cursor[length]) != nullptr && cursor[length] != 0)
+		{
+			buffer[length] = cursor[length];
+			length++;
+		}
+		if (length == 0)
+			return false;
+		buffer[length] = 0;
+
+		char* parsedEnd;
+		out = strtod(buffer, &parsedEnd);
+		if (parsedEnd == buffer)
+			return false;
+		cursor += parsedEnd - buffer;
+		return true;
+	}
+
+	bool ParseLiteral(const char*& cursor, const char* end, const char* literal)
+	{
+		size_t length = strlen(literal);
+		if ((size_t)(end - cursor) < length || memcmp(cursor, literal, length) != 0)
+			return false;
+		cursor += length;
+		return true;
+	}
+
+	bool ParseValue(const char*& cursor, const char* end, JsonValue& out, int depth)
+	{
+		SkipWhitespace(cursor, end);
+		if (cursor >= end || depth > MaxDepth)
+			return false;
+
+		char c = *cursor;
+		if (c == '{' || c == '[')
+		{
+			bool isObject = (c == '{');
+			char close = isObject ? '}' : ']';
+			out.Kind = isObject ? JsonValue::Type::Object : JsonValue::Type::Array;
+			cursor++;
+
+			SkipWhitespace(cursor, end);
+			if (cursor < end && *cursor == close)
+			{
+				cursor++;
+				return true;
+			}
+
+			while (true)
+			{
+				if (isObject)
+				{
+					SkipWhitespace(cursor, end);
+					out.Keys.emplace_back();
+					if (!ParseString(cursor, end, out.Keys.back()))
+						return false;
+					SkipWhitespace(cursor, end);
+					if (cursor >= end || *cursor != ':')
+						return false;
+					cursor++;
+				}
+
+				out.Items.emplace_back();
+				if (!ParseValue(cursor, end, out.Items.back(), depth + 1))
+					return false;
+
+				SkipWhitespace(cursor, end);
+				if (cursor >= end)
+					return false;
+				if (*cursor == ',')
+				{
+					cursor++;
+					continue;
+				}
+				if (*cursor != close)
+					return false;
+				cursor++;
+				return true;
+			}
+		}
+		if (c == '"')
+		{
+			out.Kind = JsonValue::Type::String;
+			return ParseString(cursor, end, out.String);
+		}
+		if (c == 't' || c == 'f')
+		{
+			out.Kind = JsonValue::Type::Bool;
+			out.Bool = (c == 't');
+			return ParseLiteral(cursor, end, out.Bool ? "true" : "false");
+		}
+		if (c == 'n')
+			return ParseLiteral(cursor, end, "null");
+
+		out.Kind = JsonValue::Type::Number;
+		return ParseNumber(cursor, end, out.Number);
+	}
+
+	// --------------------------------------------------------
+	// A JSON number used as an index, or -1 (which every
+	// lookup treats as missing) if it isn't a valid one
+	// --------------------------------------------------------
+	size_t ToIndex(const JsonValue& value)
+	{
+		double number = value.GetNumber(-1.0);
+		return (number >= 0.0 && number < 4294967296.0) ? (size_t)number : (size_t)-1;
+	}
+
+	// --------------------------------------------------------
+	// A JSON number used as a count, offset or length, checked
+	// like an index. Missing ones are the fallback.
+	// --------------------------------------------------------
+	size_t ToSize(const JsonValue& value, size_t fallback)
+	{
+		return value.IsNull() ? fallback : ToIndex(value);
+	}
+
+	uint32_t ReadUint32(const char* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	unsigned int ComponentSize(unsigned int componentType)
+	{
+		switch (componentType)
+		{
+		case Byte: case UnsignedByte: return 1;
+		case Short: case UnsignedShort: return 2;
+		case UnsignedInt: case Float: return 4;
+		default: return 0;
+		}
+	}
+
+	unsigned int ComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	// --------------------------------------------------------
+	// Everything needed to turn JSON indices into accessors
+	// --------------------------------------------------------
+	struct GltfDocument
+	{
+		JsonValue Json;
+		const unsigned char* Bin = nullptr;
+		size_t BinSize = 0;
+	};
+
+	// --------------------------------------------------------
+	// Builds a view of an accessor, checking that every element
+	// lies inside its buffer view, and the view inside the
+	// binary chunk. Sparse accessors, and buffers other than
+	// the .glb's own, aren't supported.
+	// --------------------------------------------------------
+	bool MakeAccessor(const GltfDocument& doc, const JsonValue& index, GltfAccessor& out)
+	{
+		out = GltfAccessor();
+		if (index.IsNull())
+			return true;
+
+		const JsonValue& accessor = doc.Json["accessors"][ToIndex(index)];
+		const JsonValue& view = doc.Json["bufferViews"][ToIndex(accessor["bufferView"])];
+		if (accessor.IsNull() || view.IsNull() || !accessor["sparse"].IsNull())
+			return false;
+
+		const JsonValue& buffer = doc.Json["buffers"][ToIndex(view["buffer"])];
+		if (buffer.IsNull() || !buffer["uri"].IsNull() || !doc.Bin)
+			return false;
+
+		out.ComponentType = (unsigned int)ToIndex(accessor["componentType"]);
+		out.Components = ComponentCount(accessor["type"].String);
+		out.Normalized = accessor["normalized"].Bool;
+		out.Count = ToIndex(accessor["count"]);
+		size_t elementSize = (size_t)ComponentSize(out.ComponentType) * out.Components;
+		if (elementSize == 0)
+			return false;
+
+		// A stride given by the file has to be a multiple of 4,
+		// up to 252, and fit a whole element. Without one, the
+		// elements are tightly packed.
+		const size_t Invalid = (size_t)-1;
+		size_t viewOffset = ToSize(view["byteOffset"], 0);
+		size_t viewLength = ToIndex(view["byteLength"]);
+		size_t accessorOffset = ToSize(accessor["byteOffset"], 0);
+		out.Stride = ToSize(view["byteStride"], elementSize);
+		if (out.Count == Invalid || viewOffset == Invalid || viewLength == Invalid ||
+			accessorOffset == Invalid || out.Stride == Invalid ||
+			(!view["byteStride"].IsNull() && (out.Stride % 4 != 0 || out.Stride > 252)) ||
+			out.Stride < elementSize)
+			return false;
+
+		// Written so nothing can overflow, however big the values
+		if (viewOffset > doc.BinSize || viewLength > doc.BinSize - viewOffset ||
+			accessorOffset > viewLength ||
+			(out.Count > 0 && (elementSize > viewLength - accessorOffset ||
+				out.Count - 1 > (viewLength - accessorOffset - elementSize) / out.Stride)))
+			return false;
+
+		out.Data = doc.Bin + viewOffset + accessorOffset;
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Column-major 4x4 helpers, in glTF's own convention
+	// --------------------------------------------------------
+	void Multiply(const float a[16], const float b[16], float out[16])
+	{
+		float result[16];
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++)
+					sum += a[k * 4 + row] * b[column * 4 + k];
+				result[column * 4 + row] = sum;
+			}
+		}
+		memcpy(out, result, sizeof(result));
+	}
+
+	// --------------------------------------------------------
+	// A node's own transform: its matrix if it has one,
+	// otherwise translation * rotation * scale
+	// --------------------------------------------------------
+	void LocalTransform(const JsonValue& node, float out[16])
+	{
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.Size() == 16)
+		{
+			for (size_t i = 0; i < 16; i++)
+				out[i] = (float)matrix[i].GetNumber();
+			return;
+		}
+
+		float t[3], r[4], scale[3];
+		for (size_t i = 0; i < 3; i++)
+		{
+			t[i] = (float)node["translation"][i].GetNumber(0.0);
+			scale[i] = (float)node["scale"][i].GetNumber(1.0);
+		}
+		for (size_t i = 0; i < 4; i++)
+			r[i] = (float)node["rotation"][i].GetNumber(i == 3 ? 1.0 : 0.0);
+		float x = r[0], y = r[1], z = r[2], w = r[3];
+
+		// Rotation matrix columns from the unit quaternion,
+		// each scaled by that axis' scale
+		float rotation[9] = {
+			1 - 2 * (y * y + z * z),	2 * (x * y + z * w),		2 * (x * z - y * w),
+			2 * (x * y - z * w),		1 - 2 * (x * x + z * z),	2 * (y * z + x * w),
+			2 * (x * z + y * w),		2 * (y * z - x * w),		1 - 2 * (x * x + y * y) };
+		for (int column = 0; column < 3; column++)
+		{
+			for (int row = 0; row < 3; row++)
+				out[column * 4 + row] = rotation[column * 3 + row] * scale[column];
+			out[column * 4 + 3] = 0.0f;
+		}
+		out[12] = t[0];
+		out[13] = t[1];
+		out[14] = t[2];
+		out[15] = 1.0f;
+	}
+
+	// --------------------------------------------------------
+	// Adds every triangle primitive of a mesh, placed with
+	// the given transform. Points and lines are skipped.
+	// --------------------------------------------------------
+	bool AddMesh(const GltfDocument& doc, const JsonValue& mesh, const float transform[16],
+		std::vector<GltfPrimitive>& primitives)
+	{
+		const JsonValue& list = mesh["primitives"];
+		for (size_t i = 0; i < list.Size(); i++)
+		{
+			const JsonValue& source = list[i];
+			const JsonValue& attributes = source["attributes"];
+
+			GltfPrimitive primitive;
+			primitive.Mode = (unsigned int)ToSize(source["mode"], 4);
+			if (primitive.Mode < 4 || primitive.Mode > 6 || attributes["POSITION"].IsNull())
+				continue;
+
+			if (!MakeAccessor(doc, attributes["POSITION"], primitive.Positions) ||
+				!MakeAccessor(doc, attributes["NORMAL"], primitive.Normals) ||
+				!MakeAccessor(doc, attributes["TEXCOORD_0"], primitive.UVs) ||
+				!MakeAccessor(doc, source["indices"], primitive.Indices))
+				return false;
+
+			// Attributes must line up with the positions, and
+			// indices must be a scalar integer type
+			const GltfAccessor& indices = primitive.Indices;
+			if ((primitive.Normals.Data && primitive.Normals.Count != primitive.Positions.Count) ||
+				(primitive.UVs.Data && primitive.UVs.Count != primitive.Positions.Count) ||
+				(indices.Data && (indices.Components != 1 || indices.ComponentType == Byte ||
+					indices.ComponentType == Short || indices.ComponentType == Float)))
+				return false;
+
+			memcpy(primitive.Transform, transform, sizeof(primitive.Transform));
+			primitives.push_back(primitive);
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Places a node and all of its children. Nodes should form
+	// trees, so visiting more nodes than there are means the
+	// file has a cycle (or shares children) and is rejected.
+	// --------------------------------------------------------
+	bool AddNode(const GltfDocument& doc, size_t nodeIndex, const float parent[16],
+		std::vector<GltfPrimitive>& primitives, int depth, size_t& visitsLeft)
+	{
+		const JsonValue& node = doc.Json["nodes"][nodeIndex];
+		if (node.IsNull() || depth > MaxDepth || visitsLeft == 0)
+			return false;
+		visitsLeft--;
+
+		float local[16];
+		float world[16];
+		LocalTransform(node, local);
+		Multiply(parent, local, world);
+
+		const JsonValue& mesh = node["mesh"];
+		if (!mesh.IsNull() && !AddMesh(doc, doc.Json["meshes"][ToIndex(mesh)], world, primitives))
+			return false;
+
+		const JsonValue& children = node["children"];
+		for (size_t i = 0; i < children.Size(); i++)
+		{
+			if (!AddNode(doc, ToIndex(children[i]), world, primitives, depth + 1, visitsLeft))
+				return false;
+		}
+		return true;
+	}
+}
+
+
+// --------------------------------------------------------
+// Reads the header and both chunks, then walks the scene.
+// The binary chunk is never copied: accessors point into it.
+// --------------------------------------------------------
+bool GltfParser::ParseMemory(const char* data, size_t size, std::vector<GltfPrimitive>& primitives)
+{
+	primitives.clear();
+	if (!data || size < 20 || ReadUint32(data) != GlbMagic || ReadUint32(data + 4) != 2)
+		return false;
+	size = std::min<size_t>(size, ReadUint32(data + 8));
+
+	// The JSON chunk is always first, then an optional binary one
+	GltfDocument doc;
+	const char* json = nullptr;
+	size_t jsonSize = 0;
+	size_t offset = 12;
+	while (offset + 8 <= size)
+	{
+		size_t length = ReadUint32(data + offset);
+		uint32_t type = ReadUint32(data + offset + 4);
+		const char* chunk = data + offset + 8;
+		if (length > size - offset - 8)
+			return false;
+
+		if (type == JsonChunk && !json)
+		{
+			json = chunk;
+			jsonSize = length;
+		}
+		else if (type == BinChunk && !doc.Bin)
+		{
+			doc.Bin = (const unsigned char*)chunk;
+			doc.BinSize = length;
+		}
+		offset += 8 + length;
+	}
+
+	const char* cursor = json;
+	if (!json || !ParseValue(cursor, json + jsonSize, doc.Json, 0) ||
+		doc.Json.Kind != JsonValue::Type::Object)
+		return false;
+
+	// Anything the file says it can't be read without
+	// (like Draco compression) has to be understood
+	const JsonValue& required = doc.Json["extensionsRequired"];
+	for (size_t i = 0; i < required.Size(); i++)
+	{
+		if (required[i].String != "KHR_mesh_quantization")
+			return false;
+	}
+
+	const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	const JsonValue& defaultScene = doc.Json["scene"];
+	const JsonValue& scene = doc.Json["scenes"][defaultScene.IsNull() ? 0 : ToIndex(defaultScene)];
+	if (scene.IsNull())
+	{
+		// No scenes: every mesh, exactly as stored
+		const JsonValue& meshes = doc.Json["meshes"];
+		for (size_t i = 0; i < meshes.Size(); i++)
+		{
+			if (!AddMesh(doc, meshes[i], identity, primitives))
+				return false;
+		}
+		return true;
+	}
+
+	const JsonValue& roots = scene["nodes"];
+	size_t visitsLeft = doc.Json["nodes"].Size();
+	for (size_t i = 0; i < roots.Size(); i++)
+	{
+		if (!AddNode(doc, ToIndex(roots[i]), identity, primitives, 0, visitsLeft))
+			return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Strips and fans are unrolled, keeping the winding of
+// each triangle. Triangles using a vertex that doesn't
+// exist are dropped.
+// --------------------------------------------------------
+void GltfParser::ReadTriangles(const GltfPrimitive& primitive, unsigned int baseVertex,
+	std::vector<unsigned int>& indices)
+{
+	const GltfAccessor& source = primitive.Indices;
+	size_t count = source.Data ? source.Count : primitive.Positions.Count;
+	auto corner = [&](size_t i) { return source.Data ? source.ReadIndex(i) : (unsigned int)i; };
+
+	size_t triangles = 0;
+	switch (primitive.Mode)
+	{
+	case 4: triangles = count / 3; break;
+	case 5: case 6: triangles = count >= 3 ? count - 2 : 0; break;
+	}
+	indices.reserve(indices.size() + triangles * 3);
+
+	for (size_t t = 0; t < triangles; t++)
+	{
+		unsigned int a, b, c;
+		if (primitive.Mode == 4)
+		{
+			a = corner(t * 3);
+			b = corner(t * 3 + 1);
+			c = corner(t * 3 + 2);
+		}
+		else if (primitive.Mode == 5)
+		{
+			// Every other strip triangle is wound backwards
+			a = corner(t);
+			b = corner(t + 1 + t % 2);
+			c = corner(t + 2 - t % 2);
+		}
+		else
+		{
+			a = corner(t + 1);
+			b = corner(t + 2);
+			c = corner(0);
+		}
+
+		if (a >= primitive.Positions.Count || b >= primitive.Positions.Count ||
+			c >= primitive.Positions.Count)
+			continue;
+		indices.push_back(baseVertex + a);
+		indices.push_back(baseVertex + b);
+		indices.push_back(baseVertex + c);
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ---------------------------- GLTF ACCESSOR ------------------------------ //
+///////////////////////////////////////////////////////////////////////////////
+// --------------------------------------------------------
+// Normalized integers map to [0, 1] (unsigned) or [-1, 1]
+// (signed) as the glTF spec says; everything else is cast
+// --------------------------------------------------------
+void GltfAccessor::Read(size_t index, float* out, unsigned int maxComponents) const
+{
+	const unsigned char* element = Data + Stride * index;
+	unsigned int count = std::min(Components, maxComponents);
+	if (ComponentType == Float)
+	{
+		memcpy(out, element, sizeof(float) * count);
+		return;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float value = 0.0f;
+		switch (ComponentType)
+		{
+		case Byte:
+		{
+			int8_t v;
+			memcpy(&v, element + i, 1);
+			value = Normalized ? std::max(v / 127.0f, -1.0f) : v;
+			break;
+		}
+		case UnsignedByte:
+			value = Normalized ? element[i] / 255.0f : element[i];
+			break;
+		case Short:
+		{
+			int16_t v;
+			memcpy(&v, element + i * 2, 2);
+			value = Normalized ? std::max(v / 32767.0f, -1.0f) : v;
+			break;
+		}
+		case UnsignedShort:
+		{
+			uint16_t v;
+			memcpy(&v, element + i * 2, 2);
+			value = Normalized ? v / 65535.0f : v;
+			break;
+		}
+		case UnsignedInt:
+		{
+			uint32_t v;
+			memcpy(&v, element + i * 4, 4);
+			value = (float)v;
+			break;
+		}
+		}
+		out[i] = value;
+	}
+}
+
+unsigned int GltfAccessor::ReadIndex(size_t index) const
+{
+	const unsigned char* element = Data + Stride * index;
+	switch (ComponentType)
+	{
+	case UnsignedByte:
+		return element[0];
+	case UnsignedShort:
+	{
+		uint16_t v;
+		memcpy(&v, element, 2);
+		return v;
+	}
+	default:
+	{
+		uint32_t v;
+		memcpy(&v, element, 4);
+		return v;
+	}
+	}
+}
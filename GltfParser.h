@@ -0,0 +1,76 @@
+/*
+William Duprey
+12/10/24
+glTF Parser Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// A view of one glTF accessor, pointing straight into the
+// file's binary chunk. Nothing is copied or converted until
+// an element is read, and reading float data is a memcpy.
+// --------------------------------------------------------
+struct GltfAccessor
+{
+	const unsigned char* Data = nullptr;	// First element, null if missing
+	size_t Stride = 0;						// Bytes from one element to the next
+	size_t Count = 0;
+	unsigned int ComponentType = 0;			// GL enum (5120 - 5126)
+	unsigned int Components = 0;			// 1 for SCALAR, up to 4 for VEC4
+	bool Normalized = false;
+
+	// Converts one element to floats (quantized data included),
+	// filling in at most maxComponents of them
+	void Read(size_t index, float* out, unsigned int maxComponents) const;
+
+	// One element of an index accessor
+	unsigned int ReadIndex(size_t index) const;
+};
+
+// --------------------------------------------------------
+// One drawable piece of a glTF mesh, placed in the scene by
+// its node. Faces are always a triangle list once read
+// through GltfParser::ReadTriangles().
+// --------------------------------------------------------
+struct GltfPrimitive
+{
+	GltfAccessor Positions;
+	GltfAccessor Normals;		// Optional
+	GltfAccessor UVs;			// TEXCOORD_0, optional
+	GltfAccessor Indices;		// Optional (non-indexed if missing)
+	unsigned int Mode;			// 4 = triangles, 5 = strip, 6 = fan
+
+	// Node to scene transform, column-major like glTF's own
+	// (so it's already row-major for row vectors)
+	float Transform[16];
+};
+
+// --------------------------------------------------------
+// A small .glb (binary glTF 2.0) reader for mesh data only.
+// The JSON chunk is parsed into primitives whose accessors
+// point into the binary chunk, so the file can be mapped and
+// read in place. Materials, animation and so on are skipped.
+//
+// Supports every component type (including the quantized
+// attributes of KHR_mesh_quantization), interleaved buffer
+// views, node hierarchies and triangle lists, strips and
+// fans. External or embedded-URI buffers, sparse accessors
+// and compression extensions are not supported, and make
+// parsing fail.
+// --------------------------------------------------------
+namespace GltfParser
+{
+	// Finds every primitive of every mesh in the default scene
+	// (or every mesh, if there are no scenes). The primitives
+	// point into "data", which must outlive them.
+	bool ParseMemory(const char* data, size_t size, std::vector<GltfPrimitive>& primitives);
+
+	// Appends a primitive's faces as a triangle list, with
+	// indices offset by baseVertex
+	void ReadTriangles(const GltfPrimitive& primitive, unsigned int baseVertex,
+		std::vector<unsigned int>& indices);
+}
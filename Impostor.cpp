@@ -0,0 +1,225 @@
+/*
+William Duprey
+12/10/24
+Impostor Implementation
+*/
+
+#include "Impostor.h"
+#include "Graphics.h"
+
+#include <wincodec.h>
+
+using namespace DirectX;
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// Decodes an image file to RGBA8 in memory with WIC (the
+	// same decoder WICTextureLoader uses, minus the upload),
+	// so the baker can sample it without a GPU
+	// --------------------------------------------------------
+	bool LoadImageRGBA(const wchar_t* file, ImpostorImage& image)
+	{
+		image = ImpostorImage();
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+		if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+			IID_PPV_ARGS(factory.GetAddressOf()))))
+			return false;
+		if (FAILED(factory->CreateDecoderFromFilename(file, nullptr, GENERIC_READ,
+			WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())))
+			return false;
+		if (FAILED(decoder->GetFrame(0, frame.GetAddressOf())) ||
+			FAILED(factory->CreateFormatConverter(converter.GetAddressOf())) ||
+			FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA,
+				WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+			return false;
+
+		UINT width = 0, height = 0;
+		converter->GetSize(&width, &height);
+		std::vector<uint8_t> pixels((size_t)width * height * 4);
+		if (pixels.empty() || FAILED(converter->CopyPixels(nullptr, width * 4,
+			(UINT)pixels.size(), pixels.data())))
+			return false;
+
+		image.Width = width;
+		image.Height = height;
+		image.Channels = 4;
+		image.Pixels.swap(pixels);
+		return true;
+	}
+}
+
+// --------------------------------------------------------
+// Constructor for an Impostor. Bakes the atlases right away
+// (on as many threads as are worth it), then uploads them.
+// If the mesh didn't keep what the baker needs, nothing is
+// baked and IsBaked() says so.
+// --------------------------------------------------------
+Impostor::Impostor(std::shared_ptr<Mesh> mesh,
+	std::shared_ptr<Material> material,
+	const wchar_t* albedoFile,
+	std::shared_ptr<SimpleVertexShader> _impostorVS,
+	std::shared_ptr<SimplePixelShader> _impostorPS,
+	ImpostorSettings _settings)
+	: settings(_settings),
+	  center(0, 0, 0),
+	  radius(0.0f),
+	  bakeTime(0.0f),
+	  memoryBytes(0),
+	  atlasSize(0),
+	  impostorVS(_impostorVS),
+	  impostorPS(_impostorPS)
+{
+	const std::vector<Vertex>& vertices = mesh->GetGeometryVertices();
+	const std::vector<UINT>& indices = mesh->GetGeometryIndices();
+	if (vertices.empty() || indices.empty() || !mesh->GetBvh().IsBuilt())
+		return;
+
+	ImpostorImage albedo;
+	if (albedoFile)
+		LoadImageRGBA(albedoFile, albedo);
+
+	// --- Bake ---
+	const BoundingVolumes& bounds = mesh->GetBounds();
+	XMFLOAT3 tint = material->GetColorTint();
+	XMFLOAT2 uvScale = material->GetUVScale();
+	XMFLOAT2 uvOffset = material->GetUVOffset();
+
+	ImpostorSource source = {};
+	source.Bvh = &mesh->GetBvh();
+	source.Positions = &vertices[0].Position.x;
+	source.Normals = &vertices[0].Normal.x;
+	source.UVs = &vertices[0].UV.x;
+	source.VertexCount = vertices.size();
+	source.VertexStride = sizeof(Vertex);
+	source.Indices = indices.data();
+	source.IndexCount = indices.size();
+	for (int a = 0; a < 3; a++)
+		source.Center[a] = bounds.SphereCenter[a];
+	source.Radius = bounds.SphereRadius;
+	source.Albedo = albedo.Pixels.empty() ? nullptr : &albedo;
+	source.ColorTint[0] = tint.x;
+	source.ColorTint[1] = tint.y;
+	source.ColorTint[2] = tint.z;
+	source.UVScale[0] = uvScale.x;
+	source.UVScale[1] = uvScale.y;
+	source.UVOffset[0] = uvOffset.x;
+	source.UVOffset[1] = uvOffset.y;
+
+	ImpostorAtlas atlas;
+	if (!ImpostorBaker::Bake(source, settings, atlas))
+		return;
+
+	center = XMFLOAT3(atlas.Center);
+	radius = atlas.Radius;
+	bakeTime = atlas.BakeTime;
+	atlasSize = atlas.Albedo.Width;
+	memoryBytes = atlas.Albedo.Pixels.size() + atlas.Normal.Pixels.size() + atlas.Depth.Pixels.size();
+
+	// --- Upload ---
+	albedoSRV = CreateAtlas(atlas.Albedo);
+	normalSRV = CreateAtlas(atlas.Normal);
+	depthSRV = CreateAtlas(atlas.Depth);
+
+	// Clamped, so the edge frames don't wrap around
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	Graphics::Device->CreateSamplerState(&samplerDesc, atlasSampler.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Draws the impostor's quad. Six vertices made up in the
+// vertex shader from SV_VertexID, so there's no vertex
+// buffer to bind (whatever's bound is left alone).
+// --------------------------------------------------------
+void Impostor::Draw(std::shared_ptr<Transform> transform,
+	const BoundingVolumes& worldBounds,
+	std::shared_ptr<Camera> camera)
+{
+	if (!IsBaked())
+		return;
+
+	XMFLOAT3 cameraPosition = camera->GetTransform()->GetPosition();
+	XMFLOAT4X4 worldInvTranspose = transform->GetWorldInverseTransposeMatrix();
+
+	// --- Prepare shaders ---
+	impostorVS->SetShader();
+	impostorPS->SetShader();
+
+	// Vertex shader data
+	impostorVS->SetMatrix4x4("view", camera->GetViewMatrix());
+	impostorVS->SetMatrix4x4("projection", camera->GetProjectionMatrix());
+	impostorVS->SetMatrix4x4("worldInvTranspose", worldInvTranspose);
+	impostorVS->SetFloat3("cameraPosition", cameraPosition);
+	impostorVS->SetFloat("framesPerSide", (float)settings.FramesPerSide);
+	impostorVS->SetFloat3("worldCenter", XMFLOAT3(worldBounds.SphereCenter));
+	impostorVS->SetFloat("worldRadius", worldBounds.SphereRadius);
+	impostorVS->SetFloat3("center", center);
+	impostorVS->SetFloat("radius", radius);
+	impostorVS->CopyAllBufferData();
+
+	// Pixel shader data (lights and shadows are already set)
+	impostorPS->SetMatrix4x4("world", transform->GetWorldMatrix());
+	impostorPS->SetMatrix4x4("worldInvTranspose", worldInvTranspose);
+	impostorPS->SetMatrix4x4("view", camera->GetViewMatrix());
+	impostorPS->SetMatrix4x4("projection", camera->GetProjectionMatrix());
+	impostorPS->SetFloat3("cameraPosition", cameraPosition);
+	impostorPS->SetFloat("framesPerSide", (float)settings.FramesPerSide);
+	impostorPS->SetFloat3("center", center);
+	impostorPS->SetFloat("radius", radius);
+	impostorPS->SetShaderResourceView("Albedo", albedoSRV);
+	impostorPS->SetShaderResourceView("NormalAtlas", normalSRV);
+	impostorPS->SetShaderResourceView("DepthAtlas", depthSRV);
+	impostorPS->SetSamplerState("AtlasSampler", atlasSampler);
+	impostorPS->CopyAllBufferData();
+
+	// --- Draw the quad ---
+	Graphics::Context->Draw(6, 0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------------------------------- GETTERS --------------------------------- //
+///////////////////////////////////////////////////////////////////////////////
+bool Impostor::IsBaked() { return albedoSRV.Get() != nullptr; }
+float Impostor::GetBakeTime() { return bakeTime; }
+size_t Impostor::GetMemoryBytes() { return memoryBytes; }
+unsigned int Impostor::GetAtlasSize() { return atlasSize; }
+std::shared_ptr<SimplePixelShader> Impostor::GetPixelShader() { return impostorPS; }
+
+
+// --------------------------------------------------------
+// Creates an immutable texture holding the image, and
+// returns a shader resource view of it
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Impostor::CreateAtlas(
+	const ImpostorImage& image)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = image.Width;
+	desc.Height = image.Height;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = image.Channels == 1 ? DXGI_FORMAT_R8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = image.Pixels.data();
+	initialData.SysMemPitch = image.Width * image.Channels;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (SUCCEEDED(Graphics::Device->CreateTexture2D(&desc, &initialData, texture.GetAddressOf())))
+		Graphics::Device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf());
+	return srv;
+}
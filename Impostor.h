@@ -0,0 +1,80 @@
+/*
+William Duprey
+12/10/24
+Impostor Header
+*/
+
+#pragma once
+#include "Camera.h"
+#include "ImpostorBaker.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "SimpleShader.h"
+#include "Transform.h"
+
+#include <d3d11.h>
+#include <memory>
+#include <wrl/client.h> // Used for ComPtr
+
+// --------------------------------------------------------
+// A stand-in for a Mesh + Material when they're far away:
+// octahedral atlases of albedo, normals and depth baked on
+// the CPU (see ImpostorBaker), drawn as one camera-facing
+// quad that shows whichever baked view is closest to the
+// camera's. Depth and lighting are rebuilt per pixel, so it
+// still sits in the scene and reacts to the lights.
+//
+// Entities decide when to draw one (see GameEntity::Draw()).
+// The pixel shader takes the same lights, light matrices and
+// shadow map as the material's, set by whoever draws it.
+// --------------------------------------------------------
+class Impostor
+{
+public:
+	// Bakes from the mesh's kept geometry and BVH (so it needs
+	// MeshOptions::KeepGeometry and BuildBvh). The material's
+	// textures only exist on the GPU, so its albedo is decoded
+	// again from albedoFile; null bakes just the tint.
+	Impostor(std::shared_ptr<Mesh> mesh,
+		std::shared_ptr<Material> material,
+		const wchar_t* albedoFile,
+		std::shared_ptr<SimpleVertexShader> _impostorVS,
+		std::shared_ptr<SimplePixelShader> _impostorPS,
+		ImpostorSettings settings = ImpostorSettings());
+
+	// Draws the quad for an entity with this transform and
+	// these world space bounds (they must be for the mesh
+	// the impostor was baked from)
+	void Draw(std::shared_ptr<Transform> transform,
+		const BoundingVolumes& worldBounds,
+		std::shared_ptr<Camera> camera);
+
+	// Getters
+	bool IsBaked();
+	float GetBakeTime();		// Milliseconds
+	size_t GetMemoryBytes();	// All three atlases
+	unsigned int GetAtlasSize();
+	std::shared_ptr<SimplePixelShader> GetPixelShader();
+
+private:
+	// Everything the shaders need from the bake
+	ImpostorSettings settings;
+	DirectX::XMFLOAT3 center;
+	float radius;
+	float bakeTime;
+	size_t memoryBytes;
+	unsigned int atlasSize;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> albedoSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> normalSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> depthSRV;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> atlasSampler;
+
+	std::shared_ptr<SimpleVertexShader> impostorVS;
+	std::shared_ptr<SimplePixelShader> impostorPS;
+
+	// Uploads one baked atlas (a single mip, since mips
+	// would blur neighboring frames into each other)
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateAtlas(
+		const ImpostorImage& image);
+};
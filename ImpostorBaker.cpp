@@ -0,0 +1,416 @@
+/*
+William Duprey
+12/10/24
+Impostor Baker Implementation
+*/
+
+#include "ImpostorBaker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	void Cross(const float a[3], const float b[3], float out[3])
+	{
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	float Dot(const float a[3], const float b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void Normalize(float v[3])
+	{
+		float length = sqrtf(Dot(v, v));
+		if (length == 0.0f)
+			return;
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+
+	uint8_t ToUnorm8(float value)
+	{
+		if (value <= 0.0f)
+			return 0;
+		if (value >= 1.0f)
+			return 255;
+		return (uint8_t)(value * 255.0f + 0.5f);
+	}
+
+	// The same "gamma" the pixel shaders use (pow 2.2),
+	// rather than the exact sRGB curve
+	struct GammaTable
+	{
+		float ToLinear[256];
+
+		GammaTable()
+		{
+			for (int i = 0; i < 256; i++)
+				ToLinear[i] = powf(i / 255.0f, 2.2f);
+		}
+	};
+
+	// --------------------------------------------------------
+	// Bilinear, wrapping sample of an RGBA8 image, returned
+	// in linear space (filtered after un-gamma-correcting,
+	// which is close enough to what the GPU does for the
+	// full mesh at the sizes impostors are drawn)
+	// --------------------------------------------------------
+	void SampleLinear(const ImpostorImage& image, const GammaTable& gamma,
+		float u, float v, float color[3])
+	{
+		float x = u * image.Width - 0.5f;
+		float y = v * image.Height - 0.5f;
+		float floorX = floorf(x);
+		float floorY = floorf(y);
+		float fracX = x - floorX;
+		float fracY = y - floorY;
+
+		// Wrap both corners, handling negative coordinates
+		long long w = image.Width;
+		long long h = image.Height;
+		long long x0 = ((long long)floorX % w + w) % w;
+		long long y0 = ((long long)floorY % h + h) % h;
+		long long x1 = (x0 + 1) % w;
+		long long y1 = (y0 + 1) % h;
+
+		const uint8_t* p00 = &image.Pixels[(y0 * w + x0) * 4];
+		const uint8_t* p10 = &image.Pixels[(y0 * w + x1) * 4];
+		const uint8_t* p01 = &image.Pixels[(y1 * w + x0) * 4];
+		const uint8_t* p11 = &image.Pixels[(y1 * w + x1) * 4];
+		for (int c = 0; c < 3; c++)
+		{
+			float top = gamma.ToLinear[p00[c]] + (gamma.ToLinear[p10[c]] - gamma.ToLinear[p00[c]]) * fracX;
+			float bottom = gamma.ToLinear[p01[c]] + (gamma.ToLinear[p11[c]] - gamma.ToLinear[p01[c]]) * fracX;
+			color[c] = top + (bottom - top) * fracY;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Smears covered texels outward into empty ones, one ring
+	// per pass, without crossing into neighboring frames.
+	// Coverage (albedo alpha) is left alone, so the shader
+	// still clips exactly at the silhouette.
+	// --------------------------------------------------------
+	void DilateFrame(ImpostorAtlas& atlas, unsigned int frameX, unsigned int frameY)
+	{
+		unsigned int size = atlas.Settings.FrameSize;
+		unsigned int width = atlas.Albedo.Width;
+		size_t originX = (size_t)frameX * size;
+		size_t originY = (size_t)frameY * size;
+
+		std::vector<uint8_t> filled((size_t)size * size);
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+				filled[y * size + x] = atlas.Albedo.Pixels[((originY + y) * width + originX + x) * 4 + 3] != 0;
+		}
+
+		std::vector<uint8_t> next = filled;
+		for (unsigned int pass = 0; pass < atlas.Settings.DilationPasses; pass++)
+		{
+			bool changed = false;
+			for (unsigned int y = 0; y < size; y++)
+			{
+				for (unsigned int x = 0; x < size; x++)
+				{
+					if (filled[y * size + x])
+						continue;
+
+					// Average whichever of the 8 neighbors are filled
+					unsigned int albedo[3] = {}, normal[3] = {}, depth = 0, count = 0;
+					for (int dy = -1; dy <= 1; dy++)
+					{
+						for (int dx = -1; dx <= 1; dx++)
+						{
+							int nx = (int)x + dx;
+							int ny = (int)y + dy;
+							if (nx < 0 || ny < 0 || nx >= (int)size || ny >= (int)size || !filled[ny * size + nx])
+								continue;
+
+							size_t texel = (originY + ny) * width + originX + nx;
+							for (int c = 0; c < 3; c++)
+							{
+								albedo[c] += atlas.Albedo.Pixels[texel * 4 + c];
+								normal[c] += atlas.Normal.Pixels[texel * 4 + c];
+							}
+							depth += atlas.Depth.Pixels[texel];
+							count++;
+						}
+					}
+					if (count == 0)
+						continue;
+
+					size_t texel = (originY + y) * width + originX + x;
+					for (int c = 0; c < 3; c++)
+					{
+						atlas.Albedo.Pixels[texel * 4 + c] = (uint8_t)((albedo[c] + count / 2) / count);
+						atlas.Normal.Pixels[texel * 4 + c] = (uint8_t)((normal[c] + count / 2) / count);
+					}
+					atlas.Depth.Pixels[texel] = (uint8_t)((depth + count / 2) / count);
+					next[y * size + x] = 1;
+					changed = true;
+				}
+			}
+
+			if (!changed)
+				break;
+			filled = next;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Ray casts frames [firstFrame, lastFrame) of the atlas,
+	// one ray per texel straight through the bounding sphere,
+	// then dilates each finished frame
+	// --------------------------------------------------------
+	void BakeFrames(const ImpostorSource& source, const GammaTable& gamma,
+		ImpostorAtlas& atlas, unsigned int firstFrame, unsigned int lastFrame)
+	{
+		unsigned int framesPerSide = atlas.Settings.FramesPerSide;
+		unsigned int size = atlas.Settings.FrameSize;
+		unsigned int width = atlas.Albedo.Width;
+		float radius = source.Radius;
+
+		for (unsigned int frame = firstFrame; frame < lastFrame; frame++)
+		{
+			unsigned int frameX = frame % framesPerSide;
+			unsigned int frameY = frame / framesPerSide;
+			float direction[3], right[3], up[3];
+			ImpostorBaker::GetFrameDirection(frameX, frameY, framesPerSide, direction);
+			ImpostorBaker::GetFrameAxes(direction, right, up);
+
+			for (unsigned int y = 0; y < size; y++)
+			{
+				for (unsigned int x = 0; x < size; x++)
+				{
+					// Texel centers, spanning the sphere edge to edge
+					float offsetX = ((x + 0.5f) / size * 2.0f - 1.0f) * radius;
+					float offsetY = (1.0f - (y + 0.5f) / size * 2.0f) * radius;
+
+					// Start on the near side of the sphere, looking in
+					BvhRay ray = {};
+					for (int a = 0; a < 3; a++)
+					{
+						ray.Origin[a] = source.Center[a] + right[a] * offsetX + up[a] * offsetY + direction[a] * radius;
+						ray.Direction[a] = -direction[a];
+					}
+					ray.MinT = 0.0f;
+					ray.MaxT = radius * 2.0f;
+
+					BvhHit hit;
+					if (!source.Bvh->Intersect(ray, hit))
+						continue;
+
+					// Interpolate the hit triangle's vertex data
+					const unsigned int* corner = &source.Indices[(size_t)hit.Triangle * 3];
+					float weights[3] = { 1.0f - hit.U - hit.V, hit.U, hit.V };
+					float position[3][3] = {};
+					float normal[3] = {};
+					float uv[2] = {};
+					for (int c = 0; c < 3; c++)
+					{
+						size_t offset = source.VertexStride * corner[c];
+						const float* p = (const float*)((const char*)source.Positions + offset);
+						const float* n = (const float*)((const char*)source.Normals + offset);
+						const float* t = (const float*)((const char*)source.UVs + offset);
+						for (int a = 0; a < 3; a++)
+						{
+							position[c][a] = p[a];
+							normal[a] += n[a] * weights[c];
+						}
+						uv[0] += t[0] * weights[c];
+						uv[1] += t[1] * weights[c];
+					}
+
+					// The face normal, pointed the same way as the vertex
+					// normals, says whether this is the surface's back.
+					// Open meshes show their backs, which should then
+					// light like the front.
+					float edge1[3], edge2[3], face[3];
+					for (int a = 0; a < 3; a++)
+					{
+						edge1[a] = position[1][a] - position[0][a];
+						edge2[a] = position[2][a] - position[0][a];
+					}
+					Cross(edge1, edge2, face);
+					if (Dot(normal, normal) == 0.0f)
+						std::copy(face, face + 3, normal);
+					Normalize(normal);
+					float faceSign = Dot(face, normal) < 0.0f ? -1.0f : 1.0f;
+					if (Dot(face, direction) * faceSign < 0.0f)
+					{
+						for (int a = 0; a < 3; a++)
+							normal[a] = -normal[a];
+					}
+
+					// Surface color, tinted in linear space like the shader
+					float color[3] = { 1.0f, 1.0f, 1.0f };
+					if (source.Albedo && !source.Albedo->Pixels.empty())
+					{
+						SampleLinear(*source.Albedo, gamma,
+							uv[0] * source.UVScale[0] + source.UVOffset[0],
+							uv[1] * source.UVScale[1] + source.UVOffset[1], color);
+					}
+
+					size_t texel = ((size_t)frameY * size + y) * width + (size_t)frameX * size + x;
+					for (int c = 0; c < 3; c++)
+					{
+						atlas.Albedo.Pixels[texel * 4 + c] = ToUnorm8(powf(color[c] * source.ColorTint[c], 1.0f / 2.2f));
+						atlas.Normal.Pixels[texel * 4 + c] = ToUnorm8(normal[c] * 0.5f + 0.5f);
+					}
+					atlas.Albedo.Pixels[texel * 4 + 3] = 255;
+					atlas.Normal.Pixels[texel * 4 + 3] = 255;
+					atlas.Depth.Pixels[texel] = ToUnorm8(hit.T / ray.MaxT);
+				}
+			}
+
+			DilateFrame(atlas, frameX, frameY);
+		}
+	}
+
+	void ResetImage(ImpostorImage& image, unsigned int size, unsigned int channels)
+	{
+		image.Width = size;
+		image.Height = size;
+		image.Channels = channels;
+		image.Pixels.assign((size_t)size * size * channels, 0);
+	}
+}
+
+// --------------------------------------------------------
+// Projects the vector onto the octahedron |x|+|y|+|z| = 1,
+// then folds the lower (-Y) half over the upper half's
+// corners, like VertexPacking::EncodeOctahedral() but
+// around Y, so views from above sit in the middle
+// --------------------------------------------------------
+void ImpostorBaker::EncodeOctahedral(const float direction[3], float uv[2])
+{
+	float length = fabsf(direction[0]) + fabsf(direction[1]) + fabsf(direction[2]);
+	if (length == 0.0f)
+	{
+		uv[0] = 0.5f;
+		uv[1] = 0.5f;
+		return;
+	}
+
+	float x = direction[0] / length;
+	float z = direction[2] / length;
+	if (direction[1] < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(z)) * SignNotZero(x);
+		float foldedZ = (1.0f - fabsf(x)) * SignNotZero(z);
+		x = foldedX;
+		z = foldedZ;
+	}
+
+	uv[0] = x * 0.5f + 0.5f;
+	uv[1] = z * 0.5f + 0.5f;
+}
+
+void ImpostorBaker::DecodeOctahedral(const float uv[2], float direction[3])
+{
+	float x = uv[0] * 2.0f - 1.0f;
+	float z = uv[1] * 2.0f - 1.0f;
+	float y = 1.0f - fabsf(x) - fabsf(z);
+
+	// Unfold the lower half
+	float t = y < 0.0f ? -y : 0.0f;
+	x += x >= 0.0f ? -t : t;
+	z += z >= 0.0f ? -t : t;
+
+	direction[0] = x;
+	direction[1] = y;
+	direction[2] = z;
+	Normalize(direction);
+}
+
+void ImpostorBaker::GetFrameDirection(unsigned int x, unsigned int y,
+	unsigned int framesPerSide, float direction[3])
+{
+	float uv[2] = { (x + 0.5f) / framesPerSide, (y + 0.5f) / framesPerSide };
+	DecodeOctahedral(uv, direction);
+}
+
+// --------------------------------------------------------
+// Left-handed, like the cameras: looking along -direction,
+// right is direction x up and up is right x direction.
+// Straight up or down falls back to +Z for "up".
+// --------------------------------------------------------
+void ImpostorBaker::GetFrameAxes(const float direction[3], float right[3], float up[3])
+{
+	float worldUp[3] = { 0.0f, 1.0f, 0.0f };
+	if (fabsf(direction[1]) > 0.999f)
+	{
+		worldUp[1] = 0.0f;
+		worldUp[2] = 1.0f;
+	}
+
+	Cross(direction, worldUp, right);
+	Normalize(right);
+	Cross(right, direction, up);
+}
+
+bool ImpostorBaker::Bake(const ImpostorSource& source, const ImpostorSettings& settings,
+	ImpostorAtlas& atlas, unsigned int threadCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	atlas = ImpostorAtlas();
+	atlas.Settings = settings;
+	if (!source.Bvh || !source.Bvh->IsBuilt() || !source.Positions || !source.Normals ||
+		!source.UVs || !source.Indices || source.Radius <= 0.0f ||
+		settings.FramesPerSide == 0 || settings.FrameSize == 0)
+		return false;
+
+	for (int a = 0; a < 3; a++)
+		atlas.Center[a] = source.Center[a];
+	atlas.Radius = source.Radius;
+
+	unsigned int size = settings.FramesPerSide * settings.FrameSize;
+	ResetImage(atlas.Albedo, size, 4);
+	ResetImage(atlas.Normal, size, 4);
+	ResetImage(atlas.Depth, size, 1);
+
+	// Frames are independent, so split them evenly
+	unsigned int frameCount = settings.FramesPerSide * settings.FramesPerSide;
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		size_t byCount = (size_t)size * size / MinTexelsPerThread;
+		if (byCount < threadCount)
+			threadCount = (unsigned int)byCount;
+	}
+	if (threadCount > frameCount)
+		threadCount = frameCount;
+	if (threadCount < 1)
+		threadCount = 1;
+
+	// Bake on several threads (this one does the first frames)
+	GammaTable gamma;
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		workers.emplace_back(BakeFrames, std::cref(source), std::cref(gamma), std::ref(atlas),
+			frameCount * i / threadCount, frameCount * (i + 1) / threadCount);
+	}
+	BakeFrames(source, gamma, atlas, 0, frameCount / threadCount);
+	for (std::thread& t : workers)
+		t.join();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	atlas.BakeTime = std::chrono::duration<float, std::milli>(end - start).count();
+	return true;
+}
@@ -0,0 +1,124 @@
+/*
+William Duprey
+12/10/24
+Impostor Baker Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TriangleBvh.h"
+
+// --------------------------------------------------------
+// A CPU side image, rows top to bottom, Channels bytes per
+// pixel (1 or 4)
+// --------------------------------------------------------
+struct ImpostorImage
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Channels;
+	std::vector<uint8_t> Pixels;
+};
+
+// --------------------------------------------------------
+// How an impostor is baked. The atlas is a FramesPerSide x
+// FramesPerSide grid of views, each FrameSize pixels square.
+// DilationPasses is how many texels of color get smeared
+// outward past each view's silhouette, so filtering at the
+// edges doesn't pull in the empty background.
+// --------------------------------------------------------
+struct ImpostorSettings
+{
+	unsigned int FramesPerSide = 8;
+	unsigned int FrameSize = 64;
+	unsigned int DilationPasses = 4;
+};
+
+// --------------------------------------------------------
+// Everything the baker reads from a mesh and its material.
+//  - Vertex data is strided like in MeshOptimizer, with all
+//    three pointers sharing VertexStride
+//  - Bvh must be built over the same positions and indices
+//  - Center and Radius are a sphere around the whole mesh
+//  - Albedo is RGBA8 and gamma encoded, like the textures
+//    on disk. Null bakes a plain ColorTint instead.
+// --------------------------------------------------------
+struct ImpostorSource
+{
+	const TriangleBvh* Bvh;
+	const float* Positions;
+	const float* Normals;
+	const float* UVs;
+	size_t VertexCount;
+	size_t VertexStride;
+	const unsigned int* Indices;
+	size_t IndexCount;
+
+	float Center[3];
+	float Radius;
+
+	const ImpostorImage* Albedo;
+	float ColorTint[3];
+	float UVScale[2];
+	float UVOffset[2];
+};
+
+// --------------------------------------------------------
+// A baked impostor, three atlases laid out the same way:
+//  - Albedo: RGBA8, gamma encoded with the tint applied,
+//    alpha is 255 where the mesh covers the texel
+//  - Normal: RGBA8, object space normal * 0.5 + 0.5
+//  - Depth: R8, how far into the bounding sphere the surface
+//    is along the view, 0 at the near side and 1 at the far
+// --------------------------------------------------------
+struct ImpostorAtlas
+{
+	ImpostorSettings Settings;
+	float Center[3];
+	float Radius;
+	ImpostorImage Albedo;
+	ImpostorImage Normal;
+	ImpostorImage Depth;
+	float BakeTime;		// Milliseconds
+};
+
+// --------------------------------------------------------
+// Bakes octahedral impostors by ray casting a mesh's BVH,
+// so no GPU is needed.
+//
+// Every view direction around the mesh maps to a point in a
+// square through an octahedron (+Y at the center of the
+// square, -Y at its corners), and the square is split into
+// a grid of frames. Each frame is an orthographic view of
+// the bounding sphere from its center's direction, looking
+// back toward the mesh. ImpostorPS.hlsl / ImpostorVS.hlsl
+// use the same mapping and frame axes to draw the atlas.
+// --------------------------------------------------------
+namespace ImpostorBaker
+{
+	// Frames with fewer texels than this in total aren't
+	// worth handing to another thread
+	constexpr size_t MinTexelsPerThread = 1 << 14;
+
+	// Unit direction to and from [0, 1] octahedral coordinates
+	void EncodeOctahedral(const float direction[3], float uv[2]);
+	void DecodeOctahedral(const float uv[2], float direction[3]);
+
+	// The direction frame (x, y) was baked from (the decoded
+	// center of its square), pointing away from the mesh
+	void GetFrameDirection(unsigned int x, unsigned int y,
+		unsigned int framesPerSide, float direction[3]);
+
+	// Right and up axes of a view along "direction" (pointing
+	// at the viewer), kept as upright as possible
+	void GetFrameAxes(const float direction[3], float right[3], float up[3]);
+
+	// Replaces the atlas with a fresh bake. threadCount of 0
+	// picks one based on texel count and cores. Returns false
+	// (leaving an empty atlas) if there's nothing to bake.
+	bool Bake(const ImpostorSource& source, const ImpostorSettings& settings,
+		ImpostorAtlas& atlas, unsigned int threadCount = 0);
+}
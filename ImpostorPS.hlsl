@@ -0,0 +1,120 @@
+/*
+William Duprey
+12/10/24
+Impostor Pixel Shader
+*/
+
+#include "ShaderIncludes.hlsli"
+#include "Lighting.hlsli"
+
+#define NUM_LIGHTS 6
+
+// Baked views don't carry roughness or metalness,
+// so impostors light as a fairly rough dielectric
+#define IMPOSTOR_ROUGHNESS 0.8f
+#define IMPOSTOR_METALNESS 0.0f
+
+cbuffer ExternalData : register(b0)
+{
+    matrix world;
+    matrix worldInvTranspose;
+    matrix view;
+    matrix projection;
+    matrix lightView;
+    matrix lightProjection;
+
+    float3 cameraPosition;
+    float framesPerSide;
+
+    float3 center;      // Object space bounding sphere
+    float radius;       // the atlas was baked around
+
+    Light lights[NUM_LIGHTS];
+    int lightCount;
+}
+
+// The three atlases from ImpostorBaker, and the shadow map
+Texture2D Albedo        : register(t0);
+Texture2D NormalAtlas   : register(t1);
+Texture2D DepthAtlas    : register(t2);
+Texture2D ShadowMap     : register(t3);
+
+SamplerState AtlasSampler : register(s0);
+SamplerComparisonState ShadowSampler : register(s1);
+
+// Depth is written per pixel, since the quad itself
+// sits flat through the middle of the mesh
+struct PixelOutput
+{
+    float4 color : SV_TARGET;
+    float depth  : SV_DEPTH;
+};
+
+// --------------------------------------------------------
+// The entry point for the impostor pixel shader. Clips to
+// the baked silhouette, rebuilds the surface's position
+// from the depth atlas, then lights it like PixelShader.hlsl
+// --------------------------------------------------------
+PixelOutput main(VertexToPixel_Impostor input)
+{
+    // Parts of the quad past the frame's edges are empty
+    if (any(input.frameUV < 0.0f) || any(input.frameUV > 1.0f))
+        discard;
+
+    float2 uv = input.frameOrigin + input.frameUV / framesPerSide;
+    float4 albedo = Albedo.Sample(AtlasSampler, uv);
+    clip(albedo.a - 0.5f);
+
+    // --- Rebuild the surface ---
+    // Depth runs through the bounding sphere, front to back
+    float depth = DepthAtlas.Sample(AtlasSampler, uv).r;
+    float2 offset = float2(input.frameUV.x * 2.0f - 1.0f, 1.0f - input.frameUV.y * 2.0f) * radius;
+    float3 localPosition = center +
+        input.frameRight * offset.x +
+        input.frameUp * offset.y +
+        input.frameDirection * radius * (1.0f - depth * 2.0f);
+    float3 worldPosition = mul(world, float4(localPosition, 1.0f)).xyz;
+
+    float3 normal = NormalAtlas.Sample(AtlasSampler, uv).rgb * 2 - 1;
+    normal = normalize(mul((float3x3)worldInvTranspose, normal));
+
+    // --- Shadow Mapping ---
+    float4 shadowMapPos = mul(lightProjection, mul(lightView, float4(worldPosition, 1.0f)));
+    shadowMapPos /= shadowMapPos.w;
+    float2 shadowUV = shadowMapPos.xy * 0.5f + 0.5f;
+    shadowUV.y = 1 - shadowUV.y;
+    float shadowAmount = ShadowMap.SampleCmpLevelZero(
+        ShadowSampler, shadowUV, shadowMapPos.z).r;
+
+    // --- Calculate Light ---
+    // Tint is already baked into the albedo
+    float3 albedoColor = pow(albedo.rgb, 2.2f);
+    float3 specularColor = lerp(F0_NON_METAL, albedoColor, IMPOSTOR_METALNESS);
+    float3 toCam = normalize(cameraPosition - worldPosition);
+    float3 totalLight = float3(0, 0, 0);
+    for (int i = 0; i < lightCount; i++)
+    {
+        Light light = lights[i];
+        float3 toLight = float3(0, 0, 1);
+        if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+            toLight = normalize(-light.Direction);
+        else if (light.Type == LIGHT_TYPE_POINT)
+            toLight = normalize(light.Position - worldPosition);
+
+        float3 lightResult = CalculateLightPBR(light.Color, light.Intensity,
+            normal, toLight, toCam, albedoColor, specularColor,
+            IMPOSTOR_ROUGHNESS, IMPOSTOR_METALNESS);
+
+        // Only the first light casts shadows
+        if (i == 0)
+            lightResult *= shadowAmount;
+        totalLight += lightResult;
+    }
+
+    PixelOutput output;
+    output.color = float4(pow(totalLight, 1.0f / 2.2f), 1);
+
+    float4 clipPosition = mul(projection, mul(view, float4(worldPosition, 1.0f)));
+    output.depth = clipPosition.z / clipPosition.w;
+    return output;
+}
@@ -0,0 +1,69 @@
+/*
+William Duprey
+12/10/24
+Impostor Vertex Shader
+*/
+
+#include "ShaderIncludes.hlsli"
+
+// The quad is built from the entity's world space bounding
+// sphere, and the frame is picked in object space
+cbuffer ExternalData : register(b0)
+{
+    matrix view;
+    matrix projection;
+    matrix worldInvTranspose;
+
+    float3 cameraPosition;
+    float framesPerSide;
+
+    float3 worldCenter;
+    float worldRadius;
+
+    float3 center;      // Object space bounding sphere
+    float radius;       // the atlas was baked around
+}
+
+// Two triangles, clockwise when seen from the camera
+static const float2 corners[6] =
+{
+    float2(-1, 1), float2(1, 1), float2(1, -1),
+    float2(-1, 1), float2(1, -1), float2(-1, -1)
+};
+
+// --------------------------------------------------------
+// The entry point for the impostor vertex shader. Draws a
+// camera-facing quad over the bounding sphere using
+// SV_VertexID (no vertex buffer), and works out which part
+// of the chosen frame each corner covers.
+// --------------------------------------------------------
+VertexToPixel_Impostor main(uint id : SV_VertexID)
+{
+    VertexToPixel_Impostor output;
+
+    // The view matrix's first two rows are the camera's
+    // right and up axes in world space
+    float2 corner = corners[id];
+    float3 worldPosition = worldCenter +
+        (view[0].xyz * corner.x + view[1].xyz * corner.y) * worldRadius;
+    output.position = mul(projection, mul(view, float4(worldPosition, 1.0f)));
+
+    // Use the frame baked closest to where the camera is,
+    // from the entity's point of view (the inverse transpose,
+    // multiplied from the other side, is the inverse)
+    float3 cameraLocal = mul(float4(cameraPosition, 1.0f), worldInvTranspose).xyz;
+    float2 octahedral = EncodeOctahedralY(normalize(cameraLocal - center));
+    float2 frame = min(floor(octahedral * framesPerSide), framesPerSide - 1.0f);
+    output.frameOrigin = frame / framesPerSide;
+    output.frameDirection = DecodeOctahedralY((frame + 0.5f) / framesPerSide);
+    GetFrameAxes(output.frameDirection, output.frameRight, output.frameUp);
+
+    // The frame is an orthographic view, so project the corner
+    // straight onto it (this is linear across the quad, so
+    // interpolating it is exact)
+    float3 local = mul(float4(worldPosition, 1.0f), worldInvTranspose).xyz - center;
+    output.frameUV = float2(dot(local, output.frameRight), -dot(local, output.frameUp))
+        / radius * 0.5f + 0.5f;
+
+    return output;
+}
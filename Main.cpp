@@ -4,6 +4,7 @@
 
 #include "Window.h"
 #include "Graphics.h"
+#include "GeometryArena.h"
 #include "Game.h"
 #include "Input.h"
 
@@ -145,6 +146,7 @@ int WINAPI WinMain(
 	// Clean up
 	delete game;
 	Input::ShutDown();
+	GeometryArena::ShutDown();
 	Graphics::ShutDown();
 	return (HRESULT)msg.wParam;
 }
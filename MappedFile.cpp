@@ -0,0 +1,179 @@
+/*
+William Duprey
+12/9/24
+MappedFile Implementation
+*/
+
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// --------------------------------------------------------
+// Default constructor for an empty (unopened) mapping.
+// --------------------------------------------------------
+MappedFile::MappedFile()
+	: data(nullptr),
+	  size(0),
+#ifdef _WIN32
+	  fileHandle(nullptr),
+	  mappingHandle(nullptr)
+#else
+	  fileDescriptor(-1)
+#endif
+{
+}
+
+// --------------------------------------------------------
+// Constructor that immediately maps the given file.
+// Check IsOpen() afterwards to see if it worked.
+// --------------------------------------------------------
+MappedFile::MappedFile(const char* path) : MappedFile()
+{
+	Open(path);
+}
+
+// --------------------------------------------------------
+// Unmaps the file and releases the OS handles.
+// --------------------------------------------------------
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : MappedFile()
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		std::swap(data, other.data);
+		std::swap(size, other.size);
+#ifdef _WIN32
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#else
+		std::swap(fileDescriptor, other.fileDescriptor);
+#endif
+	}
+	return *this;
+}
+
+// --------------------------------------------------------
+// Maps the entire file at the given path as read-only.
+// Returns false if the file could not be opened or mapped.
+// Empty files are "open" but have a null data pointer.
+// --------------------------------------------------------
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	size = (size_t)fileSize.QuadPart;
+
+	// Can't create a mapping of an empty file
+	if (size == 0)
+		return true;
+
+	mappingHandle = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	fileDescriptor = open(path, O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat info = {};
+	if (fstat(fileDescriptor, &info) != 0)
+	{
+		Close();
+		return false;
+	}
+	size = (size_t)info.st_size;
+
+	// Can't mmap an empty file
+	if (size == 0)
+		return true;
+
+	void* view = mmap(0, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view != MAP_FAILED)
+	{
+		data = (const char*)view;
+
+		// We (almost) always read front to back
+		madvise(view, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Unmaps the view and closes the file. Safe to call
+// multiple times, or on a file that was never opened.
+// --------------------------------------------------------
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------------------------------- GETTERS --------------------------------- //
+///////////////////////////////////////////////////////////////////////////////
+bool MappedFile::IsOpen() const
+{
+#ifdef _WIN32
+	return fileHandle != nullptr;
+#else
+	return fileDescriptor >= 0;
+#endif
+}
+
+const char* MappedFile::GetData() const { return data; }
+size_t MappedFile::GetSize() const { return size; }
@@ -0,0 +1,53 @@
+/*
+William Duprey
+12/9/24
+MappedFile Header
+*/
+
+#pragma once
+#include <cstddef>
+
+// --------------------------------------------------------
+// A read-only, memory-mapped view of an entire file.
+// The OS pages the file in as it is touched, so large
+// files never need to be copied into our own buffers.
+//
+// Works on both Windows and POSIX systems, so anything
+// built on top of it does not depend on Windows headers.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile();
+	MappedFile(const char* path);
+	~MappedFile();
+
+	// Owns OS handles, so no copying (moving is fine)
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Opening and closing the mapping
+	bool Open(const char* path);
+	void Close();
+
+	// Getters
+	bool IsOpen() const;
+	const char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	// Start of the mapped bytes and how many there are
+	const char* data;
+	size_t size;
+
+	// Platform handles, stored as plain integers / pointers
+	// so the header does not need any OS includes
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
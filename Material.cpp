@@ -7,6 +7,15 @@ Material Class Implementation
 #include "Material.h"
 using namespace DirectX;
 
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Shaders are shared between materials (and their buffers
+	// between everything drawn with them), so where their
+	// values last came from is kept per shader
+	UploadStamps uploads;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // --------------------------- MATERIAL CLASS ------------------------------ //
 ///////////////////////////////////////////////////////////////////////////////
@@ -23,8 +32,11 @@ Material::Material(const char* _name,
 	  colorTint(_colorTint),
 	  vs(_vs),
 	  ps(_ps),
+	  packedVS(nullptr),
 	  uvScale(_uvScale),
-	  uvOffset(_uvOffset)
+	  uvOffset(_uvOffset),
+	  version(0),
+	  id(UploadStamps::NextId())
 {
 }
 
@@ -33,26 +45,55 @@ Material::Material(const char* _name,
 // in preparation for being drawn.
 // --------------------------------------------------------
 void Material::PrepareMaterial(std::shared_ptr<Transform> transform,
-	std::shared_ptr<Camera> camera)
+	std::shared_ptr<Camera> camera, std::shared_ptr<Mesh> mesh)
 {
+	std::shared_ptr<SimpleVertexShader> vertexShader = GetVertexShader(mesh);
+
 	// Activate the correct shaders
-	vs->SetShader();
+	vertexShader->SetShader();
 	ps->SetShader();
 
-	// Strings must exactly match variable names in shader cbuffer
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("worldInvTranspose", transform->GetWorldInverseTransposeMatrix());
-	vs->SetMatrix4x4("view", camera->GetViewMatrix());
-	vs->SetMatrix4x4("projection", camera->GetProjectionMatrix());
+	// Strings must exactly match variable names in shader cbuffer.
+	// Skipped when the shader still has this transform, camera
+	// and mesh's values (drawing the same thing again).
+	if (uploads.Restamp(vertexShader->GetId(), {
+		{ transform->GetId(), camera->GetId(), mesh->GetId() },
+		{ transform->GetVersion(), camera->GetVersion(), 0 } }))
+	{
+		if (vertexShader == packedVS)
+		{
+			vertexShader->SetFloat3("positionScale", mesh->GetPositionScale());
+			vertexShader->SetFloat3("positionOffset", mesh->GetPositionOffset());
+		}
+		vertexShader->SetMatrix4x4("world", transform->GetWorldMatrix());
+
+		// With uniform scale the shader turns normals with the
+		// world matrix, so the inverse transpose isn't needed
+		bool uniformScale = transform->HasUniformScale();
+		vertexShader->SetInt("uniformScale", uniformScale);
+		if (!uniformScale)
+			vertexShader->SetMatrix4x4("worldInvTranspose", transform->GetWorldInverseTransposeMatrix());
+		vertexShader->SetMatrix4x4("view", camera->GetViewMatrix());
+		vertexShader->SetMatrix4x4("projection", camera->GetProjectionMatrix());
+	}
 
-	// Copy data to the GPU
-	vs->CopyAllBufferData();
+	// Copy data to the GPU (if any of it changed)
+	vertexShader->CopyAllBufferData();
 
-	// Do the same for the pixel shader
-	ps->SetFloat3("colorTint", colorTint);
-	ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
-	ps->SetFloat2("uvScale", uvScale);
-	ps->SetFloat2("uvOffset", uvOffset);
+	// Do the same for the pixel shader, which only needs setting
+	// when the material or the camera's position is different
+	// (so drawing entities with the same material in a row
+	// usually skips this)
+	std::shared_ptr<Transform> cameraTransform = camera->GetTransform();
+	if (uploads.Restamp(ps->GetId(), {
+		{ id, cameraTransform->GetId(), 0 },
+		{ version, cameraTransform->GetVersion(), 0 } }))
+	{
+		ps->SetFloat3("colorTint", colorTint);
+		ps->SetFloat3("cameraPosition", cameraTransform->GetPosition());
+		ps->SetFloat2("uvScale", uvScale);
+		ps->SetFloat2("uvOffset", uvOffset);
+	}
 	ps->CopyAllBufferData();
 
 	// Loop through srv and sampler unordered maps to set resources
@@ -72,18 +113,33 @@ void Material::PrepareMaterial(std::shared_ptr<Transform> transform,
 const char* Material::GetName() { return name; }
 DirectX::XMFLOAT3 Material::GetColorTint() { return colorTint; }
 std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() { return vs; }
+std::shared_ptr<SimpleVertexShader> Material::GetPackedVertexShader() { return packedVS; }
+
+// --------------------------------------------------------
+// Meshes with packed vertices need packedVS instead of vs,
+// since the input layout and decoding are different.
+// --------------------------------------------------------
+std::shared_ptr<SimpleVertexShader> Material::GetVertexShader(std::shared_ptr<Mesh> mesh)
+{
+	return (mesh->GetPackedVertices() && packedVS) ? packedVS : vs;
+}
 std::shared_ptr<SimplePixelShader> Material::GetPixelShader() { return ps; }
 DirectX::XMFLOAT2 Material::GetUVScale() { return uvScale; }
 DirectX::XMFLOAT2 Material::GetUVOffset() { return uvOffset; }
+unsigned int Material::GetVersion() { return version; }
+uint64_t Material::GetId() { return id; }
+unsigned int Material::GetSkippedSets() { return uploads.GetSkippedCount(); }
+void Material::ResetSkippedSets() { uploads.ResetSkippedCount(); }
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------------------------------- SETTERS --------------------------------- //
 ///////////////////////////////////////////////////////////////////////////////
-void Material::SetColorTint(XMFLOAT3 _colorTint) { colorTint = _colorTint; }
-void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> _vs) { vs = _vs; }
-void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> _ps) { ps = _ps; }
-void Material::SetUVScale(DirectX::XMFLOAT2 _uvScale) { uvScale = _uvScale; }
-void Material::SetUVOffset(DirectX::XMFLOAT2 _uvOffset) { uvOffset = _uvOffset; }
+void Material::SetColorTint(XMFLOAT3 _colorTint) { colorTint = _colorTint; version++; }
+void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> _vs) { vs = _vs; version++; }
+void Material::SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> _packedVS) { packedVS = _packedVS; version++; }
+void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> _ps) { ps = _ps; version++; }
+void Material::SetUVScale(DirectX::XMFLOAT2 _uvScale) { uvScale = _uvScale; version++; }
+void Material::SetUVOffset(DirectX::XMFLOAT2 _uvOffset) { uvOffset = _uvOffset; version++; }
 
 ///////////////////////////////////////////////////////////////////////////////
 // ----------------------- UNORDERED MAP FUNCTIONS ------------------------- //
@@ -92,10 +148,12 @@ void Material::AddTextureSRV(std::string name,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	textureSRVs.insert({ name, srv });
+	version++;
 }
 
 void Material::AddSampler(std::string name, 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 {
 	samplers.insert({ name, sampler });
+	version++;
 }
\ No newline at end of file
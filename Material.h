@@ -10,6 +10,7 @@ Material Class Header
 #include <unordered_map>
 
 #include "Camera.h"
+#include "Mesh.h"
 #include "Transform.h"
 #include "SimpleShader.h"
 
@@ -34,13 +35,24 @@ public:
 	const char* GetName();
 	DirectX::XMFLOAT3 GetColorTint();
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
+	std::shared_ptr<SimpleVertexShader> GetPackedVertexShader();
+	std::shared_ptr<SimpleVertexShader> GetVertexShader(std::shared_ptr<Mesh> mesh);
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
 	DirectX::XMFLOAT2 GetUVScale();
 	DirectX::XMFLOAT2 GetUVOffset();
+	unsigned int GetVersion();	// Bumped by every setter
+	uint64_t GetId();			// Never reused (see UploadStamps)
+
+	// How many times PrepareMaterial() skipped setting a
+	// shader's values, since they were already there, since
+	// the last ResetSkippedSets() (call once per frame)
+	static unsigned int GetSkippedSets();
+	static void ResetSkippedSets();
 
 	// Setters
 	void SetColorTint(DirectX::XMFLOAT3 _colorTint);
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> _vs);
+	void SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> _packedVS);
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> _ps);
 	void SetUVScale(DirectX::XMFLOAT2 _uvScale);
 	void SetUVOffset(DirectX::XMFLOAT2 _uvOffset);
@@ -51,17 +63,27 @@ public:
 	void AddSampler(std::string name, 
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 
+	// Sets the shaders' values for drawing with this transform
+	// and camera, then copies them to the GPU. Values a shader
+	// already got from the same transform, camera and material
+	// (going by their versions) aren't set again, and buffers
+	// that didn't change aren't copied (see SimpleShader).
 	void PrepareMaterial(std::shared_ptr<Transform> transform,
-		std::shared_ptr<Camera> camera);
+		std::shared_ptr<Camera> camera, std::shared_ptr<Mesh> mesh);
 
 private:
 	const char* name;
 	DirectX::XMFLOAT3 colorTint;
+	unsigned int version;
+	uint64_t id;
 
 	// Simple shader resources
 	std::shared_ptr<SimpleVertexShader> vs;
 	std::shared_ptr<SimplePixelShader> ps;
 
+	// Variant of vs for meshes with packed vertices
+	std::shared_ptr<SimpleVertexShader> packedVS;
+
 	// UV modifying properties
 	DirectX::XMFLOAT2 uvScale;
 	DirectX::XMFLOAT2 uvOffset;
@@ -3,10 +3,90 @@
 // Mesh Class Implementation
 
 #include "Mesh.h"
-#include <fstream>
+#include "ObjParser.h"
+#include "GltfParser.h"
+#include "MeshCache.h"
+#include "ObjStreamCache.h"
+#include "TangentGenerator.h"
+#include "VertexPacking.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
 #include <vector>
 using namespace DirectX;
 
+// The position stream copies the front of each vertex, which
+// only works while positions stay the first member of both
+// (VertexPacking.h checks PackedVertex's side)
+static_assert(offsetof(Vertex, Position) == 0 && sizeof(Vertex::Position) == 12,
+	"Position stream stride must match the depth-only shaders' input");
+
+// Streamed .obj loads write unpacked vertices without DirectXMath
+static_assert(sizeof(Vertex) == sizeof(StreamedVertex) &&
+	offsetof(Vertex, Normal) == offsetof(StreamedVertex, Normal) &&
+	offsetof(Vertex, Tangent) == offsetof(StreamedVertex, Tangent) &&
+	offsetof(Vertex, UV) == offsetof(StreamedVertex, UV),
+	"StreamedVertex must match Vertex");
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// Builds a Vertex from one parsed .obj face corner.
+	// Missing UVs become (0, 0), missing normals are zeroed.
+	// 
+	// Comments on the coordinate fixups are from the original
+	// loading code provided by Prof. Chris Cascioli.
+	// --------------------------------------------------------
+	Vertex MakeObjVertex(const ObjData& obj, const ObjIndex& corner)
+	{
+		Vertex v = {};
+		if (corner.Position >= 0)
+			v.Position = XMFLOAT3(&obj.Positions[corner.Position * 3]);
+		if (corner.UV >= 0)
+			v.UV = XMFLOAT2(&obj.UVs[corner.UV * 2]);
+		if (corner.Normal >= 0)
+			v.Normal = XMFLOAT3(&obj.Normals[corner.Normal * 3]);
+
+		// The model is most likely in a right-handed space,
+		// especially if it came from Maya.  We want to convert
+		// to a left-handed space for DirectX.  This means we 
+		// need to:
+		//  - Invert the Z position
+		//  - Invert the normal's Z
+		//  - Flip the winding order (done by the caller)
+		// We also need to flip the UV coordinate since DirectX
+		// defines (0,0) as the top left of the texture, and many
+		// 3D modeling packages use the bottom left as (0,0)
+		v.UV.y = 1.0f - v.UV.y;
+		v.Position.z *= -1.0f;
+		v.Normal.z *= -1.0f;
+		return v;
+	}
+
+	// Most bytes handed to the GPU in one copy, so a huge
+	// mesh never needs one huge staging copy in the driver
+	const size_t UploadWindowBytes = 4 << 20;
+
+	// --------------------------------------------------------
+	// Uploads a whole range of the geometry arena, at most
+	// UploadWindowBytes at a time
+	// --------------------------------------------------------
+	void UploadInWindows(const ArenaRange& range, const void* data, size_t stride)
+	{
+		size_t perWindow = std::max<size_t>(UploadWindowBytes / stride, 1);
+		for (size_t first = 0; first < range.Count; first += perWindow)
+		{
+			size_t count = std::min<size_t>(perWindow, range.Count - first);
+			GeometryArena::Upload(range, (unsigned int)first,
+				(const char*)data + first * stride, (unsigned int)count);
+		}
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // ----------------------------- MESH CLASS -------------------------------- //
 ///////////////////////////////////////////////////////////////////////////////
@@ -16,250 +96,487 @@ using namespace DirectX;
 // ----------------------------------------------------------------------------
 Mesh::Mesh(Vertex* vertices, size_t _vertexCount, UINT* indices, size_t _indexCount,
 	const char* _name)
-	: name(_name)
+	: packedVertices(false),
+	  vertexStride(sizeof(Vertex)),
+	  positionStride(0),
+	  unweldedVertexCount((UINT)_vertexCount),
+	  cacheStatsBefore(),
+	  cacheStatsAfter(),
+	  lruStatsBefore(),
+	  lruStatsAfter(),
+	  overdrawStatsBefore(),
+	  overdrawStatsAfter(),
+	  bounds(),
+	  loadedFromCache(false),
+	  loadTime(0.0f),
+	  indexFormat(DXGI_FORMAT_R32_UINT),
+	  id(UploadStamps::NextId()),
+	  name(_name)
 {
+	CalculateBounds(vertices, _vertexCount, false);
 	CreateBuffers(vertices, _vertexCount, indices, _indexCount);
+	lods.assign(1, { 0, (UINT)_indexCount, 0.0f, 0.0f });
 }
 
 // ----------------------------------------------------------------------------
-// Constructor for a Mesh object that reads data from a file.
-// File-reading code provided by Prof. Chris Cascioli.
+// Constructor for a Mesh object that reads data from a file
+// (.glb, or .obj for anything else). Uses the binary cache
+// next to the file when it was built from the same bytes,
+// and otherwise loads the file and writes a fresh cache
+// for next time.
 // ----------------------------------------------------------------------------
-Mesh::Mesh(const char* _name, const char* objFile)
-	: name(_name)
+Mesh::Mesh(const char* _name, const char* file, MeshOptions options)
+	: id(UploadStamps::NextId()),
+	  name(_name)
 {
 	// Set values in case the file cannot be read
 	vertexCount = 0;
 	indexCount = 0;
+	packedVertices = options.PackVertices;
+	vertexStride = packedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+	positionStride = 0;
+	if (options.KeepPositionStream)
+		positionStride = packedVertices ? sizeof(PackedVertex::Position) : sizeof(Vertex::Position);
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	unweldedVertexCount = 0;
+	cacheStatsBefore = {};
+	cacheStatsAfter = {};
+	lruStatsBefore = {};
+	lruStatsAfter = {};
+	overdrawStatsBefore = {};
+	overdrawStatsAfter = {};
+	bounds = {};
+	loadedFromCache = false;
+	loadTime = 0.0f;
+	lods.assign(1, { 0, 0, 0.0f, 0.0f });
+	options.LodCount = std::min(std::max(options.LodCount, 1u), MeshSimplifier::MaxLods);
+
+	// The BVH is built from the CPU copy of the geometry, so
+	// keep that around at least until it has been built
+	bool keepGeometry = options.KeepGeometry;
+	options.KeepGeometry = keepGeometry || options.BuildBvh;
+
+	auto loadStart = std::chrono::high_resolution_clock::now();
+
+	std::string path(file);
+	std::string cachePath = path + MeshCache::Extension;
+	std::string extension = path.substr(path.size() >= 4 ? path.size() - 4 : 0);
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+		[](char c) { return (char)tolower((unsigned char)c); });
+	bool isGlb = (extension == ".glb");
+	if (options.StreamingBudget > 0 && !isGlb)
+	{
+		// Never mapped, only ever read a window at a time
+		uint64_t sourceHash;
+		if (!MeshCache::HashFile(file, sourceHash))
+			return;
+
+		loadedFromCache = LoadCache(cachePath.c_str(), sourceHash, options);
+		if (!loadedFromCache && StreamObj(file, cachePath.c_str(), sourceHash, options))
+			LoadCache(cachePath.c_str(), sourceHash, options);
+	}
+	else
+	{
+		// The file is always mapped, since hashing it is the
+		// only way to know whether the cache is still valid
+		MappedFile source(file);
+		if (!source.IsOpen())
+			return;
+		uint64_t sourceHash = MeshCache::Hash(source.GetData(), source.GetSize());
+
+		loadedFromCache = LoadCache(cachePath.c_str(), sourceHash, options);
+		if (!loadedFromCache && isGlb)
+			LoadGlb(source, cachePath.c_str(), sourceHash, options);
+		else if (!loadedFromCache)
+			LoadObj(source, cachePath.c_str(), sourceHash, options);
+	}
+
+	if (options.BuildBvh && !geometryIndices.empty())
+	{
+		bvh.Build(&geometryVertices[0].Position.x, geometryVertices.size(), sizeof(Vertex),
+			geometryIndices.data(), geometryIndices.size());
+	}
+	if (!keepGeometry)
+	{
+		std::vector<Vertex>().swap(geometryVertices);
+		std::vector<UINT>().swap(geometryIndices);
+	}
+
+	auto loadEnd = std::chrono::high_resolution_clock::now();
+	loadTime = std::chrono::duration<float, std::milli>(loadEnd - loadStart).count();
+}
 
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
+// --------------------------------------------------------
+// Creates the buffers directly from a mapped cache file,
+// if it exists and matches the source file and settings.
+// Uncompressed vertex and index bytes are never copied on
+// the CPU; compressed ones are decoded once, into memory.
+// --------------------------------------------------------
+bool Mesh::LoadCache(const char* cachePath, uint64_t sourceHash, MeshOptions options)
+{
+	MappedFile file(cachePath);
+	MeshCacheView cache;
+	if (!MeshCache::Read(file, cache))
+		return false;
+
+	// Stale, built with other settings, or for another vertex format
+	const MeshCacheHeader* header = cache.Header;
+	if (header->SourceHash != sourceHash ||
+		header->OverdrawThreshold != options.OverdrawThreshold ||
+		header->VertexStride != vertexStride ||
+		header->VertexCount == 0 ||
+		header->IndexCount == 0)
+		return false;
+
+	// Index size always follows from the vertex count
+	DXGI_FORMAT cachedIndexFormat = (header->IndexStride == sizeof(uint16_t))
+		? DXGI_FORMAT_R16_UINT
+		: DXGI_FORMAT_R32_UINT;
+	if (header->IndexStride != (header->VertexCount <= 65536 ? sizeof(uint16_t) : sizeof(UINT)))
+		return false;
+
+	// Levels of detail, which must have been built with the same
+	// setting (Read() already checked they fit in the index buffer)
+	if (header->RequestedLodCount != options.LodCount || header->LodCount == 0)
+		return false;
+
+	// Same for the oriented box
+	if (options.BuildOrientedBox && !header->Bounds.HasOrientedBox)
+		return false;
+
+	// Meshlets are only in the cache if they were asked for then
+	if (options.BuildMeshlets)
+	{
+		if (header->MeshletCount == 0)
+			return false;
+		meshlets.assign(cache.Meshlets, cache.Meshlets + header->MeshletCount);
+		Meshlets::BuildCullData(meshlets, meshletCullData);
+	}
+	lods.assign(cache.Lods, cache.Lods + header->LodCount);
+
+	unweldedVertexCount = header->UnweldedVertexCount;
+	cacheStatsBefore = header->CacheStatsBefore;
+	cacheStatsAfter = header->CacheStatsAfter;
+	lruStatsBefore = header->LruStatsBefore;
+	lruStatsAfter = header->LruStatsAfter;
+	overdrawStatsBefore = header->OverdrawStatsBefore;
+	overdrawStatsAfter = header->OverdrawStatsAfter;
+	bounds = header->Bounds;
+	bounds.HasOrientedBox = options.BuildOrientedBox;
+
+	// Decoding checks every index, so a corrupt file just
+	// means the source gets loaded again
+	std::vector<char> decodedVertices;
+	std::vector<char> decodedIndices;
+	if (!MeshCache::Decompress(cache, decodedVertices, decodedIndices))
+		return false;
+
+	indexFormat = cachedIndexFormat;
+	CreateBuffers(cache.Vertices, header->VertexCount,
+		cache.Indices, header->IndexCount);
+	indexCount = lods[0].IndexCount;
+
+	// Only copied out of the mapping when asked for
+	if (options.KeepGeometry)
+		DecodeGeometry(cache.Vertices, header->VertexCount, cache.Indices, indexCount);
+	return true;
+}
 
-	// File input object
-	std::ifstream obj(objFile);
+// --------------------------------------------------------
+// The full .obj load path: parse, weld and assemble the
+// vertices, then process them like any other file format.
+// Parsing is done by ObjParser; vertex assembly is adapted
+// from code provided by Prof. Chris Cascioli.
+// --------------------------------------------------------
+void Mesh::LoadObj(const MappedFile& source, const char* cachePath,
+	uint64_t sourceHash, MeshOptions options)
+{
+	// Parse the already mapped file with the multithreaded
+	// parser (no line length limit, and no sscanf calls per face)
+	ObjData obj;
+	if (!ObjParser::ParseMemory(source.GetData(), source.GetSize(), obj))
+		return;
 
-	// Check for successful open
-	if (!obj.is_open())
+	// Nothing to build buffers from
+	if (obj.Corners.empty())
 		return;
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
+	// Weld identical (position, uv, normal) corners together so
+	// each unique combination becomes exactly one vertex, and
+	// the index buffer actually gets to share them
+	std::vector<ObjIndex> uniqueCorners;
+	std::vector<UINT> indices;
+	ObjParser::WeldCorners(obj.Corners, uniqueCorners, indices);
+
+	// Without welding, every corner would have been its own vertex
+	unweldedVertexCount = (UINT)obj.Corners.size();
+
+	// --- Assembly adapted from code provided by Prof. Chris Cascioli ---
+	// - Create the verts by looking up
+	//    corresponding data from the parsed arrays
+	// - The parser has already made indices 0-based
+	std::vector<Vertex> verts(uniqueCorners.size());
+	for (size_t i = 0; i < uniqueCorners.size(); i++)
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+		verts[i] = MakeObjVertex(obj, uniqueCorners[i]);
+	}
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
+	// Flip the winding order of every triangle,
+	// since MakeObjVertex converted to left-handed
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		std::swap(indices[i + 1], indices[i + 2]);
+	}
+	// ----- END CODE ADAPTED FROM PROF. CHRIS CASCIOLI -----
+
+	ProcessGeometry(verts, indices, cachePath, sourceHash, options);
+}
+
+// --------------------------------------------------------
+// Loads every triangle primitive in a .glb, read in place
+// from the mapped file through accessor views. Vertices are
+// already unique in glTF, so nothing needs welding, and they
+// go straight from the file into Vertex structs. Only the
+// handedness needs fixing: glTF is right-handed like .obj,
+// but its UVs already start at the top left like DirectX's.
+// --------------------------------------------------------
+void Mesh::LoadGlb(const MappedFile& source, const char* cachePath,
+	uint64_t sourceHash, MeshOptions options)
+{
+	std::vector<GltfPrimitive> primitives;
+	if (!GltfParser::ParseMemory(source.GetData(), source.GetSize(), primitives))
+		return;
+
+	std::vector<Vertex> verts;
+	std::vector<UINT> indices;
+	for (const GltfPrimitive& primitive : primitives)
+	{
+		// Node transforms go on positions, their inverse
+		// transpose on normals (column-major data loads as
+		// the transpose, which is what row vectors need)
+		XMFLOAT4X4 transform(primitive.Transform);
+		XMMATRIX world = XMLoadFloat4x4(&transform);
+		XMMATRIX normalWorld = XMMatrixTranspose(XMMatrixInverse(0, world));
+
+		UINT baseVertex = (UINT)verts.size();
+		verts.resize(verts.size() + primitive.Positions.Count);
+		for (size_t i = 0; i < primitive.Positions.Count; i++)
 		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
+			Vertex& v = verts[baseVertex + i];
+			v = {};
+			primitive.Positions.Read(i, &v.Position.x, 3);
+			XMStoreFloat3(&v.Position, XMVector3Transform(XMLoadFloat3(&v.Position), world));
+			if (primitive.Normals.Data)
 			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
+				primitive.Normals.Read(i, &v.Normal.x, 3);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(
+					XMVector3TransformNormal(XMLoadFloat3(&v.Normal), normalWorld)));
 			}
+			if (primitive.UVs.Data)
+				primitive.UVs.Read(i, &v.UV.x, 2);
 
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
+			// Right-handed to left-handed, as for .obj files
+			v.Position.z *= -1.0f;
+			v.Normal.z *= -1.0f;
+		}
+
+		// Flip the winding along with the handedness, unless
+		// the node mirrors the mesh and so already flipped it
+		size_t firstIndex = indices.size();
+		GltfParser::ReadTriangles(primitive, baseVertex, indices);
+		if (XMVectorGetX(XMMatrixDeterminant(world)) > 0.0f)
+		{
+			for (size_t i = firstIndex; i + 2 < indices.size(); i += 3)
+				std::swap(indices[i + 1], indices[i + 2]);
 		}
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-	//
-	// - The vector "indices" is similar. It's a vector of unsigned ints and
-	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is the number of vertices
-	// - "indexCounter" is the number of indices
-	// - Yes, these are effectively the same since OBJs do not index entire vertices!  This means
-	//    an index buffer isn't doing much for us.  We could try to optimize the mesh ourselves
-	//    and detect duplicate vertices, but at that point it would be better to use a more
-	//    sophisticated model loading library like TinyOBJLoader or The Open Asset Importer Library
-	// ----- END CODE PROVIDED BY PROF. CHRIS CASCIOLI -----
+	// Nothing to build buffers from
+	if (indices.empty())
+		return;
+
+	unweldedVertexCount = (UINT)verts.size();
+	ProcessGeometry(verts, indices, cachePath, sourceHash, options);
+}
+
+// --------------------------------------------------------
+// Everything after the vertices and indices are assembled,
+// whatever file format they came from: optimize, calculate
+// tangents, bounds, meshlets and levels of detail, create
+// buffers, then save all of that work as a cache file.
+// --------------------------------------------------------
+void Mesh::ProcessGeometry(std::vector<Vertex>& verts, std::vector<UINT>& indices,
+	const char* cachePath, uint64_t sourceHash, MeshOptions options)
+{
+	// Reorder triangles and vertices for the GPU's caches,
+	// and to cut down on overdraw within the mesh
+	OptimizeForGPU(verts, indices, options.OverdrawThreshold);
+
+	// - "verts" is a vector of unique Vertex structs, and can be used directly
+	//    to create a vertex buffer: &verts[0] is the address of the first vert
+	// - "indices" is a vector of unsigned ints for the index buffer
+	UINT vertCounter = (UINT)verts.size();
+	UINT indexCounter = (UINT)indices.size();
 
 	// CalculateTangents helper method provided by Chris Cascioli
 	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
-	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+	CalculateBounds(&verts[0], vertCounter, options.BuildOrientedBox);
+
+	// Split the final triangle order into meshlets
+	if (options.BuildMeshlets)
+	{
+		Meshlets::Build(meshlets, &indices[0], indexCounter,
+			&verts[0].Position.x, vertCounter, sizeof(Vertex));
+		Meshlets::BuildCullData(meshlets, meshletCullData);
+	}
+
+	// Simpler versions of the mesh go after it in the index buffer
+	BuildLods(verts, indices, options.LodCount);
+	UINT bufferIndexCounter = (UINT)indices.size();
+
+	// Encode once, for both the buffers and the cache file
+	std::vector<char> vertexData;
+	std::vector<char> indexData;
+	EncodeBuffers(&verts[0], vertCounter, &indices[0], bufferIndexCounter, vertexData, indexData);
+	CreateBuffers(vertexData.data(), vertCounter, indexData.data(), bufferIndexCounter);
+	indexCount = indexCounter;
+
+	// The full precision vertices, even if the buffer is packed
+	if (options.KeepGeometry)
+	{
+		geometryVertices = verts;
+		geometryIndices.assign(indices.begin(), indices.begin() + indexCounter);
+	}
+
+	// Save everything for next time (failing is harmless,
+	// the .obj will just be loaded again)
+	MeshCacheHeader header = {};
+	header.SourceHash = sourceHash;
+	header.OverdrawThreshold = options.OverdrawThreshold;
+	header.VertexStride = vertexStride;
+	header.VertexCount = vertCounter;
+	header.IndexStride = (UINT)(indexData.size() / bufferIndexCounter); // 2 or 4
+	header.IndexCount = bufferIndexCounter;
+	header.MeshletCount = (UINT)meshlets.size();
+	header.LodCount = (UINT)lods.size();
+	header.RequestedLodCount = options.LodCount;
+	header.Compression = options.CompressCache
+		? MeshCache::CompressVertices | MeshCache::CompressIndices
+		: 0;
+	header.Bounds = bounds;
+	header.UnweldedVertexCount = unweldedVertexCount;
+	header.CacheStatsBefore = cacheStatsBefore;
+	header.CacheStatsAfter = cacheStatsAfter;
+	header.LruStatsBefore = lruStatsBefore;
+	header.LruStatsAfter = lruStatsAfter;
+	header.OverdrawStatsBefore = overdrawStatsBefore;
+	header.OverdrawStatsAfter = overdrawStatsAfter;
+	MeshCache::Write(cachePath, header, vertexData.data(), indexData.data(),
+		meshlets.data(), lods.data());
 }
 
 
 // --------------------------------------------------------
-// Mesh destructor. ComPtrs will clean themselves up, 
-// so there's nothing here that needs deleting (yet).
+// Same steps as LoadObj(), but reading the .obj through
+// ObjStream a block at a time (see ObjStreamCache.h).
+// Blocks go straight into the cache file, which LoadCache()
+// then loads like any other.
 // --------------------------------------------------------
-Mesh::~Mesh() { }
+bool Mesh::StreamObj(const char* objFile, const char* cachePath,
+	uint64_t sourceHash, MeshOptions options)
+{
+	ObjStreamSettings settings;
+	settings.Budget = options.StreamingBudget;
+	settings.OverdrawThreshold = options.OverdrawThreshold;
+	settings.PackVertices = packedVertices;
+	settings.BuildMeshlets = options.BuildMeshlets;
+	settings.BuildOrientedBox = options.BuildOrientedBox;
+	settings.SourceHash = sourceHash;
+	settings.RequestedLodCount = options.LodCount;
+	return ObjStreamCache::Write(objFile, cachePath, settings);
+}
+
+
+// --------------------------------------------------------
+// Mesh destructor. Gives the mesh's ranges back to the
+// geometry arena, so other meshes can use the space.
+// --------------------------------------------------------
+Mesh::~Mesh()
+{
+	GeometryArena::Free(vertexRange);
+	GeometryArena::Free(positionRange);
+	GeometryArena::Free(indexRange);
+}
 
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------------------------------- GETTERS --------------------------------- //
 ///////////////////////////////////////////////////////////////////////////////
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() { return vertexBuffer; }
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() { return GeometryArena::GetBuffer(vertexRange); }
 UINT Mesh::GetVertexCount() { return vertexCount; }
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() { return indexBuffer; }
+UINT Mesh::GetUnweldedVertexCount() { return unweldedVertexCount; }
+VertexCacheStats Mesh::GetCacheStatsBefore() { return cacheStatsBefore; }
+VertexCacheStats Mesh::GetCacheStatsAfter() { return cacheStatsAfter; }
+VertexCacheStats Mesh::GetLruStatsBefore() { return lruStatsBefore; }
+VertexCacheStats Mesh::GetLruStatsAfter() { return lruStatsAfter; }
+OverdrawStats Mesh::GetOverdrawStatsBefore() { return overdrawStatsBefore; }
+OverdrawStats Mesh::GetOverdrawStatsAfter() { return overdrawStatsAfter; }
+DirectX::XMFLOAT3 Mesh::GetBoundsMin() { return XMFLOAT3(bounds.BoxMin); }
+DirectX::XMFLOAT3 Mesh::GetBoundsMax() { return XMFLOAT3(bounds.BoxMax); }
+const BoundingVolumes& Mesh::GetBounds() { return bounds; }
+bool Mesh::GetLoadedFromCache() { return loadedFromCache; }
+float Mesh::GetLoadTime() { return loadTime; }
+bool Mesh::GetPackedVertices() { return packedVertices; }
+UINT Mesh::GetVertexStride() { return vertexStride; }
+UINT Mesh::GetPositionStride() { return positionStride; }
+DXGI_FORMAT Mesh::GetIndexFormat() { return indexFormat; }
+const std::vector<Meshlet>& Mesh::GetMeshlets() { return meshlets; }
+const std::vector<LodLevel>& Mesh::GetLods() { return lods; }
+uint64_t Mesh::GetId() { return id; }
+const std::vector<Vertex>& Mesh::GetGeometryVertices() { return geometryVertices; }
+const std::vector<UINT>& Mesh::GetGeometryIndices() { return geometryIndices; }
+const TriangleBvh& Mesh::GetBvh() { return bvh; }
+
+// --------------------------------------------------------
+// The stats were recorded at load (or came from the cache),
+// so this is just arithmetic. Index bytes count every level
+// of detail, since they all live in the same buffer.
+// --------------------------------------------------------
+MeshMetrics Mesh::GetMetrics()
+{
+	MeshMetrics metrics = {};
+	metrics.TriangleCount = indexCount / 3;
+	metrics.VertexCount = vertexCount;
+	if (metrics.TriangleCount == 0 || vertexCount == 0)
+		return metrics;
+
+	metrics.FifoCache = cacheStatsAfter;
+	metrics.LruCache = lruStatsAfter;
+	metrics.VertexReuse = (float)indexCount / vertexCount;
+	metrics.Overdraw = overdrawStatsAfter;
+
+	size_t vertexBytes = (size_t)vertexCount * (vertexStride + positionStride);
+	size_t bufferIndices = (size_t)lods.back().IndexOffset + lods.back().IndexCount;
+	size_t indexBytes = bufferIndices * (indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4);
+	metrics.VertexBytesPerTriangle = (float)vertexBytes / metrics.TriangleCount;
+	metrics.IndexBytesPerTriangle = (float)indexBytes / metrics.TriangleCount;
+	return metrics;
+}
+
+DirectX::XMFLOAT3 Mesh::GetPositionScale()
+{
+	XMFLOAT3 scale, offset;
+	VertexPacking::GetPositionDequantize(bounds.BoxMin, bounds.BoxMax, &scale.x, &offset.x);
+	return scale;
+}
+
+DirectX::XMFLOAT3 Mesh::GetPositionOffset()
+{
+	XMFLOAT3 scale, offset;
+	VertexPacking::GetPositionDequantize(bounds.BoxMin, bounds.BoxMax, &scale.x, &offset.x);
+	return offset;
+}
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() { return GeometryArena::GetBuffer(indexRange); }
 UINT Mesh::GetIndexCount() { return indexCount; }
 const char* Mesh::GetName() { return name; }
 
@@ -281,11 +598,9 @@ void Mesh::SetBuffersAndDraw()
 	// - Other Direct3D calls will also be necessary to do more complex things
 	{
 		// Set buffers in the input assembler (IA) stage
-		//  - Do this ONCE PER OBJECT, since each object may have different geometry
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-		Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+		//  - The buffers are shared by every mesh in the geometry arena,
+		//     so this only does anything when the last mesh was elsewhere
+		GeometryArena::Bind(vertexRange, indexRange);
 
 		// Tell Direct3D to draw
 		//  - Begins the rendering pipeline on the GPU
@@ -294,12 +609,239 @@ void Mesh::SetBuffersAndDraw()
 		//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 		//     vertices in the currently set VERTEX BUFFER
 		Graphics::Context->DrawIndexed(
-			indexCount, // The number of indices to use (we could draw a subset if we wanted)
-			0,			// Offset to the first index we want to use
-			0);			// Offset to add to each index when looking up vertices
+			indexCount,				// The number of indices to use (we could draw a subset if we wanted)
+			indexRange.Offset,		// Offset to the first index we want to use
+			vertexRange.Offset);	// Offset to add to each index when looking up vertices
 	}
 }
 
+// --------------------------------------------------------
+// Same as above, but with one draw per range of indices
+// (the meshlets that survived culling)
+// --------------------------------------------------------
+void Mesh::SetBuffersAndDraw(const std::vector<MeshletRange>& ranges)
+{
+	GeometryArena::Bind(vertexRange, indexRange);
+	for (const MeshletRange& range : ranges)
+	{
+		Graphics::Context->DrawIndexed(range.IndexCount,
+			indexRange.Offset + range.IndexOffset, vertexRange.Offset);
+	}
+}
+
+// --------------------------------------------------------
+// Draws with only positions bound, for depth-only passes.
+// The position stream is a tight array of just the first
+// positionStride bytes of each vertex, so a shader whose
+// only input is POSITION reads it the same way it reads
+// the full vertex buffer. Without a stream, that's used.
+// --------------------------------------------------------
+void Mesh::SetPositionsAndDraw()
+{
+	if (positionRange.Count == 0)
+	{
+		SetBuffersAndDraw();
+		return;
+	}
+
+	GeometryArena::Bind(positionRange, indexRange);
+	Graphics::Context->DrawIndexed(indexCount, indexRange.Offset, positionRange.Offset);
+}
+
+// --------------------------------------------------------
+// Culling happens in object space, so the frustum comes
+// from world * view * projection, and the camera position
+// is brought into object space with the inverse world.
+// --------------------------------------------------------
+size_t Mesh::CullMeshlets(XMFLOAT4X4 world, std::shared_ptr<Camera> camera,
+	std::vector<MeshletRange>& ranges)
+{
+	if (meshlets.empty())
+	{
+		ranges.assign(1, { 0, indexCount });
+		return 0;
+	}
+
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	XMFLOAT4X4 projection = camera->GetProjectionMatrix();
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+
+	XMFLOAT4X4 worldViewProjection;
+	XMStoreFloat4x4(&worldViewProjection, worldMatrix *
+		XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+
+	// Orthographic cameras see everything from the same direction,
+	// which the cone test (built around a position) doesn't handle
+	XMFLOAT3 cameraPosition = camera->GetTransform()->GetPosition();
+	XMStoreFloat3(&cameraPosition, XMVector3Transform(
+		XMLoadFloat3(&cameraPosition), XMMatrixInverse(0, worldMatrix)));
+
+	return Meshlets::Cull(meshlets, meshletCullData, &worldViewProjection._11,
+		camera->DoingPerspective() ? &cameraPosition.x : nullptr, ranges);
+}
+
+// --------------------------------------------------------
+// Picks the coarsest level of detail whose error, projected
+// onto the screen at the closest point of the (world space)
+// bounding sphere, is at most maxPixelError pixels tall.
+// --------------------------------------------------------
+size_t Mesh::SelectLod(XMFLOAT4X4 world, std::shared_ptr<Camera> camera,
+	float screenHeight, float maxPixelError)
+{
+	if (lods.size() < 2)
+		return 0;
+
+	// Errors are in object space, so scale them by the
+	// largest scale along any axis
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	float scale = XMVectorGetX(XMVectorMax(XMVector3Length(worldMatrix.r[0]),
+		XMVectorMax(XMVector3Length(worldMatrix.r[1]), XMVector3Length(worldMatrix.r[2]))));
+
+	// How many pixels one world unit covers
+	XMFLOAT3 sphereCenter(bounds.SphereCenter);
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&sphereCenter), worldMatrix));
+	float pixelsPerUnit = camera->GetPixelsPerUnit(center, bounds.SphereRadius * scale, screenHeight);
+
+	size_t selected = 0;
+	for (size_t i = 1; i < lods.size(); i++)
+	{
+		if (lods[i].Error * scale * pixelsPerUnit <= maxPixelError)
+			selected = i;
+	}
+	return selected;
+}
+
+// --------------------------------------------------------
+// Load-time optimization stage. Reorders triangles so the
+// post-transform vertex cache hits more often, then sorts
+// clusters of them so the mesh occludes more of itself, and
+// finally reorders vertices by first use so vertex fetch
+// reads sequentially. Nothing about what is drawn changes,
+// only the order. Stats are recorded before and after.
+// --------------------------------------------------------
+void Mesh::OptimizeForGPU(std::vector<Vertex>& verts, std::vector<UINT>& indices,
+	float overdrawThreshold)
+{
+	cacheStatsBefore = MeshOptimizer::AnalyzeVertexCache(
+		indices.data(), indices.size(), verts.size());
+	lruStatsBefore = MeshAnalysis::AnalyzeLruCache(
+		indices.data(), indices.size(), verts.size());
+	overdrawStatsBefore = MeshOptimizer::AnalyzeOverdraw(
+		indices.data(), indices.size(), &verts[0].Position.x, verts.size(), sizeof(Vertex));
+
+	// Triangle order first, since everything else depends on it
+	MeshOptimizer::OptimizeVertexCache(
+		indices.data(), indices.data(), indices.size(), verts.size());
+
+	// Then shuffle clusters of triangles, costing at most
+	// a little of the cache efficiency we just gained
+	MeshOptimizer::OptimizeOverdraw(
+		indices.data(), indices.data(), indices.size(),
+		&verts[0].Position.x, verts.size(), sizeof(Vertex), overdrawThreshold);
+
+	// Then renumber vertices in the order they're first used
+	std::vector<UINT> remap(verts.size());
+	size_t used = MeshOptimizer::OptimizeVertexFetchRemap(
+		remap.data(), indices.data(), indices.size(), verts.size());
+
+	std::vector<Vertex> remapped(used);
+	MeshOptimizer::RemapVertexBuffer(
+		remapped.data(), verts.data(), verts.size(), sizeof(Vertex), remap.data());
+	MeshOptimizer::RemapIndexBuffer(
+		indices.data(), indices.data(), indices.size(), remap.data());
+	verts.swap(remapped);
+
+	cacheStatsAfter = MeshOptimizer::AnalyzeVertexCache(
+		indices.data(), indices.size(), verts.size());
+	lruStatsAfter = MeshAnalysis::AnalyzeLruCache(
+		indices.data(), indices.size(), verts.size());
+	overdrawStatsAfter = MeshOptimizer::AnalyzeOverdraw(
+		indices.data(), indices.size(), &verts[0].Position.x, verts.size(), sizeof(Vertex));
+}
+
+// --------------------------------------------------------
+// Simplifies the (already optimized) full detail triangles
+// into up to lodCount - 1 coarser levels, appended to the
+// index buffer. Every level starts from the full detail
+// mesh, so its error is measured against the original.
+// Levels that can't shrink much within their error allowance
+// aren't worth the memory, and end the chain.
+// Needs the bounds, since errors scale with the mesh.
+// --------------------------------------------------------
+void Mesh::BuildLods(const std::vector<Vertex>& verts, std::vector<UINT>& indices,
+	unsigned int lodCount)
+{
+	size_t fullCount = indices.size();
+	lods.assign(1, { 0, (UINT)fullCount, 0.0f, 0.0f });
+
+	XMFLOAT3 boxMin(bounds.BoxMin);
+	XMFLOAT3 boxMax(bounds.BoxMax);
+	XMVECTOR size = XMLoadFloat3(&boxMax) - XMLoadFloat3(&boxMin);
+	float targetError = XMVectorGetX(XMVector3Length(size)) * MeshSimplifier::FirstLodError;
+	size_t targetCount = fullCount;
+
+	std::vector<UINT> lod(fullCount);
+	for (unsigned int i = 1; i < lodCount; i++)
+	{
+		targetCount = (size_t)(targetCount * MeshSimplifier::LodTriangleRatio) / 3 * 3;
+
+		float error = 0.0f;
+		size_t count = MeshSimplifier::Simplify(lod.data(), indices.data(), fullCount,
+			&verts[0].Position.x, verts.size(), sizeof(Vertex),
+			targetCount, targetError, &error);
+		if (count == 0 || count > lods.back().IndexCount * 9 / 10)
+			break;
+
+		// Each level gets its own vertex cache friendly order
+		MeshOptimizer::OptimizeVertexCache(lod.data(), lod.data(), count, verts.size());
+
+		lods.push_back({ (UINT)indices.size(), (UINT)count, error, targetError });
+		indices.insert(indices.end(), lod.begin(), lod.begin() + count);
+		targetError *= MeshSimplifier::LodErrorGrowth;
+	}
+}
+
+// --------------------------------------------------------
+// Turns encoded buffer data (packed or not, 16 or 32 bit
+// indices) back into full vertices and indices
+// --------------------------------------------------------
+void Mesh::DecodeGeometry(const void* vertexData, size_t _vertexCount,
+	const void* indexData, size_t _indexCount)
+{
+	geometryVertices.resize(_vertexCount);
+	if (packedVertices)
+	{
+		const PackedVertex* packed = (const PackedVertex*)vertexData;
+		for (size_t i = 0; i < _vertexCount; i++)
+		{
+			Vertex& v = geometryVertices[i];
+			VertexPacking::Unpack(packed[i], bounds.BoxMin, bounds.BoxMax,
+				&v.Position.x, &v.Normal.x, &v.Tangent.x, &v.UV.x);
+		}
+	}
+	else
+	{
+		memcpy(geometryVertices.data(), vertexData, sizeof(Vertex) * _vertexCount);
+	}
+
+	geometryIndices.resize(_indexCount);
+	for (size_t i = 0; i < _indexCount; i++)
+	{
+		geometryIndices[i] = (indexFormat == DXGI_FORMAT_R16_UINT)
+			? ((const uint16_t*)indexData)[i]
+			: ((const UINT*)indexData)[i];
+	}
+}
+
+// --------------------------------------------------------
+// Fits the bounding volumes around every vertex position
+// --------------------------------------------------------
+void Mesh::CalculateBounds(const Vertex* verts, size_t numVerts, bool orientedBox)
+{
+	Bounds::Calculate(bounds, &verts[0].Position.x, numVerts, sizeof(Vertex), orientedBox);
+}
+
 // --------------------------------------------------------
 // Author: Chris Cascioli
 // Purpose: Calculates the tangents of the vertices in a mesh
@@ -319,139 +861,124 @@ void Mesh::SetBuffersAndDraw()
 // --------------------------------------------------------
 void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	// SIMD and multithreaded, and guards against degenerate
+	// UVs (see TangentGenerator.h)
+	TangentGenerator::Calculate(&verts[0].Position.x, &verts[0].Normal.x,
+		&verts[0].UV.x, &verts[0].Tangent.x, sizeof(Vertex), numVerts,
+		indices, numIndices);
+}
+
+
+// --------------------------------------------------------
+// Converts full vertices and 32 bit indices into the bytes
+// the buffers will actually hold. Vertices are packed if
+// this mesh uses PackedVertex, and indices shrink to 16 bits
+// whenever every index fits. Sets indexFormat to match.
+// --------------------------------------------------------
+void Mesh::EncodeBuffers(const Vertex* vertices, size_t _vertexCount,
+	const UINT* indices, size_t _indexCount,
+	std::vector<char>& vertexData, std::vector<char>& indexData)
+{
+	EncodeVertices(vertices, _vertexCount, vertexData);
+
+	if (_vertexCount <= 65536)
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+		indexFormat = DXGI_FORMAT_R16_UINT;
+		indexData.resize(sizeof(uint16_t) * _indexCount);
+		uint16_t* narrow = (uint16_t*)indexData.data();
+		for (size_t i = 0; i < _indexCount; i++)
+			narrow[i] = (uint16_t)indices[i];
 	}
-
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	else
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+		indexFormat = DXGI_FORMAT_R32_UINT;
+		indexData.resize(sizeof(UINT) * _indexCount);
+		memcpy(indexData.data(), indices, indexData.size());
 	}
+}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
+// --------------------------------------------------------
+// Just the vertex half of EncodeBuffers()
+// --------------------------------------------------------
+void Mesh::EncodeVertices(const Vertex* vertices, size_t _vertexCount,
+	std::vector<char>& vertexData)
+{
+	vertexData.resize(vertexStride * _vertexCount);
+	if (packedVertices)
 	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
+		PackedVertex* packed = (PackedVertex*)vertexData.data();
+		for (size_t i = 0; i < _vertexCount; i++)
+		{
+			const Vertex& v = vertices[i];
+			packed[i] = VertexPacking::Pack(&v.Position.x, &v.Normal.x,
+				&v.Tangent.x, &v.UV.x, bounds.BoxMin, bounds.BoxMax);
+		}
+	}
+	else
+	{
+		memcpy(vertexData.data(), vertices, vertexData.size());
 	}
 }
 
+// --------------------------------------------------------
+// Private helper method for setting up the vertex and
+// index buffers from full vertex data. Encodes it first.
+// --------------------------------------------------------
+void Mesh::CreateBuffers(const Vertex* vertices, size_t _vertexCount,
+	const UINT* indices, size_t _indexCount)
+{
+	std::vector<char> vertexData;
+	std::vector<char> indexData;
+	EncodeBuffers(vertices, _vertexCount, indices, _indexCount, vertexData, indexData);
+	CreateBuffers(vertexData.data(), _vertexCount, indexData.data(), _indexCount);
+}
 
 // --------------------------------------------------------
 // Private helper method for setting up the vertex and
-// index buffers. Called by the Mesh constructors.
+// index buffers from already encoded data, laid out as
+// vertexStride and indexFormat say. Called by the Mesh
+// constructors (directly, when loading a cache file).
+// The data goes into the shared buffers of the geometry
+// arena rather than buffers of this mesh's own.
 // --------------------------------------------------------
-void Mesh::CreateBuffers(Vertex* vertices, size_t _vertexCount, 
-	UINT* indices, size_t _indexCount)
+void Mesh::CreateBuffers(const void* vertexData, size_t _vertexCount,
+	const void* indexData, size_t _indexCount)
 {
 	// Explicit cast to UINT to avoid warnings
 	vertexCount = (UINT)_vertexCount;
 	indexCount = (UINT)_indexCount;
 
-	// Create a VERTEX BUFFER
-	// - This holds the vertex data of triangles for a single object
-	// - This buffer is created on the GPU, which is where the data needs to
+	// Copy the vertices and indices into the arena
+	// - The arena's buffers are created on the GPU, which is where the data needs to
 	//    be if we want the GPU to act on it (as in: draw it to the screen)
+	// - Each mesh only gets a range of vertices and indices within them
+	// - Copied a window at a time, so a huge mesh (which may still
+	//    be in a mapped file) never has to be staged all at once
+	vertexRange = GeometryArena::AllocateVertices(nullptr, vertexCount, vertexStride);
+	indexRange = GeometryArena::AllocateIndices(nullptr, indexCount, indexFormat);
+	UploadInWindows(vertexRange, vertexData, vertexStride);
+	UploadInWindows(indexRange, indexData,
+		indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(UINT));
+
+	// Create the optional POSITION STREAM
+	// - Positions are the first member of both vertex structs,
+	//    so this is the front of each vertex copied into a tight array
+	// - Depth-only passes fetch 3-5x less data from it
+	// - Built and uploaded one window at a time, for the same reason
+	if (positionStride > 0)
 	{
-		// First, we need to describe the buffer we want Direct3D to make on the GPU
-		//  - Note that this variable is created on the stack since we only need it once
-		//  - After the buffer is created, this description variable is unnecessary
-		D3D11_BUFFER_DESC vbd = {};
-		vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		vbd.ByteWidth = sizeof(Vertex) * vertexCount; // number of vertices in the buffer
-		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
-		vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		vbd.MiscFlags = 0;
-		vbd.StructureByteStride = 0;
-
-		// Create the proper struct to hold the initial vertex data
-		// - This is how we initially fill the buffer with data
-		// - Essentially, we're specifying a pointer to the data to copy
-		D3D11_SUBRESOURCE_DATA initialVertexData = {};
-		initialVertexData.pSysMem = vertices; // pSysMem = Pointer to System Memory
-
-		// Actually create the buffer on the GPU with the initial data
-		// - Once we do this, we'll NEVER CHANGE DATA IN THE BUFFER AGAIN
-		Graphics::Device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
-	}
+		positionRange = GeometryArena::AllocateVertices(nullptr, vertexCount, positionStride);
 
-	// Create an INDEX BUFFER
-	// - This holds indices to elements in the vertex buffer
-	// - This is most useful when vertices are shared among neighboring triangles
-	// - This buffer is created on the GPU, which is where the data needs to
-	//    be if we want the GPU to act on it (as in: draw it to the screen)
-	{
-		// Describe the buffer, as we did above, with two major differences
-		//  - Byte Width (3 unsigned integers vs. 3 whole vertices)
-		//  - Bind Flag (used as an index buffer instead of a vertex buffer) 
-		D3D11_BUFFER_DESC ibd = {};
-		ibd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		ibd.ByteWidth = sizeof(unsigned int) * indexCount; // number of indices in the buffer
-		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells Direct3D this is an index buffer
-		ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		ibd.MiscFlags = 0;
-		ibd.StructureByteStride = 0;
-
-		// Specify the initial data for this buffer, similar to above
-		D3D11_SUBRESOURCE_DATA initialIndexData = {};
-		initialIndexData.pSysMem = indices; // pSysMem = Pointer to System Memory
-
-		// Actually create the buffer with the initial data
-		// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-		Graphics::Device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+		size_t perWindow = std::max<size_t>(UploadWindowBytes / positionStride, 1);
+		std::vector<char> positions(positionStride * std::min<size_t>(perWindow, vertexCount));
+		const char* source = (const char*)vertexData;
+		for (size_t first = 0; first < vertexCount; first += perWindow)
+		{
+			size_t count = std::min<size_t>(perWindow, vertexCount - first);
+			VertexPacking::ExtractPositions(positions.data(), source + first * vertexStride,
+				count, vertexStride, positionStride);
+			GeometryArena::Upload(positionRange, (unsigned int)first,
+				positions.data(), (unsigned int)count);
+		}
 	}
 }
@@ -7,8 +7,80 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 
+#include <cstdint>
+#include <vector>
+
 #include "Graphics.h"
 #include "Vertex.h"
+#include "Camera.h"
+#include "MappedFile.h"
+#include "MeshAnalysis.h"
+#include "MeshOptimizer.h"
+#include "Bounds.h"
+#include "GeometryArena.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "TriangleBvh.h"
+#include "UploadStamp.h"
+#include "VertexPacking.h"
+
+
+// --------------------------------------------------------
+// Settings for loading a mesh from a file
+// --------------------------------------------------------
+struct MeshOptions
+{
+	// How much vertex cache efficiency may be traded
+	// for less overdraw (see MeshOptimizer.h)
+	float OverdrawThreshold = MeshOptimizer::DefaultOverdrawThreshold;
+
+	// Store PackedVertex (20 bytes) instead of Vertex (44 bytes).
+	// Needs the packed vertex shader variants to draw.
+	bool PackVertices = false;
+
+	// Also keep a position-only copy of the vertices for depth-only
+	// passes (12 bytes per vertex, or 8 if vertices are packed)
+	bool KeepPositionStream = false;
+
+	// Split into meshlets (see Meshlets.h) that can be
+	// culled against the camera individually
+	bool BuildMeshlets = false;
+
+	// Levels of detail, counting the full detail mesh (at most
+	// MeshSimplifier::MaxLods). The simplified levels share the
+	// vertex buffer, and live after the full detail indices.
+	unsigned int LodCount = 1;
+
+	// Also fit an oriented box (see Bounds.h). The axis-aligned
+	// box and the sphere are always there.
+	bool BuildOrientedBox = false;
+
+	// Keep a CPU copy of the full detail vertices and indices
+	// after the buffers are made, for anything that needs to
+	// read the geometry back (like static batching)
+	bool KeepGeometry = false;
+
+	// Build a triangle BVH (see TriangleBvh.h) for ray queries
+	// against the full detail geometry. The BVH keeps its own
+	// copy of the triangles, so this works with or without
+	// KeepGeometry.
+	bool BuildBvh = false;
+
+	// Peak bytes an .obj load may use, or 0 for no limit. When
+	// set, the file is streamed instead of parsed all at once:
+	// only the v / vt / vn data is held whole, and faces are
+	// built a block at a time straight into the cache file.
+	// Vertices are only welded (and tangents only smoothed)
+	// within a block, and levels of detail aren't built. If
+	// the attributes alone don't fit, the mesh is left empty.
+	size_t StreamingBudget = 0;
+
+	// Compress the vertices and indices in the cache file (see
+	// GeometryCodec.h), which are then decoded on every load.
+	// Only matters when the cache gets written; a cache is
+	// loaded either way. Streamed loads are never compressed.
+	bool CompressCache = true;
+};
 
 
 // --------------------------------------------------------
@@ -22,7 +94,8 @@ public:
 	Mesh(Vertex* vertices, size_t _vertexCount,
 		UINT* indices, size_t _indexCount,
 		const char* _name);
-	Mesh(const char* _name, const char* objFile);
+	Mesh(const char* _name, const char* file,
+		MeshOptions options = MeshOptions());
 	~Mesh();
 
 	// No copy constructor and copy assignment operator
@@ -33,27 +106,176 @@ public:
 	UINT GetIndexCount();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	UINT GetVertexCount();
+	UINT GetUnweldedVertexCount();
+	VertexCacheStats GetCacheStatsBefore();
+	VertexCacheStats GetCacheStatsAfter();
+	VertexCacheStats GetLruStatsBefore();
+	VertexCacheStats GetLruStatsAfter();
+	OverdrawStats GetOverdrawStatsBefore();
+	OverdrawStats GetOverdrawStatsAfter();
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+	const BoundingVolumes& GetBounds();
+	bool GetLoadedFromCache();
+	float GetLoadTime();
+	bool GetPackedVertices();
+	UINT GetVertexStride();
+	UINT GetPositionStride();
+	DXGI_FORMAT GetIndexFormat();
+	const std::vector<Meshlet>& GetMeshlets();
+	const std::vector<LodLevel>& GetLods();
+	uint64_t GetId();	// Never reused (see UploadStamps)
+
+	// Everything in MeshMetrics for the mesh as loaded (after
+	// the optimization stage), with the buffers' real sizes
+	MeshMetrics GetMetrics();
+
+	// Empty unless MeshOptions::KeepGeometry was set (always
+	// unpacked Vertex structs, and only the full detail indices)
+	const std::vector<Vertex>& GetGeometryVertices();
+	const std::vector<UINT>& GetGeometryIndices();
+
+	// Not built unless MeshOptions::BuildBvh was set. Object
+	// space, and hits report full detail triangle indices.
+	const TriangleBvh& GetBvh();
+
+	// What the packed vertex shaders need to turn quantized
+	// positions back into object space (see VertexPacking.h)
+	DirectX::XMFLOAT3 GetPositionScale();
+	DirectX::XMFLOAT3 GetPositionOffset();
 	const char* GetName();
 
 	// Sets buffers and draws the mesh to the screen
 	void SetBuffersAndDraw();
 
+	// Same, but only draws the given runs of indices
+	void SetBuffersAndDraw(const std::vector<MeshletRange>& ranges);
+
+	// Same, but binds the position-only stream if there is one.
+	// Only for shaders that read nothing but POSITION.
+	void SetPositionsAndDraw();
+
+	// Culls this mesh's meshlets for an instance with the given world
+	// matrix, filling "ranges" with what to draw. Returns how many
+	// meshlets survived. Meshes without meshlets aren't culled, and
+	// just get one range covering everything.
+	size_t CullMeshlets(DirectX::XMFLOAT4X4 world, std::shared_ptr<Camera> camera,
+		std::vector<MeshletRange>& ranges);
+
+	// Which level of detail an instance with the given world matrix
+	// should draw, so its error stays under maxPixelError pixels
+	size_t SelectLod(DirectX::XMFLOAT4X4 world, std::shared_ptr<Camera> camera,
+		float screenHeight, float maxPixelError);
+
 private:
+	// The ways of loading from a file
+	bool LoadCache(const char* cachePath, uint64_t sourceHash, MeshOptions options);
+	void LoadObj(const MappedFile& source, const char* cachePath,
+		uint64_t sourceHash, MeshOptions options);
+	void LoadGlb(const MappedFile& source, const char* cachePath,
+		uint64_t sourceHash, MeshOptions options);
+
+	// Everything after assembling vertices and indices that the
+	// file formats share, down to creating buffers and the cache
+	void ProcessGeometry(std::vector<Vertex>& verts, std::vector<UINT>& indices,
+		const char* cachePath, uint64_t sourceHash, MeshOptions options);
+
+	// The bounded memory version of LoadObj(), which only
+	// writes the cache file (for LoadCache() to load)
+	bool StreamObj(const char* objFile, const char* cachePath,
+		uint64_t sourceHash, MeshOptions options);
+
 	// Helper method provided by Chris Cascioli
 	void CalculateTangents(Vertex* verts, int numVerts, 
 		unsigned int* indices, int numIndices);
 
-	// Helper method for creating vertex and index buffers
-	void CreateBuffers(Vertex* vertices, size_t _vertexCount,
-		UINT* indices, size_t _indexCount);
+	// Load-time triangle and vertex reordering
+	void OptimizeForGPU(std::vector<Vertex>& verts, std::vector<UINT>& indices,
+		float overdrawThreshold);
+
+	// Fills in bounds
+	void CalculateBounds(const Vertex* verts, size_t numVerts, bool orientedBox);
+
+	// Fills in the CPU copy of the geometry from encoded buffer data
+	void DecodeGeometry(const void* vertexData, size_t _vertexCount,
+		const void* indexData, size_t _indexCount);
+
+	// Appends simplified levels to the index buffer, filling in lods
+	void BuildLods(const std::vector<Vertex>& verts, std::vector<UINT>& indices,
+		unsigned int lodCount);
+
+	// Converts vertices and indices into exactly what the
+	// buffers will hold (packed or not, 16 or 32 bit indices)
+	void EncodeBuffers(const Vertex* vertices, size_t _vertexCount,
+		const UINT* indices, size_t _indexCount,
+		std::vector<char>& vertexData, std::vector<char>& indexData);
+	void EncodeVertices(const Vertex* vertices, size_t _vertexCount,
+		std::vector<char>& vertexData);
+
+	// Helper methods for creating vertex and index buffers, either
+	// from full data, or from data that's already been encoded
+	void CreateBuffers(const Vertex* vertices, size_t _vertexCount,
+		const UINT* indices, size_t _indexCount);
+	void CreateBuffers(const void* vertexData, size_t _vertexCount,
+		const void* indexData, size_t _indexCount);
 
-	// Vertices of the triangles making up the mesh
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	// Vertices of the triangles making up the mesh, either
+	// Vertex or PackedVertex structs, in the geometry arena
+	ArenaRange vertexRange;
 	UINT vertexCount;
+	bool packedVertices;
+	UINT vertexStride;
 
-	// Indices of the vertices of the triangles making up the mesh
-	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	// Optional position-only copy of the vertex buffer
+	// (positionStride is 0 when there isn't one)
+	ArenaRange positionRange;
+	UINT positionStride;
+
+	// How many vertices there would be if identical
+	// .obj corners had not been welded together
+	UINT unweldedVertexCount;
+
+	// Simulated vertex cache efficiency before and
+	// after the load-time optimization stage
+	VertexCacheStats cacheStatsBefore;
+	VertexCacheStats cacheStatsAfter;
+	VertexCacheStats lruStatsBefore;
+	VertexCacheStats lruStatsAfter;
+
+	// Estimated overdraw (from the software rasterizer)
+	// before and after the same stage
+	OverdrawStats overdrawStatsBefore;
+	OverdrawStats overdrawStatsAfter;
+
+	// Clusters of triangles, and their bounds laid out for culling
+	std::vector<Meshlet> meshlets;
+	MeshletCullData meshletCullData;
+
+	// Object space bounding volumes of the vertex positions
+	BoundingVolumes bounds;
+
+	// Whether the binary cache was used, and how long
+	// the whole load took in milliseconds
+	bool loadedFromCache;
+	float loadTime;
+
+	// Indices of the vertices of the triangles making up the mesh,
+	// 16 bit whenever there are few enough vertices. The buffer
+	// holds every level of detail, and indexCount is the first's.
+	// Index offsets everywhere else are relative to indexRange.
+	ArenaRange indexRange;
 	UINT indexCount;
+	DXGI_FORMAT indexFormat;
+	std::vector<LodLevel> lods;
+
+	// Optional CPU copy of the full detail geometry
+	std::vector<Vertex> geometryVertices;
+	std::vector<UINT> geometryIndices;
+
+	// Optional ray query structure over the same geometry
+	TriangleBvh bvh;
+
+	uint64_t id;
 
 	// Name of the mesh for ImGui to display
 	const char* name;
@@ -0,0 +1,304 @@
+/*
+William Duprey
+12/10/24
+Mesh Analysis Implementation
+*/
+
+#include "MeshAnalysis.h"
+#include "GltfParser.h"
+#include "MappedFile.h"
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// Lower-cased extension, dot included (".obj")
+	// --------------------------------------------------------
+	std::string GetExtension(const std::string& path)
+	{
+		std::string extension = std::filesystem::path(path).extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](char c) { return (char)tolower((unsigned char)c); });
+		return extension;
+	}
+
+	bool IsMeshFile(const std::string& path)
+	{
+		std::string extension = GetExtension(path);
+		return extension == ".obj" || extension == ".glb";
+	}
+
+	// --------------------------------------------------------
+	// Welded positions and indices of an .obj, converted to
+	// left-handed like Mesh::LoadObj() does
+	// --------------------------------------------------------
+	bool LoadObjGeometry(const char* path,
+		std::vector<float>& positions, std::vector<unsigned int>& indices)
+	{
+		ObjData obj;
+		if (!ObjParser::ParseFile(path, obj))
+			return false;
+
+		std::vector<ObjIndex> uniqueCorners;
+		ObjParser::WeldCorners(obj.Corners, uniqueCorners, indices);
+
+		positions.assign(uniqueCorners.size() * 3, 0.0f);
+		for (size_t i = 0; i < uniqueCorners.size(); i++)
+		{
+			int position = uniqueCorners[i].Position;
+			if (position < 0)
+				continue;
+			positions[i * 3 + 0] = obj.Positions[position * 3 + 0];
+			positions[i * 3 + 1] = obj.Positions[position * 3 + 1];
+			positions[i * 3 + 2] = -obj.Positions[position * 3 + 2];
+		}
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			std::swap(indices[i + 1], indices[i + 2]);
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Every primitive of a .glb, placed by its node and
+	// converted to left-handed like Mesh::LoadGlb() does
+	// --------------------------------------------------------
+	bool LoadGlbGeometry(const char* path,
+		std::vector<float>& positions, std::vector<unsigned int>& indices)
+	{
+		MappedFile file(path);
+		std::vector<GltfPrimitive> primitives;
+		if (!file.IsOpen() || !GltfParser::ParseMemory(file.GetData(), file.GetSize(), primitives))
+			return false;
+
+		for (const GltfPrimitive& primitive : primitives)
+		{
+			// Row vectors, so a point is x * row 0 + y * row 1 + ...
+			const float* m = primitive.Transform;
+			unsigned int baseVertex = (unsigned int)(positions.size() / 3);
+			for (size_t i = 0; i < primitive.Positions.Count; i++)
+			{
+				float p[3] = {};
+				primitive.Positions.Read(i, p, 3);
+				positions.push_back(p[0] * m[0] + p[1] * m[4] + p[2] * m[8] + m[12]);
+				positions.push_back(p[0] * m[1] + p[1] * m[5] + p[2] * m[9] + m[13]);
+				positions.push_back(-(p[0] * m[2] + p[1] * m[6] + p[2] * m[10] + m[14]));
+			}
+
+			// A mirroring node already flipped the winding
+			float determinant =
+				m[0] * (m[5] * m[10] - m[6] * m[9]) -
+				m[1] * (m[4] * m[10] - m[6] * m[8]) +
+				m[2] * (m[4] * m[9] - m[5] * m[8]);
+			size_t firstIndex = indices.size();
+			GltfParser::ReadTriangles(primitive, baseVertex, indices);
+			if (determinant > 0.0f)
+			{
+				for (size_t i = firstIndex; i + 2 < indices.size(); i += 3)
+					std::swap(indices[i + 1], indices[i + 2]);
+			}
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Quotes a string for JSON (file paths have backslashes)
+	// --------------------------------------------------------
+	void WriteJsonString(std::ostream& out, const std::string& value)
+	{
+		const char* hex = "0123456789abcdef";
+		out << '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+				out << '\\' << c;
+			else if ((unsigned char)c < 0x20)
+				out << "\\u00" << hex[(c >> 4) & 15] << hex[c & 15];
+			else
+				out << c;
+		}
+		out << '"';
+	}
+
+	void WriteJsonCache(std::ostream& out, const char* name, const VertexCacheStats& stats)
+	{
+		out << "\"" << name << "\": { \"acmr\": " << stats.ACMR
+			<< ", \"atvr\": " << stats.ATVR
+			<< ", \"verticesTransformed\": " << stats.VerticesTransformed << " }";
+	}
+}
+
+// --------------------------------------------------------
+// The cache is small, so a plain array kept in most to
+// least recently used order is fast enough
+// --------------------------------------------------------
+VertexCacheStats MeshAnalysis::AnalyzeLruCache(const unsigned int* indices,
+	size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount < 3 || vertexCount == 0 || cacheSize == 0)
+		return stats;
+
+	std::vector<unsigned int> cache;
+	cache.reserve(cacheSize);
+	std::vector<bool> referenced(vertexCount, false);
+	size_t uniqueVertices = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int index = indices[i];
+		auto found = std::find(cache.begin(), cache.end(), index);
+		if (found != cache.end())
+		{
+			// Hit: to the front, everything before it moves back
+			std::rotate(cache.begin(), found, found + 1);
+		}
+		else
+		{
+			// Miss: the least recently used falls off the back
+			if (cache.size() == cacheSize)
+				cache.pop_back();
+			cache.insert(cache.begin(), index);
+			stats.VerticesTransformed++;
+		}
+
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.ACMR = (float)stats.VerticesTransformed / (float)(indexCount / 3);
+	stats.ATVR = (float)stats.VerticesTransformed / (float)uniqueVertices;
+	return stats;
+}
+
+MeshMetrics MeshAnalysis::Analyze(const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	size_t vertexStride, size_t indexStride)
+{
+	MeshMetrics metrics = {};
+	metrics.TriangleCount = (unsigned int)(indexCount / 3);
+	metrics.VertexCount = (unsigned int)vertexCount;
+	if (metrics.TriangleCount == 0 || vertexCount == 0)
+		return metrics;
+
+	metrics.FifoCache = MeshOptimizer::AnalyzeVertexCache(indices, indexCount, vertexCount);
+	metrics.LruCache = AnalyzeLruCache(indices, indexCount, vertexCount);
+	metrics.VertexReuse = (float)indexCount / (float)vertexCount;
+	metrics.Overdraw = MeshOptimizer::AnalyzeOverdraw(
+		indices, indexCount, positions, vertexCount, positionStride);
+	metrics.VertexBytesPerTriangle = (float)(vertexCount * vertexStride) / metrics.TriangleCount;
+	metrics.IndexBytesPerTriangle = (float)(indexCount * indexStride) / metrics.TriangleCount;
+	return metrics;
+}
+
+bool MeshAnalysis::AnalyzeFile(const char* path, size_t vertexStride, MeshReport& report)
+{
+	report = {};
+	report.File = path;
+
+	std::vector<float> positions;
+	std::vector<unsigned int> indices;
+	std::string extension = GetExtension(path);
+	bool loaded = false;
+	if (extension == ".obj")
+		loaded = LoadObjGeometry(path, positions, indices);
+	else if (extension == ".glb")
+		loaded = LoadGlbGeometry(path, positions, indices);
+	else
+	{
+		report.Error = "not an .obj or .glb file";
+		return false;
+	}
+
+	if (!loaded)
+	{
+		report.Error = "failed to load";
+		return false;
+	}
+	if (indices.empty())
+	{
+		report.Error = "no triangles";
+		return false;
+	}
+
+	size_t vertexCount = positions.size() / 3;
+	size_t indexStride = vertexCount <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+	report.Metrics = Analyze(indices.data(), indices.size(),
+		positions.data(), vertexCount, sizeof(float) * 3, vertexStride, indexStride);
+	return true;
+}
+
+// --------------------------------------------------------
+// Directory contents are sorted, so reports come out in the
+// same order every run and can be diffed
+// --------------------------------------------------------
+void MeshAnalysis::AnalyzeFiles(const std::vector<std::string>& paths, size_t vertexStride,
+	std::vector<MeshReport>& reports)
+{
+	std::vector<std::string> files;
+	for (const std::string& path : paths)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_directory(path, error))
+		{
+			files.push_back(path);
+			continue;
+		}
+
+		std::vector<std::string> found;
+		for (const auto& entry : std::filesystem::directory_iterator(path, error))
+		{
+			if (entry.is_regular_file(error) && IsMeshFile(entry.path().string()))
+				found.push_back(entry.path().string());
+		}
+		std::sort(found.begin(), found.end());
+		files.insert(files.end(), found.begin(), found.end());
+	}
+
+	reports.resize(files.size());
+	for (size_t i = 0; i < files.size(); i++)
+		AnalyzeFile(files[i].c_str(), vertexStride, reports[i]);
+}
+
+void MeshAnalysis::WriteJson(std::ostream& out, const std::vector<MeshReport>& reports)
+{
+	out << "{\n\t\"cacheSize\": " << MeshOptimizer::DefaultCacheSize << ",\n\t\"meshes\": [";
+	for (size_t i = 0; i < reports.size(); i++)
+	{
+		const MeshReport& report = reports[i];
+		const MeshMetrics& metrics = report.Metrics;
+		out << (i == 0 ? "\n" : ",\n") << "\t\t{\n\t\t\t\"file\": ";
+		WriteJsonString(out, report.File);
+		if (!report.Error.empty())
+		{
+			out << ",\n\t\t\t\"error\": ";
+			WriteJsonString(out, report.Error);
+			out << "\n\t\t}";
+			continue;
+		}
+
+		out << ",\n\t\t\t\"triangles\": " << metrics.TriangleCount;
+		out << ",\n\t\t\t\"vertices\": " << metrics.VertexCount;
+		out << ",\n\t\t\t";
+		WriteJsonCache(out, "fifoCache", metrics.FifoCache);
+		out << ",\n\t\t\t";
+		WriteJsonCache(out, "lruCache", metrics.LruCache);
+		out << ",\n\t\t\t\"vertexReuse\": " << metrics.VertexReuse;
+		out << ",\n\t\t\t\"overdraw\": " << metrics.Overdraw.Overdraw;
+		out << ",\n\t\t\t\"vertexBytesPerTriangle\": " << metrics.VertexBytesPerTriangle;
+		out << ",\n\t\t\t\"indexBytesPerTriangle\": " << metrics.IndexBytesPerTriangle;
+		out << ",\n\t\t\t\"bytesPerTriangle\": "
+			<< metrics.VertexBytesPerTriangle + metrics.IndexBytesPerTriangle;
+		out << "\n\t\t}";
+	}
+	out << (reports.empty() ? "]\n}\n" : "\n\t]\n}\n");
+}
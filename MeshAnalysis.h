@@ -0,0 +1,83 @@
+/*
+William Duprey
+12/10/24
+Mesh Analysis Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+// --------------------------------------------------------
+// How GPU friendly a mesh is, in one place, for both the
+// inspector and the command line analyzer.
+//  - FifoCache / LruCache: a MeshOptimizer::DefaultCacheSize
+//    entry post-transform cache of each kind (see
+//    VertexCacheStats). Real hardware sits somewhere between.
+//  - VertexReuse: triangle corners per vertex. About 6 for a
+//    big closed grid, 1 means nothing is shared at all.
+//  - Overdraw: from MeshOptimizer::AnalyzeOverdraw()
+//  - Bytes per triangle: vertex and index buffer memory
+//    divided by the full detail triangle count
+// --------------------------------------------------------
+struct MeshMetrics
+{
+	unsigned int TriangleCount;
+	unsigned int VertexCount;
+	VertexCacheStats FifoCache;
+	VertexCacheStats LruCache;
+	float VertexReuse;
+	OverdrawStats Overdraw;
+	float VertexBytesPerTriangle;
+	float IndexBytesPerTriangle;
+};
+
+// --------------------------------------------------------
+// A named MeshMetrics, one per file the analyzer looked at.
+// Error is empty unless the file failed to load.
+// --------------------------------------------------------
+struct MeshReport
+{
+	std::string File;
+	std::string Error;
+	MeshMetrics Metrics;
+};
+
+// --------------------------------------------------------
+// Measures meshes without drawing them.
+// --------------------------------------------------------
+namespace MeshAnalysis
+{
+	// Simulates a least recently used post-transform cache over
+	// the index buffer (hits move a vertex to the front, instead
+	// of leaving it where it entered like a FIFO does)
+	VertexCacheStats AnalyzeLruCache(const unsigned int* indices,
+		size_t indexCount, size_t vertexCount,
+		unsigned int cacheSize = MeshOptimizer::DefaultCacheSize);
+
+	// Everything in MeshMetrics, from the geometry. "positions"
+	// points at the first vertex's xyz, "positionStride" bytes
+	// apart. vertexStride and indexStride are the sizes the
+	// buffers would use, for the bytes per triangle.
+	MeshMetrics Analyze(const unsigned int* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		size_t vertexStride, size_t indexStride);
+
+	// Loads an .obj or .glb the way Mesh does (welded and made
+	// left-handed), but NOT optimized, so the metrics are the
+	// asset's own. Index size follows the vertex count, as in
+	// Mesh. Fills in report.Error and returns false on failure.
+	bool AnalyzeFile(const char* path, size_t vertexStride, MeshReport& report);
+
+	// Analyzes every path given, looking inside directories
+	// (not recursively) for .obj and .glb files
+	void AnalyzeFiles(const std::vector<std::string>& paths, size_t vertexStride,
+		std::vector<MeshReport>& reports);
+
+	// One JSON object, with a "meshes" array of the reports
+	void WriteJson(std::ostream& out, const std::vector<MeshReport>& reports);
+}
@@ -0,0 +1,386 @@
+/*
+William Duprey
+12/10/24
+Mesh Cache Implementation
+*/
+
+#include "MeshCache.h"
+#include "GeometryCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const char Magic[4] = { 'W', 'D', 'M', 'C' };
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Whether "bytes" starting at "offset" fit in "size" bytes,
+	// without overflowing on the huge values of a corrupt header
+	bool Fits(uint64_t offset, uint64_t bytes, uint64_t size)
+	{
+		return offset <= size && bytes <= size - offset;
+	}
+
+	// Whether every index is below the vertex count
+	template<typename T>
+	bool IndicesInRange(const T* indices, size_t count, uint32_t vertexCount)
+	{
+		T largest = 0;
+		for (size_t i = 0; i < count; i++)
+			largest = std::max(largest, indices[i]);
+		return count == 0 || largest < vertexCount;
+	}
+
+	// Bytes read at a time by HashFile() (a multiple of 8,
+	// so every window but the last is only whole words)
+	const size_t HashWindowBytes = 1 << 20;
+
+	// Mixes one 64-bit word into the hash (multiply + xorshift)
+	uint64_t Mix(uint64_t hash, uint64_t word)
+	{
+		hash ^= word;
+		hash *= 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	// Mixes in every word of the data, with any leftover
+	// bytes zero padded into one last word
+	uint64_t MixBytes(uint64_t hash, const unsigned char* bytes, size_t size)
+	{
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, 8);
+			hash = Mix(hash, word);
+		}
+
+		if (i < size)
+		{
+			uint64_t word = 0;
+			memcpy(&word, bytes + i, size - i);
+			hash = Mix(hash, word);
+		}
+		return hash;
+	}
+}
+
+// --------------------------------------------------------
+// Hashes 8 bytes at a time, which keeps it well ahead of
+// the .obj parser even for very large files. Not meant to
+// be cryptographic, only to notice when a file changed.
+// --------------------------------------------------------
+uint64_t MeshCache::Hash(const void* data, size_t size)
+{
+	uint64_t hash = 0xCBF29CE484222325ull ^ size;
+	hash = MixBytes(hash, (const unsigned char*)data, size);
+	return Mix(hash, 0);
+}
+
+// --------------------------------------------------------
+// Gives exactly what Hash() would for the whole file
+// --------------------------------------------------------
+bool MeshCache::HashFile(const char* path, uint64_t& hash)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+	uint64_t size = (uint64_t)file.tellg();
+	file.seekg(0);
+
+	hash = 0xCBF29CE484222325ull ^ size;
+	std::vector<unsigned char> window(HashWindowBytes);
+	uint64_t read = 0;
+	while (read < size)
+	{
+		size_t count = (size_t)std::min<uint64_t>(window.size(), size - read);
+		if (!file.read((char*)window.data(), count))
+			return false;
+		hash = MixBytes(hash, window.data(), count);
+		read += count;
+	}
+	hash = Mix(hash, 0);
+	return true;
+}
+
+// --------------------------------------------------------
+// Validates a mapped cache file and finds its blobs
+// --------------------------------------------------------
+bool MeshCache::Read(const MappedFile& file, MeshCacheView& view)
+{
+	view = {};
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshCacheHeader))
+		return false;
+
+	const MeshCacheHeader* header = (const MeshCacheHeader*)file.GetData();
+	if (memcmp(header->Magic, Magic, sizeof(Magic)) != 0 ||
+		header->Version != Version)
+		return false;
+
+	// Indices are 16 or 32 bits, and uncompressed blobs must be
+	// exactly their raw size
+	uint64_t vertexBytes = header->VertexBytes;
+	uint64_t indexBytes = header->IndexBytes;
+	if ((header->IndexStride != sizeof(uint16_t) && header->IndexStride != sizeof(uint32_t)) ||
+		(header->Compression & ~(CompressVertices | CompressIndices)) != 0 ||
+		(!(header->Compression & CompressVertices) &&
+			vertexBytes != (uint64_t)header->VertexStride * header->VertexCount) ||
+		(!(header->Compression & CompressIndices) &&
+			indexBytes != (uint64_t)header->IndexStride * header->IndexCount))
+		return false;
+
+	// Every blob must be aligned and sit entirely inside the file
+	// (a half-written file fails here instead of crashing later)
+	uint64_t size = file.GetSize();
+	uint64_t meshletBytes = (uint64_t)sizeof(Meshlet) * header->MeshletCount;
+	uint64_t lodBytes = (uint64_t)sizeof(LodLevel) * header->LodCount;
+	if (header->VertexOffset % BlobAlignment != 0 ||
+		header->IndexOffset % BlobAlignment != 0 ||
+		header->MeshletOffset % BlobAlignment != 0 ||
+		header->LodOffset % BlobAlignment != 0 ||
+		header->VertexOffset < sizeof(MeshCacheHeader) ||
+		!Fits(header->VertexOffset, vertexBytes, size) ||
+		!Fits(header->IndexOffset, indexBytes, size) ||
+		!Fits(header->MeshletOffset, meshletBytes, size) ||
+		!Fits(header->LodOffset, lodBytes, size))
+		return false;
+
+	// Uncompressed indices must stay in the vertex buffer (the
+	// compressed ones are checked as they're decoded)
+	const char* data = file.GetData();
+	if (!(header->Compression & CompressIndices))
+	{
+		const char* indices = data + header->IndexOffset;
+		if (header->IndexStride == sizeof(uint16_t)
+			? !IndicesInRange((const uint16_t*)indices, header->IndexCount, header->VertexCount)
+			: !IndicesInRange((const uint32_t*)indices, header->IndexCount, header->VertexCount))
+			return false;
+	}
+
+	// Every LOD and meshlet must be a run of the index buffer
+	const Meshlet* meshlets = (const Meshlet*)(data + header->MeshletOffset);
+	const LodLevel* lods = (const LodLevel*)(data + header->LodOffset);
+	for (uint32_t i = 0; i < header->LodCount; i++)
+	{
+		if ((uint64_t)lods[i].IndexOffset + lods[i].IndexCount > header->IndexCount)
+			return false;
+	}
+	for (uint32_t i = 0; i < header->MeshletCount; i++)
+	{
+		if ((uint64_t)meshlets[i].IndexOffset + (uint64_t)meshlets[i].TriangleCount * 3 > header->IndexCount)
+			return false;
+	}
+
+	view.Header = header;
+	view.Vertices = data + header->VertexOffset;
+	view.Indices = data + header->IndexOffset;
+	view.Meshlets = meshlets;
+	view.Lods = lods;
+	return true;
+}
+
+// --------------------------------------------------------
+// Compressed blobs are decoded straight into their vectors,
+// with every index checked against the vertex count
+// --------------------------------------------------------
+bool MeshCache::Decompress(MeshCacheView& view,
+	std::vector<char>& vertices, std::vector<char>& indices)
+{
+	const MeshCacheHeader* header = view.Header;
+	if (header->Compression & CompressVertices)
+	{
+		vertices.resize((size_t)header->VertexStride * header->VertexCount);
+		if (!GeometryCodec::DecodeVertices(vertices.data(), header->VertexCount, header->VertexStride,
+			(const unsigned char*)view.Vertices, (size_t)header->VertexBytes))
+			return false;
+		view.Vertices = vertices.data();
+	}
+
+	if (header->Compression & CompressIndices)
+	{
+		indices.resize((size_t)header->IndexStride * header->IndexCount);
+		if (!GeometryCodec::DecodeIndices(indices.data(), header->IndexCount, header->IndexStride,
+			header->VertexCount, (const unsigned char*)view.Indices, (size_t)header->IndexBytes))
+			return false;
+		view.Indices = indices.data();
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Writes the header, then the vertex, index, meshlet and LOD
+// blobs, with zero padding in between to keep each aligned.
+// Compressed blobs are encoded here first.
+// --------------------------------------------------------
+bool MeshCache::Write(const char* path, const MeshCacheHeader& header,
+	const void* vertices, const void* indices,
+	const Meshlet* meshlets, const LodLevel* lods)
+{
+	size_t vertexBytes = (size_t)header.VertexStride * header.VertexCount;
+	size_t indexBytes = (size_t)header.IndexStride * header.IndexCount;
+	size_t meshletBytes = sizeof(Meshlet) * header.MeshletCount;
+	size_t lodBytes = sizeof(LodLevel) * header.LodCount;
+
+	std::vector<unsigned char> compressedVertices;
+	if (header.Compression & CompressVertices)
+	{
+		GeometryCodec::EncodeVertices(compressedVertices, vertices, header.VertexCount, header.VertexStride);
+		vertices = compressedVertices.data();
+		vertexBytes = compressedVertices.size();
+	}
+
+	std::vector<unsigned char> compressedIndices;
+	if (header.Compression & CompressIndices)
+	{
+		GeometryCodec::EncodeIndices(compressedIndices, indices, header.IndexCount, header.IndexStride);
+		indices = compressedIndices.data();
+		indexBytes = compressedIndices.size();
+	}
+
+	MeshCacheHeader out = header;
+	memcpy(out.Magic, Magic, sizeof(Magic));
+	out.Version = Version;
+	out.VertexBytes = vertexBytes;
+	out.IndexBytes = indexBytes;
+	out.VertexOffset = AlignUp(sizeof(MeshCacheHeader), BlobAlignment);
+	out.IndexOffset = AlignUp((size_t)out.VertexOffset + vertexBytes, BlobAlignment);
+	out.MeshletOffset = AlignUp((size_t)out.IndexOffset + indexBytes, BlobAlignment);
+	out.LodOffset = AlignUp((size_t)out.MeshletOffset + meshletBytes, BlobAlignment);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	const char padding[BlobAlignment] = {};
+	file.write((const char*)&out, sizeof(out));
+	file.write(padding, out.VertexOffset - sizeof(out));
+	file.write((const char*)vertices, vertexBytes);
+	file.write(padding, out.IndexOffset - (out.VertexOffset + vertexBytes));
+	file.write((const char*)indices, indexBytes);
+	file.write(padding, out.MeshletOffset - (out.IndexOffset + indexBytes));
+	file.write((const char*)meshlets, meshletBytes);
+	file.write(padding, out.LodOffset - (out.MeshletOffset + meshletBytes));
+	file.write((const char*)lods, lodBytes);
+	return file.good();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// -------------------------- MESH CACHE STREAM ---------------------------- //
+///////////////////////////////////////////////////////////////////////////////
+MeshCacheStream::MeshCacheStream() :
+	indexOffset(0),
+	vertexOffset(0),
+	reservedIndices(0),
+	indicesWritten(0),
+	vertexBytesWritten(0)
+{
+}
+
+// --------------------------------------------------------
+// Starts with a zeroed header, which Read() won't accept
+// until Finish() replaces it
+// --------------------------------------------------------
+bool MeshCacheStream::Open(const char* path, size_t indexCount)
+{
+	file.open(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	reservedIndices = indexCount;
+	indicesWritten = 0;
+	vertexBytesWritten = 0;
+	indexOffset = AlignUp(sizeof(MeshCacheHeader), MeshCache::BlobAlignment);
+	vertexOffset = AlignUp((size_t)(indexOffset + sizeof(uint32_t) * reservedIndices),
+		MeshCache::BlobAlignment);
+
+	const char zeroes[MeshCache::BlobAlignment * 32] = {};
+	static_assert(sizeof(zeroes) >= sizeof(MeshCacheHeader), "Header must fit in the zeroes");
+	file.write(zeroes, indexOffset);
+	return file.good();
+}
+
+bool MeshCacheStream::WriteIndices(const uint32_t* indices, size_t count)
+{
+	if (indicesWritten + count > reservedIndices)
+		return false;
+
+	file.seekp(indexOffset + sizeof(uint32_t) * indicesWritten);
+	file.write((const char*)indices, sizeof(uint32_t) * count);
+	indicesWritten += count;
+	return file.good();
+}
+
+bool MeshCacheStream::WriteVertices(const void* vertices, size_t bytes)
+{
+	file.seekp(vertexOffset + vertexBytesWritten);
+	file.write((const char*)vertices, bytes);
+	vertexBytesWritten += bytes;
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Narrowing happens in place, front to back: each 16 bit
+// index lands at or before where its 32 bit one was read,
+// so nothing is overwritten before it's been read. The
+// index blob ends up with unused space after it.
+// --------------------------------------------------------
+bool MeshCacheStream::Finish(const MeshCacheHeader& header,
+	const Meshlet* meshlets, const LodLevel* lods)
+{
+	if (!file.is_open() ||
+		header.IndexCount != indicesWritten ||
+		(uint64_t)header.VertexStride * header.VertexCount != vertexBytesWritten ||
+		(header.IndexStride != sizeof(uint16_t) && header.IndexStride != sizeof(uint32_t)))
+		return false;
+
+	if (header.IndexStride == sizeof(uint16_t))
+	{
+		const size_t WindowIndices = 1 << 16;
+		std::vector<uint32_t> wide(WindowIndices);
+		std::vector<uint16_t> narrow(WindowIndices);
+		for (uint64_t first = 0; first < indicesWritten; first += WindowIndices)
+		{
+			size_t count = (size_t)std::min<uint64_t>(WindowIndices, indicesWritten - first);
+			file.seekg(indexOffset + sizeof(uint32_t) * first);
+			file.read((char*)wide.data(), sizeof(uint32_t) * count);
+			for (size_t i = 0; i < count; i++)
+				narrow[i] = (uint16_t)wide[i];
+			file.seekp(indexOffset + sizeof(uint16_t) * first);
+			file.write((const char*)narrow.data(), sizeof(uint16_t) * count);
+		}
+	}
+
+	MeshCacheHeader out = header;
+	memcpy(out.Magic, Magic, sizeof(Magic));
+	out.Version = MeshCache::Version;
+	out.Compression = 0;
+	out.VertexBytes = vertexBytesWritten;
+	out.IndexBytes = (uint64_t)header.IndexStride * header.IndexCount;
+	out.IndexOffset = indexOffset;
+	out.VertexOffset = vertexOffset;
+	out.MeshletOffset = AlignUp((size_t)(vertexOffset + vertexBytesWritten), MeshCache::BlobAlignment);
+	size_t meshletBytes = sizeof(Meshlet) * header.MeshletCount;
+	out.LodOffset = AlignUp((size_t)out.MeshletOffset + meshletBytes, MeshCache::BlobAlignment);
+
+	const char padding[MeshCache::BlobAlignment] = {};
+	file.seekp(vertexOffset + vertexBytesWritten);
+	file.write(padding, out.MeshletOffset - (vertexOffset + vertexBytesWritten));
+	file.write((const char*)meshlets, meshletBytes);
+	file.write(padding, out.LodOffset - (out.MeshletOffset + meshletBytes));
+	file.write((const char*)lods, sizeof(LodLevel) * header.LodCount);
+
+	file.seekp(0);
+	file.write((const char*)&out, sizeof(out));
+	file.close();
+	return !file.fail();
+}
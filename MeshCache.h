@@ -0,0 +1,164 @@
+/*
+William Duprey
+12/10/24
+Mesh Cache Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "Bounds.h"
+
+// --------------------------------------------------------
+// Header at the very start of a binary mesh cache file.
+// The vertex, index, meshlet and LOD blobs follow it, each at
+// a BlobAlignment boundary, so a mapped file can be handed
+// straight to the GPU without copying or realigning. The
+// vertex and index blobs may instead be compressed (see
+// GeometryCodec.h), in which case they're decoded first.
+// --------------------------------------------------------
+struct MeshCacheHeader
+{
+	char Magic[4];					// Always "WDMC"
+	uint32_t Version;				// MeshCache::Version when written
+
+	// What the cache was built from, and how
+	uint64_t SourceHash;			// MeshCache::Hash() of the source file
+	float OverdrawThreshold;		// Setting used by the optimizer
+	uint32_t RequestedLodCount;		// Setting used for levels of detail
+
+	// Layout of the blobs
+	uint32_t VertexStride;
+	uint32_t VertexCount;
+	uint32_t IndexStride;
+	uint32_t IndexCount;
+	uint32_t MeshletCount;			// 0 if meshlets weren't built
+	uint32_t LodCount;				// Index runs, all in the index blob
+	uint32_t Compression;			// MeshCache::Compress* flags
+	uint64_t VertexBytes;			// Size in the file, compressed or not
+	uint64_t IndexBytes;
+	uint64_t VertexOffset;			// From the start of the file
+	uint64_t IndexOffset;
+	uint64_t MeshletOffset;
+	uint64_t LodOffset;
+
+	// Bounding volumes of every vertex position (the oriented
+	// box is only there if it was asked for)
+	BoundingVolumes Bounds;
+
+	// Load-time stats, so they survive a cached load
+	uint32_t UnweldedVertexCount;
+	VertexCacheStats CacheStatsBefore;
+	VertexCacheStats CacheStatsAfter;
+	VertexCacheStats LruStatsBefore;
+	VertexCacheStats LruStatsAfter;
+	OverdrawStats OverdrawStatsBefore;
+	OverdrawStats OverdrawStatsAfter;
+};
+
+// --------------------------------------------------------
+// Pointers into a mapped, validated cache file
+// --------------------------------------------------------
+struct MeshCacheView
+{
+	const MeshCacheHeader* Header;
+	const void* Vertices;
+	const void* Indices;
+	const Meshlet* Meshlets;
+	const LodLevel* Lods;
+};
+
+// --------------------------------------------------------
+// Versioned binary mesh format, so the full .obj parse,
+// optimize and tangent pipeline only runs when the source
+// actually changes.
+// --------------------------------------------------------
+namespace MeshCache
+{
+	// Bump whenever the file layout OR the processing that
+	// produces the cached data changes, so old caches rebuild
+	constexpr uint32_t Version = 8;
+
+	// Appended to the source file's path
+	constexpr const char* Extension = ".meshcache";
+
+	// Alignment of the blobs within the file
+	constexpr size_t BlobAlignment = 16;
+
+	// MeshCacheHeader::Compression flags
+	constexpr uint32_t CompressVertices = 1;
+	constexpr uint32_t CompressIndices = 2;
+
+	// 64-bit content hash of a source file's bytes
+	uint64_t Hash(const void* data, size_t size);
+
+	// Same hash, reading the file a window at a time
+	// instead of needing all of it in memory
+	bool HashFile(const char* path, uint64_t& hash);
+
+	// Checks the magic, version and that every blob fits inside
+	// the file, and that uncompressed indices, LODs and meshlets
+	// stay inside the vertex and index buffers. Does NOT check
+	// the hash or vertex stride, since only the caller knows
+	// what those should be.
+	bool Read(const MappedFile& file, MeshCacheView& view);
+
+	// Decodes whichever of the vertex and index blobs are
+	// compressed into "vertices" and "indices", and points the
+	// view at them instead. Fails if the data is corrupt.
+	bool Decompress(MeshCacheView& view,
+		std::vector<char>& vertices, std::vector<char>& indices);
+
+	// Writes a cache file. The magic, version, offsets and blob
+	// sizes in "header" are filled in here; everything else is
+	// used as is. "vertices" and "indices" are never compressed,
+	// header.Compression says whether to compress them.
+	bool Write(const char* path, const MeshCacheHeader& header,
+		const void* vertices, const void* indices,
+		const Meshlet* meshlets, const LodLevel* lods);
+}
+
+// --------------------------------------------------------
+// Writes a cache file a piece at a time, for meshes that are
+// built a block at a time (see MeshOptions::StreamingBudget).
+// The index count must be known up front, since the indices
+// go first, with room for 32 bits each; the vertices go after
+// them, since their count isn't known until the end. The
+// header is written last, so a file that never gets finished
+// fails MeshCache::Read(). Nothing is compressed, since that
+// would need the whole blob in memory.
+// --------------------------------------------------------
+class MeshCacheStream
+{
+public:
+	MeshCacheStream();
+
+	bool Open(const char* path, size_t indexCount);
+
+	// Append to the index and vertex blobs
+	bool WriteIndices(const uint32_t* indices, size_t count);
+	bool WriteVertices(const void* vertices, size_t bytes);
+
+	// Narrows the indices to 16 bits if header.IndexStride is 2,
+	// then writes the meshlets, LODs and header. The counts in
+	// "header" must match what was written.
+	bool Finish(const MeshCacheHeader& header,
+		const Meshlet* meshlets, const LodLevel* lods);
+
+private:
+	std::fstream file;
+
+	// Where the blobs start, and how much of each is written
+	uint64_t indexOffset;
+	uint64_t vertexOffset;
+	uint64_t reservedIndices;
+	uint64_t indicesWritten;
+	uint64_t vertexBytesWritten;
+};
@@ -0,0 +1,638 @@
+/*
+William Duprey
+12/10/24
+Mesh Optimizer Implementation
+*/
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache
+	// Optimisation" (2006). The simulated cache is a bit bigger
+	// than the real one on purpose, it gives better orderings.
+	const unsigned int ForsythCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// --------------------------------------------------------
+	// How badly a vertex wants to be used next, based on where
+	// it sits in the cache and how many triangles still need it.
+	// --------------------------------------------------------
+	float VertexScore(int cachePosition, unsigned int liveTriangles)
+	{
+		// No triangles left means this vertex is no longer interesting
+		if (liveTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The three vertices of the last triangle get a fixed score
+			// so they don't unfairly dominate the choice
+			if (cachePosition < 3)
+			{
+				score = LastTriangleScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (ForsythCacheSize - 3);
+				score = 1.0f - (cachePosition - 3) * scaler;
+				score = powf(score, CacheDecayPower);
+			}
+		}
+
+		// Boost vertices with few triangles left, so we
+		// finish off lone triangles instead of leaving them
+		score += ValenceBoostScale * powf((float)liveTriangles, -ValenceBoostPower);
+		return score;
+	}
+
+	// Minimal vector math, so this file doesn't need DirectXMath
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	Float3 Subtract(Float3 a, Float3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	float Dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Float3 Cross(Float3 a, Float3 b)
+	{
+		return {
+			a.y * b.z - a.z * b.y,
+			a.z * b.x - a.x * b.z,
+			a.x * b.y - a.y * b.x };
+	}
+
+	Float3 GetPosition(const float* positions, size_t stride, unsigned int index)
+	{
+		const float* p = (const float*)((const char*)positions + index * stride);
+		return { p[0], p[1], p[2] };
+	}
+
+	// --------------------------------------------------------
+	// FIFO post-transform cache, tracked with timestamps like
+	// AnalyzeVertexCache(). Reset() empties it in O(1).
+	// --------------------------------------------------------
+	struct FifoCache
+	{
+		std::vector<unsigned int> timestamps;
+		unsigned int time;
+		unsigned int size;
+
+		FifoCache(size_t vertexCount, unsigned int cacheSize)
+			: timestamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) { }
+
+		void Reset() { time += size + 1; }
+
+		// Returns how many of the triangle's vertices missed
+		unsigned int AddTriangle(const unsigned int* tri)
+		{
+			unsigned int misses = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				if (time - timestamps[tri[k]] > size)
+				{
+					timestamps[tri[k]] = time++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+	};
+
+	// --------------------------------------------------------
+	// Rasterizes one triangle (already in pixel coordinates,
+	// with z as depth) into the depth buffer. Counts every
+	// pixel that passes the depth test as a shader invocation.
+	// --------------------------------------------------------
+	unsigned int RasterizeTriangle(Float3 v0, Float3 v1, Float3 v2,
+		float* depth, unsigned int resolution)
+	{
+		// Orient counter-clockwise in pixel space, so all three
+		// edge functions are positive inside the triangle
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		if (area == 0.0f)
+			return 0;
+		if (area < 0.0f)
+		{
+			std::swap(v1, v2);
+			area = -area;
+		}
+
+		int minX = std::max(0, (int)floorf(std::min({ v0.x, v1.x, v2.x })));
+		int minY = std::max(0, (int)floorf(std::min({ v0.y, v1.y, v2.y })));
+		int maxX = std::min((int)resolution - 1, (int)ceilf(std::max({ v0.x, v1.x, v2.x })));
+		int maxY = std::min((int)resolution - 1, (int)ceilf(std::max({ v0.y, v1.y, v2.y })));
+
+		// Shared edges run in opposite directions in the two triangles
+		// that share them, so this rule gives each edge pixel to exactly one
+		auto owns = [](Float3 a, Float3 b) { return b.y > a.y || (b.y == a.y && b.x < a.x); };
+		bool own0 = owns(v1, v2), own1 = owns(v2, v0), own2 = owns(v0, v1);
+
+		unsigned int shaded = 0;
+		for (int y = minY; y <= maxY; y++)
+		{
+			float py = y + 0.5f;
+			for (int x = minX; x <= maxX; x++)
+			{
+				float px = x + 0.5f;
+				float w0 = (v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x);
+				float w1 = (v0.x - v2.x) * (py - v2.y) - (v0.y - v2.y) * (px - v2.x);
+				float w2 = (v1.x - v0.x) * (py - v0.y) - (v1.y - v0.y) * (px - v0.x);
+				if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+				if ((w0 == 0.0f && !own0) || (w1 == 0.0f && !own1) || (w2 == 0.0f && !own2)) continue;
+
+				float z = (w0 * v0.z + w1 * v1.z + w2 * v2.z) / area;
+				float& stored = depth[y * resolution + x];
+				if (z < stored)
+				{
+					stored = z;
+					shaded++;
+				}
+			}
+		}
+		return shaded;
+	}
+}
+
+
+// --------------------------------------------------------
+// Greedy triangle reordering. Each step emits the triangle
+// with the best combined vertex score, then updates scores
+// only for vertices in (or just pushed out of) the cache.
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(unsigned int* destination,
+	const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Copy the input in case destination == indices
+	std::vector<unsigned int> source(indices, indices + triangleCount * 3);
+
+	// Build vertex -> triangle adjacency in one flat array
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (unsigned int index : source)
+		liveTriangles[index]++;
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			unsigned int v = source[t * 3 + k];
+			adjacency[fill[v]++] = (unsigned int)t;
+		}
+	}
+
+	// Initial scores (nothing is in the cache yet)
+	std::vector<float> vertexScores(vertexCount);
+	std::vector<int> cachePositions(vertexCount, -1);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = VertexScore(-1, liveTriangles[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	unsigned int bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] =
+			vertexScores[source[t * 3 + 0]] +
+			vertexScores[source[t * 3 + 1]] +
+			vertexScores[source[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = (unsigned int)t;
+	}
+
+	// Cache holds up to three extra entries while being updated
+	unsigned int cache[ForsythCacheSize + 3];
+	unsigned int newCache[ForsythCacheSize + 3];
+	unsigned int cacheCount = 0;
+
+	// Fallback for when the cache has no live triangles left
+	size_t deadEndCursor = 0;
+
+	for (size_t output = 0; output < triangleCount; output++)
+	{
+		// Dead end: take the next unemitted triangle in input order
+		if (bestTriangle == ~0u)
+		{
+			while (emitted[deadEndCursor])
+				deadEndCursor++;
+			bestTriangle = (unsigned int)deadEndCursor;
+		}
+
+		// Emit the triangle
+		const unsigned int* tri = &source[bestTriangle * 3];
+		destination[output * 3 + 0] = tri[0];
+		destination[output * 3 + 1] = tri[1];
+		destination[output * 3 + 2] = tri[2];
+		emitted[bestTriangle] = true;
+
+		// Remove it from its vertices' adjacency lists
+		for (size_t k = 0; k < 3; k++)
+		{
+			unsigned int v = tri[k];
+			unsigned int* list = &adjacency[adjacencyOffsets[v]];
+			unsigned int count = liveTriangles[v];
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (list[i] == bestTriangle)
+				{
+					list[i] = list[count - 1];
+					break;
+				}
+			}
+			liveTriangles[v]--;
+		}
+
+		// New cache: this triangle's vertices, then the old cache
+		unsigned int newCount = 0;
+		newCache[newCount++] = tri[0];
+		newCache[newCount++] = tri[1];
+		newCache[newCount++] = tri[2];
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Anything past the real cache size just got evicted
+		for (unsigned int i = ForsythCacheSize; i < newCount; i++)
+			cachePositions[newCache[i]] = -1;
+
+		// Re-score everything the cache touched
+		for (unsigned int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			if (i < ForsythCacheSize)
+				cachePositions[v] = (int)i;
+
+			float score = VertexScore(cachePositions[v], liveTriangles[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const unsigned int* list = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < liveTriangles[v]; j++)
+				triangleScores[list[j]] += delta;
+		}
+
+		// Then pick the best live triangle touching the cache
+		bestTriangle = ~0u;
+		float bestScore = -1.0f;
+		unsigned int cachedCount = newCount < ForsythCacheSize ? newCount : ForsythCacheSize;
+		for (unsigned int i = 0; i < cachedCount; i++)
+		{
+			unsigned int v = newCache[i];
+			const unsigned int* list = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < liveTriangles[v]; j++)
+			{
+				unsigned int t = list[j];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheCount = cachedCount;
+		memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+	}
+}
+
+// --------------------------------------------------------
+// Overdraw reduction based on Sander, Nehab & Barczak's
+// "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw" (2007):
+//  1. Cut the index buffer wherever the cache runs dry (all
+//     three vertices miss), since reordering there is free.
+//  2. Cut those runs further into smaller clusters, as long
+//     as each cluster's ACMR stays under threshold * the ACMR
+//     of the run it came from.
+//  3. Sort clusters by how far they sit out from the center
+//     along their own average normal. Outer, outward-facing
+//     clusters tend to be in front from most directions.
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(unsigned int* destination,
+	const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Copy the input in case destination == indices
+	std::vector<unsigned int> source(indices, indices + triangleCount * 3);
+
+	// Hard boundaries: triangles where the cache had nothing useful
+	std::vector<size_t> hardClusters;
+	FifoCache cache(vertexCount, DefaultCacheSize);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (cache.AddTriangle(&source[t * 3]) == 3)
+			hardClusters.push_back(t);
+	}
+	hardClusters.push_back(triangleCount);
+
+	// Soft boundaries: split each hard cluster again once the
+	// current piece's ACMR is low enough. Each split starts with
+	// a cold cache, which is where the cache efficiency goes.
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+	{
+		size_t start = hardClusters[c];
+		size_t end = hardClusters[c + 1];
+
+		cache.Reset();
+		unsigned int hardMisses = 0;
+		for (size_t t = start; t < end; t++)
+			hardMisses += cache.AddTriangle(&source[t * 3]);
+		float limit = threshold * hardMisses / (float)(end - start);
+
+		cache.Reset();
+		clusters.push_back(start);
+		size_t clusterStart = start;
+		unsigned int clusterMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			clusterMisses += cache.AddTriangle(&source[t * 3]);
+			float acmr = clusterMisses / (float)(t - clusterStart + 1);
+			if (acmr <= limit && t + 1 < end)
+			{
+				clusters.push_back(t + 1);
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				cache.Reset();
+			}
+		}
+	}
+	size_t clusterCount = clusters.size();
+	clusters.push_back(triangleCount);
+
+	// Area weighted centroid of the whole mesh. The cross products
+	// below are twice the triangle area, but that cancels out.
+	std::vector<Float3> triangleCenters(triangleCount);
+	std::vector<Float3> triangleNormals(triangleCount);
+	Float3 meshCenter = { 0, 0, 0 };
+	float meshArea = 0.0f;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		Float3 a = GetPosition(positions, positionStride, source[t * 3 + 0]);
+		Float3 b = GetPosition(positions, positionStride, source[t * 3 + 1]);
+		Float3 c = GetPosition(positions, positionStride, source[t * 3 + 2]);
+		Float3 n = Cross(Subtract(b, a), Subtract(c, a));
+		float area = sqrtf(Dot(n, n));
+
+		triangleCenters[t] = { (a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3, (a.z + b.z + c.z) / 3 };
+		triangleNormals[t] = n;
+		meshCenter.x += triangleCenters[t].x * area;
+		meshCenter.y += triangleCenters[t].y * area;
+		meshCenter.z += triangleCenters[t].z * area;
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+		meshCenter = { meshCenter.x / meshArea, meshCenter.y / meshArea, meshCenter.z / meshArea };
+
+	// Sort key for each cluster: its (area weighted) centroid
+	// projected onto its (area weighted) average normal
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		Float3 center = { 0, 0, 0 };
+		Float3 normal = { 0, 0, 0 };
+		float area = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			Float3 n = triangleNormals[t];
+			float a = sqrtf(Dot(n, n));
+			center.x += triangleCenters[t].x * a;
+			center.y += triangleCenters[t].y * a;
+			center.z += triangleCenters[t].z * a;
+			normal.x += n.x;
+			normal.y += n.y;
+			normal.z += n.z;
+			area += a;
+		}
+
+		float normalLength = sqrtf(Dot(normal, normal));
+		if (area <= 0.0f || normalLength <= 0.0f)
+		{
+			sortKeys[c] = -FLT_MAX;
+			continue;
+		}
+		center = { center.x / area, center.y / area, center.z / area };
+		sortKeys[c] = Dot(Subtract(center, meshCenter), normal) / normalLength;
+	}
+
+	// Highest key first. Stable, so ties keep their cache-friendly order.
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(),
+		[&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	size_t output = 0;
+	for (size_t c : order)
+	{
+		size_t start = clusters[c] * 3;
+		size_t count = (clusters[c + 1] - clusters[c]) * 3;
+		memcpy(destination + output, &source[start], count * sizeof(unsigned int));
+		output += count;
+	}
+}
+
+// --------------------------------------------------------
+// Numbers vertices in the order the index buffer first
+// references them. Once applied, vertex fetches become
+// (mostly) sequential reads through the vertex buffer.
+// --------------------------------------------------------
+size_t MeshOptimizer::OptimizeVertexFetchRemap(unsigned int* remap,
+	const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	for (size_t v = 0; v < vertexCount; v++)
+		remap[v] = ~0u;
+
+	unsigned int next = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int index = indices[i];
+		if (remap[index] == ~0u)
+			remap[index] = next++;
+	}
+	return next;
+}
+
+void MeshOptimizer::RemapIndexBuffer(unsigned int* destination,
+	const unsigned int* indices, size_t indexCount, const unsigned int* remap)
+{
+	for (size_t i = 0; i < indexCount; i++)
+		destination[i] = remap[indices[i]];
+}
+
+void MeshOptimizer::RemapVertexBuffer(void* destination, const void* vertices,
+	size_t vertexCount, size_t vertexStride, const unsigned int* remap)
+{
+	const char* src = (const char*)vertices;
+	char* dst = (char*)destination;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] != ~0u)
+			memcpy(dst + remap[v] * vertexStride, src + v * vertexStride, vertexStride);
+	}
+}
+
+// --------------------------------------------------------
+// Counts how many times the vertex shader would run with a
+// FIFO cache of the given size, which is how most hardware
+// caches (or their batching) behave.
+// --------------------------------------------------------
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices,
+	size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount < 3 || vertexCount == 0 || cacheSize == 0)
+		return stats;
+
+	// Each vertex remembers the "time" it entered the cache.
+	// It's still cached if fewer than cacheSize misses happened since.
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	unsigned int time = cacheSize + 1;
+	size_t uniqueVertices = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int index = indices[i];
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			stats.VerticesTransformed++;
+		}
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.ACMR = (float)stats.VerticesTransformed / (float)(indexCount / 3);
+	stats.ATVR = (float)stats.VerticesTransformed / (float)uniqueVertices;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Software overdraw estimate, so the overdraw pass can be
+// tuned without a GPU. Each view is an orthographic camera
+// framing the mesh's bounding sphere, looking at it from a
+// direction on a Fibonacci sphere. Triangles are drawn in
+// index buffer order with back-face culling and a strict
+// less-than depth test, like an early-Z GPU would.
+// --------------------------------------------------------
+OverdrawStats MeshOptimizer::AnalyzeOverdraw(const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	unsigned int viewCount, unsigned int resolution)
+{
+	OverdrawStats stats = {};
+	if (indexCount < 3 || vertexCount == 0 || viewCount == 0 || resolution == 0)
+		return stats;
+
+	// Bounding sphere (box center, farthest vertex) to frame each view
+	Float3 minimum = GetPosition(positions, positionStride, 0);
+	Float3 maximum = minimum;
+	for (unsigned int v = 1; v < vertexCount; v++)
+	{
+		Float3 p = GetPosition(positions, positionStride, v);
+		minimum = { std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z) };
+		maximum = { std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z) };
+	}
+	Float3 center = {
+		(minimum.x + maximum.x) * 0.5f,
+		(minimum.y + maximum.y) * 0.5f,
+		(minimum.z + maximum.z) * 0.5f };
+	float radius = 0.0f;
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		Float3 d = Subtract(GetPosition(positions, positionStride, v), center);
+		radius = std::max(radius, Dot(d, d));
+	}
+	radius = sqrtf(radius);
+	if (radius <= 0.0f)
+		return stats;
+
+	std::vector<float> depth((size_t)resolution * resolution);
+	std::vector<Float3> projected(vertexCount);
+	const float goldenAngle = 2.39996323f;
+	float pixelScale = resolution * 0.5f / radius;
+
+	for (unsigned int view = 0; view < viewCount; view++)
+	{
+		// Fibonacci sphere direction, pointing from the camera into the scene
+		float y = 1.0f - (view + 0.5f) * 2.0f / viewCount;
+		float ring = sqrtf(std::max(0.0f, 1.0f - y * y));
+		Float3 forward = { cosf(view * goldenAngle) * ring, y, sinf(view * goldenAngle) * ring };
+
+		// Any basis perpendicular to forward works for counting overdraw
+		Float3 up = fabsf(forward.y) < 0.99f ? Float3{ 0, 1, 0 } : Float3{ 1, 0, 0 };
+		Float3 right = Cross(up, forward);
+		float rightLength = sqrtf(Dot(right, right));
+		right = { right.x / rightLength, right.y / rightLength, right.z / rightLength };
+		up = Cross(forward, right);
+
+		// Project every vertex into pixel space once
+		for (unsigned int v = 0; v < vertexCount; v++)
+		{
+			Float3 d = Subtract(GetPosition(positions, positionStride, v), center);
+			projected[v] = {
+				(Dot(d, right) + radius) * pixelScale,
+				(Dot(d, up) + radius) * pixelScale,
+				Dot(d, forward) };
+		}
+
+		std::fill(depth.begin(), depth.end(), FLT_MAX);
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			// With clockwise front faces (in a left-handed space)
+			// this cross product points out of the front face
+			Float3 a = GetPosition(positions, positionStride, indices[i + 0]);
+			Float3 b = GetPosition(positions, positionStride, indices[i + 1]);
+			Float3 c = GetPosition(positions, positionStride, indices[i + 2]);
+			if (Dot(Cross(Subtract(b, a), Subtract(c, a)), forward) >= 0.0f)
+				continue;
+
+			stats.PixelsShaded += RasterizeTriangle(
+				projected[indices[i + 0]],
+				projected[indices[i + 1]],
+				projected[indices[i + 2]],
+				depth.data(), resolution);
+		}
+
+		for (float z : depth)
+		{
+			if (z != FLT_MAX)
+				stats.PixelsCovered++;
+		}
+	}
+
+	if (stats.PixelsCovered > 0)
+		stats.Overdraw = (float)stats.PixelsShaded / (float)stats.PixelsCovered;
+	return stats;
+}
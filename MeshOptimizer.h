@@ -0,0 +1,98 @@
+/*
+William Duprey
+12/10/24
+Mesh Optimizer Header
+*/
+
+#pragma once
+#include <cstddef>
+
+// --------------------------------------------------------
+// Results of running an index buffer through a simulated
+// post-transform vertex cache.
+//  - ACMR: average cache miss ratio, vertex shader runs per
+//    triangle. 0.5 is ideal for big grids, 3 is the worst.
+//  - ATVR: average transformed vertex ratio, vertex shader
+//    runs per unique vertex. 1.0 is ideal.
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int VerticesTransformed;
+	float ACMR;
+	float ATVR;
+};
+
+// --------------------------------------------------------
+// Results of software-rasterizing a mesh from several view
+// directions with back-face culling and an early depth test.
+//  - Overdraw: pixel shader runs per covered pixel, averaged
+//    over all views. 1.0 means every pixel shaded once.
+// --------------------------------------------------------
+struct OverdrawStats
+{
+	unsigned int PixelsCovered;
+	unsigned int PixelsShaded;
+	float Overdraw;
+};
+
+// --------------------------------------------------------
+// Index / vertex buffer optimizations that reorder data
+// without changing what gets drawn.
+// --------------------------------------------------------
+namespace MeshOptimizer
+{
+	// Size of the FIFO cache used when none is specified.
+	// Close to what most desktop GPUs effectively have.
+	constexpr unsigned int DefaultCacheSize = 16;
+
+	// Reorders triangles to make better use of the post-transform
+	// vertex cache (Tom Forsyth's linear-speed algorithm).
+	// "destination" may be the same array as "indices".
+	void OptimizeVertexCache(unsigned int* destination,
+		const unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+	// How much worse than the input's ACMR the overdraw pass may
+	// make the vertex cache, as a ratio (1.05 = up to 5% worse)
+	constexpr float DefaultOverdrawThreshold = 1.05f;
+
+	// View count and square resolution of the overdraw estimator
+	constexpr unsigned int DefaultOverdrawViews = 8;
+	constexpr unsigned int DefaultOverdrawResolution = 256;
+
+	// Splits an already cache-optimized index buffer into clusters,
+	// then sorts the clusters so ones facing out from the mesh's
+	// center draw first, and occlude the ones behind them.
+	// "positions" points at the first vertex's xyz, and consecutive
+	// positions are "positionStride" bytes apart.
+	// "destination" may be the same array as "indices".
+	void OptimizeOverdraw(unsigned int* destination,
+		const unsigned int* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		float threshold = DefaultOverdrawThreshold);
+
+	// Builds a remap table that orders vertices by first use in
+	// the index buffer, so vertex fetch walks memory forwards.
+	// Unused vertices map to ~0u. Returns the used vertex count.
+	size_t OptimizeVertexFetchRemap(unsigned int* remap,
+		const unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+	// Apply a remap table to an index or vertex buffer.
+	// "destination" must not overlap the source.
+	void RemapIndexBuffer(unsigned int* destination,
+		const unsigned int* indices, size_t indexCount, const unsigned int* remap);
+	void RemapVertexBuffer(void* destination, const void* vertices,
+		size_t vertexCount, size_t vertexStride, const unsigned int* remap);
+
+	// Simulates a FIFO post-transform cache over the index buffer
+	VertexCacheStats AnalyzeVertexCache(const unsigned int* indices,
+		size_t indexCount, size_t vertexCount,
+		unsigned int cacheSize = DefaultCacheSize);
+
+	// Rasterizes the mesh orthographically from "viewCount" directions
+	// spread evenly over a sphere, and counts pixel shader invocations.
+	// Expects clockwise front faces, same as the D3D default.
+	OverdrawStats AnalyzeOverdraw(const unsigned int* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		unsigned int viewCount = DefaultOverdrawViews,
+		unsigned int resolution = DefaultOverdrawResolution);
+}
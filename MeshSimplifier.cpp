@@ -0,0 +1,513 @@
+/*
+William Duprey
+12/10/24
+Mesh Simplifier Implementation
+*/
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Border planes count this much more than surface planes,
+	// so seams and open edges hold their shape
+	const double BorderWeight = 10.0;
+
+	// Minimal vector math, so this file doesn't need DirectXMath
+	struct Float3 { float x, y, z; };
+
+	Float3 Sub(Float3 a, Float3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	float Dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Float3 Cross(Float3 a, Float3 b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	// --------------------------------------------------------
+	// Sum of weighted squared distances to a set of planes,
+	// stored as the symmetric matrix A, vector b and scalar c:
+	//   error(p) = p'Ap + 2b'p + c
+	// Doubles, since the sums get large and cancel a lot.
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+
+		// Plane through "point" with unit "normal"
+		void AddPlane(Float3 normal, Float3 point, double planeWeight)
+		{
+			double nx = normal.x, ny = normal.y, nz = normal.z;
+			double d = -(nx * point.x + ny * point.y + nz * point.z);
+			a00 += planeWeight * nx * nx; a01 += planeWeight * nx * ny; a02 += planeWeight * nx * nz;
+			a11 += planeWeight * ny * ny; a12 += planeWeight * ny * nz; a22 += planeWeight * nz * nz;
+			b0 += planeWeight * nx * d; b1 += planeWeight * ny * d; b2 += planeWeight * nz * d;
+			c += planeWeight * d * d;
+			weight += planeWeight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02;
+			a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		// Weighted mean squared distance to the planes
+		double Error(Float3 p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double r = x * (a00 * x + 2 * (a01 * y + a02 * z + b0)) +
+				y * (a11 * y + 2 * (a12 * z + b1)) +
+				z * (a22 * z + 2 * b2) + c;
+			return weight > 0.0 ? fabs(r) / weight : 0.0;
+		}
+	};
+
+	// How a group of vertices sharing a position may move
+	enum class VertexKind
+	{
+		Interior,	// One vertex, no borders, can collapse anywhere
+		Seam,		// On one seam or border line, slides along it
+		Locked		// Seam corner or something odd, stays put
+	};
+
+	// A collapse of every vertex at one position onto
+	// the vertices at a neighboring position
+	struct Collapse
+	{
+		unsigned int From;	// Group (position) collapsing
+		unsigned int To;	// Interior: vertex it collapses onto
+							// Seam: group it slides to
+		bool Seam;
+		double Error;
+	};
+
+	uint64_t HalfEdge(unsigned int a, unsigned int b)
+	{
+		return ((uint64_t)a << 32) | b;
+	}
+
+	// Hash of a position's exact bits
+	struct PositionHash
+	{
+		size_t operator()(const Float3& p) const
+		{
+			uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const Float3& a, const Float3& b) const
+		{
+			return memcmp(&a, &b, sizeof(Float3)) == 0;
+		}
+	};
+
+	// --------------------------------------------------------
+	// Everything one pass of collapses needs to know about
+	// the current triangles, rebuilt at the start of each pass
+	// --------------------------------------------------------
+	struct Topology
+	{
+		// Triangles around each vertex (compressed rows)
+		std::vector<unsigned int> TriangleStart;
+		std::vector<unsigned int> Triangles;
+
+		// Every half-edge, sorted, for finding borders
+		std::vector<uint64_t> HalfEdges;
+
+		// Live vertices at each position, as a linked list
+		std::vector<unsigned int> FirstInGroup;
+		std::vector<unsigned int> NextInGroup;
+
+		void Build(const std::vector<unsigned int>& indices,
+			const std::vector<unsigned int>& group, size_t vertexCount)
+		{
+			TriangleStart.assign(vertexCount + 1, 0);
+			for (unsigned int v : indices)
+				TriangleStart[v + 1]++;
+			for (size_t i = 0; i < vertexCount; i++)
+				TriangleStart[i + 1] += TriangleStart[i];
+
+			Triangles.resize(indices.size());
+			std::vector<unsigned int> fill(TriangleStart.begin(), TriangleStart.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				Triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+			HalfEdges.resize(indices.size());
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				HalfEdges[i] = HalfEdge(indices[i], indices[i + 1]);
+				HalfEdges[i + 1] = HalfEdge(indices[i + 1], indices[i + 2]);
+				HalfEdges[i + 2] = HalfEdge(indices[i + 2], indices[i]);
+			}
+			std::sort(HalfEdges.begin(), HalfEdges.end());
+
+			FirstInGroup.assign(vertexCount, ~0u);
+			NextInGroup.assign(vertexCount, ~0u);
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				if (TriangleStart[v + 1] == TriangleStart[v])
+					continue;
+				NextInGroup[v] = FirstInGroup[group[v]];
+				FirstInGroup[group[v]] = (unsigned int)v;
+			}
+		}
+
+		bool HasHalfEdge(unsigned int a, unsigned int b) const
+		{
+			return std::binary_search(HalfEdges.begin(), HalfEdges.end(), HalfEdge(a, b));
+		}
+
+		// A half-edge without its opposite is on a border or seam
+		bool IsBorder(unsigned int a, unsigned int b) const
+		{
+			return !HasHalfEdge(b, a);
+		}
+	};
+
+	// --------------------------------------------------------
+	// Works out how a group may move. Seam groups get the two
+	// groups they can slide toward in "ends".
+	// --------------------------------------------------------
+	VertexKind Classify(unsigned int g, const Topology& topology,
+		const std::vector<unsigned int>& indices, const std::vector<unsigned int>& group,
+		unsigned int ends[2])
+	{
+		unsigned int members = 0;
+		unsigned int endCount = 0;
+		for (unsigned int v = topology.FirstInGroup[g]; v != ~0u; v = topology.NextInGroup[v])
+		{
+			members++;
+			for (unsigned int i = topology.TriangleStart[v]; i < topology.TriangleStart[v + 1]; i++)
+			{
+				const unsigned int* tri = &indices[topology.Triangles[i] * 3];
+				for (int c = 0; c < 3; c++)
+				{
+					if (tri[c] != v)
+						continue;
+
+					// Both edges of this triangle that touch v
+					unsigned int next = tri[(c + 1) % 3];
+					unsigned int previous = tri[(c + 2) % 3];
+					unsigned int neighbors[2] = { ~0u, ~0u };
+					if (topology.IsBorder(v, next))
+						neighbors[0] = group[next];
+					if (topology.IsBorder(previous, v))
+						neighbors[1] = group[previous];
+
+					for (unsigned int n : neighbors)
+					{
+						if (n == ~0u || (endCount > 0 && ends[0] == n) || (endCount > 1 && ends[1] == n))
+							continue;
+						if (endCount == 2)
+							return VertexKind::Locked;
+						ends[endCount++] = n;
+					}
+				}
+			}
+		}
+
+		if (endCount == 0)
+			return members == 1 ? VertexKind::Interior : VertexKind::Locked;
+		return endCount == 2 ? VertexKind::Seam : VertexKind::Locked;
+	}
+
+	// --------------------------------------------------------
+	// For a seam collapse, finds the vertex in group "to" that
+	// each vertex in group "from" slides onto (one sharing a
+	// border edge with it). False if any of them has none.
+	// --------------------------------------------------------
+	bool MatchSeam(unsigned int from, unsigned int to, const Topology& topology,
+		const std::vector<unsigned int>& indices, const std::vector<unsigned int>& group,
+		std::vector<unsigned int>& remap)
+	{
+		for (unsigned int v = topology.FirstInGroup[from]; v != ~0u; v = topology.NextInGroup[v])
+		{
+			unsigned int match = ~0u;
+			for (unsigned int i = topology.TriangleStart[v]; i < topology.TriangleStart[v + 1] && match == ~0u; i++)
+			{
+				const unsigned int* tri = &indices[topology.Triangles[i] * 3];
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int w = tri[c];
+					if (group[w] != to)
+						continue;
+					if (topology.IsBorder(v, w) || topology.IsBorder(w, v))
+					{
+						match = w;
+						break;
+					}
+				}
+			}
+			if (match == ~0u)
+				return false;
+			remap[v] = match;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// True if moving every remapped vertex in "from" leaves no
+	// surviving triangle around it flipped or collapsed flat
+	// --------------------------------------------------------
+	bool KeepsOrientation(unsigned int from, const Topology& topology,
+		const std::vector<unsigned int>& indices, const std::vector<Float3>& positions,
+		const std::vector<unsigned int>& remap)
+	{
+		for (unsigned int v = topology.FirstInGroup[from]; v != ~0u; v = topology.NextInGroup[v])
+		{
+			unsigned int w = remap[v];
+			for (unsigned int i = topology.TriangleStart[v]; i < topology.TriangleStart[v + 1]; i++)
+			{
+				const unsigned int* tri = &indices[topology.Triangles[i] * 3];
+
+				// Triangles on the collapsing edge just disappear
+				if (tri[0] == w || tri[1] == w || tri[2] == w)
+					continue;
+
+				Float3 before[3], after[3];
+				for (int c = 0; c < 3; c++)
+				{
+					before[c] = positions[tri[c]];
+					after[c] = tri[c] == v ? positions[w] : before[c];
+				}
+				Float3 oldNormal = Cross(Sub(before[1], before[0]), Sub(before[2], before[0]));
+				Float3 newNormal = Cross(Sub(after[1], after[0]), Sub(after[2], after[0]));
+
+				// Flipped, or close enough to edge-on to be a sliver
+				float oldLength = sqrtf(Dot(oldNormal, oldNormal));
+				float newLength = sqrtf(Dot(newNormal, newNormal));
+				if (Dot(oldNormal, newNormal) <= 0.25f * oldLength * newLength)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+// --------------------------------------------------------
+// Runs passes of edge collapses until the target is met.
+// Each pass finds the cheapest collapse for every position,
+// sorts them, and applies as many as it can without two of
+// them touching the same triangles. The index buffer is then
+// rewritten and degenerate triangles dropped.
+// --------------------------------------------------------
+size_t MeshSimplifier::Simplify(unsigned int* destination,
+	const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	std::vector<unsigned int> current(indices, indices + indexCount / 3 * 3);
+	std::vector<Float3> points(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* p = (const float*)((const char*)positions + positionStride * i);
+		points[i] = { p[0], p[1], p[2] };
+	}
+
+	// Vertices at exactly the same position form a group, named
+	// after the first of them. Quadrics belong to groups.
+	std::vector<unsigned int> group(vertexCount);
+	{
+		std::unordered_map<Float3, unsigned int, PositionHash, PositionEqual> firstAt;
+		firstAt.reserve(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			group[i] = firstAt.emplace(points[i], (unsigned int)i).first->second;
+	}
+
+	// Surface planes, weighted by triangle area
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < current.size(); i += 3)
+	{
+		Float3 a = points[current[i]], b = points[current[i + 1]], c = points[current[i + 2]];
+		Float3 normal = Cross(Sub(b, a), Sub(c, a));
+		float length = sqrtf(Dot(normal, normal));
+		if (length == 0.0f)
+			continue;
+		normal = { normal.x / length, normal.y / length, normal.z / length };
+		for (int corner = 0; corner < 3; corner++)
+			quadrics[group[current[i + corner]]].AddPlane(normal, a, length * 0.5);
+	}
+
+	// Border and seam edges add a plane through the edge, standing
+	// up from the triangle, so sliding along them is cheap but
+	// moving away from them isn't
+	{
+		Topology topology;
+		topology.Build(current, group, vertexCount);
+		for (size_t i = 0; i < current.size(); i += 3)
+		{
+			Float3 a = points[current[i]], b = points[current[i + 1]], c = points[current[i + 2]];
+			Float3 normal = Cross(Sub(b, a), Sub(c, a));
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int v0 = current[i + e];
+				unsigned int v1 = current[i + (e + 1) % 3];
+				if (!topology.IsBorder(v0, v1))
+					continue;
+
+				Float3 edge = Sub(points[v1], points[v0]);
+				Float3 side = Cross(edge, normal);
+				float length = sqrtf(Dot(side, side));
+				if (length == 0.0f)
+					continue;
+				side = { side.x / length, side.y / length, side.z / length };
+				double weight = BorderWeight * Dot(edge, edge);
+				quadrics[group[v0]].AddPlane(side, points[v0], weight);
+				quadrics[group[v1]].AddPlane(side, points[v0], weight);
+			}
+		}
+	}
+
+	double maxError = (double)targetError * targetError;
+	double reachedError = 0.0;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<char> touched(vertexCount);
+	std::vector<Collapse> collapses;
+	Topology topology;
+
+	while (current.size() > targetIndexCount)
+	{
+		topology.Build(current, group, vertexCount);
+
+		// Cheapest collapse for every position that can move
+		collapses.clear();
+		for (size_t g = 0; g < vertexCount; g++)
+		{
+			if (topology.FirstInGroup[g] == ~0u)
+				continue;
+
+			unsigned int ends[2];
+			VertexKind kind = Classify((unsigned int)g, topology, current, group, ends);
+			if (kind == VertexKind::Locked)
+				continue;
+
+			Collapse best = { (unsigned int)g, ~0u, kind == VertexKind::Seam, 0.0 };
+			if (kind == VertexKind::Interior)
+			{
+				unsigned int v = topology.FirstInGroup[g];
+				for (unsigned int i = topology.TriangleStart[v]; i < topology.TriangleStart[v + 1]; i++)
+				{
+					const unsigned int* tri = &current[topology.Triangles[i] * 3];
+					for (int c = 0; c < 3; c++)
+					{
+						if (tri[c] == v)
+							continue;
+						double error = quadrics[g].Error(points[tri[c]]);
+						if (best.To == ~0u || error < best.Error)
+							best = { (unsigned int)g, tri[c], false, error };
+					}
+				}
+			}
+			else
+			{
+				// Seams slide toward either end, to that group's position
+				for (unsigned int end : ends)
+				{
+					double error = quadrics[g].Error(points[end]);
+					if (best.To == ~0u || error < best.Error)
+						best = { (unsigned int)g, end, true, error };
+				}
+			}
+
+			if (best.To != ~0u && best.Error <= maxError)
+				collapses.push_back(best);
+		}
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+		// Apply as many as possible, cheapest first
+		for (size_t i = 0; i < vertexCount; i++)
+			remap[i] = (unsigned int)i;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		size_t remainingIndices = current.size();
+		size_t applied = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (remainingIndices <= targetIndexCount)
+				break;
+
+			unsigned int from = collapse.From;
+			unsigned int toGroup = group[collapse.To];
+			if (touched[from] || touched[toGroup])
+				continue;
+
+			// Where each vertex at this position goes
+			unsigned int first = topology.FirstInGroup[from];
+			if (!collapse.Seam)
+				remap[first] = collapse.To;
+			else if (!MatchSeam(from, toGroup, topology, current, group, remap))
+			{
+				for (unsigned int v = first; v != ~0u; v = topology.NextInGroup[v])
+					remap[v] = v;
+				continue;
+			}
+
+			if (!KeepsOrientation(from, topology, current, points, remap))
+			{
+				for (unsigned int v = first; v != ~0u; v = topology.NextInGroup[v])
+					remap[v] = v;
+				continue;
+			}
+
+			// Lock everything whose triangles just changed for
+			// the rest of this pass, and count what disappears
+			for (unsigned int v = first; v != ~0u; v = topology.NextInGroup[v])
+			{
+				for (unsigned int t = topology.TriangleStart[v]; t < topology.TriangleStart[v + 1]; t++)
+				{
+					const unsigned int* tri = &current[topology.Triangles[t] * 3];
+					for (int c = 0; c < 3; c++)
+						touched[group[tri[c]]] = 1;
+					if (tri[0] == remap[v] || tri[1] == remap[v] || tri[2] == remap[v])
+						remainingIndices -= 3;
+				}
+			}
+
+			quadrics[toGroup].Add(quadrics[from]);
+			reachedError = std::max(reachedError, collapse.Error);
+			applied++;
+		}
+		if (applied == 0)
+			break;
+
+		// Rewrite the triangles, dropping ones that collapsed
+		size_t write = 0;
+		for (size_t i = 0; i < current.size(); i += 3)
+		{
+			unsigned int a = remap[current[i]];
+			unsigned int b = remap[current[i + 1]];
+			unsigned int c = remap[current[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			current[write++] = a;
+			current[write++] = b;
+			current[write++] = c;
+		}
+		current.resize(write);
+	}
+
+	if (resultError)
+		*resultError = (float)sqrt(reachedError);
+	memcpy(destination, current.data(), current.size() * sizeof(unsigned int));
+	return current.size();
+}
@@ -0,0 +1,59 @@
+/*
+William Duprey
+12/10/24
+Mesh Simplifier Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// One level of detail: a run of the mesh's index buffer
+// that draws the same vertices with fewer triangles.
+// Stored as is in the mesh cache, so it's all fixed size.
+// --------------------------------------------------------
+struct LodLevel
+{
+	uint32_t IndexOffset;
+	uint32_t IndexCount;
+	float Error;				// Object space, what the simplifier reached
+	float TargetError;			// Object space, what it was allowed
+};
+
+// --------------------------------------------------------
+// Quadric error metric simplification (Garland & Heckbert)
+// by collapsing edges onto existing vertices, so every LOD
+// can share the original vertex buffer.
+//
+// Open borders and attribute seams (UV or normal splits,
+// which look like borders once vertices are welded) are
+// kept: their vertices only slide along the seam, taking
+// every vertex at the same position with them. Corners
+// where seams meet never move.
+// --------------------------------------------------------
+namespace MeshSimplifier
+{
+	// Most levels a mesh gets, including the full detail one
+	constexpr unsigned int MaxLods = 5;
+
+	// Each level aims for this fraction of the previous one's
+	// triangles, and allows this many times its error
+	constexpr float LodTriangleRatio = 0.5f;
+	constexpr float LodErrorGrowth = 2.0f;
+
+	// Error allowed for the first simplified level, as a
+	// fraction of the diagonal of the mesh's bounding box
+	constexpr float FirstLodError = 0.005f;
+
+	// Simplifies until there are at most targetIndexCount indices,
+	// or until the next collapse would go over targetError (an
+	// object space distance). Returns the new index count, and
+	// the error reached in "resultError" if it's not null.
+	// "positions" are strided like in MeshOptimizer.
+	// "destination" may be the same array as "indices".
+	size_t Simplify(unsigned int* destination,
+		const unsigned int* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+}
@@ -0,0 +1,346 @@
+/*
+William Duprey
+12/10/24
+Meshlets Implementation
+*/
+
+#include "Meshlets.h"
+#include "Bounds.h"
+#include "SseSupport.h"
+
+#include <cmath>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Minimal vector math, so this file doesn't need DirectXMath
+	struct Float3 { float x, y, z; };
+
+	Float3 Sub(Float3 a, Float3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	float Dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Float3 Cross(Float3 a, Float3 b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	Float3 LoadPosition(const float* positions, size_t stride, unsigned int index)
+	{
+		const float* p = (const float*)((const char*)positions + stride * index);
+		return { p[0], p[1], p[2] };
+	}
+
+	// --------------------------------------------------------
+	// Fills in a finished meshlet's bounding sphere and normal
+	// cone from its triangles and unique vertices
+	// --------------------------------------------------------
+	void CalculateBounds(Meshlet& meshlet, const unsigned int* indices,
+		const std::vector<unsigned int>& vertices,
+		const float* positions, size_t stride)
+	{
+		// Sphere around the center of the box, just big
+		// enough to hold the farthest vertex
+		Float3 boxMin = LoadPosition(positions, stride, vertices[0]);
+		Float3 boxMax = boxMin;
+		for (unsigned int v : vertices)
+		{
+			Float3 p = LoadPosition(positions, stride, v);
+			boxMin = { fminf(boxMin.x, p.x), fminf(boxMin.y, p.y), fminf(boxMin.z, p.z) };
+			boxMax = { fmaxf(boxMax.x, p.x), fmaxf(boxMax.y, p.y), fmaxf(boxMax.z, p.z) };
+		}
+		Float3 center = {
+			(boxMin.x + boxMax.x) * 0.5f,
+			(boxMin.y + boxMax.y) * 0.5f,
+			(boxMin.z + boxMax.z) * 0.5f };
+
+		float radiusSquared = 0.0f;
+		for (unsigned int v : vertices)
+		{
+			Float3 offset = Sub(LoadPosition(positions, stride, v), center);
+			radiusSquared = fmaxf(radiusSquared, Dot(offset, offset));
+		}
+
+		meshlet.Center[0] = center.x;
+		meshlet.Center[1] = center.y;
+		meshlet.Center[2] = center.z;
+		meshlet.Radius = sqrtf(radiusSquared);
+
+		// Cone axis is the average of the unit triangle normals
+		// (the same facing as the rasterizer's back-face test)
+		const unsigned int* tri = indices + meshlet.IndexOffset;
+		Float3 axis = { 0, 0, 0 };
+		for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+		{
+			Float3 a = LoadPosition(positions, stride, tri[t * 3]);
+			Float3 b = LoadPosition(positions, stride, tri[t * 3 + 1]);
+			Float3 c = LoadPosition(positions, stride, tri[t * 3 + 2]);
+			Float3 normal = Cross(Sub(b, a), Sub(c, a));
+			float length = sqrtf(Dot(normal, normal));
+			if (length > 0.0f)
+				axis = { axis.x + normal.x / length, axis.y + normal.y / length, axis.z + normal.z / length };
+		}
+
+		// No cone unless every normal is within 90 degrees of the axis
+		meshlet.ConeAxis[0] = meshlet.ConeAxis[1] = meshlet.ConeAxis[2] = 0.0f;
+		meshlet.ConeCutoff = 1.0f;
+
+		float axisLength = sqrtf(Dot(axis, axis));
+		if (axisLength == 0.0f)
+			return;
+		axis = { axis.x / axisLength, axis.y / axisLength, axis.z / axisLength };
+
+		float minDot = 1.0f;
+		for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+		{
+			Float3 a = LoadPosition(positions, stride, tri[t * 3]);
+			Float3 b = LoadPosition(positions, stride, tri[t * 3 + 1]);
+			Float3 c = LoadPosition(positions, stride, tri[t * 3 + 2]);
+			Float3 normal = Cross(Sub(b, a), Sub(c, a));
+			float length = sqrtf(Dot(normal, normal));
+			if (length > 0.0f)
+				minDot = fminf(minDot, Dot(normal, axis) / length);
+		}
+		if (minDot <= 0.0f)
+			return;
+
+		meshlet.ConeAxis[0] = axis.x;
+		meshlet.ConeAxis[1] = axis.y;
+		meshlet.ConeAxis[2] = axis.z;
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+
+	// Adds a surviving meshlet, extending the last range if they touch
+	void AddRange(std::vector<MeshletRange>& ranges, const Meshlet& meshlet)
+	{
+		if (!ranges.empty() &&
+			ranges.back().IndexOffset + ranges.back().IndexCount == meshlet.IndexOffset)
+		{
+			ranges.back().IndexCount += meshlet.TriangleCount * 3;
+			return;
+		}
+		ranges.push_back({ meshlet.IndexOffset, meshlet.TriangleCount * 3 });
+	}
+
+	// --------------------------------------------------------
+	// Both tests for the four meshlets starting at "first", one
+	// at a time. Returns a bit per one that's visible.
+	// --------------------------------------------------------
+	int VisibleScalar(const MeshletCullData& cullData, size_t first,
+		const float planes[6][4], const float* cameraPosition)
+	{
+		int visible = 0;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			size_t i = first + lane;
+			float c[3] = { cullData.CenterX[i], cullData.CenterY[i], cullData.CenterZ[i] };
+			float radius = cullData.Radius[i];
+
+			bool inside = true;
+			for (int p = 0; p < 6; p++)
+			{
+				float distance = c[0] * planes[p][0] + c[1] * planes[p][1] +
+					c[2] * planes[p][2] + planes[p][3];
+				inside = inside && distance >= -radius;
+			}
+
+			if (cameraPosition)
+			{
+				float d[3] = { c[0] - cameraPosition[0], c[1] - cameraPosition[1], c[2] - cameraPosition[2] };
+				float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+				float alongAxis = d[0] * cullData.AxisX[i] + d[1] * cullData.AxisY[i] + d[2] * cullData.AxisZ[i];
+				inside = inside && !(alongAxis >= cullData.Cutoff[i] * length + radius);
+			}
+
+			if (inside)
+				visible |= 1 << lane;
+		}
+		return visible;
+	}
+
+#ifdef USE_SSE2
+	// Same tests, all four lanes at once
+	int VisibleSse(const MeshletCullData& cullData, size_t first,
+		const float planes[6][4], const float* cameraPosition)
+	{
+		__m128 cx = _mm_loadu_ps(&cullData.CenterX[first]);
+		__m128 cy = _mm_loadu_ps(&cullData.CenterY[first]);
+		__m128 cz = _mm_loadu_ps(&cullData.CenterZ[first]);
+		__m128 radius = _mm_loadu_ps(&cullData.Radius[first]);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+		// Inside (or touching) all six planes
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(cx, _mm_set1_ps(planes[p][0])),
+				_mm_mul_ps(cy, _mm_set1_ps(planes[p][1]))),
+				_mm_mul_ps(cz, _mm_set1_ps(planes[p][2]))),
+				_mm_set1_ps(planes[p][3]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		if (cameraPosition)
+		{
+			__m128 dx = _mm_sub_ps(cx, _mm_set1_ps(cameraPosition[0]));
+			__m128 dy = _mm_sub_ps(cy, _mm_set1_ps(cameraPosition[1]));
+			__m128 dz = _mm_sub_ps(cz, _mm_set1_ps(cameraPosition[2]));
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			__m128 alongAxis = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(dx, _mm_loadu_ps(&cullData.AxisX[first])),
+				_mm_mul_ps(dy, _mm_loadu_ps(&cullData.AxisY[first]))),
+				_mm_mul_ps(dz, _mm_loadu_ps(&cullData.AxisZ[first])));
+			__m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cullData.Cutoff[first]), length), radius);
+			inside = _mm_andnot_ps(_mm_cmpge_ps(alongAxis, limit), inside);
+		}
+		return _mm_movemask_ps(inside);
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Culls every meshlet with one of the four-at-a-time tests
+	// above, filling in the merged ranges
+	// --------------------------------------------------------
+	template<int (*VisibleFour)(const MeshletCullData&, size_t, const float[6][4], const float*)>
+	size_t CullWith(const std::vector<Meshlet>& meshlets, const MeshletCullData& cullData,
+		const float worldViewProjection[16], const float* cameraPosition,
+		std::vector<MeshletRange>& ranges)
+	{
+		ranges.clear();
+
+		float planes[6][4];
+		Bounds::ExtractPlanes(worldViewProjection, planes);
+
+		size_t count = meshlets.size();
+		size_t survivors = 0;
+		for (size_t first = 0; first < count; first += 4)
+		{
+			int visible = VisibleFour(cullData, first, planes, cameraPosition);
+
+			// Padding past the last meshlet is never visible
+			for (int lane = 0; lane < 4 && first + lane < count; lane++)
+			{
+				if (visible & (1 << lane))
+				{
+					AddRange(ranges, meshlets[first + lane]);
+					survivors++;
+				}
+			}
+		}
+		return survivors;
+	}
+}
+
+// --------------------------------------------------------
+// Greedy scan over the triangles in order. Vertices are
+// tagged with the last meshlet that used them, so nothing
+// needs clearing between meshlets.
+// --------------------------------------------------------
+void Meshlets::Build(std::vector<Meshlet>& meshlets,
+	const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	unsigned int maxVertices, unsigned int maxTriangles)
+{
+	meshlets.clear();
+	if (indexCount < 3)
+		return;
+
+	std::vector<unsigned int> lastMeshlet(vertexCount, ~0u);
+	std::vector<unsigned int> vertices;
+	vertices.reserve(maxVertices);
+
+	Meshlet current = {};
+	unsigned int id = 0;
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		const unsigned int* tri = indices + i;
+
+		// How many of this triangle's vertices are new to the meshlet
+		// (a corner repeated within the triangle only counts once)
+		auto countNew = [&]()
+		{
+			unsigned int count = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				bool repeat = (c > 0 && tri[c] == tri[0]) || (c > 1 && tri[c] == tri[1]);
+				if (!repeat && lastMeshlet[tri[c]] != id)
+					count++;
+			}
+			return count;
+		};
+
+		// Full? Finish it and start the next one at this triangle
+		if (current.TriangleCount == maxTriangles ||
+			current.VertexCount + countNew() > maxVertices)
+		{
+			CalculateBounds(current, indices, vertices, positions, positionStride);
+			meshlets.push_back(current);
+
+			current = {};
+			current.IndexOffset = (uint32_t)i;
+			vertices.clear();
+			id++;
+		}
+
+		for (int c = 0; c < 3; c++)
+		{
+			if (lastMeshlet[tri[c]] != id)
+			{
+				lastMeshlet[tri[c]] = id;
+				vertices.push_back(tri[c]);
+				current.VertexCount++;
+			}
+		}
+		current.TriangleCount++;
+	}
+
+	CalculateBounds(current, indices, vertices, positions, positionStride);
+	meshlets.push_back(current);
+}
+
+void Meshlets::BuildCullData(const std::vector<Meshlet>& meshlets, MeshletCullData& cullData)
+{
+	size_t padded = (meshlets.size() + 3) / 4 * 4;
+	std::vector<float>* arrays[] = {
+		&cullData.CenterX, &cullData.CenterY, &cullData.CenterZ, &cullData.Radius,
+		&cullData.AxisX, &cullData.AxisY, &cullData.AxisZ, &cullData.Cutoff };
+	for (std::vector<float>* array : arrays)
+		array->assign(padded, 0.0f);
+
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		const Meshlet& m = meshlets[i];
+		cullData.CenterX[i] = m.Center[0];
+		cullData.CenterY[i] = m.Center[1];
+		cullData.CenterZ[i] = m.Center[2];
+		cullData.Radius[i] = m.Radius;
+		cullData.AxisX[i] = m.ConeAxis[0];
+		cullData.AxisY[i] = m.ConeAxis[1];
+		cullData.AxisZ[i] = m.ConeAxis[2];
+		cullData.Cutoff[i] = m.ConeCutoff;
+	}
+}
+
+// --------------------------------------------------------
+// A meshlet is culled if its sphere is entirely outside any
+// frustum plane, or if the camera can only see the backs
+// of its triangles. The cone test is the conservative one:
+//   dot(center - camera, axis) >= cutoff * |center - camera| + radius
+// --------------------------------------------------------
+size_t Meshlets::Cull(const std::vector<Meshlet>& meshlets, const MeshletCullData& cullData,
+	const float worldViewProjection[16], const float* cameraPosition,
+	std::vector<MeshletRange>& ranges)
+{
+#ifdef USE_SSE2
+	return CullWith<VisibleSse>(meshlets, cullData, worldViewProjection, cameraPosition, ranges);
+#else
+	return CullWith<VisibleScalar>(meshlets, cullData, worldViewProjection, cameraPosition, ranges);
+#endif
+}
+
+size_t Meshlets::CullScalar(const std::vector<Meshlet>& meshlets, const MeshletCullData& cullData,
+	const float worldViewProjection[16], const float* cameraPosition,
+	std::vector<MeshletRange>& ranges)
+{
+	return CullWith<VisibleScalar>(meshlets, cullData, worldViewProjection, cameraPosition, ranges);
+}
@@ -0,0 +1,97 @@
+/*
+William Duprey
+12/10/24
+Meshlets Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// A small cluster of triangles that's culled as one. Its
+// triangles are a contiguous run of the index buffer, so a
+// surviving meshlet is drawn with a single DrawIndexed.
+// Stored as is in the mesh cache, so it's all fixed size.
+// --------------------------------------------------------
+struct Meshlet
+{
+	uint32_t IndexOffset;		// First index in the index buffer
+	uint32_t TriangleCount;
+	uint32_t VertexCount;		// Unique vertices used
+
+	// Object space bounding sphere
+	float Center[3];
+	float Radius;
+
+	// Normal cone: every triangle's normal is within the cone
+	// around the axis. ConeCutoff is the sine of its half angle,
+	// and a cutoff of 1 (with a zero axis) means no useful cone.
+	float ConeAxis[3];
+	float ConeCutoff;
+};
+
+// --------------------------------------------------------
+// A run of indices to draw, after merging meshlets that
+// survived culling and sit next to each other
+// --------------------------------------------------------
+struct MeshletRange
+{
+	unsigned int IndexOffset;
+	unsigned int IndexCount;
+};
+
+// --------------------------------------------------------
+// Meshlet bounds rearranged for culling four at a time:
+// one array per component, padded with zeros to a multiple
+// of four (the padding is never reported as visible)
+// --------------------------------------------------------
+struct MeshletCullData
+{
+	std::vector<float> CenterX, CenterY, CenterZ, Radius;
+	std::vector<float> AxisX, AxisY, AxisZ, Cutoff;
+};
+
+// --------------------------------------------------------
+// Splitting meshes into meshlets, and culling those against
+// a camera's frustum and by their normal cones.
+// --------------------------------------------------------
+namespace Meshlets
+{
+	// Limits per meshlet (the usual mesh shader friendly sizes)
+	constexpr unsigned int MaxVertices = 64;
+	constexpr unsigned int MaxTriangles = 124;
+
+	// Splits the index buffer into meshlets in its current triangle
+	// order, so nothing gets reordered and earlier optimizations
+	// (vertex cache, overdraw) are kept. A meshlet ends as soon as
+	// the next triangle would go over either limit.
+	// "positions" are strided like in MeshOptimizer.
+	void Build(std::vector<Meshlet>& meshlets,
+		const unsigned int* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		unsigned int maxVertices = MaxVertices,
+		unsigned int maxTriangles = MaxTriangles);
+
+	// Rearranges meshlet bounds for Cull()
+	void BuildCullData(const std::vector<Meshlet>& meshlets, MeshletCullData& cullData);
+
+	// Culls every meshlet, four at a time, and fills "ranges" with
+	// what's left, merging neighbors. Returns how many survived.
+	//  - worldViewProjection: row major, row vector convention
+	//    (DirectXMath's world * view * projection), D3D clip space
+	//  - cameraPosition: in the mesh's OBJECT space, or null to
+	//    skip cone culling (e.g. orthographic cameras)
+	// Both tests are done in object space, which stays exact
+	// under non-uniform scale.
+	size_t Cull(const std::vector<Meshlet>& meshlets, const MeshletCullData& cullData,
+		const float worldViewProjection[16], const float* cameraPosition,
+		std::vector<MeshletRange>& ranges);
+
+	// Same results, one meshlet at a time without SSE. The
+	// reference Cull() is checked against.
+	size_t CullScalar(const std::vector<Meshlet>& meshlets, const MeshletCullData& cullData,
+		const float worldViewProjection[16], const float* cameraPosition,
+		std::vector<MeshletRange>& ranges);
+}
@@ -0,0 +1,770 @@
+/*
+William Duprey
+12/9/24
+OBJ Parser Implementation
+*/
+
+#include "ObjParser.h"
+#include "MappedFile.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <thread>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// Everything one thread produces for its slice of the file.
+	// Indices into attributes are relative to this chunk until
+	// the chunks are merged back together.
+	// --------------------------------------------------------
+	struct ObjChunk
+	{
+		ObjData Data;
+
+		// Corner components that used negative (relative) indices.
+		// Stored as (corner * 3 + component), and need the number
+		// of attributes in earlier chunks added once merged.
+		std::vector<size_t> RelativeIndices;
+	};
+
+	// Exact powers of ten that fit in a double
+	const double PowersOfTen[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+		1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+	inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+
+	inline void SkipSpaces(const char*& cursor, const char* end)
+	{
+		while (cursor < end && IsSpace(*cursor))
+			cursor++;
+	}
+
+	// --------------------------------------------------------
+	// Turns a 1-based (or negative, relative) OBJ index into
+	// a 0-based index local to the chunk. Relative indices get
+	// remembered so they can be fixed up when merging.
+	// --------------------------------------------------------
+	inline int ResolveIndex(int index, size_t localCount,
+		ObjChunk& chunk, size_t component)
+	{
+		if (index > 0)
+			return index - 1;
+		if (index < 0)
+		{
+			chunk.RelativeIndices.push_back(component);
+			return (int)localCount + index;
+		}
+		return -1;
+	}
+
+	// --------------------------------------------------------
+	// Reads one "f" line (cursor is just past the 'f').
+	// Corners are gathered into a reusable scratch vector, then
+	// emitted as a triangle fan around the first corner.
+	// --------------------------------------------------------
+	void ParseFace(const char* cursor, const char* end,
+		ObjChunk& chunk, std::vector<ObjIndex>& scratch)
+	{
+		ObjData& data = chunk.Data;
+		size_t positionCount = data.Positions.size() / 3;
+		size_t uvCount = data.UVs.size() / 2;
+		size_t normalCount = data.Normals.size() / 3;
+
+		// Remember where relative indices for this face start, since
+		// they are recorded against scratch slots, not final corners
+		size_t firstRelative = chunk.RelativeIndices.size();
+
+		scratch.clear();
+		while (true)
+		{
+			int p = 0, t = 0, n = 0;
+			if (!ObjParser::ParseInt(cursor, end, p))
+				break;
+
+			// Optional "/uv", "/uv/normal" or "//normal"
+			if (cursor < end && *cursor == '/')
+			{
+				cursor++;
+				if (cursor < end && *cursor != '/')
+					ObjParser::ParseInt(cursor, end, t);
+				if (cursor < end && *cursor == '/')
+				{
+					cursor++;
+					ObjParser::ParseInt(cursor, end, n);
+				}
+			}
+
+			size_t slot = scratch.size() * 3;
+			ObjIndex corner;
+			corner.Position = ResolveIndex(p, positionCount, chunk, slot + 0);
+			corner.UV = ResolveIndex(t, uvCount, chunk, slot + 1);
+			corner.Normal = ResolveIndex(n, normalCount, chunk, slot + 2);
+			scratch.push_back(corner);
+		}
+
+		// Not a usable face
+		if (scratch.size() < 3)
+		{
+			chunk.RelativeIndices.resize(firstRelative);
+			return;
+		}
+
+		// Fan triangulation: (0, k, k + 1) for every k. A scratch
+		// slot can show up in several triangles, so relative index
+		// records are re-made for every corner that gets emitted.
+		std::vector<size_t> slots;
+		if (chunk.RelativeIndices.size() > firstRelative)
+			slots.assign(chunk.RelativeIndices.begin() + firstRelative,
+				chunk.RelativeIndices.end());
+		chunk.RelativeIndices.resize(firstRelative);
+
+		for (size_t k = 1; k + 1 < scratch.size(); k++)
+		{
+			size_t corners[3] = { 0, k, k + 1 };
+			for (size_t c = 0; c < 3; c++)
+			{
+				size_t emitted = data.Corners.size();
+				data.Corners.push_back(scratch[corners[c]]);
+
+				// Almost always empty, so this is nearly free
+				for (size_t s : slots)
+				{
+					if (s / 3 == corners[c])
+						chunk.RelativeIndices.push_back(emitted * 3 + s % 3);
+				}
+			}
+		}
+	}
+
+	// What a line holds, going by its first word
+	enum class ObjLine { Position, UV, Normal, Face, Other };
+
+	// --------------------------------------------------------
+	// Skips leading spaces and the line's first word, leaving
+	// the cursor on whatever follows it
+	// --------------------------------------------------------
+	ObjLine ReadLineType(const char*& cursor, const char* lineEnd)
+	{
+		SkipSpaces(cursor, lineEnd);
+		if (lineEnd - cursor < 2)
+			return ObjLine::Other;
+
+		char c0 = cursor[0];
+		char c1 = cursor[1];
+		if (c0 == 'v' && IsSpace(c1))
+		{
+			cursor += 1;
+			return ObjLine::Position;
+		}
+		if (c0 == 'v' && c1 == 'n')
+		{
+			cursor += 2;
+			return ObjLine::Normal;
+		}
+		if (c0 == 'v' && c1 == 't')
+		{
+			cursor += 2;
+			return ObjLine::UV;
+		}
+		if (c0 == 'f' && IsSpace(c1))
+		{
+			cursor += 1;
+			return ObjLine::Face;
+		}
+		return ObjLine::Other;
+	}
+
+	// --------------------------------------------------------
+	// Reads the first "count" numbers of a v, vt or vn line.
+	// For vt, a third (w) coordinate may follow, but is ignored.
+	// --------------------------------------------------------
+	void ParseAttribute(const char* cursor, const char* lineEnd,
+		size_t count, std::vector<float>& out)
+	{
+		float f[3] = {};
+		for (size_t i = 0; i < count; i++)
+			ObjParser::ParseFloat(cursor, lineEnd, f[i]);
+		out.insert(out.end(), f, f + count);
+	}
+
+	// --------------------------------------------------------
+	// Parses every line in [begin, end) into the chunk.
+	// Both ends are expected to be on line boundaries.
+	// --------------------------------------------------------
+	void ParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+	{
+		ObjData& data = chunk.Data;
+		std::vector<ObjIndex> scratch;
+
+		// Rough guess at how much we'll need, so the vectors
+		// don't have to double in size over and over
+		size_t bytes = (size_t)(end - begin);
+		data.Positions.reserve(bytes / 48 * 3);
+		data.Corners.reserve(bytes / 48 * 3);
+
+		const char* line = begin;
+		while (line < end)
+		{
+			// Find the end of this line (any length is fine)
+			const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+			if (!lineEnd)
+				lineEnd = end;
+
+			const char* cursor = line;
+			switch (ReadLineType(cursor, lineEnd))
+			{
+			case ObjLine::Position: ParseAttribute(cursor, lineEnd, 3, data.Positions); break;
+			case ObjLine::Normal:	ParseAttribute(cursor, lineEnd, 3, data.Normals); break;
+			case ObjLine::UV:		ParseAttribute(cursor, lineEnd, 2, data.UVs); break;
+			case ObjLine::Face:		ParseFace(cursor, lineEnd, chunk, scratch); break;
+			default: break;
+			}
+
+			line = lineEnd + 1;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Copies one chunk into its slice of the merged output,
+	// offsetting relative indices by the attribute counts of
+	// all earlier chunks. Out of range indices become -1.
+	// --------------------------------------------------------
+	void MergeChunk(const ObjChunk& chunk, ObjData& out,
+		size_t positionBase, size_t uvBase, size_t normalBase, size_t cornerBase)
+	{
+		const ObjData& data = chunk.Data;
+		if (!data.Positions.empty())
+			memcpy(&out.Positions[positionBase * 3], data.Positions.data(), data.Positions.size() * sizeof(float));
+		if (!data.UVs.empty())
+			memcpy(&out.UVs[uvBase * 2], data.UVs.data(), data.UVs.size() * sizeof(float));
+		if (!data.Normals.empty())
+			memcpy(&out.Normals[normalBase * 3], data.Normals.data(), data.Normals.size() * sizeof(float));
+		if (data.Corners.empty())
+			return;
+		memcpy(&out.Corners[cornerBase], data.Corners.data(), data.Corners.size() * sizeof(ObjIndex));
+
+		// Fix up negative indices that were relative to this chunk
+		int* components = &out.Corners[cornerBase].Position;
+		const size_t bases[3] = { positionBase, uvBase, normalBase };
+		for (size_t r : chunk.RelativeIndices)
+		{
+			components[r] += (int)bases[r % 3];
+		}
+
+		// Validate every index against the merged totals
+		const int counts[3] = {
+			(int)(out.Positions.size() / 3),
+			(int)(out.UVs.size() / 2),
+			(int)(out.Normals.size() / 3) };
+		for (size_t i = 0; i < data.Corners.size() * 3; i++)
+		{
+			int& index = components[i];
+			if (index < 0 || index >= counts[i % 3])
+				index = -1;
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Maps the file and parses it. Returns false if the file
+// could not be opened.
+// --------------------------------------------------------
+bool ObjParser::ParseFile(const char* path, ObjData& out, unsigned int threadCount)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	return ParseMemory(file.GetData(), file.GetSize(), out, threadCount);
+}
+
+// --------------------------------------------------------
+// Parses .obj text that is already in memory. Big inputs
+// are split at line boundaries and parsed in parallel, then
+// the per-thread results are stitched back together.
+// --------------------------------------------------------
+bool ObjParser::ParseMemory(const char* data, size_t size, ObjData& out, unsigned int threadCount)
+{
+	out = ObjData();
+	if (!data || size == 0)
+		return true;
+
+	// Decide how many pieces to split the file into
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		size_t bySize = size / MinBytesPerThread;
+		if (bySize < threadCount)
+			threadCount = (unsigned int)bySize;
+	}
+	if (threadCount < 1)
+		threadCount = 1;
+
+	// Find line-aligned chunk boundaries
+	std::vector<const char*> bounds(threadCount + 1);
+	const char* end = data + size;
+	bounds[0] = data;
+	bounds[threadCount] = end;
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		const char* split = data + size / threadCount * i;
+		if (split < bounds[i - 1])
+			split = bounds[i - 1];
+		const char* newline = (const char*)memchr(split, '\n', end - split);
+		bounds[i] = newline ? newline + 1 : end;
+	}
+
+	// Parse each chunk on its own thread (this one does the first)
+	std::vector<ObjChunk> chunks(threadCount);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		workers.emplace_back(ParseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+	}
+	ParseChunk(bounds[0], bounds[1], chunks[0]);
+	for (std::thread& t : workers)
+		t.join();
+
+	// Count everything so the output can be sized exactly once
+	std::vector<size_t> positionBase(threadCount), uvBase(threadCount);
+	std::vector<size_t> normalBase(threadCount), cornerBase(threadCount);
+	size_t positions = 0, uvs = 0, normals = 0, corners = 0;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		positionBase[i] = positions;
+		uvBase[i] = uvs;
+		normalBase[i] = normals;
+		cornerBase[i] = corners;
+		positions += chunks[i].Data.Positions.size() / 3;
+		uvs += chunks[i].Data.UVs.size() / 2;
+		normals += chunks[i].Data.Normals.size() / 3;
+		corners += chunks[i].Data.Corners.size();
+	}
+
+	out.Positions.resize(positions * 3);
+	out.UVs.resize(uvs * 2);
+	out.Normals.resize(normals * 3);
+	out.Corners.resize(corners);
+
+	// Stitch the chunks together, also in parallel
+	workers.clear();
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		workers.emplace_back(MergeChunk, std::cref(chunks[i]), std::ref(out),
+			positionBase[i], uvBase[i], normalBase[i], cornerBase[i]);
+	}
+	MergeChunk(chunks[0], out, 0, 0, 0, 0);
+	for (std::thread& t : workers)
+		t.join();
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Deduplicates face corners with an open-addressing hash
+// table keyed on the full index triple. Much faster than
+// std::unordered_map here, since there's exactly one
+// allocation and no per-entry nodes.
+// --------------------------------------------------------
+void ObjParser::WeldCorners(const std::vector<ObjIndex>& corners,
+	std::vector<ObjIndex>& unique, std::vector<unsigned int>& indices)
+{
+	unique.clear();
+	indices.resize(corners.size());
+
+	// Power of two table, at most half full
+	size_t capacity = 16;
+	while (capacity < corners.size() * 2)
+		capacity *= 2;
+	const unsigned int Empty = 0xFFFFFFFF;
+	std::vector<unsigned int> table(capacity, Empty);
+
+	for (size_t i = 0; i < corners.size(); i++)
+	{
+		const ObjIndex& c = corners[i];
+
+		// Mix the three indices together (multiplicative hashing)
+		uint64_t h = (uint32_t)c.Position * 0x9E3779B97F4A7C15ull;
+		h ^= (uint32_t)c.UV * 0xC2B2AE3D27D4EB4Full;
+		h ^= (uint32_t)c.Normal * 0x165667B19E3779F9ull;
+		h ^= h >> 29;
+
+		// Linear probing until we find the triple or an empty slot
+		size_t slot = (size_t)h & (capacity - 1);
+		while (true)
+		{
+			unsigned int entry = table[slot];
+			if (entry == Empty)
+			{
+				entry = (unsigned int)unique.size();
+				table[slot] = entry;
+				unique.push_back(c);
+				indices[i] = entry;
+				break;
+			}
+
+			const ObjIndex& u = unique[entry];
+			if (u.Position == c.Position && u.UV == c.UV && u.Normal == c.Normal)
+			{
+				indices[i] = entry;
+				break;
+			}
+			slot = (slot + 1) & (capacity - 1);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Parses a decimal float such as "-1.25", "3", ".5" or
+// "6.02e23". Digits are accumulated as an integer and
+// scaled by a power of ten once at the end, which is
+// much faster than strtof and accurate to within a bit
+// or two of float precision.
+// --------------------------------------------------------
+bool ObjParser::ParseFloat(const char*& cursor, const char* end, float& value)
+{
+	const char* p = cursor;
+	while (p < end && IsSpace(*p))
+		p++;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	// Up to 19 digits fit in 64 bits, the rest only shift the exponent
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	bool anyDigits = false;
+
+	while (p < end && IsDigit(*p))
+	{
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); digits += (mantissa != 0); }
+		else exponent++;
+		anyDigits = true;
+		p++;
+	}
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && IsDigit(*p))
+		{
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); digits += (mantissa != 0); exponent--; }
+			anyDigits = true;
+			p++;
+		}
+	}
+	if (!anyDigits)
+		return false;
+
+	// Optional exponent
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = (*e == '-');
+			e++;
+		}
+		if (e < end && IsDigit(*e))
+		{
+			int explicitExponent = 0;
+			while (e < end && IsDigit(*e))
+			{
+				if (explicitExponent < 10000)
+					explicitExponent = explicitExponent * 10 + (*e - '0');
+				e++;
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			p = e;
+		}
+	}
+
+	double result = (double)mantissa;
+	if (exponent < 0)
+	{
+		result = (-exponent <= 22) ? result / PowersOfTen[-exponent] : result * pow(10.0, exponent);
+	}
+	else if (exponent > 0)
+	{
+		result = (exponent <= 22) ? result * PowersOfTen[exponent] : result * pow(10.0, exponent);
+	}
+
+	value = (float)(negative ? -result : result);
+	cursor = p;
+	return true;
+}
+
+// --------------------------------------------------------
+// Whatever the budget has left after everything resident,
+// split into blocks of StreamingBytesPerTriangle each
+// --------------------------------------------------------
+size_t ObjParser::StreamingBlockTriangles(const ObjCounts& counts, size_t budget,
+	size_t otherResidentBytes)
+{
+	size_t attributeBytes = sizeof(float) * (counts.Positions * 3 + counts.UVs * 2 + counts.Normals * 3);
+	size_t residentBytes = attributeBytes + StreamWindowBytes + otherResidentBytes;
+	if (budget <= residentBytes)
+		return 0;
+
+	size_t blockTriangles = (budget - residentBytes) / StreamingBytesPerTriangle;
+	return blockTriangles < MinStreamingBlockTriangles ? 0 : blockTriangles;
+}
+
+// --------------------------------------------------------
+// Parses a (possibly negative) decimal integer. Numbers too
+// big for an int stop at INT_MAX (or -INT_MAX), which no
+// index can reach, so they're dropped as out of range.
+// --------------------------------------------------------
+bool ObjParser::ParseInt(const char*& cursor, const char* end, int& value)
+{
+	const char* p = cursor;
+	while (p < end && IsSpace(*p))
+		p++;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+	if (p >= end || !IsDigit(*p))
+		return false;
+
+	int result = 0;
+	while (p < end && IsDigit(*p))
+	{
+		int digit = *p - '0';
+		result = result > (INT_MAX - digit) / 10 ? INT_MAX : result * 10 + digit;
+		p++;
+	}
+
+	value = negative ? -result : result;
+	cursor = p;
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ----------------------------- OBJ STREAM -------------------------------- //
+///////////////////////////////////////////////////////////////////////////////
+ObjStream::ObjStream() :
+	windowBegin(0),
+	windowEnd(0),
+	endOfFile(false),
+	readingFaces(false),
+	positionsSeen(0),
+	uvsSeen(0),
+	normalsSeen(0)
+{
+}
+
+bool ObjStream::Open(const char* path, size_t windowBytes)
+{
+	file.open(path, std::ios::binary);
+	window.assign(windowBytes > 0 ? windowBytes : ObjParser::StreamWindowBytes, 0);
+	Rewind();
+	return file.is_open();
+}
+
+bool ObjStream::Count(ObjCounts& counts)
+{
+	counts = {};
+	if (!file.is_open())
+		return false;
+	Rewind();
+
+	// Faces are parsed for real, so the triangle count
+	// matches what ReadFaces() will produce
+	ObjChunk chunk;
+	std::vector<ObjIndex> scratch;
+	const char* line;
+	const char* lineEnd;
+	while (NextLine(line, lineEnd))
+	{
+		const char* cursor = line;
+		switch (ReadLineType(cursor, lineEnd))
+		{
+		case ObjLine::Position: counts.Positions++; break;
+		case ObjLine::UV:		counts.UVs++; break;
+		case ObjLine::Normal:	counts.Normals++; break;
+		case ObjLine::Face:
+			ParseFace(cursor, lineEnd, chunk, scratch);
+			counts.Triangles += chunk.Data.Corners.size() / 3;
+			chunk.Data.Corners.clear();
+			chunk.RelativeIndices.clear();
+			break;
+		default: break;
+		}
+	}
+	return true;
+}
+
+bool ObjStream::ReadAttributes(const ObjCounts& counts, ObjData& attributes)
+{
+	attributes = ObjData();
+	if (!file.is_open())
+		return false;
+	Rewind();
+
+	attributes.Positions.reserve(counts.Positions * 3);
+	attributes.UVs.reserve(counts.UVs * 2);
+	attributes.Normals.reserve(counts.Normals * 3);
+
+	const char* line;
+	const char* lineEnd;
+	while (NextLine(line, lineEnd))
+	{
+		const char* cursor = line;
+		switch (ReadLineType(cursor, lineEnd))
+		{
+		case ObjLine::Position: ParseAttribute(cursor, lineEnd, 3, attributes.Positions); break;
+		case ObjLine::Normal:	ParseAttribute(cursor, lineEnd, 3, attributes.Normals); break;
+		case ObjLine::UV:		ParseAttribute(cursor, lineEnd, 2, attributes.UVs); break;
+		default: break;
+		}
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Relative indices are fixed up face by face, since they
+// count back from however many attributes came before
+// that particular face
+// --------------------------------------------------------
+bool ObjStream::ReadFaces(const ObjData& attributes, size_t maxTriangles,
+	std::vector<ObjIndex>& corners)
+{
+	if (!file.is_open())
+		return false;
+	if (!readingFaces)
+	{
+		Rewind();
+		readingFaces = true;
+	}
+
+	// Reuses the caller's vector (and its capacity) for the block
+	ObjChunk chunk;
+	chunk.Data.Corners.swap(corners);
+	chunk.Data.Corners.clear();
+	std::vector<ObjIndex> scratch;
+
+	const char* line;
+	const char* lineEnd;
+	while (chunk.Data.Corners.size() < maxTriangles * 3 && NextLine(line, lineEnd))
+	{
+		const char* cursor = line;
+		switch (ReadLineType(cursor, lineEnd))
+		{
+		case ObjLine::Position: positionsSeen++; break;
+		case ObjLine::UV:		uvsSeen++; break;
+		case ObjLine::Normal:	normalsSeen++; break;
+		case ObjLine::Face:
+		{
+			ParseFace(cursor, lineEnd, chunk, scratch);
+			if (!chunk.RelativeIndices.empty())
+			{
+				int* components = &chunk.Data.Corners[0].Position;
+				const size_t seen[3] = { positionsSeen, uvsSeen, normalsSeen };
+				for (size_t r : chunk.RelativeIndices)
+					components[r] += (int)seen[r % 3];
+				chunk.RelativeIndices.clear();
+			}
+			break;
+		}
+		default: break;
+		}
+	}
+
+	// Validate every index against the totals
+	const int counts[3] = {
+		(int)(attributes.Positions.size() / 3),
+		(int)(attributes.UVs.size() / 2),
+		(int)(attributes.Normals.size() / 3) };
+	if (!chunk.Data.Corners.empty())
+	{
+		int* components = &chunk.Data.Corners[0].Position;
+		for (size_t i = 0; i < chunk.Data.Corners.size() * 3; i++)
+		{
+			int& index = components[i];
+			if (index < 0 || index >= counts[i % 3])
+				index = -1;
+		}
+	}
+
+	corners.swap(chunk.Data.Corners);
+	return !corners.empty();
+}
+
+void ObjStream::Rewind()
+{
+	file.clear();
+	file.seekg(0);
+	windowBegin = 0;
+	windowEnd = 0;
+	endOfFile = false;
+	readingFaces = false;
+	positionsSeen = 0;
+	uvsSeen = 0;
+	normalsSeen = 0;
+}
+
+// --------------------------------------------------------
+// Hands out lines from the window, refilling it from the
+// file whenever only part of a line is left. That part is
+// moved to the front first, so lines never get split.
+// --------------------------------------------------------
+bool ObjStream::NextLine(const char*& line, const char*& lineEnd)
+{
+	while (true)
+	{
+		const char* begin = window.data() + windowBegin;
+		const char* end = window.data() + windowEnd;
+		const char* newline = (const char*)memchr(begin, '\n', end - begin);
+		if (newline)
+		{
+			line = begin;
+			lineEnd = newline;
+			windowBegin = (size_t)(newline + 1 - window.data());
+			return true;
+		}
+
+		// The last line may not end in a newline
+		if (endOfFile)
+		{
+			if (begin == end)
+				return false;
+			line = begin;
+			lineEnd = end;
+			windowBegin = windowEnd;
+			return true;
+		}
+
+		size_t partial = windowEnd - windowBegin;
+		memmove(window.data(), begin, partial);
+		windowBegin = 0;
+		windowEnd = partial;
+
+		// One line filled the whole window
+		if (windowEnd == window.size())
+			window.resize(window.size() * 2);
+
+		file.read(window.data() + windowEnd, window.size() - windowEnd);
+		windowEnd += (size_t)file.gcount();
+		if (!file)
+			endOfFile = true;
+	}
+}
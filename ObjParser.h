@@ -0,0 +1,153 @@
+/*
+William Duprey
+12/9/24
+OBJ Parser Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <fstream>
+#include <vector>
+
+// --------------------------------------------------------
+// One corner of a face: 0-based indices into the position,
+// uv and normal arrays. Missing attributes are -1.
+// --------------------------------------------------------
+struct ObjIndex
+{
+	int Position;
+	int UV;
+	int Normal;
+};
+
+// --------------------------------------------------------
+// Raw data read from an .obj file, exactly as the file
+// describes it (no handedness or UV fixups applied).
+// Faces are triangulated as fans, so every three corners
+// make one triangle in the file's own winding order.
+// --------------------------------------------------------
+struct ObjData
+{
+	std::vector<float> Positions;	// 3 floats per position
+	std::vector<float> UVs;			// 2 floats per uv
+	std::vector<float> Normals;		// 3 floats per normal
+	std::vector<ObjIndex> Corners;	// 3 corners per triangle
+};
+
+// --------------------------------------------------------
+// How many of everything an .obj file holds
+// --------------------------------------------------------
+struct ObjCounts
+{
+	size_t Positions;
+	size_t UVs;
+	size_t Normals;
+	size_t Triangles;	// After fan triangulation
+};
+
+// --------------------------------------------------------
+// A fast .obj parser that memory-maps the file and reads
+// it in place. Numbers are parsed by hand instead of with
+// sscanf, lines may be any length, and large files are
+// split into line-aligned chunks parsed on several threads.
+//
+// Supports v, vt, vn and f (v, v/vt, v//vn, v/vt/vn, any
+// number of corners, negative indices). Everything else
+// in the file is skipped.
+// --------------------------------------------------------
+namespace ObjParser
+{
+	// Files smaller than this are always parsed on one thread
+	constexpr size_t MinBytesPerThread = 1 << 20;
+
+	// Default size of ObjStream's window into the file
+	constexpr size_t StreamWindowBytes = 1 << 20;
+
+	// Rough peak bytes per triangle of one block of a streamed
+	// load: corners, the welding table, vertices before and after
+	// optimization, the optimizer's own scratch, and the encoded copy
+	constexpr size_t StreamingBytesPerTriangle = 1024;
+
+	// Smaller blocks share too few vertices to be worth streaming
+	constexpr size_t MinStreamingBlockTriangles = 1 << 14;
+
+	// threadCount of 0 picks one based on file size and cores
+	bool ParseFile(const char* path, ObjData& out, unsigned int threadCount = 0);
+	bool ParseMemory(const char* data, size_t size, ObjData& out, unsigned int threadCount = 0);
+
+	// Finds every unique (position, uv, normal) triple among the
+	// corners. "unique" gets one entry per distinct triple, and
+	// "indices" gets one entry per corner pointing into "unique".
+	void WeldCorners(const std::vector<ObjIndex>& corners,
+		std::vector<ObjIndex>& unique, std::vector<unsigned int>& indices);
+
+	// How many triangles each ObjStream::ReadFaces() block can
+	// have for a streamed load to peak under "budget" bytes.
+	// The attributes and window are resident for the whole load,
+	// along with "otherResidentBytes" of the caller's. Returns 0
+	// if that leaves too little for a block.
+	size_t StreamingBlockTriangles(const ObjCounts& counts, size_t budget,
+		size_t otherResidentBytes = 0);
+
+	// The hand-written number parsers, exposed for reuse.
+	// Each skips leading spaces / tabs and advances "cursor"
+	// past what was read. Returns false if no number was found.
+	bool ParseFloat(const char*& cursor, const char* end, float& value);
+	bool ParseInt(const char*& cursor, const char* end, int& value);
+}
+
+// --------------------------------------------------------
+// Reads an .obj through a fixed size window instead of
+// mapping it, for files too big to hold in memory at once.
+// Each step is its own pass over the file: counting, then
+// the attributes (kept whole, since any face may use any of
+// them), then the faces, a block at a time.
+//
+// Parses lines exactly like ObjParser, on one thread. The
+// window only grows if a single line doesn't fit in it.
+// --------------------------------------------------------
+class ObjStream
+{
+public:
+	ObjStream();
+
+	bool Open(const char* path, size_t windowBytes = ObjParser::StreamWindowBytes);
+
+	// First pass: how many of everything there is
+	bool Count(ObjCounts& counts);
+
+	// Second pass: every v, vt and vn line, into vectors sized
+	// exactly from the counts (Corners is left empty)
+	bool ReadAttributes(const ObjCounts& counts, ObjData& attributes);
+
+	// Third pass, one call per block: replaces "corners" with the
+	// next whole faces, stopping once there are at least
+	// maxTriangles triangles. Indices are 0-based and checked
+	// against the attributes, like ParseMemory's. Returns false
+	// once there are no faces left.
+	bool ReadFaces(const ObjData& attributes, size_t maxTriangles,
+		std::vector<ObjIndex>& corners);
+
+private:
+	// Back to the start of the file for another pass
+	void Rewind();
+
+	// The next line, without its newline. Only valid
+	// until the next call.
+	bool NextLine(const char*& line, const char*& lineEnd);
+
+	std::ifstream file;
+
+	// Bytes read from the file, and the part not handed out yet
+	std::vector<char> window;
+	size_t windowBegin;
+	size_t windowEnd;
+	bool endOfFile;
+
+	// Attributes passed so far by the face pass, which
+	// relative (negative) indices count back from
+	bool readingFaces;
+	size_t positionsSeen;
+	size_t uvsSeen;
+	size_t normalsSeen;
+};
@@ -0,0 +1,237 @@
+/*
+William Duprey
+12/10/24
+OBJ Stream Cache Implementation
+*/
+
+#include "ObjStreamCache.h"
+#include "ObjParser.h"
+#include "MeshAnalysis.h"
+#include "MeshCache.h"
+#include "TangentGenerator.h"
+#include "VertexPacking.h"
+
+#include <utility>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// Builds a vertex from one face corner, converted to
+	// left-handed like Mesh's MakeObjVertex(). Missing
+	// attributes are zeroed before the flips.
+	// --------------------------------------------------------
+	StreamedVertex MakeVertex(const ObjData& obj, const ObjIndex& corner)
+	{
+		StreamedVertex v = {};
+		for (int a = 0; a < 3; a++)
+		{
+			if (corner.Position >= 0)
+				v.Position[a] = obj.Positions[(size_t)corner.Position * 3 + a];
+			if (corner.Normal >= 0)
+				v.Normal[a] = obj.Normals[(size_t)corner.Normal * 3 + a];
+		}
+		if (corner.UV >= 0)
+		{
+			v.UV[0] = obj.UVs[(size_t)corner.UV * 2];
+			v.UV[1] = obj.UVs[(size_t)corner.UV * 2 + 1];
+		}
+
+		v.UV[1] = 1.0f - v.UV[1];
+		v.Position[2] *= -1.0f;
+		v.Normal[2] *= -1.0f;
+		return v;
+	}
+
+	// --------------------------------------------------------
+	// Mirrors every position's Z, which is its own undo
+	// --------------------------------------------------------
+	void FlipPositionsZ(std::vector<float>& positions)
+	{
+		for (size_t i = 2; i < positions.size(); i += 3)
+			positions[i] = -positions[i];
+	}
+
+	void AddCacheStats(VertexCacheStats& total, const VertexCacheStats& block)
+	{
+		total.VerticesTransformed += block.VerticesTransformed;
+	}
+
+	void FinishCacheStats(VertexCacheStats& total, size_t triangles, size_t vertices)
+	{
+		total.ACMR = (float)total.VerticesTransformed / triangles;
+		total.ATVR = (float)total.VerticesTransformed / vertices;
+	}
+
+	void AddOverdrawStats(OverdrawStats& total, const OverdrawStats& block)
+	{
+		total.PixelsCovered += block.PixelsCovered;
+		total.PixelsShaded += block.PixelsShaded;
+	}
+
+	void FinishOverdrawStats(OverdrawStats& total)
+	{
+		total.Overdraw = total.PixelsCovered == 0 ? 0.0f :
+			(float)total.PixelsShaded / total.PixelsCovered;
+	}
+}
+
+// --------------------------------------------------------
+// Meshlets stay resident for the whole load too, so their
+// memory comes out of the budget before the blocks get the
+// rest (they're about one per hundred triangles, and get
+// copied twice more when the cache is loaded)
+// --------------------------------------------------------
+bool ObjStreamCache::Write(const char* objPath, const char* cachePath,
+	const ObjStreamSettings& settings, size_t* blockTriangles)
+{
+	ObjStream stream;
+	ObjCounts counts;
+	if (!stream.Open(objPath) || !stream.Count(counts) ||
+		counts.Positions == 0 || counts.Triangles == 0)
+		return false;
+
+	size_t meshletBytes = settings.BuildMeshlets ? sizeof(Meshlet) * (counts.Triangles / 64 + 1) * 3 : 0;
+	size_t perBlock = ObjParser::StreamingBlockTriangles(counts, settings.Budget, meshletBytes);
+	if (blockTriangles)
+		*blockTriangles = perBlock;
+	if (perBlock == 0)
+		return false;
+
+	ObjData attributes;
+	if (!stream.ReadAttributes(counts, attributes))
+		return false;
+
+	// Packing needs the bounds before the first block, so fit them
+	// to every position, flipped to left-handed just long enough
+	BoundingVolumes bounds;
+	FlipPositionsZ(attributes.Positions);
+	Bounds::Calculate(bounds, attributes.Positions.data(), counts.Positions,
+		sizeof(float) * 3, settings.BuildOrientedBox);
+	FlipPositionsZ(attributes.Positions);
+
+	MeshCacheStream cache;
+	if (!cache.Open(cachePath, counts.Triangles * 3))
+		return false;
+
+	MeshCacheHeader header = {};
+	size_t totalVertices = 0;
+	size_t totalIndices = 0;
+	size_t totalCorners = 0;
+	std::vector<Meshlet> allMeshlets;
+
+	// Reused by every block
+	std::vector<ObjIndex> corners;
+	std::vector<ObjIndex> uniqueCorners;
+	std::vector<unsigned int> indices;
+	std::vector<StreamedVertex> verts;
+	std::vector<StreamedVertex> remapped;
+	std::vector<unsigned int> remap;
+	std::vector<PackedVertex> packed;
+	std::vector<Meshlet> blockMeshlets;
+	const size_t Stride = sizeof(StreamedVertex);
+	while (stream.ReadFaces(attributes, perBlock, corners))
+	{
+		ObjParser::WeldCorners(corners, uniqueCorners, indices);
+		totalCorners += corners.size();
+
+		verts.resize(uniqueCorners.size());
+		for (size_t i = 0; i < uniqueCorners.size(); i++)
+			verts[i] = MakeVertex(attributes, uniqueCorners[i]);
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			std::swap(indices[i + 1], indices[i + 2]);
+
+		// Same steps as Mesh::OptimizeForGPU(), with stats
+		// before and after each block
+		AddCacheStats(header.CacheStatsBefore,
+			MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), verts.size()));
+		AddCacheStats(header.LruStatsBefore,
+			MeshAnalysis::AnalyzeLruCache(indices.data(), indices.size(), verts.size()));
+		AddOverdrawStats(header.OverdrawStatsBefore, MeshOptimizer::AnalyzeOverdraw(
+			indices.data(), indices.size(), verts[0].Position, verts.size(), Stride));
+
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.data(), indices.size(), verts.size());
+		MeshOptimizer::OptimizeOverdraw(indices.data(), indices.data(), indices.size(),
+			verts[0].Position, verts.size(), Stride, settings.OverdrawThreshold);
+		remap.resize(verts.size());
+		size_t used = MeshOptimizer::OptimizeVertexFetchRemap(
+			remap.data(), indices.data(), indices.size(), verts.size());
+		remapped.resize(used);
+		MeshOptimizer::RemapVertexBuffer(remapped.data(), verts.data(), verts.size(), Stride, remap.data());
+		MeshOptimizer::RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+		verts.swap(remapped);
+
+		AddCacheStats(header.CacheStatsAfter,
+			MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), verts.size()));
+		AddCacheStats(header.LruStatsAfter,
+			MeshAnalysis::AnalyzeLruCache(indices.data(), indices.size(), verts.size()));
+		AddOverdrawStats(header.OverdrawStatsAfter, MeshOptimizer::AnalyzeOverdraw(
+			indices.data(), indices.size(), verts[0].Position, verts.size(), Stride));
+
+		TangentGenerator::Calculate(verts[0].Position, verts[0].Normal, verts[0].UV,
+			verts[0].Tangent, Stride, verts.size(), indices.data(), indices.size());
+
+		if (settings.BuildMeshlets)
+		{
+			Meshlets::Build(blockMeshlets, indices.data(), indices.size(),
+				verts[0].Position, verts.size(), Stride);
+			for (Meshlet& meshlet : blockMeshlets)
+				meshlet.IndexOffset += (uint32_t)totalIndices;
+			allMeshlets.insert(allMeshlets.end(), blockMeshlets.begin(), blockMeshlets.end());
+		}
+
+		// Indices become relative to the start of the whole mesh
+		for (unsigned int& index : indices)
+			index += (unsigned int)totalVertices;
+
+		bool written;
+		if (settings.PackVertices)
+		{
+			packed.resize(verts.size());
+			for (size_t i = 0; i < verts.size(); i++)
+			{
+				const StreamedVertex& v = verts[i];
+				packed[i] = VertexPacking::Pack(v.Position, v.Normal, v.Tangent, v.UV,
+					bounds.BoxMin, bounds.BoxMax);
+			}
+			written = cache.WriteVertices(packed.data(), sizeof(PackedVertex) * packed.size());
+		}
+		else
+		{
+			written = cache.WriteVertices(verts.data(), Stride * verts.size());
+		}
+		if (!written || !cache.WriteIndices(indices.data(), indices.size()))
+			return false;
+
+		totalVertices += verts.size();
+		totalIndices += indices.size();
+		if (totalVertices > UINT32_MAX)
+			return false;
+	}
+
+	// Whole mesh stats from the per-block counts
+	size_t triangles = totalIndices / 3;
+	FinishCacheStats(header.CacheStatsBefore, triangles, totalVertices);
+	FinishCacheStats(header.CacheStatsAfter, triangles, totalVertices);
+	FinishCacheStats(header.LruStatsBefore, triangles, totalVertices);
+	FinishCacheStats(header.LruStatsAfter, triangles, totalVertices);
+	FinishOverdrawStats(header.OverdrawStatsBefore);
+	FinishOverdrawStats(header.OverdrawStatsAfter);
+
+	// Just the full detail level
+	LodLevel lod = { 0, (uint32_t)totalIndices, 0.0f, 0.0f };
+
+	header.SourceHash = settings.SourceHash;
+	header.OverdrawThreshold = settings.OverdrawThreshold;
+	header.VertexStride = settings.PackVertices ? sizeof(PackedVertex) : sizeof(StreamedVertex);
+	header.VertexCount = (uint32_t)totalVertices;
+	header.IndexStride = totalVertices <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.IndexCount = (uint32_t)totalIndices;
+	header.MeshletCount = (uint32_t)allMeshlets.size();
+	header.LodCount = 1;
+	header.RequestedLodCount = settings.RequestedLodCount;
+	header.Bounds = bounds;
+	header.UnweldedVertexCount = (uint32_t)totalCorners;
+	return cache.Finish(header, allMeshlets.data(), &lod);
+}
@@ -0,0 +1,62 @@
+/*
+William Duprey
+12/10/24
+OBJ Stream Cache Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "MeshOptimizer.h"
+
+// --------------------------------------------------------
+// Same layout as Vertex (Vertex.h), without DirectXMath.
+// Unpacked vertices are written to the cache like this.
+// --------------------------------------------------------
+struct StreamedVertex
+{
+	float Position[3];
+	float Normal[3];
+	float Tangent[3];
+	float UV[2];
+};
+static_assert(sizeof(StreamedVertex) == 44, "StreamedVertex must match Vertex");
+
+// --------------------------------------------------------
+// How a streamed .obj is processed, and what its cache
+// file gets stamped with (see MeshOptions)
+// --------------------------------------------------------
+struct ObjStreamSettings
+{
+	size_t Budget = 0;
+	float OverdrawThreshold = MeshOptimizer::DefaultOverdrawThreshold;
+	bool PackVertices = false;
+	bool BuildMeshlets = false;
+	bool BuildOrientedBox = false;
+	uint64_t SourceHash = 0;
+	uint32_t RequestedLodCount = 1;
+};
+
+// --------------------------------------------------------
+// The bounded memory .obj to cache file pipeline. The file
+// is read through ObjStream in blocks sized by
+// ObjParser::StreamingBlockTriangles(), and each block is
+// welded, optimized, given tangents, split into meshlets and
+// encoded on its own, then written straight into the cache
+// with MeshCacheStream. Block indices are offset by the
+// vertices of earlier blocks, so the blocks add up to one
+// mesh, and the stats in the header are totals over all of
+// them. Positions, normals and winding are converted to
+// left-handed, and UVs flipped, exactly like Mesh's own
+// loading. Indices are 16 bits whenever every one fits.
+// --------------------------------------------------------
+namespace ObjStreamCache
+{
+	// Returns false if the file can't be read, has no faces,
+	// its attributes alone don't fit the budget, or the cache
+	// can't be written. blockTriangles, if given, gets the
+	// triangles per block.
+	bool Write(const char* objPath, const char* cachePath,
+		const ObjStreamSettings& settings, size_t* blockTriangles = nullptr);
+}
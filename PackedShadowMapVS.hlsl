@@ -0,0 +1,10 @@
+/*
+William Duprey
+12/10/24
+Packed Shadow Map Vertex Shader
+*/
+
+// The shadow map vertex shader, reading PackedVertex input
+// instead of Vertex. All of the code lives in ShadowMapVS.hlsl.
+#define PACKED_VERTICES
+#include "ShadowMapVS.hlsl"
@@ -0,0 +1,10 @@
+/*
+William Duprey
+12/10/24
+Packed Vertex Shader
+*/
+
+// The regular vertex shader, reading PackedVertex input
+// instead of Vertex. All of the code lives in VertexShader.hlsl.
+#define PACKED_VERTICES
+#include "VertexShader.hlsl"
@@ -0,0 +1,285 @@
+/*
+William Duprey
+12/10/24
+PLY Reader Implementation
+*/
+
+#include "PlyReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// The scalar types a property can have, with both the
+	// original names and the sized ones newer files use
+	enum PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, TypeCount };
+	const char* TypeNames[TypeCount][2] = {
+		{ "char", "int8" }, { "uchar", "uint8" },
+		{ "short", "int16" }, { "ushort", "uint16" },
+		{ "int", "int32" }, { "uint", "uint32" },
+		{ "float", "float32" }, { "double", "float64" } };
+	const size_t TypeSizes[TypeCount] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+	// Headers are a few hundred bytes, so anything longer
+	// than this isn't a real .ply file
+	const size_t MaxHeaderLines = 4096;
+
+	int FindType(const std::string& name)
+	{
+		for (int t = 0; t < TypeCount; t++)
+		{
+			if (name == TypeNames[t][0] || name == TypeNames[t][1])
+				return t;
+		}
+		return -1;
+	}
+
+	// Copies a scalar out of the file, swapping its bytes if
+	// the file's byte order isn't this machine's
+	template <typename T>
+	T Load(const unsigned char* bytes, bool swap)
+	{
+		unsigned char copy[sizeof(T)];
+		memcpy(copy, bytes, sizeof(T));
+		if (swap)
+			std::reverse(copy, copy + sizeof(T));
+
+		T value;
+		memcpy(&value, copy, sizeof(T));
+		return value;
+	}
+
+	bool IsLittleEndian()
+	{
+		const uint16_t one = 1;
+		unsigned char first;
+		memcpy(&first, &one, 1);
+		return first == 1;
+	}
+}
+
+PlyReader::PlyReader() :
+	dataOffset(0),
+	pointCount(0),
+	stride(0),
+	bigEndian(false),
+	pointsRead(0)
+{
+}
+
+// --------------------------------------------------------
+// Parses the header line by line, adding up the size of
+// every element before the vertices to find where they start
+// --------------------------------------------------------
+bool PlyReader::Open(const char* path, size_t windowBytes)
+{
+	file.close();
+	file.clear();
+	file.open(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::string line;
+	if (!std::getline(file, line) || line.substr(0, 3) != "ply")
+		return false;
+
+	const char* positionNames[3] = { "x", "y", "z" };
+	const char* colorNames[3] = { "red", "green", "blue" };
+	for (int i = 0; i < 3; i++)
+	{
+		position[i] = Property();
+		color[i] = Property();
+	}
+
+	bool binary = false;
+	bool inVertex = false;
+	bool foundVertex = false;
+	bool vertexHasList = false;
+	uint64_t skippedBytes = 0;		// Elements before the vertices
+	uint64_t elementCount = 0;		// Of the element being read
+	size_t elementStride = 0;
+	bool elementHasList = false;
+	stride = 0;
+
+	// Ends the element being read, counting its bytes if it
+	// comes before the vertices
+	auto endElement = [&]()
+		{
+			if (inVertex)
+			{
+				stride = elementStride;
+				vertexHasList = elementHasList;
+				foundVertex = true;
+			}
+			else if (!foundVertex)
+			{
+				if (elementHasList && elementCount > 0)
+					return false;
+				skippedBytes += elementCount * elementStride;
+			}
+			return true;
+		};
+
+	bool headerEnded = false;
+	for (size_t lineCount = 0; lineCount < MaxHeaderLines && std::getline(file, line); lineCount++)
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		std::istringstream words(line);
+		std::string keyword;
+		words >> keyword;
+
+		if (keyword == "format")
+		{
+			std::string format;
+			words >> format;
+			binary = (format == "binary_little_endian" || format == "binary_big_endian");
+			bigEndian = (format == "binary_big_endian");
+		}
+		else if (keyword == "element")
+		{
+			if (!endElement())
+				return false;
+
+			std::string name;
+			words >> name >> elementCount;
+			inVertex = (name == "vertex");
+			if (inVertex)
+				pointCount = elementCount;
+			elementStride = 0;
+			elementHasList = false;
+		}
+		else if (keyword == "property")
+		{
+			std::string type, name;
+			words >> type;
+			if (type == "list")
+			{
+				elementHasList = true;
+				continue;
+			}
+			words >> name;
+
+			int t = FindType(type);
+			if (t < 0)
+				return false;
+
+			if (inVertex)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					if (name == positionNames[i])
+						position[i] = { t, elementStride };
+					if (name == colorNames[i] || name == std::string("diffuse_") + colorNames[i])
+						color[i] = { t, elementStride };
+				}
+			}
+			elementStride += TypeSizes[t];
+		}
+		else if (keyword == "end_header")
+		{
+			if (!endElement())
+				return false;
+			headerEnded = true;
+			break;
+		}
+	}
+
+	// Needs every coordinate, and vertices of a known size
+	if (!headerEnded || !binary || !foundVertex || vertexHasList || stride == 0 ||
+		position[0].Type < 0 || position[1].Type < 0 || position[2].Type < 0)
+		return false;
+
+	dataOffset = (uint64_t)file.tellg() + skippedBytes;
+	window.resize(std::max(windowBytes, stride));
+	return Rewind();
+}
+
+bool PlyReader::Rewind()
+{
+	if (!file.is_open())
+		return false;
+
+	file.clear();
+	file.seekg(dataOffset);
+	pointsRead = 0;
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Reads as many whole vertices as fit in the window, then
+// converts them one at a time
+// --------------------------------------------------------
+size_t PlyReader::Read(PlyPoint* points, size_t maxPoints)
+{
+	if (!file.is_open() || stride == 0)
+		return 0;
+
+	uint64_t count = std::min<uint64_t>(pointCount - pointsRead, maxPoints);
+	count = std::min<uint64_t>(count, window.size() / stride);
+	if (count == 0)
+		return 0;
+
+	if (!file.read((char*)window.data(), (std::streamsize)(count * stride)))
+		return 0;
+
+	bool colors = HasColors();
+	for (size_t i = 0; i < count; i++)
+	{
+		const unsigned char* vertex = window.data() + i * stride;
+		PlyPoint& p = points[i];
+		for (int c = 0; c < 3; c++)
+		{
+			p.Position[c] = ReadProperty(vertex, position[c]);
+			p.Color[c] = colors ? ReadColor(vertex, color[c]) : 255;
+		}
+		p.Color[3] = 255;
+	}
+
+	pointsRead += count;
+	return (size_t)count;
+}
+
+uint64_t PlyReader::GetPointCount() const { return pointCount; }
+bool PlyReader::HasColors() const { return color[0].Type >= 0 && color[1].Type >= 0 && color[2].Type >= 0; }
+
+double PlyReader::ReadProperty(const unsigned char* vertex, const Property& property) const
+{
+	const unsigned char* bytes = vertex + property.Offset;
+	bool swap = (bigEndian == IsLittleEndian());
+	switch (property.Type)
+	{
+	case Int8: return (double)(int8_t)bytes[0];
+	case UInt8: return (double)bytes[0];
+	case Int16: return (double)Load<int16_t>(bytes, swap);
+	case UInt16: return (double)Load<uint16_t>(bytes, swap);
+	case Int32: return (double)Load<int32_t>(bytes, swap);
+	case UInt32: return (double)Load<uint32_t>(bytes, swap);
+	case Float32: return (double)Load<float>(bytes, swap);
+	case Float64: return Load<double>(bytes, swap);
+	default: return 0.0;
+	}
+}
+
+// --------------------------------------------------------
+// Scales a color channel to 8 bits, by its type's range
+// (0 - 1 for floating point channels)
+// --------------------------------------------------------
+uint8_t PlyReader::ReadColor(const unsigned char* vertex, const Property& property) const
+{
+	double value = ReadProperty(vertex, property);
+	switch (property.Type)
+	{
+	case UInt16: value /= 257.0; break;
+	case Float32:
+	case Float64: value *= 255.0; break;
+	default: break;
+	}
+	return (uint8_t)std::clamp(value + 0.5, 0.0, 255.0);
+}
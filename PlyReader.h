@@ -0,0 +1,81 @@
+/*
+William Duprey
+12/10/24
+PLY Reader Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// --------------------------------------------------------
+// One point of a scan, exactly as the file describes it
+// (no handedness fixup). Positions stay in double, since
+// scans are often in large world coordinates.
+// --------------------------------------------------------
+struct PlyPoint
+{
+	double Position[3];
+	uint8_t Color[4];	// RGBA, white if the file has no colors
+};
+
+// --------------------------------------------------------
+// Reads the vertex element of a binary (little or big
+// endian) .ply file a window at a time, so scans far bigger
+// than memory can be read in several passes.
+//
+// x, y and z may be any scalar type. red, green and blue
+// (or diffuse_red and so on) are optional, and 8 bit, 16 bit
+// and float colors are all converted to 8 bits. Elements
+// before the vertices must have fixed sizes (no lists);
+// anything after them (faces, usually) is never read.
+// ASCII files are not supported.
+// --------------------------------------------------------
+class PlyReader
+{
+public:
+	// Default size of the window into the file
+	static constexpr size_t WindowBytes = 1 << 20;
+
+	PlyReader();
+
+	// Reads the header and stops at the first vertex
+	bool Open(const char* path, size_t windowBytes = WindowBytes);
+
+	// Back to the first vertex for another pass
+	bool Rewind();
+
+	// Reads up to maxPoints more points. Returns how many were
+	// read, which is 0 once every point has been (or on error).
+	size_t Read(PlyPoint* points, size_t maxPoints);
+
+	// Getters
+	uint64_t GetPointCount() const;
+	bool HasColors() const;
+
+private:
+	// One scalar property of a vertex, and where it is
+	struct Property
+	{
+		int Type = -1;		// Index into the type table, -1 if missing
+		size_t Offset = 0;	// Bytes from the start of the vertex
+	};
+
+	double ReadProperty(const unsigned char* vertex, const Property& property) const;
+	uint8_t ReadColor(const unsigned char* vertex, const Property& property) const;
+
+	std::ifstream file;
+	std::vector<unsigned char> window;
+
+	// Layout of the vertex element
+	uint64_t dataOffset;	// First vertex, from the start of the file
+	uint64_t pointCount;
+	size_t stride;
+	bool bigEndian;
+	Property position[3];
+	Property color[3];
+
+	uint64_t pointsRead;
+};
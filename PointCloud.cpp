@@ -0,0 +1,207 @@
+/*
+William Duprey
+12/10/24
+PointCloud Implementation
+*/
+
+#include "PointCloud.h"
+#include "Graphics.h"
+#include "MeshCache.h"
+#include "Window.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Maps the octree, building it first if needed. A cloud that
+// fails to load just never draws (see IsLoaded()).
+// --------------------------------------------------------
+PointCloud::PointCloud(const char* plyPath,
+	std::shared_ptr<SimpleVertexShader> _pointVS,
+	std::shared_ptr<SimplePixelShader> _pointPS,
+	size_t _gpuBudget)
+	: view(),
+	  pointVS(_pointVS),
+	  pointPS(_pointPS),
+	  gpuBudget(_gpuBudget),
+	  frame(0),
+	  targetSpacing(1.5f),
+	  pointBudget(8000000),
+	  stats()
+{
+	uint64_t sourceHash;
+	if (!MeshCache::HashFile(plyPath, sourceHash))
+		return;
+
+	std::string octreePath = std::string(plyPath) + PointOctree::Extension;
+	if (file.Open(octreePath.c_str()) && PointOctree::Read(file, view) &&
+		view.Header->SourceHash == sourceHash)
+	{
+		stats.SourcePoints = view.Header->SourcePointCount;
+		stats.NodeCount = view.Header->NodeCount;
+		return;
+	}
+
+	// Missing or stale, so (re)build it. The old file has to be
+	// closed first, since it can't be replaced while mapped.
+	view = {};
+	file.Close();
+	auto buildStart = std::chrono::high_resolution_clock::now();
+	if (!PointOctree::Build(plyPath, octreePath.c_str(), sourceHash))
+		return;
+	auto buildEnd = std::chrono::high_resolution_clock::now();
+	stats.BuildTime = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+
+	if (file.Open(octreePath.c_str()) && PointOctree::Read(file, view))
+	{
+		stats.SourcePoints = view.Header->SourcePointCount;
+		stats.NodeCount = view.Header->NodeCount;
+	}
+}
+
+// --------------------------------------------------------
+// Selection runs on the CPU every frame (it only looks at
+// the node table). Selected nodes already on the GPU are
+// marked first, so making room for new ones never drops them.
+// --------------------------------------------------------
+void PointCloud::Draw(std::shared_ptr<Camera> cam)
+{
+	if (!view.Header)
+		return;
+	frame++;
+
+	// --- Select nodes from the camera ---
+	XMFLOAT4X4 viewMatrix = cam->GetViewMatrix();
+	XMFLOAT4X4 projMatrix = cam->GetProjectionMatrix();
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(
+		XMLoadFloat4x4(&viewMatrix), XMLoadFloat4x4(&projMatrix)));
+	XMFLOAT3 position = cam->GetTransform()->GetPosition();
+
+	PointOctreeCamera octreeCamera = {};
+	memcpy(octreeCamera.ViewProjection, &viewProjection, sizeof(octreeCamera.ViewProjection));
+	octreeCamera.Position[0] = position.x;
+	octreeCamera.Position[1] = position.y;
+	octreeCamera.Position[2] = position.z;
+	octreeCamera.Perspective = cam->DoingPerspective();
+	float screenHeight = (float)Window::Height();
+	octreeCamera.PixelsPerUnit = octreeCamera.Perspective ?
+		screenHeight / (2.0f * tanf(cam->GetFieldOfView() * 0.5f)) :
+		screenHeight / (cam->GetOrthographicWidth() / cam->GetAspectRatio());
+	octreeCamera.TargetSpacing = targetSpacing;
+	octreeCamera.PointBudget = std::min<uint64_t>(pointBudget, gpuBudget / sizeof(OctreePoint));
+
+	stats.SelectedPoints = PointOctree::SelectNodes(view.Nodes, view.Header->NodeCount,
+		octreeCamera, selected);
+	stats.SelectedNodes = (uint32_t)selected.size();
+
+	// --- Stream in what's missing, most needed first ---
+	for (uint32_t node : selected)
+	{
+		auto found = resident.find(node);
+		if (found != resident.end())
+			found->second.LastUsed = frame;
+	}
+
+	stats.Loads = 0;
+	stats.Evictions = 0;
+	size_t uploaded = 0;
+	for (uint32_t node : selected)
+	{
+		if (resident.count(node) != 0 || view.Nodes[node].PointCount == 0)
+			continue;
+		if (stats.Loads > 0 && uploaded >= MaxUploadBytesPerFrame)
+			break;
+		if (!Upload(node))
+			break;
+		uploaded += sizeof(OctreePoint) * view.Nodes[node].PointCount;
+	}
+
+	// --- Draw everything selected that's on the GPU ---
+	pointVS->SetShader();
+	pointPS->SetShader();
+	pointVS->SetMatrix4x4("view", viewMatrix);
+	pointVS->SetMatrix4x4("projection", projMatrix);
+	pointVS->CopyAllBufferData();
+	Graphics::Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+
+	stats.DrawnNodes = 0;
+	stats.DrawnPoints = 0;
+	UINT stride = sizeof(OctreePoint);
+	UINT offset = 0;
+	for (uint32_t node : selected)
+	{
+		auto found = resident.find(node);
+		if (found == resident.end())
+			continue;
+
+		UINT count = view.Nodes[node].PointCount;
+		Graphics::Context->IASetVertexBuffers(0, 1, found->second.Buffer.GetAddressOf(), &stride, &offset);
+		Graphics::Context->Draw(count, 0);
+		stats.DrawnNodes++;
+		stats.DrawnPoints += count;
+	}
+
+	// Everything else draws triangles
+	Graphics::Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stats.ResidentNodes = (uint32_t)resident.size();
+}
+
+// --------------------------------------------------------
+// The points go straight from the mapped file into an
+// immutable buffer, so the OS pages them in from disk here
+// --------------------------------------------------------
+bool PointCloud::Upload(uint32_t node)
+{
+	const PointOctreeNode& n = view.Nodes[node];
+	size_t bytes = sizeof(OctreePoint) * n.PointCount;
+
+	// Drop the least recently used nodes until it fits
+	while (stats.ResidentBytes + bytes > gpuBudget)
+	{
+		auto oldest = resident.end();
+		for (auto it = resident.begin(); it != resident.end(); ++it)
+		{
+			if (it->second.LastUsed != frame &&
+				(oldest == resident.end() || it->second.LastUsed < oldest->second.LastUsed))
+				oldest = it;
+		}
+		if (oldest == resident.end())
+			return false;
+
+		stats.ResidentBytes -= sizeof(OctreePoint) * view.Nodes[oldest->first].PointCount;
+		resident.erase(oldest);
+		stats.Evictions++;
+	}
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.ByteWidth = (UINT)bytes;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = view.Points + n.FirstPoint;
+
+	ResidentNode added;
+	added.LastUsed = frame;
+	if (FAILED(Graphics::Device->CreateBuffer(&desc, &data, added.Buffer.GetAddressOf())))
+		return false;
+
+	resident[node] = added;
+	stats.ResidentBytes += bytes;
+	stats.Loads++;
+	return true;
+}
+
+bool PointCloud::IsLoaded() { return view.Header != nullptr; }
+const PointCloudStats& PointCloud::GetStats() { return stats; }
+float PointCloud::GetTargetSpacing() { return targetSpacing; }
+uint64_t PointCloud::GetPointBudget() { return pointBudget; }
+
+void PointCloud::SetTargetSpacing(float _targetSpacing) { targetSpacing = std::max(_targetSpacing, 0.1f); }
+void PointCloud::SetPointBudget(uint64_t _pointBudget) { pointBudget = _pointBudget; }
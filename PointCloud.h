@@ -0,0 +1,111 @@
+/*
+William Duprey
+12/10/24
+PointCloud Header
+*/
+
+#pragma once
+#include "Camera.h"
+#include "MappedFile.h"
+#include "PointOctree.h"
+#include "SimpleShader.h"
+
+#include <d3d11.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <wrl/client.h> // Used for ComPtr
+
+// --------------------------------------------------------
+// What the last Draw() did, for the UI
+// --------------------------------------------------------
+struct PointCloudStats
+{
+	uint64_t SourcePoints;
+	uint32_t NodeCount;
+	uint32_t SelectedNodes;
+	uint64_t SelectedPoints;
+	uint32_t DrawnNodes;		// Selected AND on the GPU
+	uint64_t DrawnPoints;
+	uint32_t ResidentNodes;
+	size_t ResidentBytes;
+	uint32_t Loads;				// Nodes uploaded this frame
+	uint32_t Evictions;			// Nodes dropped this frame
+	double BuildTime;			// ms, 0 if the octree was already built
+};
+
+// --------------------------------------------------------
+// Draws a huge point scan (a binary .ply) through an octree
+// built next to it (see PointOctree). Only the nodes the
+// camera needs are selected each frame, and only those get
+// vertex buffers: new ones are uploaded a few at a time from
+// the mapped octree file, and the least recently used are
+// dropped to stay under the GPU budget.
+//
+// Points are drawn as one pixel each (a point list), and
+// the cloud sits where the octree puts it: centered on the
+// world origin.
+// --------------------------------------------------------
+class PointCloud
+{
+public:
+	// GPU memory for point vertex buffers
+	static constexpr size_t DefaultGpuBudget = (size_t)256 << 20;
+
+	// Most bytes uploaded in one frame, so streaming in a
+	// new view never causes a big hitch (at least one node
+	// is always uploaded, however big)
+	static constexpr size_t MaxUploadBytesPerFrame = (size_t)16 << 20;
+
+	// Builds the octree first if it's missing, or was built
+	// from a different version of the .ply
+	PointCloud(const char* plyPath,
+		std::shared_ptr<SimpleVertexShader> _pointVS,
+		std::shared_ptr<SimplePixelShader> _pointPS,
+		size_t _gpuBudget = DefaultGpuBudget);
+
+	// Selects, streams in and draws the nodes the camera needs.
+	// Binds its own vertex buffers, so anything drawn through
+	// GeometryArena should come before this.
+	void Draw(std::shared_ptr<Camera> cam);
+
+	// Getters
+	bool IsLoaded();
+	const PointCloudStats& GetStats();
+	float GetTargetSpacing();
+	uint64_t GetPointBudget();
+
+	// Setters
+	void SetTargetSpacing(float _targetSpacing);
+	void SetPointBudget(uint64_t _pointBudget);
+
+private:
+	// A node with its points on the GPU
+	struct ResidentNode
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		unsigned int LastUsed;		// Frame it was last selected
+	};
+
+	// Uploads a node's points, dropping old nodes to make room.
+	// Returns false if there's no room without dropping a node
+	// selected this frame.
+	bool Upload(uint32_t node);
+
+	MappedFile file;
+	PointOctreeView view;
+
+	std::shared_ptr<SimpleVertexShader> pointVS;
+	std::shared_ptr<SimplePixelShader> pointPS;
+
+	std::unordered_map<uint32_t, ResidentNode> resident;
+	size_t gpuBudget;
+	unsigned int frame;
+
+	// Refinement settings (see PointOctreeCamera)
+	float targetSpacing;
+	uint64_t pointBudget;
+
+	std::vector<uint32_t> selected;
+	PointCloudStats stats;
+};
@@ -0,0 +1,693 @@
+/*
+William Duprey
+12/10/24
+Point Octree Implementation
+*/
+
+#include "PointOctree.h"
+#include "Bounds.h"
+#include "PlyReader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <string>
+#include <utility>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const char Magic[4] = { 'W', 'D', 'P', 'O' };
+
+	// Points read from the .ply (or a temporary file) at a time
+	const size_t ReadBatchPoints = 1 << 15;
+
+	// Bytes a chunk needs per point while it's built: the
+	// points themselves, with room to spare for the rest
+	const size_t BytesPerBuildPoint = sizeof(OctreePoint) * 2;
+
+	// Smallest buffer each chunk gets while points are copied
+	// to the temporary file, so writes never get tiny
+	const size_t MinChunkBufferPoints = 256;
+
+	// Keeps a node's sampling grid (one bit per cell) small
+	const uint32_t MaxSampleGrid = 256;
+
+	// Levels below the root of the histogram pyramid
+	const uint32_t HistogramLevels = 7;
+	static_assert((1u << HistogramLevels) == PointOctree::HistogramGrid,
+		"The histogram must be a power of two across");
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Which of "grid" cells across a cube a coordinate is in
+	uint32_t CellOf(float p, float min, float size, uint32_t grid)
+	{
+		float cell = (p - min) / size * (float)grid;
+		if (!(cell > 0.0f))
+			return 0;
+		return std::min((uint32_t)cell, grid - 1);
+	}
+
+	// --------------------------------------------------------
+	// Moves a point from the file's space to the octree's:
+	// relative to the origin, and flipped to left-handed like
+	// .obj meshes are. Points with NaN or infinite coordinates
+	// are dropped.
+	// --------------------------------------------------------
+	bool ToOctreePoint(const PlyPoint& source, const double origin[3], OctreePoint& point)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			if (!std::isfinite(source.Position[a]))
+				return false;
+		}
+		point.Position[0] = (float)(source.Position[0] - origin[0]);
+		point.Position[1] = (float)(source.Position[1] - origin[1]);
+		point.Position[2] = (float)(origin[2] - source.Position[2]);
+		memcpy(point.Color, source.Color, sizeof(point.Color));
+		return true;
+	}
+
+	// A node while the octree is built, before it's moved
+	// to breadth first order
+	struct BuildNode
+	{
+		PointOctreeNode Node;
+		uint32_t Children[8];
+	};
+
+	// --------------------------------------------------------
+	// A cube of the histogram pyramid. The top of the octree is
+	// made of these, split until each is small enough to load
+	// whole; the ones that weren't split are the chunks.
+	// --------------------------------------------------------
+	struct Chunk
+	{
+		uint32_t Level;
+		uint32_t Cell[3];
+		uint64_t Count;
+		uint32_t Children[8];
+		uint8_t ChildCount;
+
+		// Where its points go in the temporary file (chunks only),
+		// and the ones waiting to be written there
+		uint64_t FirstPoint;
+		uint64_t Written;
+		std::vector<OctreePoint> Buffer;
+	};
+
+	// --------------------------------------------------------
+	// Everything the build steps share
+	// --------------------------------------------------------
+	struct Builder
+	{
+		PointOctreeSettings Settings;
+		float RootMin[3];
+		float RootSize;
+
+		std::fstream Out;
+		uint64_t PointOffset;
+		uint64_t PointsWritten;
+		std::vector<BuildNode> Nodes;
+		uint32_t MaxLevel;
+
+		// One bit per cell of a node's sampling grid. Only one
+		// node samples at a time, and clears its bits after.
+		std::vector<uint64_t> Sampled;
+
+		std::fstream Temp;
+		std::vector<Chunk> Chunks;
+	};
+
+	uint32_t NewNode(Builder& b, const float min[3], float size, uint32_t level)
+	{
+		BuildNode built = {};
+		memcpy(built.Node.Min, min, sizeof(built.Node.Min));
+		built.Node.Size = size;
+		built.Node.Spacing = size / (float)b.Settings.SampleGrid;
+		built.Node.Level = (uint8_t)level;
+		b.Nodes.push_back(built);
+		b.MaxLevel = std::max(b.MaxLevel, level);
+		return (uint32_t)(b.Nodes.size() - 1);
+	}
+
+	bool WritePoints(Builder& b, uint32_t node, const OctreePoint* points, size_t count)
+	{
+		b.Nodes[node].Node.FirstPoint = b.PointsWritten;
+		b.Nodes[node].Node.PointCount = (uint32_t)count;
+		b.Out.seekp(b.PointOffset + sizeof(OctreePoint) * b.PointsWritten);
+		b.Out.write((const char*)points, sizeof(OctreePoint) * count);
+		b.PointsWritten += count;
+		return b.Out.good();
+	}
+
+	void AddChild(Builder& b, uint32_t parent, uint32_t child)
+	{
+		PointOctreeNode& node = b.Nodes[parent].Node;
+		b.Nodes[parent].Children[node.ChildCount++] = child;
+	}
+
+	// --------------------------------------------------------
+	// Keeps the first point in each cell of the node's sampling
+	// grid, moving those to the front. Returns how many.
+	// --------------------------------------------------------
+	size_t SamplePoints(Builder& b, OctreePoint* points, size_t count, const float min[3], float size)
+	{
+		uint64_t grid = b.Settings.SampleGrid;
+		auto key = [&](const OctreePoint& p)
+			{
+				uint64_t x = CellOf(p.Position[0], min[0], size, (uint32_t)grid);
+				uint64_t y = CellOf(p.Position[1], min[1], size, (uint32_t)grid);
+				uint64_t z = CellOf(p.Position[2], min[2], size, (uint32_t)grid);
+				return (x * grid + y) * grid + z;
+			};
+
+		size_t kept = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t k = key(points[i]);
+			uint64_t bit = 1ull << (k & 63);
+			if (b.Sampled[k >> 6] & bit)
+				continue;
+			b.Sampled[k >> 6] |= bit;
+			std::swap(points[kept++], points[i]);
+		}
+
+		// Every kept point set exactly one bit
+		for (size_t i = 0; i < kept; i++)
+			b.Sampled[key(points[i]) >> 6] = 0;
+		return kept;
+	}
+
+	// --------------------------------------------------------
+	// Sorts points into their octants in place (by z, then y,
+	// then x), so octant o is [splits[o], splits[o + 1]), with
+	// bit 0 of o set for the upper half of x, bit 1 for y and
+	// bit 2 for z
+	// --------------------------------------------------------
+	void SplitOctants(OctreePoint* points, size_t count, const float min[3], float size,
+		OctreePoint* splits[9])
+	{
+		float half = size * 0.5f;
+		auto below = [&](int axis)
+			{
+				float middle = min[axis] + half;
+				return [axis, middle](const OctreePoint& p) { return p.Position[axis] < middle; };
+			};
+
+		splits[0] = points;
+		splits[8] = points + count;
+		splits[4] = std::partition(splits[0], splits[8], below(2));
+		for (int h = 0; h < 8; h += 4)
+			splits[h + 2] = std::partition(splits[h], splits[h + 4], below(1));
+		for (int q = 0; q < 8; q += 2)
+			splits[q + 1] = std::partition(splits[q], splits[q + 2], below(0));
+	}
+
+	// --------------------------------------------------------
+	// Builds a node from points that are all in memory: it
+	// keeps a subsample and the rest go to its children, until
+	// few enough are left that it keeps them all
+	// --------------------------------------------------------
+	bool BuildSubtree(Builder& b, OctreePoint* points, size_t count,
+		const float min[3], float size, uint32_t level, uint32_t& index)
+	{
+		index = NewNode(b, min, size, level);
+		if (count <= b.Settings.MaxLeafPoints || level >= PointOctree::MaxLevel)
+			return WritePoints(b, index, points, count);
+
+		size_t kept = SamplePoints(b, points, count, min, size);
+		if (!WritePoints(b, index, points, kept))
+			return false;
+
+		OctreePoint* splits[9];
+		SplitOctants(points + kept, count - kept, min, size, splits);
+		float half = size * 0.5f;
+		for (int o = 0; o < 8; o++)
+		{
+			if (splits[o] == splits[o + 1])
+				continue;
+
+			float childMin[3];
+			for (int a = 0; a < 3; a++)
+				childMin[a] = min[a] + (((o >> a) & 1) ? half : 0.0f);
+
+			uint32_t child;
+			if (!BuildSubtree(b, splits[o], (size_t)(splits[o + 1] - splits[o]),
+				childMin, half, level + 1, child))
+				return false;
+			AddChild(b, index, child);
+		}
+		return true;
+	}
+
+	void ChunkBounds(const Builder& b, const Chunk& chunk, float min[3], float& size)
+	{
+		size = b.RootSize / (float)(1u << chunk.Level);
+		for (int a = 0; a < 3; a++)
+			min[a] = b.RootMin[a] + size * (float)chunk.Cell[a];
+	}
+
+	// --------------------------------------------------------
+	// Splits a cube of the histogram pyramid until its pieces
+	// fit in memory (or can't be split further). Returns false
+	// for an empty cube, which gets no chunk.
+	// --------------------------------------------------------
+	bool SplitChunks(Builder& b, const std::vector<std::vector<uint64_t>>& pyramid,
+		uint32_t level, uint32_t x, uint32_t y, uint32_t z, size_t chunkPoints, uint32_t& index)
+	{
+		uint64_t n = 1ull << level;
+		uint64_t count = pyramid[level][(x * n + y) * n + z];
+		if (count == 0)
+			return false;
+
+		index = (uint32_t)b.Chunks.size();
+		b.Chunks.push_back({});
+		Chunk& chunk = b.Chunks.back();
+		chunk.Level = level;
+		chunk.Cell[0] = x;
+		chunk.Cell[1] = y;
+		chunk.Cell[2] = z;
+		chunk.Count = count;
+		if (count <= chunkPoints || level == HistogramLevels)
+			return true;
+
+		for (uint32_t o = 0; o < 8; o++)
+		{
+			uint32_t child;
+			if (SplitChunks(b, pyramid, level + 1,
+				x * 2 + (o & 1), y * 2 + ((o >> 1) & 1), z * 2 + ((o >> 2) & 1), chunkPoints, child))
+			{
+				Chunk& parent = b.Chunks[index];
+				parent.Children[parent.ChildCount++] = child;
+			}
+		}
+		return true;
+	}
+
+	bool FlushChunk(Builder& b, Chunk& chunk)
+	{
+		if (chunk.Buffer.empty())
+			return true;
+
+		b.Temp.seekp(sizeof(OctreePoint) * (chunk.FirstPoint + chunk.Written));
+		b.Temp.write((const char*)chunk.Buffer.data(), sizeof(OctreePoint) * chunk.Buffer.size());
+		chunk.Written += chunk.Buffer.size();
+		chunk.Buffer.clear();
+		return b.Temp.good();
+	}
+
+	// --------------------------------------------------------
+	// Builds a chunk from its points in the temporary file, or
+	// the nodes above the chunks from their children. Those get
+	// a subsample of their children's own points, which stay in
+	// the children too, since they're already written.
+	// --------------------------------------------------------
+	bool BuildChunk(Builder& b, uint32_t chunkIndex, uint32_t& index)
+	{
+		float min[3];
+		float size;
+		ChunkBounds(b, b.Chunks[chunkIndex], min, size);
+		uint32_t level = b.Chunks[chunkIndex].Level;
+
+		if (b.Chunks[chunkIndex].ChildCount == 0)
+		{
+			std::vector<OctreePoint> points((size_t)b.Chunks[chunkIndex].Count);
+			b.Temp.seekg(sizeof(OctreePoint) * b.Chunks[chunkIndex].FirstPoint);
+			if (!b.Temp.read((char*)points.data(), sizeof(OctreePoint) * points.size()))
+				return false;
+			return BuildSubtree(b, points.data(), points.size(), min, size, level, index);
+		}
+
+		std::vector<uint32_t> children;
+		for (uint8_t c = 0; c < b.Chunks[chunkIndex].ChildCount; c++)
+		{
+			uint32_t child;
+			if (!BuildChunk(b, b.Chunks[chunkIndex].Children[c], child))
+				return false;
+			children.push_back(child);
+		}
+
+		std::vector<OctreePoint> points;
+		for (uint32_t child : children)
+		{
+			const PointOctreeNode& node = b.Nodes[child].Node;
+			size_t first = points.size();
+			points.resize(first + node.PointCount);
+			b.Out.seekg(b.PointOffset + sizeof(OctreePoint) * node.FirstPoint);
+			if (!b.Out.read((char*)(points.data() + first), sizeof(OctreePoint) * node.PointCount))
+				return false;
+		}
+
+		index = NewNode(b, min, size, level);
+		for (uint32_t child : children)
+			AddChild(b, index, child);
+		size_t kept = SamplePoints(b, points.data(), points.size(), min, size);
+		return WritePoints(b, index, points.data(), kept);
+	}
+}
+
+// --------------------------------------------------------
+// Runs every step of the build (see PointOctree.h), with
+// the header written last so an unfinished file never reads
+// --------------------------------------------------------
+bool PointOctree::Build(const char* plyPath, const char* octreePath, uint64_t sourceHash,
+	const PointOctreeSettings& settings)
+{
+	PlyReader reader;
+	if (!reader.Open(plyPath))
+		return false;
+
+	Builder b;
+	b.Settings = settings;
+	b.Settings.MaxLeafPoints = std::max(b.Settings.MaxLeafPoints, 1u);
+	b.Settings.SampleGrid = std::clamp(b.Settings.SampleGrid, 1u, MaxSampleGrid);
+	b.PointsWritten = 0;
+	b.MaxLevel = 0;
+	uint64_t gridCells = (uint64_t)b.Settings.SampleGrid * b.Settings.SampleGrid * b.Settings.SampleGrid;
+	b.Sampled.assign((size_t)((gridCells + 63) / 64), 0);
+
+	// --- Bounds, in the file's own coordinates ---
+	std::vector<PlyPoint> batch(ReadBatchPoints);
+	const double Largest = std::numeric_limits<double>::max();
+	double low[3] = { Largest, Largest, Largest };
+	double high[3] = { -Largest, -Largest, -Largest };
+	size_t read;
+	while ((read = reader.Read(batch.data(), batch.size())) > 0)
+	{
+		for (size_t i = 0; i < read; i++)
+		{
+			const double* p = batch[i].Position;
+			if (!std::isfinite(p[0]) || !std::isfinite(p[1]) || !std::isfinite(p[2]))
+				continue;
+			for (int a = 0; a < 3; a++)
+			{
+				low[a] = std::min(low[a], p[a]);
+				high[a] = std::max(high[a], p[a]);
+			}
+		}
+	}
+	if (low[0] > high[0])
+		return false;
+
+	// The root is a cube around the origin, padded a little so
+	// rounding never puts a point outside it
+	double origin[3];
+	double extent = 0.0;
+	for (int a = 0; a < 3; a++)
+	{
+		origin[a] = (low[a] + high[a]) * 0.5;
+		extent = std::max(extent, high[a] - low[a]);
+	}
+	b.RootSize = extent > 0.0 ? (float)(extent * 1.001) : 1.0f;
+	for (int a = 0; a < 3; a++)
+		b.RootMin[a] = -b.RootSize * 0.5f;
+
+	// --- Histogram, then the sums of each level above it ---
+	const uint32_t grid = HistogramGrid;
+	std::vector<std::vector<uint64_t>> pyramid(HistogramLevels + 1);
+	pyramid[HistogramLevels].assign((size_t)grid * grid * grid, 0);
+	auto cellIndex = [&](const OctreePoint& p)
+		{
+			size_t x = CellOf(p.Position[0], b.RootMin[0], b.RootSize, grid);
+			size_t y = CellOf(p.Position[1], b.RootMin[1], b.RootSize, grid);
+			size_t z = CellOf(p.Position[2], b.RootMin[2], b.RootSize, grid);
+			return (x * grid + y) * grid + z;
+		};
+
+	if (!reader.Rewind())
+		return false;
+	while ((read = reader.Read(batch.data(), batch.size())) > 0)
+	{
+		for (size_t i = 0; i < read; i++)
+		{
+			OctreePoint p;
+			if (ToOctreePoint(batch[i], origin, p))
+				pyramid[HistogramLevels][cellIndex(p)]++;
+		}
+	}
+
+	for (uint32_t level = HistogramLevels; level > 0; level--)
+	{
+		size_t n = (size_t)1 << level;
+		size_t half = n / 2;
+		pyramid[level - 1].assign(half * half * half, 0);
+		for (size_t x = 0; x < n; x++)
+		{
+			for (size_t y = 0; y < n; y++)
+			{
+				for (size_t z = 0; z < n; z++)
+				{
+					pyramid[level - 1][((x / 2) * half + y / 2) * half + z / 2] +=
+						pyramid[level][(x * n + y) * n + z];
+				}
+			}
+		}
+	}
+
+	// --- Chunks, and which one each histogram cell belongs to ---
+	size_t chunkPoints = std::max<size_t>(b.Settings.MaxLeafPoints,
+		b.Settings.MemoryBudget / BytesPerBuildPoint);
+	uint32_t rootChunk;
+	if (!SplitChunks(b, pyramid, 0, 0, 0, 0, chunkPoints, rootChunk))
+		return false;
+
+	std::vector<uint32_t> cellChunk(pyramid[HistogramLevels].size());
+	std::vector<uint32_t> leafChunks;
+	uint64_t tempPoints = 0;
+	for (uint32_t c = 0; c < (uint32_t)b.Chunks.size(); c++)
+	{
+		Chunk& chunk = b.Chunks[c];
+		if (chunk.ChildCount != 0)
+			continue;
+
+		chunk.FirstPoint = tempPoints;
+		tempPoints += chunk.Count;
+		leafChunks.push_back(c);
+
+		// Every histogram cell inside the chunk's cube
+		uint32_t span = 1u << (HistogramLevels - chunk.Level);
+		for (uint32_t x = chunk.Cell[0] * span; x < (chunk.Cell[0] + 1) * span; x++)
+			for (uint32_t y = chunk.Cell[1] * span; y < (chunk.Cell[1] + 1) * span; y++)
+				for (uint32_t z = chunk.Cell[2] * span; z < (chunk.Cell[2] + 1) * span; z++)
+					cellChunk[((size_t)x * grid + y) * grid + z] = c;
+	}
+	pyramid.clear();
+	pyramid.shrink_to_fit();
+
+	// --- Every point to its chunk's part of the temporary file ---
+	std::string tempPath = std::string(octreePath) + ".tmp";
+	b.Temp.open(tempPath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+	if (!b.Temp.is_open())
+		return false;
+
+	size_t bufferPoints = std::max(MinChunkBufferPoints,
+		b.Settings.MemoryBudget / 2 / sizeof(OctreePoint) / leafChunks.size());
+	bool good = reader.Rewind();
+	while (good && (read = reader.Read(batch.data(), batch.size())) > 0)
+	{
+		for (size_t i = 0; i < read && good; i++)
+		{
+			OctreePoint p;
+			if (!ToOctreePoint(batch[i], origin, p))
+				continue;
+
+			Chunk& chunk = b.Chunks[cellChunk[cellIndex(p)]];
+			chunk.Buffer.push_back(p);
+			if (chunk.Buffer.size() >= bufferPoints)
+				good = FlushChunk(b, chunk);
+		}
+	}
+	for (uint32_t c : leafChunks)
+	{
+		good = good && FlushChunk(b, b.Chunks[c]);
+		b.Chunks[c].Buffer.shrink_to_fit();
+	}
+	cellChunk.clear();
+	cellChunk.shrink_to_fit();
+
+	// --- Nodes, one chunk at a time, into the octree file ---
+	b.Out.open(octreePath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+	uint32_t root = 0;
+	if (good && b.Out.is_open())
+	{
+		b.PointOffset = AlignUp(sizeof(PointOctreeHeader), BlobAlignment);
+		const char zeroes[BlobAlignment * 16] = {};
+		static_assert(sizeof(zeroes) >= sizeof(PointOctreeHeader), "Header must fit in the zeroes");
+		b.Out.write(zeroes, b.PointOffset);
+		good = b.Out.good() && BuildChunk(b, rootChunk, root);
+	}
+	else
+		good = false;
+
+	b.Temp.close();
+	std::remove(tempPath.c_str());
+	if (!good)
+		return false;
+
+	// --- Node table, breadth first so siblings are together ---
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> newIndex(b.Nodes.size());
+	order.reserve(b.Nodes.size());
+	order.push_back(root);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		newIndex[order[i]] = (uint32_t)i;
+		const BuildNode& built = b.Nodes[order[i]];
+		for (uint8_t c = 0; c < built.Node.ChildCount; c++)
+			order.push_back(built.Children[c]);
+	}
+
+	std::vector<PointOctreeNode> table(order.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const BuildNode& built = b.Nodes[order[i]];
+		table[i] = built.Node;
+		table[i].FirstChild = built.Node.ChildCount ? newIndex[built.Children[0]] : 0;
+	}
+
+	PointOctreeHeader header = {};
+	memcpy(header.Magic, Magic, sizeof(Magic));
+	header.Version = Version;
+	header.SourceHash = sourceHash;
+	memcpy(header.Origin, origin, sizeof(origin));
+	header.NodeCount = (uint32_t)table.size();
+	header.MaxLevel = b.MaxLevel;
+	header.PointCount = b.PointsWritten;
+	header.SourcePointCount = reader.GetPointCount();
+	header.PointOffset = b.PointOffset;
+	header.NodeOffset = AlignUp((size_t)(b.PointOffset + sizeof(OctreePoint) * b.PointsWritten),
+		BlobAlignment);
+
+	b.Out.seekp(header.NodeOffset);
+	b.Out.write((const char*)table.data(), sizeof(PointOctreeNode) * table.size());
+	b.Out.seekp(0);
+	b.Out.write((const char*)&header, sizeof(header));
+	return b.Out.good();
+}
+
+// --------------------------------------------------------
+// Validates a mapped octree file and finds its blobs. Every
+// node is checked too, since SelectNodes() follows children
+// without checking: children always come after their parent
+// (so there are no cycles), and everything is in range.
+// --------------------------------------------------------
+bool PointOctree::Read(const MappedFile& file, PointOctreeView& view)
+{
+	view = {};
+	if (!file.IsOpen() || file.GetSize() < sizeof(PointOctreeHeader))
+		return false;
+
+	const PointOctreeHeader* header = (const PointOctreeHeader*)file.GetData();
+	if (memcmp(header->Magic, Magic, sizeof(Magic)) != 0 ||
+		header->Version != Version || header->NodeCount == 0)
+		return false;
+
+	uint64_t size = file.GetSize();
+	if (header->PointOffset % BlobAlignment != 0 || header->NodeOffset % BlobAlignment != 0 ||
+		header->PointOffset > size || header->NodeOffset > size ||
+		header->PointCount > (size - header->PointOffset) / sizeof(OctreePoint) ||
+		header->NodeCount > (size - header->NodeOffset) / sizeof(PointOctreeNode))
+		return false;
+
+	const PointOctreeNode* nodes = (const PointOctreeNode*)(file.GetData() + header->NodeOffset);
+	for (uint32_t i = 0; i < header->NodeCount; i++)
+	{
+		const PointOctreeNode& node = nodes[i];
+		if (node.FirstPoint > header->PointCount ||
+			node.PointCount > header->PointCount - node.FirstPoint ||
+			node.ChildCount > 8)
+			return false;
+		if (node.ChildCount != 0 &&
+			(node.FirstChild <= i || node.FirstChild > header->NodeCount - node.ChildCount))
+			return false;
+	}
+
+	view.Header = header;
+	view.Points = (const OctreePoint*)(file.GetData() + header->PointOffset);
+	view.Nodes = nodes;
+	return true;
+}
+
+// --------------------------------------------------------
+// A best-first walk down the tree. A node's priority is how
+// far apart its points look on screen: its spacing, over
+// the distance to the nearest point of its bounding sphere
+// for a perspective camera. A camera inside a node's sphere
+// always wants that node first.
+// --------------------------------------------------------
+uint64_t PointOctree::SelectNodes(const PointOctreeNode* nodes, size_t nodeCount,
+	const PointOctreeCamera& camera, std::vector<uint32_t>& selected)
+{
+	selected.clear();
+	if (nodeCount == 0)
+		return 0;
+
+	float planes[6][4];
+	Bounds::ExtractPlanes(camera.ViewProjection, planes);
+
+	// Returns false if the node is outside the frustum
+	auto prioritize = [&](const PointOctreeNode& node, float& priority)
+		{
+			float half = node.Size * 0.5f;
+			float center[3] = { node.Min[0] + half, node.Min[1] + half, node.Min[2] + half };
+			float radius = half * sqrtf(3.0f);
+			for (int p = 0; p < 6; p++)
+			{
+				float distance = center[0] * planes[p][0] + center[1] * planes[p][1] +
+					center[2] * planes[p][2] + planes[p][3];
+				if (distance < -radius)
+					return false;
+			}
+
+			priority = node.Spacing * camera.PixelsPerUnit;
+			if (camera.Perspective)
+			{
+				float d[3] = {
+					center[0] - camera.Position[0],
+					center[1] - camera.Position[1],
+					center[2] - camera.Position[2] };
+				float distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) - radius;
+				priority = distance > 0.0f ? priority / distance : std::numeric_limits<float>::max();
+			}
+			return true;
+		};
+
+	std::priority_queue<std::pair<float, uint32_t>> queue;
+	float priority;
+	if (prioritize(nodes[0], priority))
+		queue.push({ priority, 0 });
+
+	uint64_t total = 0;
+	while (!queue.empty())
+	{
+		auto [spacing, index] = queue.top();
+		queue.pop();
+
+		const PointOctreeNode& node = nodes[index];
+		if (total + node.PointCount > camera.PointBudget)
+			break;
+		total += node.PointCount;
+		selected.push_back(index);
+
+		// Dense enough already, so its children aren't needed
+		if (spacing <= camera.TargetSpacing)
+			continue;
+
+		for (uint32_t c = 0; c < node.ChildCount; c++)
+		{
+			uint32_t child = node.FirstChild + c;
+			if (child < nodeCount && prioritize(nodes[child], priority))
+				queue.push({ priority, child });
+		}
+	}
+	return total;
+}
@@ -0,0 +1,164 @@
+/*
+William Duprey
+12/10/24
+Point Octree Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MappedFile.h"
+
+// --------------------------------------------------------
+// One point as it's stored (and drawn): a position relative
+// to the octree's origin, and an RGBA color. Must match the
+// PointVertexShaderInput struct in ShaderIncludes.hlsli.
+// --------------------------------------------------------
+struct OctreePoint
+{
+	float Position[3];
+	uint8_t Color[4];
+};
+
+// --------------------------------------------------------
+// One cube of the octree. Each node holds a subsample of
+// the points inside it, one per cell of a grid with Spacing
+// sized cells, and its children hold the rest. Coarse nodes
+// are meant to be drawn along WITH their children (additive
+// refinement), so drawing any connected set of nodes from
+// the root down shows every point once, at most.
+//
+// The exception is nodes the builder made from points that
+// were already in their children (see PointOctree::Build()),
+// which only adds some overdraw.
+// --------------------------------------------------------
+struct PointOctreeNode
+{
+	float Min[3];			// Corner of the cube, relative to the origin
+	float Size;				// Width of the cube
+	float Spacing;			// Smallest distance between this node's points
+	uint32_t PointCount;
+	uint64_t FirstPoint;	// Index into the point blob
+	uint32_t FirstChild;	// Children are contiguous; 0 if there are none
+	uint8_t ChildCount;
+	uint8_t Level;			// 0 for the root
+	uint16_t Padding;
+};
+
+// --------------------------------------------------------
+// Header at the very start of an octree file. The points
+// follow it, grouped by node, then the node table (in
+// breadth first order, so the root is node 0).
+// --------------------------------------------------------
+struct PointOctreeHeader
+{
+	char Magic[4];				// Always "WDPO"
+	uint32_t Version;			// PointOctree::Version when written
+	uint64_t SourceHash;		// MeshCache::Hash() of the .ply file
+
+	// Every stored position is relative to this, so large
+	// world coordinates keep their precision as floats
+	double Origin[3];
+
+	uint32_t NodeCount;
+	uint32_t MaxLevel;			// Deepest node's level
+	uint64_t PointCount;		// Stored, counting any repeats
+	uint64_t SourcePointCount;	// In the .ply file
+	uint64_t PointOffset;		// From the start of the file
+	uint64_t NodeOffset;
+};
+
+// --------------------------------------------------------
+// Pointers into a mapped, validated octree file
+// --------------------------------------------------------
+struct PointOctreeView
+{
+	const PointOctreeHeader* Header;
+	const OctreePoint* Points;
+	const PointOctreeNode* Nodes;
+};
+
+// --------------------------------------------------------
+// How the octree is built. Memory use stays near
+// MemoryBudget however big the scan is.
+// --------------------------------------------------------
+struct PointOctreeSettings
+{
+	uint32_t MaxLeafPoints = 20000;		// Nodes with fewer than this aren't split
+	uint32_t SampleGrid = 128;			// Cells across a node's sampling grid
+	size_t MemoryBudget = (size_t)512 << 20;
+};
+
+// --------------------------------------------------------
+// Where the octree is seen from, for SelectNodes(). Every
+// position is relative to the octree's origin.
+// --------------------------------------------------------
+struct PointOctreeCamera
+{
+	float ViewProjection[16];	// Row-major, for row vectors (like DirectXMath)
+	float Position[3];
+	bool Perspective;
+
+	// Screen pixels per world unit: at a distance of 1 for a
+	// perspective camera, or anywhere for an orthographic one
+	float PixelsPerUnit;
+
+	// Nodes are refined until their points are at most this
+	// many pixels apart on screen (or the budget runs out)
+	float TargetSpacing;
+	uint64_t PointBudget;
+};
+
+// --------------------------------------------------------
+// Out-of-core octree builder for huge point scans, and the
+// node selection used to stream it.
+//
+// Building reads the .ply a window at a time:
+//  1. Bounds, then a histogram of points over a coarse grid
+//  2. The top of the octree is split until each piece (a
+//     "chunk") fits in the memory budget, and every point is
+//     copied to its chunk's part of a temporary file
+//  3. One chunk at a time is loaded and built into nodes,
+//     each keeping a grid subsample and handing the rest of
+//     its points down to its children
+//  4. The nodes above the chunks get subsamples of their
+//     children's points (copies, since those are written)
+// --------------------------------------------------------
+namespace PointOctree
+{
+	// Bump whenever the file layout OR the building changes
+	constexpr uint32_t Version = 1;
+
+	// Appended to the source file's path
+	constexpr const char* Extension = ".octree";
+
+	// Alignment of the blobs within the file
+	constexpr size_t BlobAlignment = 16;
+
+	// Depth where nodes stop splitting no matter how many
+	// points they have (only piles of repeated points get here)
+	constexpr uint32_t MaxLevel = 24;
+
+	// Cells across the histogram of step 1 (so the deepest
+	// chunks are at level 7)
+	constexpr uint32_t HistogramGrid = 128;
+
+	// Builds an octree file from a binary .ply. The temporary
+	// file is the output path plus ".tmp", and is deleted after.
+	bool Build(const char* plyPath, const char* octreePath, uint64_t sourceHash,
+		const PointOctreeSettings& settings = PointOctreeSettings());
+
+	// Checks the magic, version and that every blob fits inside
+	// the file. Does NOT check the hash.
+	bool Read(const MappedFile& file, PointOctreeView& view);
+
+	// Picks the nodes to draw, most needed first: visible nodes
+	// are refined in order of how far apart their points look,
+	// until they're all dense enough or the next one would go
+	// over the point budget. Children only come after their
+	// parent. Returns the number of points selected.
+	uint64_t SelectNodes(const PointOctreeNode* nodes, size_t nodeCount,
+		const PointOctreeCamera& camera, std::vector<uint32_t>& selected);
+}
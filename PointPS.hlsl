@@ -0,0 +1,16 @@
+/*
+William Duprey
+12/10/24
+Point Pixel Shader
+*/
+
+#include "ShaderIncludes.hlsli"
+
+// --------------------------------------------------------
+// The entry point for the point pixel shader. Points are
+// just their scanned color, with no lighting.
+// --------------------------------------------------------
+float4 main(VertexToPixel_Point input) : SV_TARGET
+{
+    return input.color;
+}
@@ -0,0 +1,32 @@
+/*
+William Duprey
+12/10/24
+Point Vertex Shader
+*/
+
+#include "ShaderIncludes.hlsli"
+
+// Point clouds are drawn in place, so only
+// view and projection are needed
+cbuffer ExternalData : register(b0)
+{
+    matrix view;
+    matrix projection;
+}
+
+// --------------------------------------------------------
+// The entry point for the point vertex shader. Positions
+// one point, and unpacks its RGBA8 color.
+// --------------------------------------------------------
+VertexToPixel_Point main(PointVertexShaderInput input)
+{
+    VertexToPixel_Point output;
+    
+    matrix vp = mul(projection, view);
+    output.position = mul(vp, float4(input.localPosition, 1.0f));
+    
+    uint c = input.packedColor;
+    output.color = float4(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF, c >> 24) / 255.0f;
+    
+    return output;
+}
@@ -0,0 +1,117 @@
+/*
+William Duprey
+12/10/24
+RangeAllocator Implementation
+*/
+
+#include "RangeAllocator.h"
+
+#include <iterator>
+
+RangeAllocator::RangeAllocator() : capacity(0), used(0) { }
+
+RangeAllocator::RangeAllocator(size_t capacity) : capacity(0), used(0)
+{
+	Grow(capacity);
+}
+
+// --------------------------------------------------------
+// Best fit: the smallest free range that's big enough, so
+// big ranges stay whole for big requests. Whatever's left
+// of it stays free.
+// --------------------------------------------------------
+size_t RangeAllocator::Allocate(size_t size)
+{
+	if (size == 0)
+		return InvalidOffset;
+
+	// Lowest offset among the best fits, which keeps
+	// allocations packed toward the start
+	auto best = freeBySize.lower_bound({ size, 0 });
+	if (best == freeBySize.end())
+		return InvalidOffset;
+
+	size_t freeSize = best->first;
+	size_t offset = best->second;
+	RemoveFree(freeByOffset.find(offset));
+	if (freeSize > size)
+		AddFree(offset + size, freeSize - size);
+
+	used += size;
+	return offset;
+}
+
+// --------------------------------------------------------
+// Merges the freed range with the free ranges right before
+// and after it, if there are any
+// --------------------------------------------------------
+void RangeAllocator::Free(size_t offset, size_t size)
+{
+	if (size == 0 || offset == InvalidOffset)
+		return;
+	used -= size;
+
+	auto next = freeByOffset.lower_bound(offset);
+	if (next != freeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFree(previous);
+		}
+	}
+	if (next != freeByOffset.end() && offset + size == next->first)
+	{
+		size += next->second;
+		RemoveFree(next);
+	}
+
+	AddFree(offset, size);
+}
+
+// --------------------------------------------------------
+// The new space is freed like any other range, so it joins
+// a free range that was already at the end
+// --------------------------------------------------------
+void RangeAllocator::Grow(size_t newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	size_t oldCapacity = capacity;
+	capacity = newCapacity;
+	used += newCapacity - oldCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+size_t RangeAllocator::GetCapacity() const { return capacity; }
+size_t RangeAllocator::GetUsed() const { return used; }
+size_t RangeAllocator::GetFreeRangeCount() const { return freeByOffset.size(); }
+
+size_t RangeAllocator::GetLargestFree() const
+{
+	return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+}
+
+float RangeAllocator::GetFragmentation() const
+{
+	size_t free = capacity - used;
+	return free == 0 ? 0.0f : 1.0f - (float)GetLargestFree() / free;
+}
+
+// --------------------------------------------------------
+// Keeping the two maps in sync
+// --------------------------------------------------------
+void RangeAllocator::AddFree(size_t offset, size_t size)
+{
+	freeByOffset.emplace(offset, size);
+	freeBySize.insert({ size, offset });
+}
+
+void RangeAllocator::RemoveFree(std::map<size_t, size_t>::iterator range)
+{
+	freeBySize.erase({ range->second, range->first });
+	freeByOffset.erase(range);
+}
@@ -0,0 +1,60 @@
+/*
+William Duprey
+12/10/24
+RangeAllocator Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <map>
+#include <set>
+#include <utility>
+
+// --------------------------------------------------------
+// Hands out ranges of [0, capacity) from a free list, for
+// sub-allocating big buffers. Best fit, and neighboring
+// free ranges are merged as soon as they're freed, so
+// fragmentation only comes from what's still allocated.
+// Units are up to the caller (vertices, indices, bytes).
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	// What Allocate() returns when nothing is big enough
+	static constexpr size_t InvalidOffset = (size_t)-1;
+
+	RangeAllocator();
+	RangeAllocator(size_t capacity);
+
+	// Returns the offset of "size" free units, or InvalidOffset
+	size_t Allocate(size_t size);
+
+	// Gives back a range from Allocate(), exactly as allocated
+	void Free(size_t offset, size_t size);
+
+	// Adds free space at the end (the new capacity must be larger)
+	void Grow(size_t newCapacity);
+
+	// Getters
+	size_t GetCapacity() const;
+	size_t GetUsed() const;
+	size_t GetLargestFree() const;
+	size_t GetFreeRangeCount() const;
+
+	// 0 when all free space is one range, approaching 1 as it's
+	// split into many small ones: 1 - largest free / total free
+	float GetFragmentation() const;
+
+private:
+	// Inserting and removing a free range from both maps
+	void AddFree(size_t offset, size_t size);
+	void RemoveFree(std::map<size_t, size_t>::iterator range);
+
+	// Every free range, both by where it starts (for merging)
+	// and by its size, then offset (for best fit)
+	std::map<size_t, size_t> freeByOffset;
+	std::set<std::pair<size_t, size_t>> freeBySize;
+
+	size_t capacity;
+	size_t used;
+};
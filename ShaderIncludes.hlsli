@@ -29,6 +29,42 @@ struct VertexShaderInput
     float2 uv : TEXCOORD;
 };
 
+// Compact version of VertexShaderInput
+// - Must match the PackedVertex struct in VertexPacking.h
+// - Everything is read as raw uints (so SimpleShader's reflected
+//   input layout has the right byte sizes) and unpacked by
+//   UnpackVertex() below
+struct PackedVertexShaderInput
+{
+    uint2 packedPosition : POSITION; // 3x unorm16 within mesh bounds
+    uint packedNormal : NORMAL;      // 2x snorm16, octahedral
+    uint packedTangent : TANGENT;    // 2x snorm16, octahedral
+    uint packedUV : TEXCOORD;        // 2x half float
+};
+
+// Position-only versions of the two structs above, for depth-only passes
+// - Either matches the position stream of a mesh, OR the mesh's full
+//   vertex buffer, since position is always the first member
+struct PositionOnlyVertexShaderInput
+{
+    float3 localPosition : POSITION;
+};
+
+struct PackedPositionOnlyVertexShaderInput
+{
+    uint2 packedPosition : POSITION;
+};
+
+// One point of a point cloud
+// - Must match the OctreePoint struct in PointOctree.h
+// - Color is read as a raw uint (RGBA8) for the same reason
+//   the packed vertex members are
+struct PointVertexShaderInput
+{
+    float3 localPosition : POSITION;
+    uint packedColor : COLOR;
+};
+
 // Struct representing the data we're sending down the pipeline
 // - Should match our pixel shader's input (hence the name: Vertex to Pixel)
 // - At a minimum, we need a piece of data defined tagged as SV_POSITION
@@ -57,9 +93,107 @@ struct VertexToPixel_Sky
     float3 sampleDir : DIRECTION;
 };
 
+// Struct representing data from
+// point vertex shader to point pixel shader.
+struct VertexToPixel_Point
+{
+    float4 position : SV_POSITION;
+    float4 color    : COLOR;
+};
+
+// Struct representing data from
+// impostor vertex shader to impostor pixel shader.
+// - frameUV is where the pixel lands in the chosen frame
+//   (0 to 1 across it), the rest is the same for the whole quad
+struct VertexToPixel_Impostor
+{
+    float4 position : SV_POSITION;
+    float2 frameUV  : TEXCOORD;
+    nointerpolation float2 frameOrigin    : FRAME_ORIGIN;    // Atlas UV of the frame's corner
+    nointerpolation float3 frameDirection : FRAME_DIRECTION; // Object space, all three
+    nointerpolation float3 frameRight     : FRAME_RIGHT;
+    nointerpolation float3 frameUp        : FRAME_UP;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // --------------------------- HELPER FUNCTIONS ----------------------------- //
 ////////////////////////////////////////////////////////////////////////////////
+// --------------------------------------------------------
+// Decodes two snorm16s (octahedral) into a unit vector.
+// Matches VertexPacking::DecodeOctahedral() on the CPU.
+// --------------------------------------------------------
+float3 DecodeOctahedral(uint packed)
+{
+    // Sign extend each 16 bit half
+    int2 snorm = int2((int)(packed << 16) >> 16, (int)packed >> 16);
+    float2 f = max(snorm / 32767.0f, -1.0f);
+
+    // Unfold the lower half of the octahedron
+    float3 n = float3(f, 1.0f - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += (n.xy >= 0.0f) ? -t : t;
+    return normalize(n);
+}
+
+// --------------------------------------------------------
+// Maps a unit vector to and from [0, 1] octahedral coords,
+// folded around Y rather than Z (+Y lands in the middle).
+// Matches ImpostorBaker::EncodeOctahedral() and
+// ImpostorBaker::DecodeOctahedral() on the CPU.
+// --------------------------------------------------------
+float2 EncodeOctahedralY(float3 direction)
+{
+    float2 f = direction.xz / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+    if (direction.y < 0.0f)
+        f = (1.0f - abs(f.yx)) * (f >= 0.0f ? 1.0f : -1.0f);
+    return f * 0.5f + 0.5f;
+}
+
+float3 DecodeOctahedralY(float2 uv)
+{
+    float2 f = uv * 2.0f - 1.0f;
+    float3 n = float3(f.x, 1.0f - abs(f.x) - abs(f.y), f.y);
+    float t = max(-n.y, 0.0f);
+    n.xz += (n.xz >= 0.0f) ? -t : t;
+    return normalize(n);
+}
+
+// --------------------------------------------------------
+// Right and up axes of a view along "direction" (toward the
+// viewer). Matches ImpostorBaker::GetFrameAxes().
+// --------------------------------------------------------
+void GetFrameAxes(float3 direction, out float3 right, out float3 up)
+{
+    float3 worldUp = abs(direction.y) > 0.999f ? float3(0, 0, 1) : float3(0, 1, 0);
+    right = normalize(cross(direction, worldUp));
+    up = cross(right, direction);
+}
+
+// --------------------------------------------------------
+// Decodes three unorm16s (the 4th is padding) into an
+// object space position, given the mesh's dequantization
+// --------------------------------------------------------
+float3 UnpackPosition(uint2 packed, float3 positionScale, float3 positionOffset)
+{
+    float3 quantized = float3(packed.x & 0xFFFF, packed.x >> 16, packed.y & 0xFFFF);
+    return positionOffset + quantized * positionScale;
+}
+
+// --------------------------------------------------------
+// Expands a packed vertex into the regular vertex struct,
+// given the mesh's position dequantization values
+// --------------------------------------------------------
+VertexShaderInput UnpackVertex(PackedVertexShaderInput packed,
+    float3 positionScale, float3 positionOffset)
+{
+    VertexShaderInput input;
+    input.localPosition = UnpackPosition(packed.packedPosition, positionScale, positionOffset);
+    input.normal = DecodeOctahedral(packed.packedNormal);
+    input.tangent = DecodeOctahedral(packed.packedTangent);
+    input.uv = f16tof32(uint2(packed.packedUV & 0xFFFF, packed.packedUV >> 16));
+    return input;
+}
+
 // --------------------------------------------------------
 // Performs a bunch of arbitrary steps 
 // to produce a deterministically random float2.
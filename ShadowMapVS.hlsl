@@ -12,13 +12,29 @@ cbuffer externalData : register(b0)
     matrix world;
     matrix view;
     matrix projection;
+
+#ifdef PACKED_VERTICES
+    // Turns quantized positions back into object space
+    float3 positionScale;
+    float3 positionOffset;
+#endif
 };
 
 // --------------------------------------------------------
-// A simplified vertex shader for rendering to a shadow map
+// A simplified vertex shader for rendering to a shadow map.
+// Only reads positions, so it works with either a mesh's
+// position stream or its full vertex buffer.
+// (see VertexShader.hlsl for the PACKED_VERTICES variant)
 // --------------------------------------------------------
-float4 main( VertexShaderInput input ) : SV_POSITION
+#ifdef PACKED_VERTICES
+float4 main( PackedPositionOnlyVertexShaderInput input ) : SV_POSITION
+{
+    float3 localPosition = UnpackPosition(input.packedPosition, positionScale, positionOffset);
+#else
+float4 main( PositionOnlyVertexShaderInput input ) : SV_POSITION
 {
+    float3 localPosition = input.localPosition;
+#endif
     matrix wvp = mul(projection, mul(view, world));
-    return mul(wvp, float4(input.localPosition, 1.0f));
+    return mul(wvp, float4(localPosition, 1.0f));
 }
\ No newline at end of file
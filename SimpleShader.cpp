@@ -13,6 +13,16 @@ bool ISimpleShader::ReportWarnings = false;
 // ISimpleShader::ReportErrors = true;
 // ISimpleShader::ReportWarnings = true;
 
+// Upload counts, for stats
+unsigned int ISimpleShader::Uploads = 0;
+unsigned int ISimpleShader::UploadsSkipped = 0;
+
+void ISimpleShader::ResetUploadCounts()
+{
+	Uploads = 0;
+	UploadsSkipped = 0;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -31,6 +41,7 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
 	this->shaderValid = false;
+	this->id = UploadStamps::NextId();
 }
 
 // --------------------------------------------------------
@@ -351,9 +362,7 @@ void ISimpleShader::CopyAllBufferData()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		CopyBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -382,9 +391,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0,
-		cb->LocalDataBuffer, 0, 0);
+	CopyBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -404,9 +411,27 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
+	CopyBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Copies a buffer's local data to the GPU, unless nothing
+// has been set to a different value since the last copy
+// (the GPU's copy is still the same, so it'd be wasted)
+// --------------------------------------------------------
+void ISimpleShader::CopyBuffer(SimpleConstantBuffer* cb)
+{
+	if (!cb->Dirty)
+	{
+		UploadsSkipped++;
+		return;
+	}
+
 	deviceContext->UpdateSubresource(
 		cb->ConstantBuffer.Get(), 0, 0,
 		cb->LocalDataBuffer, 0, 0);
+	cb->Dirty = false;
+	Uploads++;
 }
 
 
@@ -447,11 +472,14 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 	}
 
-	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	// Set the data in the local data buffer, flagging the
+	// buffer for the next copy only if it's actually different
+	SimpleConstantBuffer* cb = &constantBuffers[var->ConstantBufferIndex];
+	if (memcmp(cb->LocalDataBuffer + var->ByteOffset, data, size) != 0)
+	{
+		memcpy(cb->LocalDataBuffer + var->ByteOffset, data, size);
+		cb->Dirty = true;
+	}
 
 	// Success
 	return true;
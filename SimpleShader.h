@@ -13,6 +13,8 @@
 #include <vector>
 #include <string>
 
+#include "UploadStamp.h"
+
 // --------------------------------------------------------
 // Used by simple shaders to store information about
 // specific variables in constant buffers
@@ -37,6 +39,7 @@ struct SimpleConstantBuffer
 	unsigned int BindIndex = 0;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
+	bool Dirty = true; // LocalDataBuffer differs from what the GPU has
 	std::vector<SimpleShaderVariable> Variables;
 };
 
@@ -118,14 +121,23 @@ public:
 
 	// Misc getters
 	Microsoft::WRL::ComPtr<ID3DBlob> GetShaderBlob() { return shaderBlob; }
+	uint64_t GetId() { return id; }	// Never reused (see UploadStamps)
 
 	// Error reporting
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Buffers copied to the GPU, and copies skipped because
+	// nothing had changed, across all shaders since the last
+	// ResetUploadCounts() (call once per frame)
+	static unsigned int Uploads;
+	static unsigned int UploadsSkipped;
+	static void ResetUploadCounts();
+
 protected:
 
 	bool shaderValid;
+	uint64_t id;
 	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
@@ -151,6 +163,9 @@ protected:
 
 	virtual void CleanUp();
 
+	// Copies one buffer's local data to the GPU, if it changed
+	void CopyBuffer(SimpleConstantBuffer* cb);
+
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
@@ -0,0 +1,17 @@
+/*
+William Duprey
+12/10/24
+SSE Support Header
+*/
+
+#pragma once
+
+// --------------------------------------------------------
+// SSE2 is always there on x64, and on x86 when asked for.
+// Files with SSE2 paths include this and check USE_SSE2,
+// keeping a scalar path for everything else.
+// --------------------------------------------------------
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
@@ -0,0 +1,187 @@
+/*
+William Duprey
+12/10/24
+StaticBatcher Implementation
+*/
+
+#include "StaticBatcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+StaticBatcher::StaticBatcher() :
+	updateCount(0),
+	rebuildCount(0)
+{
+}
+
+// --------------------------------------------------------
+// Finds entities that were added, changed, or are gone,
+// moves them between chunks, then rebuilds only the
+// chunks that any of that touched
+// --------------------------------------------------------
+void StaticBatcher::Update(const std::vector<std::shared_ptr<GameEntity>>& entities)
+{
+	updateCount++;
+	rebuildCount = 0;
+
+	for (const std::shared_ptr<GameEntity>& entity : entities)
+	{
+		// Only entities that can be batched
+		GameEntity* e = entity.get();
+		if (!e->IsStatic() || e->GetMesh()->GetGeometryVertices().empty())
+			continue;
+
+		auto found = members.find(e);
+		if (found != members.end())
+		{
+			found->second.LastSeen = updateCount;
+			const Member& m = found->second;
+			if (m.TransformVersion == e->GetTransform()->GetVersion() &&
+				m.SourceMesh == e->GetMesh().get() &&
+				m.SourceMaterial == e->GetMaterial().get())
+				continue;
+
+			// Changed since it was batched
+			RemoveMember(e);
+		}
+		AddMember(e, GetChunkKey(e));
+	}
+
+	// Anything not seen this time isn't static anymore (or is gone)
+	std::vector<const GameEntity*> stale;
+	for (const auto& [entity, member] : members)
+	{
+		if (member.LastSeen != updateCount)
+			stale.push_back(entity);
+	}
+	for (const GameEntity* entity : stale)
+		RemoveMember(entity);
+
+	// Rebuild what changed, and drop chunks left empty
+	bool changed = false;
+	for (auto it = chunks.begin(); it != chunks.end();)
+	{
+		Chunk& chunk = it->second;
+		if (!chunk.Dirty)
+		{
+			++it;
+			continue;
+		}
+
+		changed = true;
+		if (chunk.Members.empty())
+		{
+			it = chunks.erase(it);
+			continue;
+		}
+		RebuildChunk(chunk);
+		rebuildCount++;
+		++it;
+	}
+
+	if (changed)
+	{
+		batches.clear();
+		for (auto& [key, chunk] : chunks)
+			batches.push_back(chunk.Batch);
+	}
+}
+
+bool StaticBatcher::IsBatched(const GameEntity* entity)
+{
+	return members.count(entity) != 0;
+}
+
+const std::vector<std::shared_ptr<GameEntity>>& StaticBatcher::GetBatches() { return batches; }
+size_t StaticBatcher::GetBatchedEntityCount() { return members.size(); }
+size_t StaticBatcher::GetRebuildCount() { return rebuildCount; }
+
+// --------------------------------------------------------
+// Material first, then the chunk the center of the
+// entity's world space bounds is in
+// --------------------------------------------------------
+StaticBatcher::ChunkKey StaticBatcher::GetChunkKey(GameEntity* entity)
+{
+	const BoundingVolumes& bounds = entity->GetWorldBounds();
+	return ChunkKey(entity->GetMaterial().get(),
+		(int)floorf(bounds.SphereCenter[0] / ChunkSize),
+		(int)floorf(bounds.SphereCenter[1] / ChunkSize),
+		(int)floorf(bounds.SphereCenter[2] / ChunkSize));
+}
+
+void StaticBatcher::AddMember(GameEntity* entity, const ChunkKey& key)
+{
+	Chunk& chunk = chunks[key];
+	chunk.Members.push_back(entity);
+	chunk.Dirty = true;
+
+	members[entity] = {
+		key,
+		entity->GetTransform()->GetVersion(),
+		entity->GetMesh().get(),
+		entity->GetMaterial().get(),
+		updateCount };
+}
+
+void StaticBatcher::RemoveMember(const GameEntity* entity)
+{
+	auto found = members.find(entity);
+	if (found == members.end())
+		return;
+
+	Chunk& chunk = chunks[found->second.Key];
+	chunk.Members.erase(std::remove(chunk.Members.begin(), chunk.Members.end(), entity),
+		chunk.Members.end());
+	chunk.Dirty = true;
+	members.erase(found);
+}
+
+// --------------------------------------------------------
+// Pre-transforms every member's vertices into world space
+// and merges them into one mesh. Normals go through the
+// inverse transpose (so non-uniform scale keeps them
+// perpendicular), and tangents through the world matrix.
+// --------------------------------------------------------
+void StaticBatcher::RebuildChunk(Chunk& chunk)
+{
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+	for (GameEntity* entity : chunk.Members)
+	{
+		const std::vector<Vertex>& sourceVertices = entity->GetMesh()->GetGeometryVertices();
+		const std::vector<UINT>& sourceIndices = entity->GetMesh()->GetGeometryIndices();
+
+		XMFLOAT4X4 world = entity->GetTransform()->GetWorldMatrix();
+		XMFLOAT4X4 worldInverseTranspose = entity->GetTransform()->GetWorldInverseTransposeMatrix();
+		XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+		XMMATRIX normalMatrix = XMLoadFloat4x4(&worldInverseTranspose);
+
+		UINT baseVertex = (UINT)vertices.size();
+		for (const Vertex& source : sourceVertices)
+		{
+			Vertex v = source;
+			XMStoreFloat3(&v.Position, XMVector3Transform(XMLoadFloat3(&source.Position), worldMatrix));
+			XMStoreFloat3(&v.Normal, XMVector3Normalize(
+				XMVector3TransformNormal(XMLoadFloat3(&source.Normal), normalMatrix)));
+			XMStoreFloat3(&v.Tangent, XMVector3Normalize(
+				XMVector3TransformNormal(XMLoadFloat3(&source.Tangent), worldMatrix)));
+			vertices.push_back(v);
+		}
+		for (UINT index : sourceIndices)
+			indices.push_back(baseVertex + index);
+	}
+
+	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(vertices.data(), vertices.size(),
+		indices.data(), indices.size(), "Static Batch");
+
+	// The batch keeps a reference to the material, since the
+	// key only has the raw pointer
+	if (!chunk.Batch)
+		chunk.Batch = std::make_shared<GameEntity>(mesh, chunk.Members[0]->GetMaterial());
+	else
+		chunk.Batch->SetMesh(mesh);
+	chunk.Dirty = false;
+}
@@ -0,0 +1,91 @@
+/*
+William Duprey
+12/10/24
+StaticBatcher Header
+*/
+
+#pragma once
+#include "GameEntity.h"
+#include "Material.h"
+#include "Mesh.h"
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Merges static entities into a few big world space
+// meshes, one per material per chunk of the world, so
+// scenery costs one draw per chunk instead of one per
+// entity. Each batch is itself a GameEntity (with an
+// identity transform), so it draws like any other.
+//
+// Entities only get batched if their mesh kept its CPU
+// geometry (MeshOptions::KeepGeometry); the rest are left
+// for the caller to draw as usual. When a batched entity
+// moves, or changes mesh or material, only the chunks it
+// left and joined are rebuilt.
+// --------------------------------------------------------
+class StaticBatcher
+{
+public:
+	// Width of the cubes of world space that batches are split
+	// into, by where the center of each entity's bounds falls
+	static constexpr float ChunkSize = 16.0f;
+
+	StaticBatcher();
+
+	// Batches every static entity in the list, and takes out any
+	// entity that's no longer static (or no longer in the list).
+	// Call once per frame, after anything that moves entities.
+	void Update(const std::vector<std::shared_ptr<GameEntity>>& entities);
+
+	// Whether an entity is drawn through a batch (and so
+	// shouldn't also be drawn on its own)
+	bool IsBatched(const GameEntity* entity);
+
+	// Getters
+	const std::vector<std::shared_ptr<GameEntity>>& GetBatches();
+	size_t GetBatchedEntityCount();
+	size_t GetRebuildCount();	// Chunks rebuilt by the last Update()
+
+private:
+	// Which batch an entity belongs in
+	using ChunkKey = std::tuple<Material*, int, int, int>;
+
+	// Entities merged into one mesh, and the entity drawing it
+	struct Chunk
+	{
+		std::vector<GameEntity*> Members;
+		std::shared_ptr<GameEntity> Batch;
+		bool Dirty = true;
+	};
+
+	// What an entity looked like when it was batched,
+	// to tell when it needs batching again
+	struct Member
+	{
+		ChunkKey Key;
+		uint64_t TransformVersion;
+		Mesh* SourceMesh;
+		Material* SourceMaterial;
+		unsigned int LastSeen;
+	};
+
+	ChunkKey GetChunkKey(GameEntity* entity);
+	void AddMember(GameEntity* entity, const ChunkKey& key);
+	void RemoveMember(const GameEntity* entity);
+	void RebuildChunk(Chunk& chunk);
+
+	std::map<ChunkKey, Chunk> chunks;
+	std::unordered_map<const GameEntity*, Member> members;
+
+	// Every chunk's batch entity, for drawing
+	std::vector<std::shared_ptr<GameEntity>> batches;
+
+	// Counts Update() calls, to find entities that disappeared
+	unsigned int updateCount;
+	size_t rebuildCount;
+};
@@ -0,0 +1,451 @@
+/*
+William Duprey
+12/10/24
+Tangent Generator Implementation
+*/
+
+#include "TangentGenerator.h"
+#include "SseSupport.h"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Reads element "i" of a strided float array
+	inline const float* At(const float* base, size_t stride, size_t i)
+	{
+		return (const float*)((const char*)base + stride * i);
+	}
+
+	inline float* At(float* base, size_t stride, size_t i)
+	{
+		return (float*)((char*)base + stride * i);
+	}
+
+	// --------------------------------------------------------
+	// Where one thread adds up its tangents: a strided array of
+	// xyz sums. The first thread uses the output tangents
+	// themselves, so one thread needs no extra memory at all.
+	// --------------------------------------------------------
+	struct TangentSums
+	{
+		float* Data;
+		size_t Stride;
+		std::vector<float> Storage;	// Only for the other threads
+	};
+
+	// --------------------------------------------------------
+	// The tangent of one triangle, from its edges in object
+	// and UV space. Zero for degenerate UVs. The SSE version
+	// below does exactly these operations in the same order.
+	// --------------------------------------------------------
+	inline void TriangleTangent(
+		float x1, float y1, float z1, float x2, float y2, float z2,
+		float s1, float t1, float s2, float t2,
+		float& tx, float& ty, float& tz)
+	{
+		float determinant = s1 * t2 - s2 * t1;
+		float r = fabsf(determinant) >= TangentGenerator::MinUVDeterminant
+			? 1.0f / determinant : 0.0f;
+
+		tx = (t2 * x1 - t1 * x2) * r;
+		ty = (t2 * y1 - t1 * y2) * r;
+		tz = (t2 * z1 - t1 * z2) * r;
+	}
+
+	// --------------------------------------------------------
+	// Gram-Schmidt orthogonalizes a summed tangent against its
+	// vertex's normal, then normalizes it. A tangent that's
+	// zero (every triangle had degenerate UVs) or parallel to
+	// the normal is replaced by any vector perpendicular to it.
+	// --------------------------------------------------------
+	inline void FinishTangent(const float normal[3], float tangent[3])
+	{
+		float d = normal[0] * tangent[0] + normal[1] * tangent[1] + normal[2] * tangent[2];
+		float x = tangent[0] - normal[0] * d;
+		float y = tangent[1] - normal[1] * d;
+		float z = tangent[2] - normal[2] * d;
+		float length = sqrtf(x * x + y * y + z * z);
+
+		// Written so NaN and infinity fail too
+		if (!(length > 0.0f && length < INFINITY))
+		{
+			// Cross the normal with whichever axis it's least like
+			if (fabsf(normal[0]) > fabsf(normal[2]))
+			{
+				x = -normal[1];
+				y = normal[0];
+				z = 0.0f;
+			}
+			else
+			{
+				x = 0.0f;
+				y = -normal[2];
+				z = normal[1];
+			}
+			length = sqrtf(x * x + y * y + z * z);
+
+			// A zero normal has no perpendicular, so just pick +X
+			if (!(length > 0.0f))
+			{
+				x = 1.0f;
+				length = 1.0f;
+			}
+		}
+
+		tangent[0] = x / length;
+		tangent[1] = y / length;
+		tangent[2] = z / length;
+	}
+
+	// --------------------------------------------------------
+	// Adds one triangle's tangent to its three vertices
+	// --------------------------------------------------------
+	inline void AccumulateTriangle(const float* positions, const float* uvs,
+		size_t stride, const unsigned int* tri, TangentSums& sums)
+	{
+		const float* p1 = At(positions, stride, tri[0]);
+		const float* p2 = At(positions, stride, tri[1]);
+		const float* p3 = At(positions, stride, tri[2]);
+		const float* uv1 = At(uvs, stride, tri[0]);
+		const float* uv2 = At(uvs, stride, tri[1]);
+		const float* uv3 = At(uvs, stride, tri[2]);
+
+		float tx, ty, tz;
+		TriangleTangent(
+			p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2],
+			p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2],
+			uv2[0] - uv1[0], uv2[1] - uv1[1], uv3[0] - uv1[0], uv3[1] - uv1[1],
+			tx, ty, tz);
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			float* t = At(sums.Data, sums.Stride, tri[corner]);
+			t[0] += tx;
+			t[1] += ty;
+			t[2] += tz;
+		}
+	}
+
+#ifdef USE_SSE2
+	// --------------------------------------------------------
+	// Loads one corner of four triangles, transposed into one
+	// register per component (lane n is triangle n). Reads 4
+	// floats per position, so the caller makes sure that's safe.
+	// --------------------------------------------------------
+	inline void LoadCorner(const float* positions, const float* uvs, size_t stride,
+		const unsigned int* tri, int corner,
+		__m128& x, __m128& y, __m128& z, __m128& u, __m128& v)
+	{
+		__m128 a = _mm_loadu_ps(At(positions, stride, tri[corner]));
+		__m128 b = _mm_loadu_ps(At(positions, stride, tri[3 + corner]));
+		__m128 c = _mm_loadu_ps(At(positions, stride, tri[6 + corner]));
+		__m128 d = _mm_loadu_ps(At(positions, stride, tri[9 + corner]));
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+		x = a;
+		y = b;
+		z = c;
+
+		// Two uvs per register, then split into u's and v's
+		__m128 uv01 = _mm_setzero_ps();
+		__m128 uv23 = _mm_setzero_ps();
+		uv01 = _mm_loadl_pi(uv01, (const __m64*)At(uvs, stride, tri[corner]));
+		uv01 = _mm_loadh_pi(uv01, (const __m64*)At(uvs, stride, tri[3 + corner]));
+		uv23 = _mm_loadl_pi(uv23, (const __m64*)At(uvs, stride, tri[6 + corner]));
+		uv23 = _mm_loadh_pi(uv23, (const __m64*)At(uvs, stride, tri[9 + corner]));
+		u = _mm_shuffle_ps(uv01, uv23, _MM_SHUFFLE(2, 0, 2, 0));
+		v = _mm_shuffle_ps(uv01, uv23, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Sums the tangents of one range of triangles into "sums".
+	// Each group of four triangles is transposed into SoA form
+	// (one register per component) as it's loaded, computed
+	// together, then added in triangle and corner order, just
+	// like the scalar loop does.
+	// --------------------------------------------------------
+	void AccumulateTriangles(const float* positions, const float* uvs,
+		size_t stride, size_t vertexCount, const unsigned int* indices, size_t firstTriangle, size_t lastTriangle,
+		TangentSums& sums)
+	{
+		size_t triangle = firstTriangle;
+
+#ifdef USE_SSE2
+		const __m128 minDeterminant = _mm_set1_ps(TangentGenerator::MinUVDeterminant);
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		const bool wideLoads = stride >= sizeof(float) * 4;
+		for (; triangle + 4 <= lastTriangle; triangle += 4)
+		{
+			const unsigned int* tri = indices + triangle * 3;
+
+			// Loading a position as 4 floats reads one past z, which is
+			// only safe when that's still inside the array. Otherwise
+			// these four go through the scalar loop below.
+			unsigned int highest = 0;
+			for (int c = 0; c < 12; c++)
+				highest = tri[c] > highest ? tri[c] : highest;
+			if (!wideLoads || highest + 1 >= vertexCount)
+			{
+				for (int i = 0; i < 4; i++)
+					AccumulateTriangle(positions, uvs, stride, tri + i * 3, sums);
+				continue;
+			}
+
+			__m128 x0, y0, z0, u0, v0;
+			__m128 x1, y1, z1, s1, t1;
+			__m128 x2, y2, z2, s2, t2;
+			LoadCorner(positions, uvs, stride, tri, 0, x0, y0, z0, u0, v0);
+			LoadCorner(positions, uvs, stride, tri, 1, x1, y1, z1, s1, t1);
+			LoadCorner(positions, uvs, stride, tri, 2, x2, y2, z2, s2, t2);
+
+			// Edges relative to the first corner
+			x1 = _mm_sub_ps(x1, x0); y1 = _mm_sub_ps(y1, y0); z1 = _mm_sub_ps(z1, z0);
+			x2 = _mm_sub_ps(x2, x0); y2 = _mm_sub_ps(y2, y0); z2 = _mm_sub_ps(z2, z0);
+			s1 = _mm_sub_ps(s1, u0); t1 = _mm_sub_ps(t1, v0);
+			s2 = _mm_sub_ps(s2, u0); t2 = _mm_sub_ps(t2, v0);
+
+			// r = 1 / determinant, masked to zero where the UVs are
+			// degenerate (a NaN determinant fails the compare too)
+			__m128 determinant = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+			__m128 valid = _mm_cmpge_ps(_mm_and_ps(determinant, absMask), minDeterminant);
+			__m128 r = _mm_and_ps(valid, _mm_div_ps(one, determinant));
+
+			alignas(16) float tx[4], ty[4], tz[4];
+			_mm_store_ps(tx, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r));
+			_mm_store_ps(ty, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r));
+			_mm_store_ps(tz, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r));
+
+			// Scatter, in triangle then corner order
+			for (int lane = 0; lane < 4; lane++)
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					float* t = At(sums.Data, sums.Stride, tri[lane * 3 + corner]);
+					t[0] += tx[lane];
+					t[1] += ty[lane];
+					t[2] += tz[lane];
+				}
+			}
+		}
+#endif
+
+		// Whatever didn't fill a group of four
+		for (; triangle < lastTriangle; triangle++)
+		{
+			AccumulateTriangle(positions, uvs, stride, indices + triangle * 3, sums);
+		}
+	}
+
+#ifdef USE_SSE2
+	// --------------------------------------------------------
+	// FinishTangent for four vertices in a row, transposed so
+	// each register holds one component of all four. Lanes
+	// that need the perpendicular fallback are redone by the
+	// scalar version. Reads 4 floats per normal and tangent,
+	// so the caller makes sure that's safe.
+	// --------------------------------------------------------
+	inline void FinishTangents4(const float* normals, float* tangents, size_t stride, size_t first)
+	{
+		__m128 nx = _mm_loadu_ps(At(normals, stride, first));
+		__m128 ny = _mm_loadu_ps(At(normals, stride, first + 1));
+		__m128 nz = _mm_loadu_ps(At(normals, stride, first + 2));
+		__m128 nw = _mm_loadu_ps(At(normals, stride, first + 3));
+		_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+
+		__m128 tx = _mm_loadu_ps(At(tangents, stride, first));
+		__m128 ty = _mm_loadu_ps(At(tangents, stride, first + 1));
+		__m128 tz = _mm_loadu_ps(At(tangents, stride, first + 2));
+		__m128 tw = _mm_loadu_ps(At(tangents, stride, first + 3));
+		_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+
+		// Same operations, in the same order, as FinishTangent
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)), _mm_mul_ps(nz, tz));
+		__m128 x = _mm_sub_ps(tx, _mm_mul_ps(nx, d));
+		__m128 y = _mm_sub_ps(ty, _mm_mul_ps(ny, d));
+		__m128 z = _mm_sub_ps(tz, _mm_mul_ps(nz, d));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		int valid = _mm_movemask_ps(_mm_and_ps(
+			_mm_cmpgt_ps(length, _mm_setzero_ps()),
+			_mm_cmplt_ps(length, _mm_set1_ps(INFINITY))));
+
+		alignas(16) float outX[4], outY[4], outZ[4];
+		_mm_store_ps(outX, _mm_div_ps(x, length));
+		_mm_store_ps(outY, _mm_div_ps(y, length));
+		_mm_store_ps(outZ, _mm_div_ps(z, length));
+		for (int lane = 0; lane < 4; lane++)
+		{
+			float* tangent = At(tangents, stride, first + lane);
+			if (valid & (1 << lane))
+			{
+				tangent[0] = outX[lane];
+				tangent[1] = outY[lane];
+				tangent[2] = outZ[lane];
+			}
+			else
+			{
+				FinishTangent(At(normals, stride, first + lane), tangent);
+			}
+		}
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Adds the other threads' sums into the first thread's
+	// (the output tangents) for one range of vertices, then
+	// finishes those tangents, four at a time where possible
+	// --------------------------------------------------------
+	void ReduceAndFinish(const std::vector<TangentSums>& sums,
+		const float* normals, float* tangents, size_t stride,
+		size_t vertexCount, size_t begin, size_t end)
+	{
+		// Thread order, so the result doesn't depend on timing
+		for (size_t t = 1; t < sums.size(); t++)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				float* tangent = At(tangents, stride, i);
+				const float* sum = At(sums[t].Data, sums[t].Stride, i);
+				tangent[0] += sum[0];
+				tangent[1] += sum[1];
+				tangent[2] += sum[2];
+			}
+		}
+
+		size_t i = begin;
+#ifdef USE_SSE2
+		// Stop while a 4 float read of the last vertex would
+		// still land inside the array
+		if (stride >= sizeof(float) * 4)
+		{
+			for (; i + 4 <= end && i + 4 < vertexCount; i += 4)
+				FinishTangents4(normals, tangents, stride, i);
+		}
+#endif
+		for (; i < end; i++)
+			FinishTangent(At(normals, stride, i), At(tangents, stride, i));
+	}
+}
+
+// --------------------------------------------------------
+// Reference version: one triangle at a time, adding its
+// tangent straight into its three vertices
+// --------------------------------------------------------
+void TangentGenerator::CalculateScalar(const float* positions, const float* normals,
+	const float* uvs, float* tangents, size_t vertexStride, size_t vertexCount,
+	const unsigned int* indices, size_t indexCount)
+{
+	// Reset tangents
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		float* t = At(tangents, vertexStride, i);
+		t[0] = t[1] = t[2] = 0.0f;
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		float* t1 = At(tangents, vertexStride, indices[i]);
+		float* t2 = At(tangents, vertexStride, indices[i + 1]);
+		float* t3 = At(tangents, vertexStride, indices[i + 2]);
+		const float* p1 = At(positions, vertexStride, indices[i]);
+		const float* p2 = At(positions, vertexStride, indices[i + 1]);
+		const float* p3 = At(positions, vertexStride, indices[i + 2]);
+		const float* uv1 = At(uvs, vertexStride, indices[i]);
+		const float* uv2 = At(uvs, vertexStride, indices[i + 1]);
+		const float* uv3 = At(uvs, vertexStride, indices[i + 2]);
+
+		float tx, ty, tz;
+		TriangleTangent(
+			p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2],
+			p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2],
+			uv2[0] - uv1[0], uv2[1] - uv1[1], uv3[0] - uv1[0], uv3[1] - uv1[1],
+			tx, ty, tz);
+
+		t1[0] += tx; t1[1] += ty; t1[2] += tz;
+		t2[0] += tx; t2[1] += ty; t2[2] += tz;
+		t3[0] += tx; t3[1] += ty; t3[2] += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		FinishTangent(At(normals, vertexStride, i), At(tangents, vertexStride, i));
+	}
+}
+
+// --------------------------------------------------------
+// Two parallel passes over the mesh:
+//  1. Sum triangle tangents into per-thread arrays (by triangle)
+//  2. Add those arrays up and finish each tangent (by vertex)
+// Each thread only ever writes to its own arrays or its own
+// range of vertices, so nothing needs locking.
+// --------------------------------------------------------
+void TangentGenerator::Calculate(const float* positions, const float* normals,
+	const float* uvs, float* tangents, size_t vertexStride, size_t vertexCount,
+	const unsigned int* indices, size_t indexCount, unsigned int threadCount)
+{
+	size_t triangleCount = indexCount / 3;
+
+	// Decide how many pieces to split the work into
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		size_t byTriangles = triangleCount / MinTrianglesPerThread;
+		if (byTriangles < threadCount)
+			threadCount = (unsigned int)byTriangles;
+	}
+	if (threadCount < 1)
+		threadCount = 1;
+
+	// Runs "work(begin, end, thread)" over even slices of
+	// [0, count) on threadCount threads (this one does the first)
+	auto parallelFor = [threadCount](size_t count, auto work)
+	{
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < threadCount; t++)
+		{
+			workers.emplace_back(work, count * t / threadCount, count * (t + 1) / threadCount, t);
+		}
+		work(0, count / threadCount, 0u);
+		for (std::thread& t : workers)
+			t.join();
+	};
+
+	// 1. Per-thread sums. Each thread zeroes its own first,
+	//    and the first thread's are the output tangents.
+	std::vector<TangentSums> sums(threadCount);
+	parallelFor(triangleCount, [&](size_t begin, size_t end, unsigned int thread)
+	{
+		TangentSums& mine = sums[thread];
+		if (thread == 0)
+		{
+			mine.Data = tangents;
+			mine.Stride = vertexStride;
+			for (size_t i = 0; i < vertexCount; i++)
+			{
+				float* t = At(tangents, vertexStride, i);
+				t[0] = t[1] = t[2] = 0.0f;
+			}
+		}
+		else
+		{
+			mine.Storage.assign(vertexCount * 3, 0.0f);
+			mine.Data = mine.Storage.data();
+			mine.Stride = sizeof(float) * 3;
+		}
+		AccumulateTriangles(positions, uvs, vertexStride, vertexCount, indices, begin, end, mine);
+	});
+
+	// 2. Reduce and finish
+	parallelFor(vertexCount, [&](size_t begin, size_t end, unsigned int)
+	{
+		ReduceAndFinish(sums, normals, tangents, vertexStride, vertexCount, begin, end);
+	});
+}
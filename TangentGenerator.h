@@ -0,0 +1,44 @@
+/*
+William Duprey
+12/10/24
+Tangent Generator Header
+*/
+
+#pragma once
+#include <cstddef>
+
+// --------------------------------------------------------
+// Per-vertex tangent generation from positions, normals and
+// UVs (the method Prof. Chris Cascioli's helper used).
+// Tangents of every triangle touching a vertex are summed,
+// then made orthogonal to its normal and normalized.
+//
+// Every array is read with the same byte stride, so they
+// can all point into one array of interleaved vertices.
+// --------------------------------------------------------
+namespace TangentGenerator
+{
+	// Meshes with fewer triangles than this per thread
+	// aren't worth splitting up
+	constexpr size_t MinTrianglesPerThread = 1 << 15;
+
+	// Triangles whose UV area (the determinant of the UV edges)
+	// is smaller than this contribute nothing, instead of
+	// dividing by zero and spreading NaNs to their vertices
+	constexpr float MinUVDeterminant = 1e-20f;
+
+	// One triangle at a time on this thread. Simple, and the
+	// reference the faster version is checked against.
+	void CalculateScalar(const float* positions, const float* normals,
+		const float* uvs, float* tangents, size_t vertexStride, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount);
+
+	// Same results, computed four triangles at a time with SSE,
+	// summed into per-thread buffers and reduced in parallel.
+	// One thread gives exactly the scalar result; more threads
+	// only change the order the sums are added in.
+	// threadCount of 0 picks one based on triangle count and cores.
+	void Calculate(const float* positions, const float* normals,
+		const float* uvs, float* tangents, size_t vertexStride, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount, unsigned int threadCount = 0);
+}
@@ -5,110 +5,204 @@ Transform Class Implementation
 */
 
 #include "Transform.h"
+
+#include <algorithm>
 using namespace DirectX;
 
 // --------------------------------------------------------
-// Constructor for a transform object. Initializes its
-// fields to line up with an identity matrix for the world.
+// Constructor for a transform object. Takes a slot in the
+// store, which starts out lined up with an identity matrix
+// for the world.
 // --------------------------------------------------------
 Transform::Transform() : 
-    position(0, 0, 0),
-    rotation(0, 0, 0),
-    scale(1, 1, 1),
-    dirtyWorld(false),
-    dirtyDirections(false),
-    worldMatrix(1, 0, 0, 0,
-                0, 1, 0, 0,
-                0, 0, 1, 0,
-                0, 0, 0, 1),
-    worldInverseTransposeMatrix(worldMatrix),
-    right(  1, 0, 0),
-    up(     0, 1, 0),
-    forward(0, 0, 1)
+    slot(GetStore().Allocate()),
+    id(UploadStamps::NextId()),
+    parent(nullptr)
+{
+}
+
+// --------------------------------------------------------
+// Copies another transform's values into a new slot
+// --------------------------------------------------------
+Transform::Transform(const Transform& other) :
+    Transform()
+{
+    *this = other;
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+    if (this != &other)
+    {
+        TransformStore& store = GetStore();
+        float x, y, z;
+        store.GetPosition(other.slot, x, y, z);
+        SetPosition(x, y, z);
+        float w;
+        store.GetRotation(other.slot, x, y, z, w);
+        store.SetRotation(slot, x, y, z, w);
+        store.GetScale(other.slot, x, y, z);
+        SetScale(x, y, z);
+    }
+    return *this;
+}
+
+// --------------------------------------------------------
+// Lets go of the parent and children, and gives the slot back
+// to the store (which does the same with the slots)
+// --------------------------------------------------------
+Transform::~Transform()
 {
-    // Better to do it this way or by using initializer list?
-    //XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-    //XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
+    for (Transform* child : children)
+        child->parent = nullptr;
+    if (parent)
+    {
+        std::vector<Transform*>& siblings = parent->children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+    }
+    GetStore().Release(slot);
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------------------------------- GETTERS --------------------------------- //
 ///////////////////////////////////////////////////////////////////////////////
-XMFLOAT3 Transform::GetPosition() { return position; }
-XMFLOAT3 Transform::GetRotation() { return rotation; }
-XMFLOAT3 Transform::GetScale() { return scale; }
+XMFLOAT3 Transform::GetPosition()
+{
+    XMFLOAT3 position;
+    GetStore().GetPosition(slot, position.x, position.y, position.z);
+    return position;
+}
 
-XMFLOAT4X4 Transform::GetWorldMatrix()
+XMFLOAT3 Transform::GetRotation()
 {
-    UpdateWorld();
-    return worldMatrix;
+    XMFLOAT4 orientation = GetOrientation();
+    XMFLOAT3 rotation;
+    TransformStore::QuaternionToEuler(&orientation.x, rotation.x, rotation.y, rotation.z);
+    return rotation;
 }
 
-XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
+XMFLOAT4 Transform::GetOrientation()
 {
-    UpdateWorld();
-    return worldInverseTransposeMatrix;
+    XMFLOAT4 orientation;
+    GetStore().GetRotation(slot, orientation.x, orientation.y, orientation.z, orientation.w);
+    return orientation;
 }
 
+XMFLOAT3 Transform::GetScale()
+{
+    XMFLOAT3 scale;
+    GetStore().GetScale(slot, scale.x, scale.y, scale.z);
+    return scale;
+}
+
+// The store rebuilds the matrices first if they're out of date
+XMFLOAT4X4 Transform::GetWorldMatrix() { return XMFLOAT4X4(GetStore().GetWorldMatrix(slot)); }
+XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix() { return XMFLOAT4X4(GetStore().GetWorldInverseTransposeMatrix(slot)); }
+
+// --------------------------------------------------------
+// The relative axes are the rows of the rotation matrix,
+// which come straight from the quaternion
+// --------------------------------------------------------
 XMFLOAT3 Transform::GetRight()
 {
-    UpdateDirections();
-    return right;
+    XMFLOAT4 q = GetOrientation();
+    return XMFLOAT3(
+        1 - 2 * (q.y * q.y + q.z * q.z),
+        2 * (q.x * q.y + q.z * q.w),
+        2 * (q.x * q.z - q.y * q.w));
 }
 
 XMFLOAT3 Transform::GetUp()
 {
-    UpdateDirections();
-    return up;
+    XMFLOAT4 q = GetOrientation();
+    return XMFLOAT3(
+        2 * (q.x * q.y - q.z * q.w),
+        1 - 2 * (q.x * q.x + q.z * q.z),
+        2 * (q.y * q.z + q.x * q.w));
 }
 
 XMFLOAT3 Transform::GetForward()
 {
-    UpdateDirections();
-    return forward;
+    XMFLOAT4 q = GetOrientation();
+    return XMFLOAT3(
+        2 * (q.x * q.z + q.y * q.w),
+        2 * (q.y * q.z - q.x * q.w),
+        1 - 2 * (q.x * q.x + q.y * q.y));
 }
 
+Transform* Transform::GetParent() { return parent; }
+unsigned int Transform::GetChildCount() { return (unsigned int)children.size(); }
+
+Transform* Transform::GetChild(unsigned int index)
+{
+    return index < children.size() ? children[index] : nullptr;
+}
+
+uint64_t Transform::GetVersion() { return GetStore().GetVersion(slot); }
+uint64_t Transform::GetId() { return id; }
+bool Transform::HasUniformScale() { return GetStore().HasUniformScale(slot); }
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------------------------------- SETTERS --------------------------------- //
 ///////////////////////////////////////////////////////////////////////////////
+// The store flags the world matrix as dirty and bumps the version
 void Transform::SetPosition(float x, float y, float z)
 {
-    dirtyWorld = true;
-    position = XMFLOAT3(x, y, z);
+    GetStore().SetPosition(slot, x, y, z);
 }
 
 void Transform::SetPosition(XMFLOAT3 _position)
 {
-    position = _position;
-    dirtyWorld = true;
+    GetStore().SetPosition(slot, _position.x, _position.y, _position.z);
 }
 
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
-    rotation = XMFLOAT3(pitch, yaw, roll);
-    dirtyWorld = true;
-    dirtyDirections = true;
+    XMFLOAT4 q;
+    TransformStore::EulerToQuaternion(pitch, yaw, roll, &q.x);
+    SetOrientation(q);
 }
 
 void Transform::SetRotation(XMFLOAT3 _rotation)
 {
-    rotation = _rotation;
-    dirtyWorld = true;
-    dirtyDirections = true;
+    SetRotation(_rotation.x, _rotation.y, _rotation.z);
+}
+
+// The store normalizes it
+void Transform::SetOrientation(XMFLOAT4 _orientation)
+{
+    GetStore().SetRotation(slot, _orientation.x, _orientation.y, _orientation.z, _orientation.w);
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-    scale = XMFLOAT3(x, y, z);
-    dirtyWorld = true;
+    GetStore().SetScale(slot, x, y, z);
 }
 
 void Transform::SetScale(XMFLOAT3 _scale)
 {
-    scale = _scale;
-    dirtyWorld = true;
+    GetStore().SetScale(slot, _scale.x, _scale.y, _scale.z);
+}
+
+// --------------------------------------------------------
+// Moves this transform under a new parent. The store turns
+// down loops, and only then are the pointers changed.
+// --------------------------------------------------------
+void Transform::SetParent(Transform* _parent)
+{
+    if (!GetStore().SetParent(slot, _parent ? _parent->slot : TransformStore::NoParent))
+        return;
+
+    if (parent)
+    {
+        std::vector<Transform*>& siblings = parent->children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+    }
+    parent = _parent;
+    if (parent)
+        parent->children.push_back(this);
 }
 
 
@@ -117,18 +211,13 @@ void Transform::SetScale(XMFLOAT3 _scale)
 ///////////////////////////////////////////////////////////////////////////////
 void Transform::MoveAbsolute(float x, float y, float z)
 {
-    position.x += x;
-    position.y += y;
-    position.z += z;
-    dirtyWorld = true;
+    XMFLOAT3 position = GetPosition();
+    SetPosition(position.x + x, position.y + y, position.z + z);
 }
 
 void Transform::MoveAbsolute(XMFLOAT3 offset)
 {
-    position.x += offset.x;
-    position.y += offset.y;
-    position.z += offset.z;
-    dirtyWorld = true;
+    MoveAbsolute(offset.x, offset.y, offset.z);
 }
 
 // --------------------------------------------------------
@@ -141,18 +230,20 @@ void Transform::MoveRelative(float x, float y, float z)
     // so we can do math with it
     XMVECTOR move = XMVectorSet(x, y, z, 0);
 
-    // Store quaternion of the rotation using this
-    // amazingly descriptive function name
-    XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(
-        XMLoadFloat3(&rotation));
+    // The rotation is already a quaternion
+    XMFLOAT4 orientation = GetOrientation();
+    XMVECTOR rotQuat = XMLoadFloat4(&orientation);
     
     // Rotate movement by the rotation to get the direction
     // that the transform should actually move
     XMVECTOR dir = XMVector3Rotate(move, rotQuat);
 
-    // Make an XMVECTOR of the position, add to it,
-    // then store the result back in the position
+    // Make an XMVECTOR of the position, add to it, then store
+    // the result back in the position (through SetPosition(),
+    // so the world matrix is flagged and the version bumped)
+    XMFLOAT3 position = GetPosition();
     XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
+    SetPosition(position);
 }
 
 void Transform::MoveRelative(XMFLOAT3 offset)
@@ -163,36 +254,36 @@ void Transform::MoveRelative(XMFLOAT3 offset)
 
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
-    rotation.x += pitch;
-    rotation.y += yaw;
-    rotation.z += roll;
-    dirtyWorld = true;
-    dirtyDirections = true;
+    XMFLOAT4 delta;
+    TransformStore::EulerToQuaternion(pitch, yaw, roll, &delta.x);
+    Rotate(delta);
 }
 
 void Transform::Rotate(XMFLOAT3 _rotation)
 {
-    rotation.x += _rotation.x;
-    rotation.y += _rotation.y;
-    rotation.z += _rotation.z;
-    dirtyWorld = true;
-    dirtyDirections = true;
+    Rotate(_rotation.x, _rotation.y, _rotation.z);
+}
+
+// --------------------------------------------------------
+// Current rotation first, then this one
+// --------------------------------------------------------
+void Transform::Rotate(XMFLOAT4 quaternion)
+{
+    XMFLOAT4 orientation = GetOrientation();
+    XMStoreFloat4(&orientation, XMQuaternionMultiply(
+        XMLoadFloat4(&orientation), XMLoadFloat4(&quaternion)));
+    SetOrientation(orientation);
 }
 
 void Transform::Scale(float x, float y, float z)
 {
-    scale.x *= x;
-    scale.y *= y;
-    scale.z *= z;
-    dirtyWorld = true;
+    XMFLOAT3 scale = GetScale();
+    SetScale(scale.x * x, scale.y * y, scale.z * z);
 }
 
 void Transform::Scale(XMFLOAT3 _scale)
 {
-    scale.x *= _scale.x;
-    scale.y *= _scale.y;
-    scale.z *= _scale.z;
-    dirtyWorld = true;
+    Scale(_scale.x, _scale.y, _scale.z);
 }
 
 
@@ -202,63 +293,20 @@ void Transform::Scale(XMFLOAT3 _scale)
 // --------------------------------------------------------
 // If any changes have been made to the position, rotation,
 // or scale, recalculates the world matrix as well as the
-// world inverse transpose matrix.
+// world inverse transpose matrix. Usually they've already
+// been rebuilt in a batch by the store.
 // --------------------------------------------------------
 void Transform::UpdateWorld()
 {
-    // If no changes to position, rotation, or scale,
-    // no need to recalculate, just return world matrix
-    if (!dirtyWorld) {
-        return;
-    }
-
-    // Otherwise, time to recalculate that world matrix
-    // First, create matrices for translation, rotation, and scale
-    XMMATRIX t = XMMatrixTranslation(
-        position.x, position.y, position.z);
-    XMMATRIX r = XMMatrixRotationRollPitchYaw(
-        rotation.x, rotation.y, rotation.z);
-    XMMATRIX s = XMMatrixScaling(
-        scale.x, scale.y, scale.z);
-
-    // Multiply S * R * T for the most predictable result
-    // Using multiply method because supposedly it is faster
-    XMMATRIX world = XMMatrixMultiply(XMMatrixMultiply(s, r), t);
-
-    // Finally, store that result back in the matrix fields
-    XMStoreFloat4x4(&worldMatrix, world);
-    XMStoreFloat4x4(&worldInverseTransposeMatrix,
-        XMMatrixInverse(0, XMMatrixTranspose(world)));
-
-    // The world has been cleaned
-    dirtyWorld = false;
+    GetStore().GetWorldMatrix(slot);
 }
 
 // --------------------------------------------------------
-// If any changes have been made to the rotation, this
-// function recalculates the forward, up, and right vectors.
+// The one store every transform lives in, made the first
+// time a transform is
 // --------------------------------------------------------
-void Transform::UpdateDirections()
+TransformStore& Transform::GetStore()
 {
-    // If orientation has not changed, do nothing
-    if (!dirtyDirections){
-        return;
-    }
-
-    // Store quaternion of the rotation using this
-    // amazingly descriptive function name
-    XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(
-        XMLoadFloat3(&rotation));
-
-    // Rotate the world's direction vector by the quaternion,
-    // then store the result back in the corresponding field
-    XMStoreFloat3(&right, XMVector3Rotate(
-        XMVectorSet(1, 0, 0, 0), rotQuat));
-    XMStoreFloat3(&up, XMVector3Rotate(
-        XMVectorSet(0, 1, 0, 0), rotQuat));
-    XMStoreFloat3(&forward, XMVector3Rotate(
-        XMVectorSet(0, 0, 1, 0), rotQuat));
-
-    // The directions are now clean
-    dirtyDirections = false;
+    static TransformStore store;
+    return store;
 }
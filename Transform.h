@@ -6,69 +6,106 @@ Transform Class Header
 
 #pragma once
 #include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+#include "TransformStore.h"
+#include "UploadStamp.h"
 
 // --------------------------------------------------------
 // A class representing an entity's position, 
 // rotation, and scale within the world.
+//
+// The values and matrices themselves live in a slot of one
+// shared TransformStore, next to every other transform's,
+// so they can all be brought up to date in one batch.
+//
+// Transforms can have a parent, in which case position,
+// rotation and scale are relative to it, and the world
+// matrix follows it around.
+//
+// Rotation is stored as a unit quaternion. The pitch, yaw,
+// roll versions are converted on the way in and out (for
+// the inspector), and Rotate() multiplies quaternions.
 // --------------------------------------------------------
 class Transform
 {
 public:
-	// No destructor since nothing on the heap
+	// Copies get a slot of their own, with no parent or children
 	Transform();
+	Transform(const Transform& other);
+	Transform& operator=(const Transform& other);
+	~Transform();
 
 	// Getters
 	DirectX::XMFLOAT3 GetPosition();
-	DirectX::XMFLOAT3 GetRotation();
+	DirectX::XMFLOAT3 GetRotation();		// Pitch, yaw, roll
+	DirectX::XMFLOAT4 GetOrientation();		// Quaternion
 	DirectX::XMFLOAT3 GetScale();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
 	DirectX::XMFLOAT3 GetRight();
 	DirectX::XMFLOAT3 GetUp();
 	DirectX::XMFLOAT3 GetForward();
+	Transform* GetParent();
+	unsigned int GetChildCount();
+	Transform* GetChild(unsigned int index);
+
+	// Changes whenever the world matrix does, so anything derived
+	// from it can be cached and recalculated only when needed
+	uint64_t GetVersion();
+
+	// Never the same for two transforms, even one made where
+	// another was freed (see UploadStamps)
+	uint64_t GetId();
+
+	// Whether the scale is the same on every axis (along with
+	// every parent's), in which case the world matrix turns
+	// normals correctly without the inverse transpose
+	bool HasUniformScale();
 	
 	// Setters
 	void SetPosition(float x, float y, float z);
 	void SetPosition(DirectX::XMFLOAT3 _position);
 	void SetRotation(float pitch, float yaw, float roll);
 	void SetRotation(DirectX::XMFLOAT3 _rotation);
+	void SetOrientation(DirectX::XMFLOAT4 _orientation);
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 _scale);
 
+	// Null detaches it. Does nothing if the new parent is this
+	// transform or one of its children (or theirs, and so on).
+	void SetParent(Transform* _parent);
+
 	// Mutators
 	void MoveAbsolute(float x, float y, float z);
 	void MoveAbsolute(DirectX::XMFLOAT3 offset);
 	void MoveRelative(float x, float y, float z);
 	void MoveRelative(DirectX::XMFLOAT3 offset);
+	// Rotates by this much more, around the parent's axes
+	// (or the world's), after the current rotation
 	void Rotate(float pitch, float yaw, float roll);
 	void Rotate(DirectX::XMFLOAT3 _rotation);
+	void Rotate(DirectX::XMFLOAT4 quaternion);
 	void Scale(float x, float y, float z);
 	void Scale(DirectX::XMFLOAT3 _scale);
 
 	// Helpers
 	void UpdateWorld();
-	void UpdateDirections();
 
-private:
-	// Vectors used to construct the world matrix
-	DirectX::XMFLOAT3 position;	
-	DirectX::XMFLOAT3 rotation;	// Could be a float4 quaternion? Scary
-	DirectX::XMFLOAT3 scale;	
+	// The store every transform lives in. Its UpdateDirty()
+	// rebuilds all of their changed matrices at once.
+	static TransformStore& GetStore();
 
-	// Matrix fields, recalculated only when it is requested
-	// and the above vectors have been updated
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
+private:
+	// Position, rotation, scale, the matrices made from them,
+	// whether they need to be recalculated, and the version
+	// all live here
+	uint32_t slot;
+	uint64_t id;
 	
-	// Vector directions for the relative axes of the transform
-	DirectX::XMFLOAT3 right;
-	DirectX::XMFLOAT3 up;
-	DirectX::XMFLOAT3 forward;
-
-	// Whether the world matrix needs to be recalculated
-	bool dirtyWorld;
-
-	// Whether forward, up, and right need to be recalculated
-	bool dirtyDirections;
+	// Not owned, each side lets go of the other when destroyed
+	Transform* parent;
+	std::vector<Transform*> children;
 };
 
@@ -0,0 +1,905 @@
+/*
+William Duprey
+12/10/24
+Transform Store Implementation
+*/
+
+#include "TransformStore.h"
+#include "SseSupport.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Slots gathered from the bitset before they're rebuilt,
+	// so the last group of four is rarely a partial one
+	constexpr size_t GatherSize = 256;
+
+	const float Identity[16] =
+	{
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	};
+
+	// --------------------------------------------------------
+	// The rows of a unit quaternion's rotation matrix (like
+	// XMMatrixRotationQuaternion), which are also its right,
+	// up and forward
+	// --------------------------------------------------------
+	void RotationRows(const float q[4], float rows[3][3])
+	{
+		float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+		float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+		float xw = q[0] * q[3], yw = q[1] * q[3], zw = q[2] * q[3];
+		rows[0][0] = 1.0f - 2.0f * (yy + zz); rows[0][1] = 2.0f * (xy + zw); rows[0][2] = 2.0f * (xz - yw);
+		rows[1][0] = 2.0f * (xy - zw); rows[1][1] = 1.0f - 2.0f * (xx + zz); rows[1][2] = 2.0f * (yz + xw);
+		rows[2][0] = 2.0f * (xz + yw); rows[2][1] = 2.0f * (yz - xw); rows[2][2] = 1.0f - 2.0f * (xx + yy);
+	}
+
+	// --------------------------------------------------------
+	// The inverse transpose of scale, then rotation, then
+	// translation, with nothing to invert: the top 3x3 is
+	// S * R, whose inverse transpose is S^-1 * R (a rotation's
+	// inverse is its transpose), so its rows are the rotation
+	// rows divided by the scale rather than multiplied. Each
+	// row's last element undoes the translation.
+	// --------------------------------------------------------
+	void InverseTransposeOne(const float rotation[3][3], const float position[3],
+		const float scale[3], float* worldInvTranspose)
+	{
+		for (int r = 0; r < 3; r++)
+		{
+			float invScale = 1.0f / scale[r];
+			float x = rotation[r][0] * invScale;
+			float y = rotation[r][1] * invScale;
+			float z = rotation[r][2] * invScale;
+			worldInvTranspose[r * 4 + 0] = x;
+			worldInvTranspose[r * 4 + 1] = y;
+			worldInvTranspose[r * 4 + 2] = z;
+			worldInvTranspose[r * 4 + 3] = -(x * position[0] + y * position[1] + z * position[2]);
+		}
+		worldInvTranspose[12] = 0.0f;
+		worldInvTranspose[13] = 0.0f;
+		worldInvTranspose[14] = 0.0f;
+		worldInvTranspose[15] = 1.0f;
+	}
+
+#ifndef USE_SSE2
+	// --------------------------------------------------------
+	// Builds the world matrix of a scale, unit quaternion and
+	// position, and its inverse transpose (unless that's null)
+	// --------------------------------------------------------
+	void ComposeOne(const float position[3], const float q[4], const float scale[3],
+		float* world, float* worldInvTranspose)
+	{
+		float rotation[3][3];
+		RotationRows(q, rotation);
+		for (int r = 0; r < 3; r++)
+		{
+			world[r * 4 + 0] = rotation[r][0] * scale[r];
+			world[r * 4 + 1] = rotation[r][1] * scale[r];
+			world[r * 4 + 2] = rotation[r][2] * scale[r];
+			world[r * 4 + 3] = 0.0f;
+		}
+		world[12] = position[0];
+		world[13] = position[1];
+		world[14] = position[2];
+		world[15] = 1.0f;
+
+		if (worldInvTranspose)
+			InverseTransposeOne(rotation, position, scale, worldInvTranspose);
+	}
+#else
+	__m128 Gather(const float* values, const uint32_t slots[4])
+	{
+		return _mm_setr_ps(values[slots[0]], values[slots[1]], values[slots[2]], values[slots[3]]);
+	}
+
+	// Writes one row of four matrices, given column by column
+	void StoreRow(float* matrices, const uint32_t slots[4], int row,
+		__m128 c0, __m128 c1, __m128 c2, __m128 c3)
+	{
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(matrices + (size_t)slots[0] * 16 + row * 4, c0);
+		_mm_storeu_ps(matrices + (size_t)slots[1] * 16 + row * 4, c1);
+		_mm_storeu_ps(matrices + (size_t)slots[2] * 16 + row * 4, c2);
+		_mm_storeu_ps(matrices + (size_t)slots[3] * 16 + row * 4, c3);
+	}
+#endif
+
+	// --------------------------------------------------------
+	// result = a * b, for 4x4 row major matrices. Row r of the
+	// result is b's rows weighted by row r of a.
+	// --------------------------------------------------------
+	void MultiplyMatrices(const float* a, const float* b, float* result)
+	{
+#ifdef USE_SSE2
+		__m128 b0 = _mm_loadu_ps(b);
+		__m128 b1 = _mm_loadu_ps(b + 4);
+		__m128 b2 = _mm_loadu_ps(b + 8);
+		__m128 b3 = _mm_loadu_ps(b + 12);
+		for (int r = 0; r < 4; r++)
+		{
+			__m128 row = _mm_mul_ps(_mm_set1_ps(a[r * 4 + 0]), b0);
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[r * 4 + 1]), b1));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[r * 4 + 2]), b2));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[r * 4 + 3]), b3));
+			_mm_storeu_ps(result + r * 4, row);
+		}
+#else
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				result[r * 4 + c] = a[r * 4 + 0] * b[c] + a[r * 4 + 1] * b[4 + c] +
+					a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c];
+#endif
+	}
+
+	bool TestBit(const std::vector<uint64_t>& bits, size_t index)
+	{
+		return (bits[index / 64] >> (index % 64)) & 1;
+	}
+
+	void SetBit(std::vector<uint64_t>& bits, size_t index, bool value)
+	{
+		if (value)
+			bits[index / 64] |= 1ull << (index % 64);
+		else
+			bits[index / 64] &= ~(1ull << (index % 64));
+	}
+
+	// Sets bits [begin, end) of a bitset
+	void SetBits(std::vector<uint64_t>& bits, size_t begin, size_t end)
+	{
+		while (begin < end)
+		{
+			size_t count = std::min<size_t>(64 - begin % 64, end - begin);
+			uint64_t mask = count == 64 ? ~0ull : ((1ull << count) - 1) << (begin % 64);
+			bits[begin / 64] |= mask;
+			begin += count;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Constructor for an empty store
+// --------------------------------------------------------
+TransformStore::TransformStore()
+	: hierarchyChanged(false),
+	  lastVersion(0),
+	  dirtyCount(0),
+	  lastUpdateCount(0),
+	  lastHierarchyCount(0),
+	  lastUpdateTime(0.0f)
+{
+}
+
+// --------------------------------------------------------
+// Hands out a slot holding the identity transform, reusing
+// a released one if there are any
+// --------------------------------------------------------
+uint32_t TransformStore::Allocate()
+{
+	uint32_t slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (uint32_t)positionX.size();
+		positionX.push_back(0.0f); positionY.push_back(0.0f); positionZ.push_back(0.0f);
+		rotationX.push_back(0.0f); rotationY.push_back(0.0f); rotationZ.push_back(0.0f); rotationW.push_back(1.0f);
+		scaleX.push_back(1.0f); scaleY.push_back(1.0f); scaleZ.push_back(1.0f);
+		worldMatrices.resize(worldMatrices.size() + 16);
+		worldInverseTransposeMatrices.resize(worldInverseTransposeMatrices.size() + 16);
+		localMatrices.resize(localMatrices.size() + 16);
+		localInverseTransposeMatrices.resize(localInverseTransposeMatrices.size() + 16);
+		parents.push_back(NoParent);
+		firstChildren.push_back(NoParent);
+		nextSiblings.push_back(NoParent);
+		orderIndices.push_back(NoParent);
+		subtreeSizes.push_back(1);
+		versions.push_back(0);
+		if (slot / 64 >= dirtyBits.size())
+		{
+			dirtyBits.push_back(0);
+			staleWorldInverseBits.push_back(0);
+			staleLocalInverseBits.push_back(0);
+		}
+	}
+
+	positionX[slot] = positionY[slot] = positionZ[slot] = 0.0f;
+	rotationX[slot] = rotationY[slot] = rotationZ[slot] = 0.0f;
+	rotationW[slot] = 1.0f;
+	scaleX[slot] = scaleY[slot] = scaleZ[slot] = 1.0f;
+	std::copy(Identity, Identity + 16, worldMatrices.begin() + (size_t)slot * 16);
+	std::copy(Identity, Identity + 16, worldInverseTransposeMatrices.begin() + (size_t)slot * 16);
+	SetBit(staleWorldInverseBits, slot, false);
+	versions[slot] = ++lastVersion;
+	return slot;
+}
+
+// --------------------------------------------------------
+// Gives a slot back. It stops being updated, and the next
+// Allocate() may hand it out again.
+// --------------------------------------------------------
+void TransformStore::Release(uint32_t slot)
+{
+	// Its children become roots, and it leaves its parent
+	while (firstChildren[slot] != NoParent)
+		SetParent(firstChildren[slot], NoParent);
+	SetParent(slot, NoParent);
+
+	uint64_t bit = 1ull << (slot % 64);
+	if (dirtyBits[slot / 64] & bit)
+	{
+		dirtyBits[slot / 64] &= ~bit;
+		dirtyCount--;
+	}
+	freeSlots.push_back(slot);
+}
+
+// --------------------------------------------------------
+// Unlinks a slot from its old parent's children and links it
+// into the new one's. The depth first order is laid out again
+// at the next update (or query), so re-parenting lots of
+// slots in a row stays cheap.
+// --------------------------------------------------------
+bool TransformStore::SetParent(uint32_t slot, uint32_t parent)
+{
+	if (parents[slot] == parent)
+		return true;
+
+	// No loops
+	for (uint32_t p = parent; p != NoParent; p = parents[p])
+	{
+		if (p == slot)
+			return false;
+	}
+
+	uint32_t oldParent = parents[slot];
+	if (oldParent != NoParent)
+	{
+		uint32_t* link = &firstChildren[oldParent];
+		while (*link != slot)
+			link = &nextSiblings[*link];
+		*link = nextSiblings[slot];
+	}
+
+	parents[slot] = parent;
+	nextSiblings[slot] = NoParent;
+	if (parent != NoParent)
+	{
+		nextSiblings[slot] = firstChildren[parent];
+		firstChildren[parent] = slot;
+	}
+
+	// Its matrices now go to a different place, and
+	// everything under it moves in the world
+	hierarchyChanged = true;
+	MarkDirty(slot);
+	return true;
+}
+
+// --------------------------------------------------------
+// Rebuilds every dirty slot's matrices. The bitset is split
+// into even runs of words, one per thread, so no two threads
+// ever touch the same slot. Then every dirty slot in a
+// hierarchy is re-parented, on this thread.
+// --------------------------------------------------------
+void TransformStore::UpdateDirty(unsigned int threadCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	if (hierarchyChanged)
+		RebuildHierarchy();
+	lastUpdateCount = dirtyCount;
+
+	// One thread per MinDirtyPerThread dirty slots, up to the core count
+	size_t wordCount = dirtyBits.size();
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		size_t byCount = dirtyCount / MinDirtyPerThread;
+		if (byCount < threadCount)
+			threadCount = (unsigned int)byCount;
+	}
+	if (threadCount > wordCount)
+		threadCount = (unsigned int)wordCount;
+	if (threadCount < 1)
+		threadCount = 1;
+
+	// Update on several threads (this one does the first words)
+	if (dirtyCount > 0)
+	{
+		std::vector<std::thread> workers;
+		for (unsigned int i = 1; i < threadCount; i++)
+		{
+			workers.emplace_back(&TransformStore::UpdateWords, this,
+				wordCount * i / threadCount, wordCount * (i + 1) / threadCount);
+		}
+		UpdateWords(0, wordCount / threadCount);
+		for (std::thread& t : workers)
+			t.join();
+		dirtyCount = 0;
+	}
+
+	// Parents are all up to date now, so children can follow
+	lastHierarchyCount = UpdateHierarchy();
+
+	lastUpdateTime = std::chrono::duration<float, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Euler angles to a quaternion, from the half angles (the
+// same products XMQuaternionRotationRollPitchYaw uses)
+// --------------------------------------------------------
+void TransformStore::EulerToQuaternion(float pitch, float yaw, float roll, float q[4])
+{
+	float sp = std::sin(pitch * 0.5f), cp = std::cos(pitch * 0.5f);
+	float sy = std::sin(yaw * 0.5f), cy = std::cos(yaw * 0.5f);
+	float sr = std::sin(roll * 0.5f), cr = std::cos(roll * 0.5f);
+	q[0] = sp * cy * cr + cp * sy * sr;
+	q[1] = cp * sy * cr - sp * cy * sr;
+	q[2] = cp * cy * sr - sp * sy * cr;
+	q[3] = cp * cy * cr + sp * sy * sr;
+}
+
+// --------------------------------------------------------
+// A quaternion back to Euler angles, read off the rotation
+// matrix it makes: its third row is (cos(pitch) sin(yaw),
+// -sin(pitch), cos(pitch) cos(yaw)), and its middle column
+// is the same for roll. Looking straight up or down, yaw and
+// roll turn the same way, so it's all put into yaw.
+// --------------------------------------------------------
+void TransformStore::QuaternionToEuler(const float q[4], float& pitch, float& yaw, float& roll)
+{
+	float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+	float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+	float xw = q[0] * q[3], yw = q[1] * q[3], zw = q[2] * q[3];
+
+	float sinPitch = -2.0f * (yz - xw);
+	if (std::fabs(sinPitch) < 0.99999f)
+	{
+		pitch = std::asin(sinPitch);
+		yaw = std::atan2(2.0f * (xz + yw), 1.0f - 2.0f * (xx + yy));
+		roll = std::atan2(2.0f * (xy + zw), 1.0f - 2.0f * (xx + zz));
+	}
+	else
+	{
+		pitch = sinPitch > 0.0f ? 1.57079633f : -1.57079633f;
+		yaw = std::atan2(-2.0f * (xz - yw), 1.0f - 2.0f * (yy + zz));
+		roll = 0.0f;
+	}
+}
+
+// --------------------------------------------------------
+// One slot's worth of what Compose() builds for normals
+// --------------------------------------------------------
+void TransformStore::InverseTranspose(const float rotation[3][3], const float position[3],
+	const float scale[3], float result[16])
+{
+	InverseTransposeOne(rotation, position, scale, result);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------------------------------- GETTERS --------------------------------- //
+///////////////////////////////////////////////////////////////////////////////
+void TransformStore::GetPosition(uint32_t slot, float& x, float& y, float& z) const
+{
+	x = positionX[slot];
+	y = positionY[slot];
+	z = positionZ[slot];
+}
+
+void TransformStore::GetRotation(uint32_t slot, float& x, float& y, float& z, float& w) const
+{
+	x = rotationX[slot];
+	y = rotationY[slot];
+	z = rotationZ[slot];
+	w = rotationW[slot];
+}
+
+void TransformStore::GetScale(uint32_t slot, float& x, float& y, float& z) const
+{
+	x = scaleX[slot];
+	y = scaleY[slot];
+	z = scaleZ[slot];
+}
+
+const float* TransformStore::GetWorldMatrix(uint32_t slot)
+{
+	if (IsInHierarchy(slot))
+		UpdateChain(slot);
+	else if (IsDirty(slot))
+		dirtyCount -= UpdateWords(slot / 64, slot / 64 + 1);
+	return &worldMatrices[(size_t)slot * 16];
+}
+
+const float* TransformStore::GetWorldInverseTransposeMatrix(uint32_t slot)
+{
+	if (IsInHierarchy(slot))
+		UpdateChain(slot);
+	else if (IsDirty(slot))
+		dirtyCount -= UpdateWords(slot / 64, slot / 64 + 1);
+	if (TestBit(staleWorldInverseBits, slot))
+		BuildInverseTranspose(slot);
+	return &worldInverseTransposeMatrices[(size_t)slot * 16];
+}
+
+uint32_t TransformStore::GetParent(uint32_t slot) const { return parents[slot]; }
+uint64_t TransformStore::GetVersion(uint32_t slot) const { return versions[slot]; }
+
+// --------------------------------------------------------
+// The same scale on every axis, for the slot and all of its
+// ancestors, makes the world matrix's top 3x3 a rotation
+// times a number, which turns normals the right way on its
+// own (they just need normalizing afterward)
+// --------------------------------------------------------
+bool TransformStore::HasUniformScale(uint32_t slot) const
+{
+	for (uint32_t s = slot; s != NoParent; s = parents[s])
+	{
+		if (scaleX[s] != scaleY[s] || scaleY[s] != scaleZ[s])
+			return false;
+	}
+	return true;
+}
+
+bool TransformStore::IsDirty(uint32_t slot) const { return (dirtyBits[slot / 64] >> (slot % 64)) & 1; }
+size_t TransformStore::GetCount() const { return positionX.size() - freeSlots.size(); }
+size_t TransformStore::GetDirtyCount() const { return dirtyCount; }
+size_t TransformStore::GetHierarchyCount() const { return hierarchyChanged ? 0 : hierarchyOrder.size(); }
+size_t TransformStore::GetLastUpdateCount() const { return lastUpdateCount; }
+size_t TransformStore::GetLastHierarchyCount() const { return lastHierarchyCount; }
+float TransformStore::GetLastUpdateTime() const { return lastUpdateTime; }
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------------------------------- SETTERS --------------------------------- //
+///////////////////////////////////////////////////////////////////////////////
+void TransformStore::SetPosition(uint32_t slot, float x, float y, float z)
+{
+	positionX[slot] = x;
+	positionY[slot] = y;
+	positionZ[slot] = z;
+	MarkDirty(slot);
+}
+
+// Normalized here, so the matrices never pick up a scale
+// from quaternions that have drifted (or all zeroes)
+void TransformStore::SetRotation(uint32_t slot, float x, float y, float z, float w)
+{
+	float lengthSq = x * x + y * y + z * z + w * w;
+	if (lengthSq > 0.0f)
+	{
+		float invLength = 1.0f / std::sqrt(lengthSq);
+		x *= invLength;
+		y *= invLength;
+		z *= invLength;
+		w *= invLength;
+	}
+	else
+	{
+		x = y = z = 0.0f;
+		w = 1.0f;
+	}
+
+	rotationX[slot] = x;
+	rotationY[slot] = y;
+	rotationZ[slot] = z;
+	rotationW[slot] = w;
+	MarkDirty(slot);
+}
+
+void TransformStore::SetScale(uint32_t slot, float x, float y, float z)
+{
+	scaleX[slot] = x;
+	scaleY[slot] = y;
+	scaleZ[slot] = z;
+	MarkDirty(slot);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------------------------------- HELPERS --------------------------------- //
+///////////////////////////////////////////////////////////////////////////////
+// --------------------------------------------------------
+// Rebuilds these slots' matrices, four at a time with SSE.
+// The last group is padded by repeating its last slot. With
+// rotations stored as quaternions, there's no trig at all.
+// Slots with the same scale on every axis get their bit in
+// staleBits set instead of an inverse transpose (a group of
+// four only skips it if all of them can).
+// --------------------------------------------------------
+void TransformStore::Compose(const uint32_t* slots, size_t count,
+	float* matrices, float* inverseTransposeMatrices, std::vector<uint64_t>& staleBits)
+{
+#ifdef USE_SSE2
+	for (size_t i = 0; i < count; i += 4)
+	{
+		uint32_t s[4];
+		for (size_t l = 0; l < 4; l++)
+			s[l] = slots[std::min(i + l, count - 1)];
+
+		__m128 qx = Gather(rotationX.data(), s);
+		__m128 qy = Gather(rotationY.data(), s);
+		__m128 qz = Gather(rotationZ.data(), s);
+		__m128 qw = Gather(rotationW.data(), s);
+		__m128 px = Gather(positionX.data(), s);
+		__m128 py = Gather(positionY.data(), s);
+		__m128 pz = Gather(positionZ.data(), s);
+		__m128 sx = Gather(scaleX.data(), s);
+		__m128 sy = Gather(scaleY.data(), s);
+		__m128 sz = Gather(scaleZ.data(), s);
+		__m128 uniform = _mm_and_ps(_mm_cmpeq_ps(sx, sy), _mm_cmpeq_ps(sy, sz));
+		bool skipInverse = _mm_movemask_ps(uniform) == 0xF;
+
+		// Rotation rows (the same math as RotationRows()), with
+		// the 2s folded into the products
+		__m128 two = _mm_set1_ps(2.0f);
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 x2 = _mm_mul_ps(qx, two);
+		__m128 y2 = _mm_mul_ps(qy, two);
+		__m128 z2 = _mm_mul_ps(qz, two);
+		__m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+		__m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+		__m128 xw = _mm_mul_ps(qw, x2), yw = _mm_mul_ps(qw, y2), zw = _mm_mul_ps(qw, z2);
+		__m128 r00 = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+		__m128 r01 = _mm_add_ps(xy, zw);
+		__m128 r02 = _mm_sub_ps(xz, yw);
+		__m128 r10 = _mm_sub_ps(xy, zw);
+		__m128 r11 = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+		__m128 r12 = _mm_add_ps(yz, xw);
+		__m128 r20 = _mm_add_ps(xz, yw);
+		__m128 r21 = _mm_sub_ps(yz, xw);
+		__m128 r22 = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+		// The world's rows are scaled, and the inverse transpose's
+		// are divided by the scale instead (see InverseTransposeOne())
+		__m128 a00 = _mm_mul_ps(r00, sx), a01 = _mm_mul_ps(r01, sx), a02 = _mm_mul_ps(r02, sx);
+		__m128 a10 = _mm_mul_ps(r10, sy), a11 = _mm_mul_ps(r11, sy), a12 = _mm_mul_ps(r12, sy);
+		__m128 a20 = _mm_mul_ps(r20, sz), a21 = _mm_mul_ps(r21, sz), a22 = _mm_mul_ps(r22, sz);
+		__m128 zero = _mm_setzero_ps();
+		StoreRow(matrices, s, 0, a00, a01, a02, zero);
+		StoreRow(matrices, s, 1, a10, a11, a12, zero);
+		StoreRow(matrices, s, 2, a20, a21, a22, zero);
+		StoreRow(matrices, s, 3, px, py, pz, one);
+		for (size_t l = 0; l < 4; l++)
+			SetBit(staleBits, s[l], skipInverse);
+		if (skipInverse)
+			continue;
+
+		__m128 ix = _mm_div_ps(one, sx);
+		__m128 iy = _mm_div_ps(one, sy);
+		__m128 iz = _mm_div_ps(one, sz);
+		__m128 c00 = _mm_mul_ps(r00, ix), c01 = _mm_mul_ps(r01, ix), c02 = _mm_mul_ps(r02, ix);
+		__m128 c10 = _mm_mul_ps(r10, iy), c11 = _mm_mul_ps(r11, iy), c12 = _mm_mul_ps(r12, iy);
+		__m128 c20 = _mm_mul_ps(r20, iz), c21 = _mm_mul_ps(r21, iz), c22 = _mm_mul_ps(r22, iz);
+		__m128 t0 = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(c00, px), _mm_mul_ps(c01, py)), _mm_mul_ps(c02, pz)));
+		__m128 t1 = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(c10, px), _mm_mul_ps(c11, py)), _mm_mul_ps(c12, pz)));
+		__m128 t2 = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(c20, px), _mm_mul_ps(c21, py)), _mm_mul_ps(c22, pz)));
+		StoreRow(inverseTransposeMatrices, s, 0, c00, c01, c02, t0);
+		StoreRow(inverseTransposeMatrices, s, 1, c10, c11, c12, t1);
+		StoreRow(inverseTransposeMatrices, s, 2, c20, c21, c22, t2);
+		StoreRow(inverseTransposeMatrices, s, 3, zero, zero, zero, one);
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t s = slots[i];
+		float position[3] = { positionX[s], positionY[s], positionZ[s] };
+		float rotation[4] = { rotationX[s], rotationY[s], rotationZ[s], rotationW[s] };
+		float scale[3] = { scaleX[s], scaleY[s], scaleZ[s] };
+		bool skipInverse = scale[0] == scale[1] && scale[1] == scale[2];
+		ComposeOne(position, rotation, scale, matrices + (size_t)s * 16,
+			skipInverse ? nullptr : inverseTransposeMatrices + (size_t)s * 16);
+		SetBit(staleBits, s, skipInverse);
+	}
+#endif
+}
+
+// --------------------------------------------------------
+// Gathers the dirty slots in these words of the bitset,
+// rebuilds them in groups, and clears the words. Slots with
+// parents get their local matrices rebuilt, and the rest
+// their world ones. Returns how many there were (the caller
+// fixes up dirtyCount, since several threads may be in here
+// at once).
+// --------------------------------------------------------
+size_t TransformStore::UpdateWords(size_t wordBegin, size_t wordEnd)
+{
+	uint32_t roots[GatherSize];
+	uint32_t children[GatherSize];
+	size_t rootCount = 0;
+	size_t childCount = 0;
+	size_t cleaned = 0;
+
+	for (size_t w = wordBegin; w < wordEnd; w++)
+	{
+		uint64_t bits = dirtyBits[w];
+		dirtyBits[w] = 0;
+		while (bits)
+		{
+			// Lowest set bit, then clear it
+			int bit = std::countr_zero(bits);
+			bits &= bits - 1;
+			uint32_t slot = (uint32_t)(w * 64 + bit);
+			cleaned++;
+
+			if (parents[slot] == NoParent)
+			{
+				roots[rootCount++] = slot;
+				if (rootCount == GatherSize)
+				{
+					Compose(roots, rootCount, worldMatrices.data(),
+						worldInverseTransposeMatrices.data(), staleWorldInverseBits);
+					rootCount = 0;
+				}
+			}
+			else
+			{
+				children[childCount++] = slot;
+				if (childCount == GatherSize)
+				{
+					Compose(children, childCount, localMatrices.data(),
+						localInverseTransposeMatrices.data(), staleLocalInverseBits);
+					childCount = 0;
+				}
+			}
+		}
+	}
+	if (rootCount > 0)
+		Compose(roots, rootCount, worldMatrices.data(),
+			worldInverseTransposeMatrices.data(), staleWorldInverseBits);
+	if (childCount > 0)
+		Compose(children, childCount, localMatrices.data(),
+			localInverseTransposeMatrices.data(), staleLocalInverseBits);
+	return cleaned;
+}
+
+// --------------------------------------------------------
+// One pass over the dirty part of the hierarchy. Depth first
+// order puts every parent before its children, so each
+// parent is already up to date when its children need it.
+// --------------------------------------------------------
+size_t TransformStore::UpdateHierarchy()
+{
+	size_t updated = 0;
+	for (size_t w = 0; w < hierarchyDirtyBits.size(); w++)
+	{
+		uint64_t bits = hierarchyDirtyBits[w];
+		hierarchyDirtyBits[w] = 0;
+		while (bits)
+		{
+			int bit = std::countr_zero(bits);
+			bits &= bits - 1;
+			ApplyParent(hierarchyOrder[w * 64 + bit]);
+			updated++;
+		}
+	}
+	return updated;
+}
+
+// --------------------------------------------------------
+// World = local * parent's world, and since the inverse of
+// a product is the product of the inverses the other way
+// around, the inverse transposes multiply the same way. If
+// either of those inverse transposes was skipped, so is the
+// slot's.
+// --------------------------------------------------------
+void TransformStore::ApplyParent(uint32_t slot)
+{
+	uint32_t parent = parents[slot];
+	if (parent == NoParent)
+		return;
+
+	MultiplyMatrices(&localMatrices[(size_t)slot * 16],
+		&worldMatrices[(size_t)parent * 16],
+		&worldMatrices[(size_t)slot * 16]);
+
+	bool skipInverse = TestBit(staleLocalInverseBits, slot) || TestBit(staleWorldInverseBits, parent);
+	if (!skipInverse)
+	{
+		MultiplyMatrices(&localInverseTransposeMatrices[(size_t)slot * 16],
+			&worldInverseTransposeMatrices[(size_t)parent * 16],
+			&worldInverseTransposeMatrices[(size_t)slot * 16]);
+	}
+	SetBit(staleWorldInverseBits, slot, skipInverse);
+}
+
+// --------------------------------------------------------
+// Builds the inverse transposes that were skipped for an up
+// to date slot and its ancestors, from the top down. Only
+// asked for if a shader needs one after all, so it's just
+// one slot at a time.
+// --------------------------------------------------------
+void TransformStore::BuildInverseTranspose(uint32_t slot)
+{
+	std::vector<uint32_t> chain;
+	for (uint32_t s = slot; s != NoParent && TestBit(staleWorldInverseBits, s); s = parents[s])
+		chain.push_back(s);
+
+	for (size_t i = chain.size(); i-- > 0;)
+	{
+		uint32_t s = chain[i];
+		uint32_t parent = parents[s];
+		float* local = parent == NoParent ?
+			&worldInverseTransposeMatrices[(size_t)s * 16] :
+			&localInverseTransposeMatrices[(size_t)s * 16];
+
+		if (parent == NoParent || TestBit(staleLocalInverseBits, s))
+		{
+			float position[3] = { positionX[s], positionY[s], positionZ[s] };
+			float q[4] = { rotationX[s], rotationY[s], rotationZ[s], rotationW[s] };
+			float scale[3] = { scaleX[s], scaleY[s], scaleZ[s] };
+			float rotation[3][3];
+			RotationRows(q, rotation);
+			InverseTransposeOne(rotation, position, scale, local);
+			SetBit(staleLocalInverseBits, s, false);
+		}
+
+		// The parent is either up to date already, or was built
+		// just before this
+		if (parent != NoParent)
+		{
+			MultiplyMatrices(local, &worldInverseTransposeMatrices[(size_t)parent * 16],
+				&worldInverseTransposeMatrices[(size_t)s * 16]);
+		}
+		SetBit(staleWorldInverseBits, s, false);
+	}
+}
+
+// --------------------------------------------------------
+// Updates just the slot and its ancestors, from the root
+// down, for when a matrix is asked for between batches.
+// Anything else left dirty stays that way.
+// --------------------------------------------------------
+void TransformStore::UpdateChain(uint32_t slot)
+{
+	if (hierarchyChanged)
+		RebuildHierarchy();
+
+	std::vector<uint32_t> chain;
+	for (uint32_t s = slot; s != NoParent; s = parents[s])
+		chain.push_back(s);
+
+	for (size_t i = chain.size(); i-- > 0;)
+	{
+		uint32_t s = chain[i];
+		if (IsDirty(s))
+			dirtyCount -= UpdateWords(s / 64, s / 64 + 1);
+
+		uint32_t index = orderIndices[s];
+		uint64_t bit = 1ull << (index % 64);
+		if (hierarchyDirtyBits[index / 64] & bit)
+		{
+			hierarchyDirtyBits[index / 64] &= ~bit;
+			ApplyParent(s);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Lays every tree out depth first, one after another. The
+// old dirty bits don't line up with the new order, so the
+// whole hierarchy gets re-parented once.
+// --------------------------------------------------------
+void TransformStore::RebuildHierarchy()
+{
+	hierarchyOrder.clear();
+	std::fill(orderIndices.begin(), orderIndices.end(), NoParent);
+
+	std::vector<uint32_t> stack;
+	for (uint32_t root = 0; root < (uint32_t)parents.size(); root++)
+	{
+		if (parents[root] != NoParent || firstChildren[root] == NoParent)
+			continue;
+
+		// A subtree is finished before anything under it on the
+		// stack is popped, so each one ends up in one run
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			uint32_t s = stack.back();
+			stack.pop_back();
+			orderIndices[s] = (uint32_t)hierarchyOrder.size();
+			hierarchyOrder.push_back(s);
+			subtreeSizes[s] = 1;
+			for (uint32_t c = firstChildren[s]; c != NoParent; c = nextSiblings[c])
+				stack.push_back(c);
+		}
+	}
+
+	// Children come after their parents, so going backwards
+	// finishes every subtree before adding it to its parent's
+	for (size_t i = hierarchyOrder.size(); i-- > 0;)
+	{
+		uint32_t s = hierarchyOrder[i];
+		if (parents[s] != NoParent)
+			subtreeSizes[parents[s]] += subtreeSizes[s];
+	}
+
+	hierarchyDirtyBits.assign((hierarchyOrder.size() + 63) / 64, 0);
+	SetBits(hierarchyDirtyBits, 0, hierarchyOrder.size());
+	hierarchyChanged = false;
+}
+
+// --------------------------------------------------------
+// Flags a slot for the next update and bumps its version.
+// In a hierarchy, its whole subtree moves in the world, so
+// that run of the order is flagged and every version in it
+// bumped too.
+// --------------------------------------------------------
+void TransformStore::MarkDirty(uint32_t slot)
+{
+	uint64_t bit = 1ull << (slot % 64);
+	if (!(dirtyBits[slot / 64] & bit))
+	{
+		dirtyBits[slot / 64] |= bit;
+		dirtyCount++;
+	}
+	versions[slot] = ++lastVersion;
+
+	if (!IsInHierarchy(slot))
+		return;
+
+	// Not laid out yet, so follow the links instead (the
+	// layout will flag the whole hierarchy anyway)
+	if (hierarchyChanged)
+	{
+		std::vector<uint32_t> stack(1, slot);
+		while (!stack.empty())
+		{
+			uint32_t s = stack.back();
+			stack.pop_back();
+			for (uint32_t c = firstChildren[s]; c != NoParent; c = nextSiblings[c])
+			{
+				versions[c] = ++lastVersion;
+				stack.push_back(c);
+			}
+		}
+		return;
+	}
+
+	uint32_t begin = orderIndices[slot];
+	uint32_t end = begin + subtreeSizes[slot];
+	for (uint32_t i = begin + 1; i < end; i++)
+		versions[hierarchyOrder[i]] = ++lastVersion;
+	SetBits(hierarchyDirtyBits, begin, end);
+}
+
+// --------------------------------------------------------
+// Flags every slot
+// --------------------------------------------------------
+void TransformStore::MarkAllDirty()
+{
+	for (uint32_t slot = 0; slot < (uint32_t)positionX.size(); slot++)
+	{
+		dirtyBits[slot / 64] |= 1ull << (slot % 64);
+		versions[slot] = ++lastVersion;
+	}
+	for (uint32_t slot : freeSlots)
+		dirtyBits[slot / 64] &= ~(1ull << (slot % 64));
+	dirtyCount = GetCount();
+
+	if (!hierarchyChanged)
+		SetBits(hierarchyDirtyBits, 0, hierarchyOrder.size());
+}
+
+bool TransformStore::IsInHierarchy(uint32_t slot) const
+{
+	return parents[slot] != NoParent || firstChildren[slot] != NoParent;
+}
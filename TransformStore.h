@@ -0,0 +1,184 @@
+/*
+William Duprey
+12/10/24
+Transform Store Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Position, rotation and scale for many transforms, one
+// array per component, along with the world and world
+// inverse transpose matrices they make. Every Transform
+// is a slot in one shared store (see
+// Transform::GetStore()).
+//
+// Changing a slot sets its bit in a dirty bitset, and
+// UpdateDirty() rebuilds every dirty slot's matrices in one
+// pass: four at a time with SSE, on several threads when
+// there are enough of them. Asking for a dirty slot's matrix
+// rebuilds just that one, so nothing is ever out of date.
+//
+// Slots can have parents. A slot's position, rotation and
+// scale are then relative to its parent, and its world
+// matrix is its own (local) matrix times its parent's world
+// matrix. Everything in a hierarchy is also kept in depth
+// first order, where every subtree is one contiguous run, so
+// a change dirties just that run of a second bitset, and one
+// pass in that order (after the batch above) rebuilds every
+// dirty child after its parent.
+//
+// Rotations are unit quaternions (x, y, z, w), so building a
+// matrix takes no trig, and the inverse transpose is just the
+// rotation over the scale, so it takes no inverting either.
+// Slots with the same scale on every axis (and ancestors
+// that do too) don't need one for their normals at all, so
+// updates skip theirs, and it's only built if asked for.
+// Matrices are row major for row
+// vectors (scale, then rotation, then translation), the same
+// as DirectXMath makes them.
+// --------------------------------------------------------
+class TransformStore
+{
+public:
+	// Fewer dirty slots than this aren't worth another thread
+	static constexpr size_t MinDirtyPerThread = 1 << 13;
+
+	// The parent of a slot that doesn't have one
+	static constexpr uint32_t NoParent = ~0u;
+
+	TransformStore();
+
+	// New slots are identity. Released slots are reused, and
+	// releasing one leaves its children without a parent.
+	uint32_t Allocate();
+	void Release(uint32_t slot);
+
+	// Moves a slot (and its subtree) under a new parent, or
+	// NoParent. Its local values stay the same, so it moves
+	// in the world. Returns false, changing nothing, if the
+	// parent is the slot or one of its descendants.
+	bool SetParent(uint32_t slot, uint32_t parent);
+
+	// Rebuilds the matrices of every dirty slot. threadCount
+	// of 0 picks one based on the dirty count and cores.
+	void UpdateDirty(unsigned int threadCount = 0);
+
+	// Flags a slot (and its subtree) or every slot for the
+	// next update without changing anything, like a full
+	// rebuild would need. Both bump versions.
+	void MarkDirty(uint32_t slot);
+	void MarkAllDirty();
+
+	// Getters
+	void GetPosition(uint32_t slot, float& x, float& y, float& z) const;
+	void GetRotation(uint32_t slot, float& x, float& y, float& z, float& w) const;
+	void GetScale(uint32_t slot, float& x, float& y, float& z) const;
+	const float* GetWorldMatrix(uint32_t slot);		// 16 floats
+	const float* GetWorldInverseTransposeMatrix(uint32_t slot);
+	uint32_t GetParent(uint32_t slot) const;
+	uint64_t GetVersion(uint32_t slot) const;	// Also bumped by ancestors' changes
+	bool HasUniformScale(uint32_t slot) const;	// Its ancestors' too
+	bool IsDirty(uint32_t slot) const;
+	size_t GetCount() const;			// Allocated slots
+	size_t GetDirtyCount() const;
+	size_t GetHierarchyCount() const;	// Slots with a parent or children
+	size_t GetLastUpdateCount() const;	// Slots rebuilt by UpdateDirty()
+	size_t GetLastHierarchyCount() const;	// Of those, world matrices re-parented
+	float GetLastUpdateTime() const;	// Milliseconds
+
+	// Setters (each marks the slot dirty and bumps its version)
+	void SetPosition(uint32_t slot, float x, float y, float z);
+	void SetRotation(uint32_t slot, float x, float y, float z, float w);	// Normalized
+	void SetScale(uint32_t slot, float x, float y, float z);
+
+	// Pitch, yaw, roll in radians (applied roll first, then
+	// pitch, then yaw, like XMQuaternionRotationRollPitchYaw)
+	// to and from a unit quaternion. Angles come back with
+	// pitch in [-pi/2, pi/2], and the others in [-pi, pi].
+	static void EulerToQuaternion(float pitch, float yaw, float roll, float q[4]);
+	static void QuaternionToEuler(const float q[4], float& pitch, float& yaw, float& roll);
+
+	// The inverse transpose of a scale, rotation (the rows of
+	// its matrix) and position's world matrix, the same way the
+	// store builds them: the rotation over the scale, with
+	// nothing to invert
+	static void InverseTranspose(const float rotation[3][3], const float position[3],
+		const float scale[3], float result[16]);
+
+private:
+	// Rebuilds these slots' matrices into these arrays
+	void Compose(const uint32_t* slots, size_t count,
+		float* matrices, float* inverseTransposeMatrices, std::vector<uint64_t>& staleBits);
+
+	// Rebuilds and cleans every dirty slot in these bitset words
+	size_t UpdateWords(size_t wordBegin, size_t wordEnd);
+
+	// Re-parents every dirty world matrix, in depth first order
+	size_t UpdateHierarchy();
+
+	// A child's world matrices, from its local ones and its
+	// parent's world ones
+	void ApplyParent(uint32_t slot);
+
+	// Builds a slot's skipped inverse transpose (and any of its
+	// ancestors' it needs)
+	void BuildInverseTranspose(uint32_t slot);
+
+	// Brings one slot in a hierarchy, and its ancestors, up to date
+	void UpdateChain(uint32_t slot);
+
+	// Lays the hierarchy out in depth first order again
+	void RebuildHierarchy();
+
+	bool IsInHierarchy(uint32_t slot) const;
+
+	// Inputs, one array per component
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+	// Outputs, 16 floats per slot. Local matrices are only
+	// used by slots with parents (for the rest, it's the world).
+	std::vector<float> worldMatrices;
+	std::vector<float> worldInverseTransposeMatrices;
+	std::vector<float> localMatrices;
+	std::vector<float> localInverseTransposeMatrices;
+
+	// Links between slots, NoParent where there isn't one
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> firstChildren;
+	std::vector<uint32_t> nextSiblings;
+
+	// Every slot with a parent or children, depth first, and
+	// where each slot's subtree starts in it (and how long it
+	// is). Only valid while hierarchyChanged is false.
+	std::vector<uint32_t> hierarchyOrder;
+	std::vector<uint32_t> orderIndices;
+	std::vector<uint32_t> subtreeSizes;
+	bool hierarchyChanged;
+
+	// One bit per entry of hierarchyOrder
+	std::vector<uint64_t> hierarchyDirtyBits;
+
+	// Set from lastVersion on every change to a slot (and when
+	// it's allocated), so no two states of any slots share one,
+	// even after a slot is released and reused
+	std::vector<uint64_t> versions;
+	uint64_t lastVersion;
+
+	// One bit per slot
+	std::vector<uint64_t> dirtyBits;
+	std::vector<uint64_t> staleWorldInverseBits;	// Inverse transpose skipped
+	std::vector<uint64_t> staleLocalInverseBits;
+	size_t dirtyCount;
+
+	std::vector<uint32_t> freeSlots;
+
+	size_t lastUpdateCount;
+	size_t lastHierarchyCount;
+	float lastUpdateTime;
+};
@@ -0,0 +1,756 @@
+/*
+William Duprey
+12/10/24
+Triangle BVH Implementation
+*/
+
+#include "TriangleBvh.h"
+#include "SseSupport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Past this depth, nodes are split in half instead of by
+	// the heuristic, which bounds the depth of the whole tree
+	// (and so the traversal stack) even for nasty inputs
+	constexpr unsigned int MaxSplitDepth = 64;
+	constexpr unsigned int StackSize = 4 * (MaxSplitDepth + 32);
+
+	// Cost of visiting a node, relative to testing a triangle
+	constexpr float TraversalCost = 1.0f;
+
+	// Pads the far side of each box test just enough to cover
+	// the rounding in the slab math, so rays that graze a box
+	// (or hit an edge shared by two leaves) aren't lost
+	constexpr float FarScale = 1.00000024f;
+
+	constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+	// Bounds and centroid of one triangle, while building.
+	// These get partitioned themselves (rather than indices to
+	// them) so every pass over a node reads memory in order.
+	struct Reference
+	{
+		float Min[3];
+		float Max[3];
+		float Centroid[3];
+		uint32_t Triangle;
+	};
+
+	// A node of the intermediate binary tree. Internal nodes
+	// have Count 0, and their children are at First and
+	// First + 1. Leaves cover Count references from First.
+	struct BuildNode
+	{
+		float Min[3];
+		float Max[3];
+		uint32_t First;
+		uint32_t Count;
+	};
+
+	struct Bin
+	{
+		float Min[3];
+		float Max[3];
+		uint32_t Count;
+	};
+
+	// Everything the build threads share. Each thread only
+	// writes the nodes it allocated and its own range of refs.
+	struct BuildContext
+	{
+		std::vector<Reference> Refs;		// Reordered into leaves
+		std::vector<BuildNode> Nodes;
+		std::atomic<uint32_t> NodeCount;
+		std::atomic<int> SpareThreads;
+	};
+
+	void EmptyBox(float min[3], float max[3])
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			min[a] = Infinity;
+			max[a] = -Infinity;
+		}
+	}
+
+	// Plain compares rather than fminf(), which compilers won't
+	// turn into a single instruction (because of its NaN rules)
+	void GrowBox(float min[3], float max[3], const float boxMin[3], const float boxMax[3])
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			min[a] = boxMin[a] < min[a] ? boxMin[a] : min[a];
+			max[a] = boxMax[a] > max[a] ? boxMax[a] : max[a];
+		}
+	}
+
+	// Half the surface area, which is all the heuristic needs
+	float HalfArea(const float min[3], const float max[3])
+	{
+		float x = max[0] - min[0];
+		float y = max[1] - min[1];
+		float z = max[2] - min[2];
+		return x * y + y * z + z * x;
+	}
+
+	// Bounds of the triangles behind refs [begin, end)
+	void RangeBox(const BuildContext& context, uint32_t begin, uint32_t end, float min[3], float max[3])
+	{
+		EmptyBox(min, max);
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const Reference& triangle = context.Refs[i];
+			GrowBox(min, max, triangle.Min, triangle.Max);
+		}
+	}
+
+	// Where a node's refs get split, and the bounds of each side
+	struct Split
+	{
+		uint32_t Middle;
+		float LeftMin[3], LeftMax[3];
+		float RightMin[3], RightMax[3];
+	};
+
+	// --------------------------------------------------------
+	// Splits a node's refs into halves, as they are. Used when
+	// the heuristic has nothing to go on.
+	// --------------------------------------------------------
+	void HalfSplit(const BuildContext& context, uint32_t begin, uint32_t end, Split& split)
+	{
+		split.Middle = begin + (end - begin) / 2;
+		RangeBox(context, begin, split.Middle, split.LeftMin, split.LeftMax);
+		RangeBox(context, split.Middle, end, split.RightMin, split.RightMax);
+	}
+
+	// --------------------------------------------------------
+	// Finds the cheapest split of the node's refs (by binning
+	// centroids along each axis), and partitions them around
+	// it. Returns false if the node is better off as a leaf.
+	// --------------------------------------------------------
+	bool FindSplit(BuildContext& context, const BuildNode& node,
+		uint32_t begin, uint32_t end, unsigned int depth, Split& split)
+	{
+		uint32_t count = end - begin;
+		Reference* refs = context.Refs.data();
+
+		if (count <= 1)
+			return false;
+		if (depth >= MaxSplitDepth)
+		{
+			if (count <= TriangleBvh::MaxLeafTriangles)
+				return false;
+			HalfSplit(context, begin, end, split);
+			return true;
+		}
+
+		// Bins are spread over the centroids, not the triangles,
+		// so every bin can actually receive something
+		float centroidMin[3], centroidMax[3];
+		EmptyBox(centroidMin, centroidMax);
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const float* c = refs[i].Centroid;
+			GrowBox(centroidMin, centroidMax, c, c);
+		}
+
+		// Small nodes don't need (or pay for) every bin. Slightly
+		// under binCount, so the max centroid lands in the last
+		// bin and not one past it. Flat axes put everything in
+		// bin 0, which never makes a split.
+		const unsigned int binCount = count < TriangleBvh::BinCount ? count : TriangleBvh::BinCount;
+		float scale[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float extent = centroidMax[axis] - centroidMin[axis];
+			scale[axis] = extent > 0.0f ? binCount * 0.9999f / extent : 0.0f;
+		}
+
+		// All three axes in one pass over the refs
+		Bin bins[3][TriangleBvh::BinCount];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (unsigned int b = 0; b < binCount; b++)
+			{
+				Bin& bin = bins[axis][b];
+				EmptyBox(bin.Min, bin.Max);
+				bin.Count = 0;
+			}
+		}
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const Reference& triangle = refs[i];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				unsigned int b = (unsigned int)((triangle.Centroid[axis] - centroidMin[axis]) * scale[axis]);
+				Bin& bin = bins[axis][b < binCount ? b : binCount - 1];
+				GrowBox(bin.Min, bin.Max, triangle.Min, triangle.Max);
+				bin.Count++;
+			}
+		}
+
+		float bestCost = Infinity;
+		int bestAxis = -1;
+		unsigned int bestBin = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			// Sweep from the right to get the bounds of everything
+			// right of each split, then from the left to finish it
+			float rightMin[TriangleBvh::BinCount][3], rightMax[TriangleBvh::BinCount][3];
+			float rightCost[TriangleBvh::BinCount];
+			float min[3], max[3];
+			EmptyBox(min, max);
+			uint32_t sideCount = 0;
+			for (unsigned int b = binCount - 1; b > 0; b--)
+			{
+				GrowBox(min, max, bins[axis][b].Min, bins[axis][b].Max);
+				sideCount += bins[axis][b].Count;
+				std::copy(min, min + 3, rightMin[b]);
+				std::copy(max, max + 3, rightMax[b]);
+				rightCost[b] = sideCount ? HalfArea(min, max) * sideCount : 0.0f;
+			}
+
+			EmptyBox(min, max);
+			sideCount = 0;
+			for (unsigned int b = 0; b < binCount - 1; b++)
+			{
+				GrowBox(min, max, bins[axis][b].Min, bins[axis][b].Max);
+				sideCount += bins[axis][b].Count;
+				if (sideCount == 0 || sideCount == count)
+					continue;
+
+				float cost = HalfArea(min, max) * sideCount + rightCost[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+					std::copy(min, min + 3, split.LeftMin);
+					std::copy(max, max + 3, split.LeftMax);
+					std::copy(rightMin[b + 1], rightMin[b + 1] + 3, split.RightMin);
+					std::copy(rightMax[b + 1], rightMax[b + 1] + 3, split.RightMax);
+				}
+			}
+		}
+
+		// All centroids in one spot, so there's nothing to bin
+		if (bestAxis < 0)
+		{
+			if (count <= TriangleBvh::MaxLeafTriangles)
+				return false;
+			HalfSplit(context, begin, end, split);
+			return true;
+		}
+
+		// Only stay a leaf if that's cheaper than splitting
+		float nodeArea = HalfArea(node.Min, node.Max);
+		float splitCost = TraversalCost + (nodeArea > 0.0f ? bestCost / nodeArea : 0.0f);
+		if (count <= TriangleBvh::MaxLeafTriangles && splitCost >= (float)count)
+			return false;
+
+		// Same math as the binning, so refs land on the same side
+		float axisMin = centroidMin[bestAxis];
+		float axisScale = scale[bestAxis];
+		Reference* middle = std::partition(refs + begin, refs + end,
+			[&](const Reference& ref)
+			{
+				unsigned int b = (unsigned int)((ref.Centroid[bestAxis] - axisMin) * axisScale);
+				return (b < binCount ? b : binCount - 1) <= bestBin;
+			});
+		split.Middle = (uint32_t)(middle - refs);
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Builds the subtree of the binary tree over refs
+	// [begin, end), rooted at the already allocated (and
+	// bounded) nodeIndex. Big enough subtrees go to another
+	// thread while there are any to spare.
+	// --------------------------------------------------------
+	void BuildSubtree(BuildContext& context, uint32_t nodeIndex,
+		uint32_t begin, uint32_t end, unsigned int depth)
+	{
+		BuildNode& node = context.Nodes[nodeIndex];
+		Split split;
+		if (!FindSplit(context, node, begin, end, depth, split))
+		{
+			node.First = begin;
+			node.Count = end - begin;
+			return;
+		}
+
+		uint32_t children = context.NodeCount.fetch_add(2);
+		node.First = children;
+		node.Count = 0;
+
+		BuildNode& left = context.Nodes[children];
+		BuildNode& right = context.Nodes[children + 1];
+		std::copy(split.LeftMin, split.LeftMin + 3, left.Min);
+		std::copy(split.LeftMax, split.LeftMax + 3, left.Max);
+		std::copy(split.RightMin, split.RightMin + 3, right.Min);
+		std::copy(split.RightMax, split.RightMax + 3, right.Max);
+
+		uint32_t middle = split.Middle;
+		bool bigEnough = std::min(middle - begin, end - middle) >= TriangleBvh::MinTrianglesPerThread;
+		if (bigEnough && context.SpareThreads.fetch_sub(1) > 0)
+		{
+			std::thread worker(BuildSubtree, std::ref(context), children, begin, middle, depth + 1);
+			BuildSubtree(context, children + 1, middle, end, depth + 1);
+			worker.join();
+			context.SpareThreads.fetch_add(1);
+			return;
+		}
+		if (bigEnough)
+			context.SpareThreads.fetch_add(1);
+
+		BuildSubtree(context, children, begin, middle, depth + 1);
+		BuildSubtree(context, children + 1, middle, end, depth + 1);
+	}
+
+	// --------------------------------------------------------
+	// Turns a binary node into a 4-wide one, by repeatedly
+	// opening up whichever child is the biggest internal node
+	// until there are four children (or only leaves). Returns
+	// the new node's index.
+	// --------------------------------------------------------
+	uint32_t CollapseNode(const std::vector<BuildNode>& binary, uint32_t binaryIndex,
+		std::vector<BvhNode>& nodes)
+	{
+		uint32_t children[4] = { binaryIndex };
+		unsigned int childCount = 1;
+		if (binary[binaryIndex].Count == 0)
+		{
+			children[0] = binary[binaryIndex].First;
+			children[1] = binary[binaryIndex].First + 1;
+			childCount = 2;
+		}
+
+		while (childCount < 4)
+		{
+			int open = -1;
+			float openArea = -1.0f;
+			for (unsigned int c = 0; c < childCount; c++)
+			{
+				const BuildNode& child = binary[children[c]];
+				float area = HalfArea(child.Min, child.Max);
+				if (child.Count == 0 && area > openArea)
+				{
+					open = (int)c;
+					openArea = area;
+				}
+			}
+			if (open < 0)
+				break;
+
+			uint32_t first = binary[children[open]].First;
+			children[open] = first;
+			children[childCount++] = first + 1;
+		}
+
+		uint32_t nodeIndex = (uint32_t)nodes.size();
+		nodes.emplace_back();
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			// Can't hold a reference to the node, since
+			// collapsing children below may grow the vector.
+			// Empty slots get an inside out box, which every
+			// ray misses, whichever way it points.
+			uint32_t child = TriangleBvh::EmptyChild;
+			uint32_t count = 0;
+			float min[3] = { Infinity, Infinity, Infinity };
+			float max[3] = { -Infinity, -Infinity, -Infinity };
+			if (c < childCount)
+			{
+				const BuildNode& source = binary[children[c]];
+				std::copy(source.Min, source.Min + 3, min);
+				std::copy(source.Max, source.Max + 3, max);
+				count = source.Count;
+				child = count ? source.First : CollapseNode(binary, children[c], nodes);
+			}
+
+			BvhNode& node = nodes[nodeIndex];
+			node.MinX[c] = min[0]; node.MinY[c] = min[1]; node.MinZ[c] = min[2];
+			node.MaxX[c] = max[0]; node.MaxY[c] = max[1]; node.MaxZ[c] = max[2];
+			node.Child[c] = child;
+			node.Count[c] = count;
+		}
+		return nodeIndex;
+	}
+
+	// --------------------------------------------------------
+	// Everything about a ray that traversal reuses for every
+	// box and triangle
+	// --------------------------------------------------------
+	struct RayData
+	{
+		float Origin[3];
+		float InvDirection[3];
+		float MinT;
+
+		// Which of a node's six box arrays is the near and far
+		// side on each axis (MinX, MinY, MinZ, MaxX, MaxY, MaxZ),
+		// from the direction's signs
+		int Near[3];
+		int Far[3];
+
+		// Watertight triangle test: the axis the ray mostly
+		// runs along (z), the other two (x, y), and the shear
+		// that lines the ray up with z
+		int Kx, Ky, Kz;
+		float Sx, Sy, Sz;
+	};
+
+	void SetupRay(const BvhRay& ray, RayData& data)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			// A zero component would make 0 * inf = NaN in the
+			// slab test, so nudge it to something tiny instead
+			float d = ray.Direction[a];
+			if (fabsf(d) < 1e-20f)
+				d = d < 0.0f ? -1e-20f : 1e-20f;
+
+			data.Origin[a] = ray.Origin[a];
+			data.InvDirection[a] = 1.0f / d;
+			data.Near[a] = d < 0.0f ? a + 3 : a;
+			data.Far[a] = d < 0.0f ? a : a + 3;
+		}
+		data.MinT = ray.MinT;
+
+		float ax = fabsf(ray.Direction[0]);
+		float ay = fabsf(ray.Direction[1]);
+		float az = fabsf(ray.Direction[2]);
+		data.Kz = (ax > ay) ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+		data.Kx = (data.Kz + 1) % 3;
+		data.Ky = (data.Kx + 1) % 3;
+
+		// Keep the winding the same after the permutation
+		if (ray.Direction[data.Kz] < 0.0f)
+			std::swap(data.Kx, data.Ky);
+
+		// The largest component is never the one that got nudged
+		data.Sz = data.InvDirection[data.Kz];
+		data.Sx = ray.Direction[data.Kx] * data.Sz;
+		data.Sy = ray.Direction[data.Ky] * data.Sz;
+	}
+
+	// --------------------------------------------------------
+	// Tests the ray against all four of a node's boxes. Returns
+	// a bit per child that's hit before maxT, and where along
+	// the ray each one starts.
+	// --------------------------------------------------------
+	inline int IntersectBoxes(const BvhNode& node, const RayData& ray, float maxT, float nearT[4])
+	{
+		const float* boxes[6] = { node.MinX, node.MinY, node.MinZ, node.MaxX, node.MaxY, node.MaxZ };
+
+#ifdef USE_SSE2
+		__m128 originX = _mm_set1_ps(ray.Origin[0]);
+		__m128 originY = _mm_set1_ps(ray.Origin[1]);
+		__m128 originZ = _mm_set1_ps(ray.Origin[2]);
+		__m128 invX = _mm_set1_ps(ray.InvDirection[0]);
+		__m128 invY = _mm_set1_ps(ray.InvDirection[1]);
+		__m128 invZ = _mm_set1_ps(ray.InvDirection[2]);
+
+		__m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes[ray.Near[0]]), originX), invX);
+		__m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes[ray.Near[1]]), originY), invY);
+		__m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes[ray.Near[2]]), originZ), invZ);
+		__m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes[ray.Far[0]]), originX), invX);
+		__m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes[ray.Far[1]]), originY), invY);
+		__m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes[ray.Far[2]]), originZ), invZ);
+
+		__m128 enter = _mm_max_ps(_mm_max_ps(nearX, nearY), _mm_max_ps(nearZ, _mm_set1_ps(ray.MinT)));
+		__m128 exit = _mm_min_ps(_mm_min_ps(farX, farY), farZ);
+		exit = _mm_min_ps(_mm_mul_ps(exit, _mm_set1_ps(FarScale)), _mm_set1_ps(maxT));
+
+		_mm_storeu_ps(nearT, enter);
+		return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+#else
+		int mask = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			float enter = ray.MinT;
+			float exit = Infinity;
+			for (int a = 0; a < 3; a++)
+			{
+				float t0 = (boxes[ray.Near[a]][c] - ray.Origin[a]) * ray.InvDirection[a];
+				float t1 = (boxes[ray.Far[a]][c] - ray.Origin[a]) * ray.InvDirection[a];
+				enter = t0 > enter ? t0 : enter;
+				exit = t1 < exit ? t1 : exit;
+			}
+			exit = fminf(exit * FarScale, maxT);
+
+			nearT[c] = enter;
+			if (enter <= exit)
+				mask |= 1 << c;
+		}
+		return mask;
+#endif
+	}
+
+	// --------------------------------------------------------
+	// Watertight ray/triangle test (Woop, Benthin and Wald):
+	// the triangle is moved into a space where the ray runs
+	// straight down z from the origin, so the edge tests are
+	// 2D and give consistent answers on shared edges. Both
+	// sides of the triangle count.
+	// --------------------------------------------------------
+	inline bool IntersectTriangle(const RayData& ray, const float v0[3], const float v1[3], const float v2[3],
+		float maxT, float& t, float& u, float& v)
+	{
+		const int kx = ray.Kx, ky = ray.Ky, kz = ray.Kz;
+		float a[3] = { v0[0] - ray.Origin[0], v0[1] - ray.Origin[1], v0[2] - ray.Origin[2] };
+		float b[3] = { v1[0] - ray.Origin[0], v1[1] - ray.Origin[1], v1[2] - ray.Origin[2] };
+		float c[3] = { v2[0] - ray.Origin[0], v2[1] - ray.Origin[1], v2[2] - ray.Origin[2] };
+
+		float ax = a[kx] - ray.Sx * a[kz];
+		float ay = a[ky] - ray.Sy * a[kz];
+		float bx = b[kx] - ray.Sx * b[kz];
+		float by = b[ky] - ray.Sy * b[kz];
+		float cx = c[kx] - ray.Sx * c[kz];
+		float cy = c[ky] - ray.Sy * c[kz];
+
+		// Scaled barycentrics of each corner (edge functions)
+		float e0 = cx * by - cy * bx;
+		float e1 = ax * cy - ay * cx;
+		float e2 = bx * ay - by * ax;
+
+		// Exactly on an edge in float, so settle it in double
+		if (e0 == 0.0f || e1 == 0.0f || e2 == 0.0f)
+		{
+			e0 = (float)((double)cx * by - (double)cy * bx);
+			e1 = (float)((double)ax * cy - (double)ay * cx);
+			e2 = (float)((double)bx * ay - (double)by * ax);
+		}
+
+		if ((e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) && (e0 > 0.0f || e1 > 0.0f || e2 > 0.0f))
+			return false;
+
+		float determinant = e0 + e1 + e2;
+		if (determinant == 0.0f)
+			return false;
+
+		float az = ray.Sz * a[kz];
+		float bz = ray.Sz * b[kz];
+		float cz = ray.Sz * c[kz];
+		float inverse = 1.0f / determinant;
+		float hitT = (e0 * az + e1 * bz + e2 * cz) * inverse;
+		if (!(hitT >= ray.MinT && hitT <= maxT))
+			return false;
+
+		t = hitT;
+		u = e1 * inverse;
+		v = e2 * inverse;
+		return true;
+	}
+}
+
+TriangleBvh::TriangleBvh() :
+	buildTime(0.0f)
+{
+}
+
+// --------------------------------------------------------
+// Triangles that reference a vertex past vertexCount are
+// left out, rather than read out of bounds
+// --------------------------------------------------------
+void TriangleBvh::Build(const float* positions, size_t vertexCount, size_t positionStride,
+	const unsigned int* indices, size_t indexCount, unsigned int threadCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	nodes.clear();
+	triangles.clear();
+
+	// Copy out every triangle, along with its bounds
+	std::vector<Triangle> source;
+	BuildContext context;
+	source.reserve(indexCount / 3);
+	context.Refs.reserve(indexCount / 3);
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+			continue;
+
+		Triangle triangle = {};
+		float* corners[3] = { triangle.V0, triangle.V1, triangle.V2 };
+		Reference reference = {};
+		EmptyBox(reference.Min, reference.Max);
+		for (int c = 0; c < 3; c++)
+		{
+			const float* p = (const float*)((const char*)positions + positionStride * indices[i + c]);
+			std::copy(p, p + 3, corners[c]);
+			GrowBox(reference.Min, reference.Max, p, p);
+		}
+		for (int a = 0; a < 3; a++)
+			reference.Centroid[a] = (reference.Min[a] + reference.Max[a]) * 0.5f;
+
+		triangle.Index = (uint32_t)(i / 3);
+		reference.Triangle = (uint32_t)source.size();
+		source.push_back(triangle);
+		context.Refs.push_back(reference);
+	}
+
+	uint32_t triangleCount = (uint32_t)source.size();
+	if (triangleCount == 0)
+	{
+		buildTime = 0.0f;
+		return;
+	}
+
+	// One thread per MinTrianglesPerThread triangles, up to the core count
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		size_t byCount = triangleCount / MinTrianglesPerThread;
+		if (byCount < threadCount)
+			threadCount = (unsigned int)byCount;
+	}
+	if (threadCount < 1)
+		threadCount = 1;
+
+	// A binary tree over n triangles never has more than 2n - 1 nodes
+	context.Nodes.resize((size_t)triangleCount * 2 - 1);
+	context.NodeCount = 1;
+	context.SpareThreads = (int)threadCount - 1;
+	RangeBox(context, 0, triangleCount, context.Nodes[0].Min, context.Nodes[0].Max);
+	BuildSubtree(context, 0, 0, triangleCount, 0);
+
+	// Leaves point into the refs, so lay the triangles
+	// out in that same order
+	triangles.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+		triangles[i] = source[context.Refs[i].Triangle];
+
+	// Every other level gets folded away, so about half as many nodes
+	nodes.reserve(context.NodeCount / 2 + 1);
+	CollapseNode(context.Nodes, 0, nodes);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	buildTime = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+bool TriangleBvh::Intersect(const BvhRay& ray, BvhHit& hit) const
+{
+	return Traverse<false>(ray, hit);
+}
+
+bool TriangleBvh::Occluded(const BvhRay& ray) const
+{
+	BvhHit hit;
+	return Traverse<true>(ray, hit);
+}
+
+// --------------------------------------------------------
+// Depth first, visiting the nearest child box first so the
+// closest hit is found early and farther boxes get culled
+// by it. Each stack entry remembers where its box started,
+// so ones that are now past the closest hit are skipped.
+// The nearest child is never pushed, just visited next.
+// --------------------------------------------------------
+template<bool AnyHit>
+bool TriangleBvh::Traverse(const BvhRay& ray, BvhHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	RayData data;
+	SetupRay(ray, data);
+
+	struct StackEntry
+	{
+		uint32_t Child;
+		uint32_t Count;
+		float NearT;
+	};
+	StackEntry stack[StackSize];
+	unsigned int stackSize = 0;
+
+	bool found = false;
+	float closestT = ray.MaxT;
+	StackEntry entry = { 0, 0, ray.MinT };
+	for (;;)
+	{
+		if (entry.Count > 0)
+		{
+			const Triangle* triangle = &triangles[entry.Child];
+			for (uint32_t i = 0; i < entry.Count; i++, triangle++)
+			{
+				float t, u, v;
+				if (!IntersectTriangle(data, triangle->V0, triangle->V1, triangle->V2, closestT, t, u, v))
+					continue;
+				if (AnyHit)
+					return true;
+
+				found = true;
+				closestT = t;
+				hit.T = t;
+				hit.U = u;
+				hit.V = v;
+				hit.Triangle = triangle->Index;
+			}
+		}
+		else
+		{
+			const BvhNode& node = nodes[entry.Child];
+			float nearT[4];
+			int mask = IntersectBoxes(node, data, closestT, nearT);
+
+			// Gather the hit children without branching on each
+			// bit (which is a coin flip for the branch predictor)
+			StackEntry hits[5];
+			unsigned int hitCount = 0;
+			for (int c = 0; c < 4; c++)
+			{
+				hits[hitCount] = { node.Child[c], node.Count[c], nearT[c] };
+				hitCount += (mask >> c) & 1;
+			}
+
+			if (hitCount > 0)
+			{
+				// Farthest first, so the nearest ends up last
+				for (unsigned int i = 1; i < hitCount; i++)
+				{
+					StackEntry child = hits[i];
+					unsigned int j = i;
+					for (; j > 0 && hits[j - 1].NearT < child.NearT; j--)
+						hits[j] = hits[j - 1];
+					hits[j] = child;
+				}
+				for (unsigned int i = 0; i + 1 < hitCount; i++)
+					stack[stackSize++] = hits[i];
+
+				entry = hits[hitCount - 1];
+				continue;
+			}
+		}
+
+		// Nothing more down this path, so back up to the
+		// next box that's still in front of the closest hit
+		do
+		{
+			if (stackSize == 0)
+				return found;
+			entry = stack[--stackSize];
+		} while (entry.NearT > closestT);
+	}
+}
+
+// --------------------------------------------------------
+// Getters
+// --------------------------------------------------------
+bool TriangleBvh::IsBuilt() const { return !nodes.empty(); }
+size_t TriangleBvh::GetNodeCount() const { return nodes.size(); }
+size_t TriangleBvh::GetTriangleCount() const { return triangles.size(); }
+float TriangleBvh::GetBuildTime() const { return buildTime; }
+
+size_t TriangleBvh::GetMemoryBytes() const
+{
+	return nodes.size() * sizeof(BvhNode) + triangles.size() * sizeof(Triangle);
+}
@@ -0,0 +1,130 @@
+/*
+William Duprey
+12/10/24
+Triangle BVH Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// A ray, in the same space as the BVH's triangles. Only
+// hits with MinT <= t <= MaxT count, where the hit point is
+// Origin + t * Direction (so t is only a distance if the
+// direction is unit length).
+// --------------------------------------------------------
+struct BvhRay
+{
+	float Origin[3];
+	float Direction[3];
+	float MinT;
+	float MaxT;
+};
+
+// --------------------------------------------------------
+// The closest hit along a ray. U and V are the barycentric
+// weights of the triangle's second and third vertices (the
+// first's is 1 - U - V). Triangle is the triangle's index
+// in the index buffer the BVH was built from (so its first
+// index is at Triangle * 3).
+// --------------------------------------------------------
+struct BvhHit
+{
+	float T;
+	float U;
+	float V;
+	uint32_t Triangle;
+};
+
+// --------------------------------------------------------
+// Four children's boxes side by side, one array per
+// component, so a ray is tested against all four at once.
+// Each child is either another node (Count 0), a leaf of
+// Count triangles starting at Child, or empty (a box that
+// no ray can hit, Count 0 and Child EmptyChild).
+// --------------------------------------------------------
+struct BvhNode
+{
+	float MinX[4], MinY[4], MinZ[4];
+	float MaxX[4], MaxY[4], MaxZ[4];
+	uint32_t Child[4];
+	uint32_t Count[4];
+};
+
+// --------------------------------------------------------
+// A bounding volume hierarchy over a mesh's triangles, for
+// ray queries against the actual geometry (picking, baking,
+// collision).
+//
+// Built top down as a binary tree, splitting where the
+// binned surface area heuristic says rays will do the least
+// work, on several threads for big meshes. That tree is then
+// collapsed into 4-wide nodes, which are traversed with SSE
+// box tests. Triangles are tested with a watertight
+// intersector, so rays never slip through shared edges.
+//
+// The BVH keeps its own copy of every triangle's corners
+// (in leaf order), and doesn't need the mesh data after
+// Build().
+// --------------------------------------------------------
+class TriangleBvh
+{
+public:
+	// Bins per axis when looking for the best split
+	static constexpr unsigned int BinCount = 16;
+
+	// Leaves never hold more triangles than this, and only
+	// hold more than one if that's cheaper than splitting
+	static constexpr unsigned int MaxLeafTriangles = 8;
+
+	// Subtrees with fewer triangles than this are never
+	// handed off to another thread
+	static constexpr size_t MinTrianglesPerThread = 1 << 14;
+
+	// Marks an unused child slot in a BvhNode
+	static constexpr uint32_t EmptyChild = ~0u;
+
+	TriangleBvh();
+
+	// Replaces the BVH with one over the given triangles.
+	// "positions" are strided like in MeshOptimizer. threadCount
+	// of 0 picks one based on triangle count and cores.
+	void Build(const float* positions, size_t vertexCount, size_t positionStride,
+		const unsigned int* indices, size_t indexCount, unsigned int threadCount = 0);
+
+	// Finds the closest hit, if there's one within the ray's range
+	bool Intersect(const BvhRay& ray, BvhHit& hit) const;
+
+	// Whether anything at all is hit within the ray's range,
+	// which can stop at the first hit found (for shadow rays)
+	bool Occluded(const BvhRay& ray) const;
+
+	// Getters
+	bool IsBuilt() const;
+	size_t GetNodeCount() const;
+	size_t GetTriangleCount() const;
+	size_t GetMemoryBytes() const;
+	float GetBuildTime() const;		// Milliseconds
+
+private:
+	// One triangle's corners, copied out of the mesh so
+	// a leaf's triangles sit next to each other in memory
+	struct Triangle
+	{
+		float V0[3];
+		float V1[3];
+		float V2[3];
+		uint32_t Index;		// In the original index buffer
+	};
+
+	// Shared by Intersect() and Occluded()
+	template<bool AnyHit>
+	bool Traverse(const BvhRay& ray, BvhHit& hit) const;
+
+	// Node 0 is the root (unless there are no triangles)
+	std::vector<BvhNode> nodes;
+	std::vector<Triangle> triangles;
+	float buildTime;
+};
@@ -0,0 +1,54 @@
+/*
+William Duprey
+12/10/24
+Upload Stamp Implementation
+*/
+
+#include "UploadStamp.h"
+
+#include <atomic>
+
+UploadStamps::UploadStamps() : skippedCount(0) { }
+
+// --------------------------------------------------------
+// Shared by everything that hands out ids, and atomic since
+// meshes can be loaded on other threads
+// --------------------------------------------------------
+uint64_t UploadStamps::NextId()
+{
+	static std::atomic<uint64_t> lastId(0);
+	return ++lastId;
+}
+
+// --------------------------------------------------------
+// A shader seen for the first time always needs its values
+// set, whatever they are
+// --------------------------------------------------------
+bool UploadStamps::Restamp(uint64_t shader, const UploadStamp& stamp)
+{
+	auto found = lastUploads.find(shader);
+	if (found == lastUploads.end())
+	{
+		lastUploads.emplace(shader, stamp);
+		return true;
+	}
+
+	UploadStamp& last = found->second;
+	bool same = true;
+	for (int i = 0; i < 3; i++)
+	{
+		same = same && last.Sources[i] == stamp.Sources[i] &&
+			last.Versions[i] == stamp.Versions[i];
+	}
+	if (same)
+	{
+		skippedCount++;
+		return false;
+	}
+
+	last = stamp;
+	return true;
+}
+
+unsigned int UploadStamps::GetSkippedCount() const { return skippedCount; }
+void UploadStamps::ResetSkippedCount() { skippedCount = 0; }
@@ -0,0 +1,50 @@
+/*
+William Duprey
+12/10/24
+Upload Stamp Header
+*/
+
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Where the values in a shader's constant buffer last came
+// from: up to three objects, by id (0 for none), and their
+// versions back then
+// --------------------------------------------------------
+struct UploadStamp
+{
+	uint64_t Sources[3];
+	uint64_t Versions[3];
+};
+
+// --------------------------------------------------------
+// Remembers each shader's last UploadStamp, so values that
+// are already in its buffer aren't set again. Shaders and
+// sources are named by ids from NextId(), which is never
+// the same twice, so something created where a freed object
+// used to be can't be mistaken for it (as it could by
+// address).
+// --------------------------------------------------------
+class UploadStamps
+{
+public:
+	UploadStamps();
+
+	// A new id, bigger than every one before it. Never 0.
+	static uint64_t NextId();
+
+	// Records where a shader's values are about to come from.
+	// Returns false if they already came from there, with the
+	// same versions, meaning there's nothing to set.
+	bool Restamp(uint64_t shader, const UploadStamp& stamp);
+
+	// Restamp() calls that returned false since the last reset
+	unsigned int GetSkippedCount() const;
+	void ResetSkippedCount();
+
+private:
+	std::unordered_map<uint64_t, UploadStamp> lastUploads;
+	unsigned int skippedCount;
+};
@@ -0,0 +1,201 @@
+/*
+William Duprey
+12/10/24
+Vertex Packing Implementation
+*/
+
+#include "VertexPacking.h"
+
+#include <cmath>
+#include <cstring>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	int16_t FloatToSnorm16(float value)
+	{
+		value = fminf(fmaxf(value, -1.0f), 1.0f);
+		return (int16_t)lroundf(value * 32767.0f);
+	}
+
+	float Snorm16ToFloat(int16_t value)
+	{
+		return fmaxf(value / 32767.0f, -1.0f);
+	}
+}
+
+// --------------------------------------------------------
+// Float to half conversion, done on the bits so rounding,
+// subnormals, infinity and NaN all behave like hardware
+// --------------------------------------------------------
+uint16_t VertexPacking::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	// Infinity stays infinity, NaN stays (some) NaN
+	if (exponent == 0xFF)
+		return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+	// Rebias from float (127) to half (15)
+	int halfExponent = (int)exponent - 127 + 15;
+	if (halfExponent >= 31)
+		return (uint16_t)(sign | 0x7C00);
+
+	// Too small for a normal half: becomes subnormal or zero
+	if (halfExponent <= 0)
+	{
+		if (halfExponent < -10)
+			return (uint16_t)sign;
+
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return (uint16_t)(sign | half);
+	}
+
+	// Normal half. Rounding up may carry into the exponent,
+	// which is still correct (and overflows to infinity)
+	uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+	return (uint16_t)(sign | half);
+}
+
+float VertexPacking::HalfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	// Subnormals (and zero) are just mantissa * 2^-24
+	if (exponent == 0)
+	{
+		float magnitude = mantissa / 16777216.0f;
+		return sign ? -magnitude : magnitude;
+	}
+
+	uint32_t bits = (exponent == 31)
+		? sign | 0x7F800000 | (mantissa << 13)
+		: sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+// --------------------------------------------------------
+// Projects the vector onto the octahedron |x|+|y|+|z| = 1,
+// then folds the lower half over the upper half's corners
+// so the whole sphere fits in a [-1, 1] square
+// --------------------------------------------------------
+void VertexPacking::EncodeOctahedral(const float direction[3], int16_t encoded[2])
+{
+	float length = fabsf(direction[0]) + fabsf(direction[1]) + fabsf(direction[2]);
+	if (length == 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x = direction[0] / length;
+	float y = direction[1] / length;
+	if (direction[2] < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = FloatToSnorm16(x);
+	encoded[1] = FloatToSnorm16(y);
+}
+
+void VertexPacking::DecodeOctahedral(const int16_t encoded[2], float direction[3])
+{
+	float x = Snorm16ToFloat(encoded[0]);
+	float y = Snorm16ToFloat(encoded[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower half
+	float t = fmaxf(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float length = sqrtf(x * x + y * y + z * z);
+	direction[0] = x / length;
+	direction[1] = y / length;
+	direction[2] = z / length;
+}
+
+void VertexPacking::GetPositionDequantize(const float boundsMin[3], const float boundsMax[3],
+	float scale[3], float offset[3])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		scale[i] = (boundsMax[i] - boundsMin[i]) / 65535.0f;
+		offset[i] = boundsMin[i];
+	}
+}
+
+PackedVertex VertexPacking::Pack(const float position[3], const float normal[3],
+	const float tangent[3], const float uv[2],
+	const float boundsMin[3], const float boundsMax[3])
+{
+	PackedVertex packed = {};
+	for (int i = 0; i < 3; i++)
+	{
+		// Flat axes (like a quad's) have nothing to quantize
+		float extent = boundsMax[i] - boundsMin[i];
+		float t = extent > 0.0f ? (position[i] - boundsMin[i]) / extent : 0.0f;
+		t = fminf(fmaxf(t, 0.0f), 1.0f);
+		packed.Position[i] = (uint16_t)lroundf(t * 65535.0f);
+	}
+
+	EncodeOctahedral(normal, packed.Normal);
+	EncodeOctahedral(tangent, packed.Tangent);
+	packed.UV[0] = FloatToHalf(uv[0]);
+	packed.UV[1] = FloatToHalf(uv[1]);
+	return packed;
+}
+
+void VertexPacking::Unpack(const PackedVertex& packed,
+	const float boundsMin[3], const float boundsMax[3],
+	float position[3], float normal[3], float tangent[3], float uv[2])
+{
+	float scale[3];
+	float offset[3];
+	GetPositionDequantize(boundsMin, boundsMax, scale, offset);
+	for (int i = 0; i < 3; i++)
+		position[i] = offset[i] + packed.Position[i] * scale[i];
+
+	DecodeOctahedral(packed.Normal, normal);
+	DecodeOctahedral(packed.Tangent, tangent);
+	uv[0] = HalfToFloat(packed.UV[0]);
+	uv[1] = HalfToFloat(packed.UV[1]);
+}
+
+void VertexPacking::ExtractPositions(void* positions, const void* vertices, size_t count,
+	size_t vertexStride, size_t positionStride)
+{
+	char* destination = (char*)positions;
+	const char* source = (const char*)vertices;
+	for (size_t i = 0; i < count; i++)
+		memcpy(destination + i * positionStride, source + i * vertexStride, positionStride);
+}
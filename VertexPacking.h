@@ -0,0 +1,78 @@
+/*
+William Duprey
+12/10/24
+Vertex Packing Header
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// A compact alternative to Vertex (20 bytes instead of 44).
+// Must match PackedVertexShaderInput in ShaderIncludes.hlsli,
+// which reads these as 32-bit uints and decodes by hand.
+// --------------------------------------------------------
+struct PackedVertex
+{
+	uint16_t Position[4];	// Unorm16 within the mesh bounds (w is padding)
+	int16_t Normal[2];		// Octahedral encoded, snorm16
+	int16_t Tangent[2];		// Octahedral encoded, snorm16
+	uint16_t UV[2];			// Half floats
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match the HLSL layout");
+static_assert(offsetof(PackedVertex, Normal) == 8 && offsetof(PackedVertex, Tangent) == 12 &&
+	offsetof(PackedVertex, UV) == 16, "PackedVertex must match the HLSL layout");
+
+// The position stream (see ExtractPositions) is the front of
+// each vertex, read by PackedPositionOnlyVertexShaderInput
+static_assert(offsetof(PackedVertex, Position) == 0 && sizeof(PackedVertex::Position) == 8,
+	"PackedVertex must start with its 8 byte position");
+
+// --------------------------------------------------------
+// CPU side encoding and decoding for PackedVertex. Decoding
+// matches what the packed vertex shader does, so the error
+// bounds below hold for what actually gets drawn.
+// --------------------------------------------------------
+namespace VertexPacking
+{
+	// Worst case position error per axis, as a fraction of the
+	// mesh bounds' size along that axis. Rounding is half a step,
+	// float math adds a tiny bit more, so this is a whole step.
+	constexpr float PositionError = 1.0f / 65535.0f;
+
+	// Worst case angle between a unit vector and its
+	// decoded octahedral encoding, in degrees
+	constexpr float DirectionErrorDegrees = 0.005f;
+
+	// Worst case relative error of a half float (normal range)
+	constexpr float HalfRelativeError = 1.0f / 2048.0f;
+
+	// IEEE half floats, rounding to nearest even
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+
+	// Octahedral mapping of a unit vector to two snorm16s.
+	// A zero vector encodes as (0, 0), which decodes to +Z.
+	void EncodeOctahedral(const float direction[3], int16_t encoded[2]);
+	void DecodeOctahedral(const int16_t encoded[2], float direction[3]);
+
+	// Scale and offset that turn a unorm16 position back into
+	// object space: position = offset + quantized * scale
+	void GetPositionDequantize(const float boundsMin[3], const float boundsMax[3],
+		float scale[3], float offset[3]);
+
+	// Full vertex encode / decode. Bounds must contain the position.
+	PackedVertex Pack(const float position[3], const float normal[3],
+		const float tangent[3], const float uv[2],
+		const float boundsMin[3], const float boundsMax[3]);
+	void Unpack(const PackedVertex& packed,
+		const float boundsMin[3], const float boundsMax[3],
+		float position[3], float normal[3], float tangent[3], float uv[2]);
+
+	// Copies the first positionStride bytes of each of "count"
+	// vertices into a tight array, for a depth-only position
+	// stream. Works for any vertex that starts with its position.
+	void ExtractPositions(void* positions, const void* vertices, size_t count,
+		size_t vertexStride, size_t positionStride);
+}
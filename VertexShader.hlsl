@@ -18,6 +18,16 @@ cbuffer ExternalData : register(b0)
     
     matrix lightView;
     matrix lightProjection;
+
+    // Nonzero when the world matrix has the same scale on every
+    // axis, and worldInvTranspose isn't set
+    int uniformScale;
+
+#ifdef PACKED_VERTICES
+    // Turns quantized positions back into object space
+    float3 positionScale;
+    float3 positionOffset;
+#endif
 }
 
 // --------------------------------------------------------
@@ -26,9 +36,17 @@ cbuffer ExternalData : register(b0)
 // - Input is exactly one vertex worth of data (defined by a struct)
 // - Output is a single struct of data to pass down the pipeline
 // - Named "main" because that's the default the shader compiler looks for
+// - When compiled with PACKED_VERTICES (see PackedVertexShader.hlsl)
+//   the input is a PackedVertex, unpacked before anything else
 // --------------------------------------------------------
+#ifdef PACKED_VERTICES
+VertexToPixel main(PackedVertexShaderInput packed)
+{
+    VertexShaderInput input = UnpackVertex(packed, positionScale, positionOffset);
+#else
 VertexToPixel main(VertexShaderInput input)
 {
+#endif
     // Set up output struct
     VertexToPixel output;
 
@@ -45,8 +63,11 @@ VertexToPixel main(VertexShaderInput input)
     matrix wvp = mul(projection, mul(view, world));
     output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
 
-    // Properly transform normals to account for non-uniform scaling
-    output.normal = mul((float3x3)worldInvTranspose, input.normal);
+    // Properly transform normals to account for non-uniform scaling.
+    // Uniform scaling doesn't bend them, so the world matrix does
+    // (the pixel shader normalizes them either way).
+    float3x3 normalMatrix = uniformScale ? (float3x3)world : (float3x3)worldInvTranspose;
+    output.normal = mul(normalMatrix, input.normal);
     output.tangent = mul((float3x3)world, input.tangent);
     output.uv = input.uv;   
     
@@ -0,0 +1,195 @@
+/*
+William Duprey
+12/10/24
+Bench Helpers Header
+*/
+
+#pragma once
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// The repo's Assets folder, so benchmarks can load the
+// bundled models from any working directory
+#ifndef BENCH_ASSETS
+#define BENCH_ASSETS "Assets"
+#endif
+
+// --------------------------------------------------------
+// A synthetic mesh, laid out like Mesh's Vertex (position,
+// normal, tangent, uv: 11 floats per vertex)
+// --------------------------------------------------------
+struct BenchMesh
+{
+	static constexpr size_t Stride = 11;
+	std::vector<float> Vertices;
+	std::vector<unsigned int> Indices;
+
+	size_t VertexCount() const { return Vertices.size() / Stride; }
+};
+
+// --------------------------------------------------------
+// Timing for the portable module benchmarks
+// --------------------------------------------------------
+namespace Bench
+{
+	// --------------------------------------------------------
+	// Best of "runs" runs of "work", in milliseconds. The best
+	// run is the one least disturbed by everything else going
+	// on, so it's the most repeatable.
+	// --------------------------------------------------------
+	template <typename Work>
+	double BestOf(int runs, Work work)
+	{
+		double best = 0.0;
+		for (int run = 0; run < runs; run++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			work();
+			double elapsed = std::chrono::duration<double, std::milli>(
+				std::chrono::high_resolution_clock::now() - start).count();
+			best = run == 0 ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	}
+
+	// --------------------------------------------------------
+	// A lumpy sphere of rings x segments quads, with its
+	// triangles in plain row order (like most exporters write
+	// them) and clockwise, the D3D default
+	// --------------------------------------------------------
+	inline BenchMesh MakeSphere(unsigned int rings, unsigned int segments)
+	{
+		const float Pi = 3.14159265f;
+		BenchMesh mesh;
+		for (unsigned int r = 0; r <= rings; r++)
+		{
+			float v = (float)r / rings;
+			float theta = v * Pi;
+			for (unsigned int s = 0; s <= segments; s++)
+			{
+				float u = (float)s / segments;
+				float phi = u * 2.0f * Pi;
+				float nx = std::sin(theta) * std::cos(phi);
+				float ny = std::cos(theta);
+				float nz = std::sin(theta) * std::sin(phi);
+				float radius = 1.0f + 0.05f * std::sin(phi * 7.0f) * std::sin(theta * 5.0f);
+				float vertex[BenchMesh::Stride] =
+				{
+					nx * radius, ny * radius, nz * radius,
+					nx, ny, nz,
+					-std::sin(phi), 0.0f, std::cos(phi),
+					u, v
+				};
+				mesh.Vertices.insert(mesh.Vertices.end(), vertex, vertex + BenchMesh::Stride);
+			}
+		}
+
+		for (unsigned int r = 0; r < rings; r++)
+			for (unsigned int s = 0; s < segments; s++)
+			{
+				unsigned int a = r * (segments + 1) + s;
+				unsigned int b = a + 1;
+				unsigned int c = a + segments + 1;
+				unsigned int d = c + 1;
+				unsigned int quad[6] = { a, b, c, b, d, c };
+				mesh.Indices.insert(mesh.Indices.end(), quad, quad + 6);
+			}
+		return mesh;
+	}
+
+	// --------------------------------------------------------
+	// Writes the mesh as an .obj, the way Blender exports one:
+	// six decimals, and v/vt/vn of a corner all the same index.
+	// Returns the file's size, or 0 if it couldn't be written.
+	// --------------------------------------------------------
+	inline size_t WriteObj(const char* path, const BenchMesh& mesh)
+	{
+		FILE* file = std::fopen(path, "wb");
+		if (!file)
+			return 0;
+
+		std::vector<char> buffer(1 << 16);
+		std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+		for (size_t i = 0; i < mesh.VertexCount(); i++)
+		{
+			const float* v = &mesh.Vertices[i * BenchMesh::Stride];
+			std::fprintf(file, "v %.6f %.6f %.6f\n", v[0], v[1], v[2]);
+			std::fprintf(file, "vt %.6f %.6f\n", v[9], v[10]);
+			std::fprintf(file, "vn %.4f %.4f %.4f\n", v[3], v[4], v[5]);
+		}
+		for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+		{
+			unsigned int a = mesh.Indices[i] + 1;
+			unsigned int b = mesh.Indices[i + 1] + 1;
+			unsigned int c = mesh.Indices[i + 2] + 1;
+			std::fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+		}
+
+		long size = std::ftell(file);
+		bool ok = std::fclose(file) == 0;
+		return ok && size > 0 ? (size_t)size : 0;
+	}
+
+	// Paths of the bundled .obj models
+	inline std::vector<std::string> BundledModels()
+	{
+		const char* names[] = { "cube", "cylinder", "helix", "quad", "quad_double_sided", "sphere", "torus" };
+		std::vector<std::string> paths;
+		for (const char* name : names)
+			paths.push_back(std::string(BENCH_ASSETS) + "/Models/" + name + ".obj");
+		return paths;
+	}
+
+	// --------------------------------------------------------
+	// Loads an .obj the way Mesh does: welded into shared
+	// vertices, flipped to left-handed (Z, V and winding).
+	// Tangents are left at zero.
+	// --------------------------------------------------------
+	inline bool LoadObj(const char* path, BenchMesh& mesh)
+	{
+		ObjData obj;
+		if (!ObjParser::ParseFile(path, obj) || obj.Corners.empty())
+			return false;
+
+		std::vector<ObjIndex> unique;
+		ObjParser::WeldCorners(obj.Corners, unique, mesh.Indices);
+		mesh.Vertices.assign(unique.size() * BenchMesh::Stride, 0.0f);
+		for (size_t i = 0; i < unique.size(); i++)
+		{
+			float* v = &mesh.Vertices[i * BenchMesh::Stride];
+			const ObjIndex& corner = unique[i];
+			if (corner.Position >= 0)
+				std::copy_n(&obj.Positions[(size_t)corner.Position * 3], 3, v);
+			if (corner.Normal >= 0)
+				std::copy_n(&obj.Normals[(size_t)corner.Normal * 3], 3, v + 3);
+			if (corner.UV >= 0)
+				std::copy_n(&obj.UVs[(size_t)corner.UV * 2], 2, v + 9);
+			v[2] = -v[2];
+			v[5] = -v[5];
+			v[10] = 1.0f - v[10];
+		}
+		for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+			std::swap(mesh.Indices[i + 1], mesh.Indices[i + 2]);
+		return true;
+	}
+
+	// "Assets/Models/helix.obj" -> "helix"
+	inline std::string ModelName(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+		return name.substr(0, name.find_last_of('.'));
+	}
+
+	// Megabytes per second for "bytes" in "milliseconds"
+	inline double Throughput(double bytes, double milliseconds)
+	{
+		return bytes / (1024.0 * 1024.0) / (milliseconds / 1000.0);
+	}
+}
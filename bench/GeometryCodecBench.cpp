@@ -0,0 +1,95 @@
+/*
+William Duprey
+12/10/24
+Geometry Codec Benchmark
+*/
+
+#include "GeometryCodec.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+#include "BenchHelpers.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// --------------------------------------------------------
+// Decode throughput of a mesh the way it sits in a cache:
+// packed vertices and 32 bit indices, after vertex cache and
+// vertex fetch optimization. Compared against a plain copy
+// of the same bytes, which is all an uncompressed cache load
+// does once the file is in memory.
+// --------------------------------------------------------
+int main()
+{
+	const int Runs = 10;
+	BenchMesh mesh = Bench::MakeSphere(1024, 1024);
+	size_t vertexCount = mesh.VertexCount();
+	std::vector<unsigned int>& indices = mesh.Indices;
+
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.data(), indices.size(), vertexCount);
+	std::vector<unsigned int> remap(vertexCount);
+	vertexCount = MeshOptimizer::OptimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertexCount);
+	std::vector<float> remapped(vertexCount * BenchMesh::Stride);
+	MeshOptimizer::RemapVertexBuffer(remapped.data(), mesh.Vertices.data(), mesh.VertexCount(),
+		sizeof(float) * BenchMesh::Stride, remap.data());
+	MeshOptimizer::RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+
+	float boundsMin[3] = { -1.1f, -1.1f, -1.1f };
+	float boundsMax[3] = { 1.1f, 1.1f, 1.1f };
+	std::vector<PackedVertex> packed(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* v = &remapped[i * BenchMesh::Stride];
+		packed[i] = VertexPacking::Pack(v, v + 3, v + 6, v + 9, boundsMin, boundsMax);
+	}
+
+	std::vector<unsigned char> vertexData;
+	std::vector<unsigned char> indexData;
+	double encodeVertices = Bench::BestOf(1, [&]()
+	{
+		GeometryCodec::EncodeVertices(vertexData, packed.data(), vertexCount, sizeof(PackedVertex));
+	});
+	double encodeIndices = Bench::BestOf(1, [&]()
+	{
+		GeometryCodec::EncodeIndices(indexData, indices.data(), indices.size(), sizeof(unsigned int));
+	});
+
+	size_t vertexBytes = sizeof(PackedVertex) * vertexCount;
+	size_t indexBytes = sizeof(unsigned int) * indices.size();
+	std::vector<PackedVertex> decodedVertices(vertexCount);
+	std::vector<unsigned int> decodedIndices(indices.size());
+	bool ok = true;
+
+	double decodeVertices = Bench::BestOf(Runs, [&]()
+	{
+		ok &= GeometryCodec::DecodeVertices(decodedVertices.data(), vertexCount, sizeof(PackedVertex),
+			vertexData.data(), vertexData.size());
+	});
+	double decodeIndices = Bench::BestOf(Runs, [&]()
+	{
+		ok &= GeometryCodec::DecodeIndices(decodedIndices.data(), indices.size(), sizeof(unsigned int),
+			vertexCount, indexData.data(), indexData.size());
+	});
+	double copyVertices = Bench::BestOf(Runs, [&]()
+	{
+		std::memcpy(decodedVertices.data(), packed.data(), vertexBytes);
+	});
+	double copyIndices = Bench::BestOf(Runs, [&]()
+	{
+		std::memcpy(decodedIndices.data(), indices.data(), indexBytes);
+	});
+
+	std::printf("%zu vertices, %zu triangles\n", vertexCount, indices.size() / 3);
+	std::printf("Vertices: %.1f MB -> %.1f MB (%.1f%%), encode %.1f ms, decode %.2f ms (%.0f MB/s), copy %.0f MB/s\n",
+		vertexBytes / 1048576.0, vertexData.size() / 1048576.0, 100.0 * vertexData.size() / vertexBytes,
+		encodeVertices, decodeVertices, Bench::Throughput((double)vertexBytes, decodeVertices),
+		Bench::Throughput((double)vertexBytes, copyVertices));
+	std::printf("Indices:  %.1f MB -> %.1f MB (%.1f%%), encode %.1f ms, decode %.2f ms (%.0f MB/s), copy %.0f MB/s\n",
+		indexBytes / 1048576.0, indexData.size() / 1048576.0, 100.0 * indexData.size() / indexBytes,
+		encodeIndices, decodeIndices, Bench::Throughput((double)indexBytes, decodeIndices),
+		Bench::Throughput((double)indexBytes, copyIndices));
+	if (!ok)
+		std::printf("Decoding failed!\n");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+/*
+William Duprey
+12/10/24
+glTF Parser Benchmark
+*/
+
+#include "GltfParser.h"
+#include "MappedFile.h"
+#include "BenchHelpers.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	template <typename T>
+	void Append(std::vector<unsigned char>& bytes, T value)
+	{
+		const unsigned char* first = (const unsigned char*)&value;
+		bytes.insert(bytes.end(), first, first + sizeof(T));
+	}
+
+	// --------------------------------------------------------
+	// Writes a loaded (left-handed) mesh back out as a .glb of
+	// the same geometry: one interleaved vertex buffer view and
+	// one index view, right-handed again like the .obj was.
+	// "quantized" stores normals as normalized bytes and UVs as
+	// normalized shorts (KHR_mesh_quantization), as a glTF
+	// pipeline tool would, though UVs that wrap outside 0 to 1
+	// stay floats. Returns the file's size, or 0.
+	// --------------------------------------------------------
+	size_t WriteGlb(const char* path, const BenchMesh& mesh, bool quantized)
+	{
+		size_t vertexCount = mesh.VertexCount();
+		bool shortIndices = vertexCount <= 0xFFFF;
+		bool quantizedUVs = quantized;
+		for (size_t i = 0; i < vertexCount; i++)
+			for (int a = 9; a < 11; a++)
+				quantizedUVs = quantizedUVs && mesh.Vertices[i * BenchMesh::Stride + a] >= 0.0f &&
+					mesh.Vertices[i * BenchMesh::Stride + a] <= 1.0f;
+		size_t stride = 12 + (quantized ? 4 : 12) + (quantizedUVs ? 4 : 8);
+
+		std::vector<unsigned char> bin;
+		float low[3] = { INFINITY, INFINITY, INFINITY };
+		float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			const float* v = &mesh.Vertices[i * BenchMesh::Stride];
+			float position[3] = { v[0], v[1], -v[2] };
+			float normal[3] = { v[3], v[4], -v[5] };
+			for (int a = 0; a < 3; a++)
+			{
+				Append(bin, position[a]);
+				low[a] = std::fmin(low[a], position[a]);
+				high[a] = std::fmax(high[a], position[a]);
+			}
+			if (quantized)
+			{
+				for (int a = 0; a < 3; a++)
+					Append(bin, (int8_t)std::lround(std::fmax(-1.0f, std::fmin(1.0f, normal[a])) * 127.0f));
+				Append(bin, (int8_t)0);
+			}
+			else
+			{
+				for (int a = 0; a < 3; a++)
+					Append(bin, normal[a]);
+			}
+
+			for (int a = 9; a < 11; a++)
+			{
+				if (quantizedUVs)
+					Append(bin, (uint16_t)std::lround(v[a] * 65535.0f));
+				else
+					Append(bin, v[a]);
+			}
+		}
+		size_t vertexBytes = bin.size();
+
+		// Winding flips back along with the handedness
+		for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+		{
+			unsigned int triangle[3] = { mesh.Indices[i], mesh.Indices[i + 2], mesh.Indices[i + 1] };
+			for (unsigned int index : triangle)
+			{
+				if (shortIndices)
+					Append(bin, (uint16_t)index);
+				else
+					Append(bin, (uint32_t)index);
+			}
+		}
+		size_t indexBytes = bin.size() - vertexBytes;
+		while (bin.size() % 4 != 0)
+			bin.push_back(0);
+
+		char json[2048];
+		std::snprintf(json, sizeof(json),
+			"{\"asset\":{\"version\":\"2.0\"},%s"
+			"\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+			"\"buffers\":[{\"byteLength\":%zu}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteLength\":%zu,\"byteStride\":%zu,\"target\":34962},"
+			"{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34963}],"
+			"\"accessors\":["
+			"{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\","
+			"\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]},"
+			"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":%d,\"normalized\":%s,\"count\":%zu,\"type\":\"VEC3\"},"
+			"{\"bufferView\":0,\"byteOffset\":%d,\"componentType\":%d,\"normalized\":%s,\"count\":%zu,\"type\":\"VEC2\"},"
+			"{\"bufferView\":1,\"componentType\":%d,\"count\":%zu,\"type\":\"SCALAR\"}]}",
+			quantized ? "\"extensionsUsed\":[\"KHR_mesh_quantization\"],"
+				"\"extensionsRequired\":[\"KHR_mesh_quantization\"]," : "",
+			bin.size(), vertexBytes, stride, vertexBytes, indexBytes,
+			vertexCount, low[0], low[1], low[2], high[0], high[1], high[2],
+			quantized ? 5120 : 5126, quantized ? "true" : "false", vertexCount,
+			quantized ? 16 : 24, quantizedUVs ? 5123 : 5126, quantizedUVs ? "true" : "false", vertexCount,
+			shortIndices ? 5123 : 5125, mesh.Indices.size());
+		std::string jsonChunk = json;
+		while (jsonChunk.size() % 4 != 0)
+			jsonChunk += ' ';
+
+		std::vector<unsigned char> file;
+		Append(file, (uint32_t)0x46546C67);		// "glTF"
+		Append(file, (uint32_t)2);
+		Append(file, (uint32_t)(12 + 8 + jsonChunk.size() + 8 + bin.size()));
+		Append(file, (uint32_t)jsonChunk.size());
+		Append(file, (uint32_t)0x4E4F534A);		// "JSON"
+		file.insert(file.end(), jsonChunk.begin(), jsonChunk.end());
+		Append(file, (uint32_t)bin.size());
+		Append(file, (uint32_t)0x004E4942);		// "BIN"
+		file.insert(file.end(), bin.begin(), bin.end());
+
+		FILE* out = std::fopen(path, "wb");
+		if (!out)
+			return 0;
+		bool ok = std::fwrite(file.data(), 1, file.size(), out) == file.size();
+		ok = std::fclose(out) == 0 && ok;
+		return ok ? file.size() : 0;
+	}
+
+	// --------------------------------------------------------
+	// Loads a .glb the way Mesh::LoadGlb() does, up to where
+	// it hands off to the same steps as an .obj: mapped, read
+	// in place through the accessors, node transforms applied
+	// and flipped to left-handed. Tangents are left at zero.
+	// --------------------------------------------------------
+	bool LoadGlb(const char* path, BenchMesh& mesh)
+	{
+		MappedFile source(path);
+		std::vector<GltfPrimitive> primitives;
+		if (!GltfParser::ParseMemory(source.GetData(), source.GetSize(), primitives))
+			return false;
+
+		mesh = BenchMesh();
+		for (const GltfPrimitive& primitive : primitives)
+		{
+			// Row-major for row vectors; normals only get the 3x3
+			// part, which is right for the rigid transforms here
+			const float* m = primitive.Transform;
+			auto transform = [&](float* v, bool point)
+				{
+					float x = v[0], y = v[1], z = v[2];
+					for (int c = 0; c < 3; c++)
+						v[c] = x * m[c] + y * m[4 + c] + z * m[8 + c] + (point ? m[12 + c] : 0.0f);
+				};
+
+			size_t baseVertex = mesh.VertexCount();
+			mesh.Vertices.resize(mesh.Vertices.size() + primitive.Positions.Count * BenchMesh::Stride, 0.0f);
+			for (size_t i = 0; i < primitive.Positions.Count; i++)
+			{
+				float* v = &mesh.Vertices[(baseVertex + i) * BenchMesh::Stride];
+				primitive.Positions.Read(i, v, 3);
+				transform(v, true);
+				if (primitive.Normals.Data)
+				{
+					primitive.Normals.Read(i, v + 3, 3);
+					transform(v + 3, false);
+					float length = std::sqrt(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]);
+					if (length > 0.0f)
+						for (int a = 3; a < 6; a++)
+							v[a] /= length;
+				}
+				if (primitive.UVs.Data)
+					primitive.UVs.Read(i, v + 9, 2);
+				v[2] = -v[2];
+				v[5] = -v[5];
+			}
+
+			size_t firstIndex = mesh.Indices.size();
+			GltfParser::ReadTriangles(primitive, (unsigned int)baseVertex, mesh.Indices);
+			float determinant = m[0] * (m[5] * m[10] - m[6] * m[9]) -
+				m[1] * (m[4] * m[10] - m[6] * m[8]) + m[2] * (m[4] * m[9] - m[5] * m[8]);
+			if (determinant > 0.0f)
+			{
+				for (size_t i = firstIndex; i + 2 < mesh.Indices.size(); i += 3)
+					std::swap(mesh.Indices[i + 1], mesh.Indices[i + 2]);
+			}
+		}
+		return !mesh.Indices.empty();
+	}
+
+	// --------------------------------------------------------
+	// Whether a .glb load gave back the .obj load's geometry:
+	// same indices and positions, and normals and UVs within
+	// what quantizing them could have moved them. The .obj's
+	// normals have four decimals, so they're only unit length
+	// to about 1e-4, and the .glb path normalizes them.
+	// --------------------------------------------------------
+	bool SameGeometry(const BenchMesh& expected, const BenchMesh& actual, bool quantized)
+	{
+		if (expected.Indices != actual.Indices || expected.Vertices.size() != actual.Vertices.size())
+			return false;
+
+		float normalTolerance = quantized ? 1.0f / 127.0f : 1e-4f;
+		float uvTolerance = quantized ? 1.0f / 65535.0f : 0.0f;
+		for (size_t i = 0; i < expected.Vertices.size(); i++)
+		{
+			size_t member = i % BenchMesh::Stride;
+			float difference = std::fabs(expected.Vertices[i] - actual.Vertices[i]);
+			float tolerance = member < 3 ? 0.0f : member < 6 ? normalTolerance : member < 9 ? 0.0f : uvTolerance;
+			if (!(difference <= tolerance))
+				return false;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Converts one .obj to float and quantized .glb files,
+	// times loading each of the three, checks they all give
+	// the same geometry, and prints a row
+	// --------------------------------------------------------
+	bool BenchFile(const char* objPath, const char* label)
+	{
+		BenchMesh expected;
+		if (!Bench::LoadObj(objPath, expected))
+		{
+			std::printf("%-18s couldn't be loaded\n", label);
+			return false;
+		}
+
+		MappedFile obj(objPath);
+		size_t objBytes = obj.GetSize();
+		obj.Close();
+		const char* glbPaths[2] = { "GltfParserBench.glb", "GltfParserBenchQuantized.glb" };
+		size_t glbBytes[2] = {};
+		for (int q = 0; q < 2; q++)
+			glbBytes[q] = WriteGlb(glbPaths[q], expected, q == 1);
+		if (glbBytes[0] == 0 || glbBytes[1] == 0)
+		{
+			std::printf("%-18s couldn't write the .glb files\n", label);
+			return false;
+		}
+
+		// Small files are loaded many times per run, so the
+		// timer has something to measure
+		int repeats = (int)std::max<size_t>(1, (4 << 20) / objBytes);
+		int runs = objBytes > (16 << 20) ? 3 : 5;
+		BenchMesh mesh;
+		bool ok = true;
+		double objTime = Bench::BestOf(runs, [&]()
+			{
+				for (int r = 0; r < repeats; r++)
+				{
+					mesh = BenchMesh();
+					ok &= Bench::LoadObj(objPath, mesh);
+				}
+			}) / repeats;
+
+		double glbTime[2] = {};
+		for (int q = 0; q < 2; q++)
+		{
+			glbTime[q] = Bench::BestOf(runs, [&]()
+				{
+					for (int r = 0; r < repeats; r++)
+						ok &= LoadGlb(glbPaths[q], mesh);
+				}) / repeats;
+			ok &= SameGeometry(expected, mesh, q == 1);
+			std::remove(glbPaths[q]);
+		}
+
+		std::printf("%-18s %8.2f %8.2f %8.2f %9.3f %9.3f %9.3f %7.1fx %7.1fx  %s\n", label,
+			objBytes / 1048576.0, glbBytes[0] / 1048576.0, glbBytes[1] / 1048576.0,
+			objTime, glbTime[0], glbTime[1], objTime / glbTime[0], objTime / glbTime[1],
+			ok ? "same" : "DIFFERENT");
+		return ok;
+	}
+}
+
+// --------------------------------------------------------
+// Load time of the same geometry from .obj and from .glb
+// (plain floats, and with quantized normals and UVs), up to
+// the point where Mesh sends either one down the same
+// optimize, tangent and buffer path. Runs on the bundled
+// models and a large synthetic sphere, or on the .obj
+// paths passed in.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::printf("%-18s %8s %8s %8s %9s %9s %9s %8s %8s\n", "", "obj MB", "glb MB", "quant MB",
+		"obj ms", "glb ms", "quant ms", "glb", "quant");
+
+	bool ok = true;
+	if (argc > 1)
+	{
+		for (int i = 1; i < argc; i++)
+			ok &= BenchFile(argv[i], argv[i]);
+		return ok ? 0 : 1;
+	}
+
+	for (const std::string& path : Bench::BundledModels())
+		ok &= BenchFile(path.c_str(), Bench::ModelName(path).c_str());
+
+	const char* largePath = "GltfParserBench.obj";
+	if (Bench::WriteObj(largePath, Bench::MakeSphere(384, 768)) == 0)
+	{
+		std::printf("Couldn't write %s\n", largePath);
+		return 1;
+	}
+	ok &= BenchFile(largePath, "synthetic sphere");
+	std::remove(largePath);
+	return ok ? 0 : 1;
+}
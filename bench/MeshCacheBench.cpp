@@ -0,0 +1,236 @@
+/*
+William Duprey
+12/10/24
+Mesh Cache Benchmark
+*/
+
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "TangentGenerator.h"
+#include "BenchHelpers.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const size_t VertexBytes = sizeof(float) * BenchMesh::Stride;
+
+	// --------------------------------------------------------
+	// Evicts a file from the OS page cache, so the next read
+	// has to go to the disk. Only Linux can do this for one
+	// file without admin rights; elsewhere it returns false
+	// and the cold column is left out.
+	// --------------------------------------------------------
+	bool DropFromPageCache(const char* path)
+	{
+#ifdef __linux__
+		int descriptor = open(path, O_RDONLY);
+		if (descriptor < 0)
+			return false;
+
+		// Dirty pages can't be dropped, so write them out first
+		bool ok = fdatasync(descriptor) == 0 &&
+			posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(descriptor);
+		return ok;
+#else
+		(void)path;
+		return false;
+#endif
+	}
+
+	// --------------------------------------------------------
+	// Everything Mesh does on a load without a cache: parse and
+	// weld the .obj, optimize for the GPU, calculate tangents,
+	// then write the cache for next time. Vertices stay full
+	// precision floats (no VertexPacking), since that's
+	// Mesh's default.
+	// --------------------------------------------------------
+	bool FullLoad(const char* objPath, const char* cachePath, bool compress)
+	{
+		uint64_t sourceHash = 0;
+		BenchMesh mesh;
+		if (!MeshCache::HashFile(objPath, sourceHash) || !Bench::LoadObj(objPath, mesh))
+			return false;
+
+		std::vector<unsigned int>& indices = mesh.Indices;
+		size_t vertexCount = mesh.VertexCount();
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.data(), indices.size(), vertexCount);
+		MeshOptimizer::OptimizeOverdraw(indices.data(), indices.data(), indices.size(),
+			mesh.Vertices.data(), vertexCount, VertexBytes);
+
+		std::vector<unsigned int> remap(vertexCount);
+		vertexCount = MeshOptimizer::OptimizeVertexFetchRemap(remap.data(),
+			indices.data(), indices.size(), vertexCount);
+		std::vector<float> vertices(vertexCount * BenchMesh::Stride);
+		MeshOptimizer::RemapVertexBuffer(vertices.data(), mesh.Vertices.data(),
+			mesh.VertexCount(), VertexBytes, remap.data());
+		MeshOptimizer::RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+
+		float* first = vertices.data();
+		TangentGenerator::Calculate(first, first + 3, first + 9, first + 6, VertexBytes,
+			vertexCount, indices.data(), indices.size());
+
+		// 16-bit indices whenever they fit, like Mesh
+		std::vector<char> indexData;
+		size_t indexStride = vertexCount <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+		indexData.resize(indices.size() * indexStride);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			if (indexStride == sizeof(uint16_t))
+				((uint16_t*)indexData.data())[i] = (uint16_t)indices[i];
+			else
+				((uint32_t*)indexData.data())[i] = indices[i];
+		}
+
+		MeshCacheHeader header = {};
+		header.SourceHash = sourceHash;
+		header.VertexStride = (uint32_t)VertexBytes;
+		header.VertexCount = (uint32_t)vertexCount;
+		header.IndexStride = (uint32_t)indexStride;
+		header.IndexCount = (uint32_t)indices.size();
+		header.Compression = compress ? MeshCache::CompressVertices | MeshCache::CompressIndices : 0;
+		return MeshCache::Write(cachePath, header, vertices.data(), indexData.data(), nullptr, nullptr);
+	}
+
+	// --------------------------------------------------------
+	// Everything Mesh does on a load from the cache: hash the
+	// source to see if the cache is stale, map and validate the
+	// cache, decompress if needed, then copy the blobs to where
+	// CreateBuffers() would (a copy stands in for the upload,
+	// and makes sure every mapped page is actually read in)
+	// --------------------------------------------------------
+	bool CacheLoad(const char* objPath, const char* cachePath, std::vector<char>& upload)
+	{
+		uint64_t sourceHash = 0;
+		if (!MeshCache::HashFile(objPath, sourceHash))
+			return false;
+
+		MappedFile file(cachePath);
+		MeshCacheView view;
+		if (!MeshCache::Read(file, view) || view.Header->SourceHash != sourceHash)
+			return false;
+
+		std::vector<char> vertices;
+		std::vector<char> indices;
+		if (!MeshCache::Decompress(view, vertices, indices))
+			return false;
+
+		const MeshCacheHeader* header = view.Header;
+		size_t vertexBytes = (size_t)header->VertexStride * header->VertexCount;
+		size_t indexBytes = (size_t)header->IndexStride * header->IndexCount;
+		upload.resize(vertexBytes + indexBytes);
+		std::memcpy(upload.data(), view.Vertices, vertexBytes);
+		std::memcpy(upload.data() + vertexBytes, view.Indices, indexBytes);
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Best of "runs" cache loads, each one right after both
+	// files are dropped from the page cache. Negative if they
+	// couldn't be dropped.
+	// --------------------------------------------------------
+	double ColdLoad(int runs, const char* objPath, const char* cachePath,
+		std::vector<char>& upload, bool& ok)
+	{
+		double best = -1.0;
+		for (int run = 0; run < runs; run++)
+		{
+			if (!DropFromPageCache(objPath) || !DropFromPageCache(cachePath))
+				return -1.0;
+			double elapsed = Bench::BestOf(1, [&]() { ok &= CacheLoad(objPath, cachePath, upload); });
+			best = run == 0 ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	}
+
+	size_t FileSize(const char* path)
+	{
+		MappedFile file(path);
+		return file.IsOpen() ? file.GetSize() : 0;
+	}
+
+	// --------------------------------------------------------
+	// Times a full load (which writes the cache), then cold
+	// and warm loads from it, with and without compression,
+	// and prints a row for each
+	// --------------------------------------------------------
+	bool BenchFile(const char* objPath, const char* label)
+	{
+		std::string cachePath = std::string("MeshCacheBench") + MeshCache::Extension;
+		size_t objBytes = FileSize(objPath);
+		int runs = objBytes > (16 << 20) ? 3 : 10;
+		bool ok = true;
+		std::vector<char> upload;
+
+		for (bool compress : { false, true })
+		{
+			double fullTime = Bench::BestOf(runs, [&]()
+				{
+					ok &= FullLoad(objPath, cachePath.c_str(), compress);
+				});
+			double coldTime = ColdLoad(runs, objPath, cachePath.c_str(), upload, ok);
+			double warmTime = Bench::BestOf(runs, [&]()
+				{
+					ok &= CacheLoad(objPath, cachePath.c_str(), upload);
+				});
+
+			char cold[16] = "-";
+			if (coldTime >= 0.0)
+				std::snprintf(cold, sizeof(cold), "%.3f", coldTime);
+			std::printf("%-18s %-5s %9.2f %9.2f %10.3f %10s %10.3f %8.1fx\n", label,
+				compress ? "yes" : "no", objBytes / 1048576.0,
+				FileSize(cachePath.c_str()) / 1048576.0, fullTime, cold, warmTime, fullTime / warmTime);
+		}
+		std::remove(cachePath.c_str());
+		if (!ok)
+			std::printf("%-18s FAILED\n", label);
+		return ok;
+	}
+}
+
+// --------------------------------------------------------
+// Load times of the bundled models and of a large synthetic
+// .obj without a cache (the full parse, optimize and tangent
+// pipeline, which writes the cache), and from the cache when
+// it's cold (evicted from the OS page cache, so read from
+// the disk) and warm (still in memory, as on a relaunch).
+// Both include hashing the source, as Mesh has to.
+// Pass .obj paths to time those instead.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::printf("%-18s %-5s %9s %9s %10s %10s %10s %9s\n", "", "comp.", "obj MB", "cache MB",
+		"full ms", "cold ms", "warm ms", "speedup");
+
+	bool ok = true;
+	if (argc > 1)
+	{
+		for (int i = 1; i < argc; i++)
+			ok &= BenchFile(argv[i], argv[i]);
+		return ok ? 0 : 1;
+	}
+
+	for (const std::string& path : Bench::BundledModels())
+		ok &= BenchFile(path.c_str(), Bench::ModelName(path).c_str());
+
+	const char* largePath = "MeshCacheBench.obj";
+	if (Bench::WriteObj(largePath, Bench::MakeSphere(384, 512)) == 0)
+	{
+		std::printf("Couldn't write %s\n", largePath);
+		return 1;
+	}
+	ok &= BenchFile(largePath, "synthetic sphere");
+	std::remove(largePath);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/*
+William Duprey
+12/10/24
+Mesh Optimizer Benchmark
+*/
+
+#include "MeshOptimizer.h"
+#include "BenchHelpers.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// Runs Mesh::OptimizeForGPU()'s steps on a copy of the mesh,
+	// printing the vertex cache and overdraw stats before and
+	// after, and how long the optimization took
+	// --------------------------------------------------------
+	void Measure(const char* label, const BenchMesh& source)
+	{
+		const size_t VertexBytes = sizeof(float) * BenchMesh::Stride;
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		size_t vertexCount = 0;
+
+		VertexCacheStats cacheBefore = MeshOptimizer::AnalyzeVertexCache(
+			source.Indices.data(), source.Indices.size(), source.VertexCount());
+		OverdrawStats overdrawBefore = MeshOptimizer::AnalyzeOverdraw(source.Indices.data(),
+			source.Indices.size(), source.Vertices.data(), source.VertexCount(), VertexBytes);
+
+		int runs = source.Indices.size() > 3000000 ? 1 : 5;
+		double milliseconds = Bench::BestOf(runs, [&]()
+			{
+				indices = source.Indices;
+				MeshOptimizer::OptimizeVertexCache(indices.data(), indices.data(),
+					indices.size(), source.VertexCount());
+				MeshOptimizer::OptimizeOverdraw(indices.data(), indices.data(), indices.size(),
+					source.Vertices.data(), source.VertexCount(), VertexBytes);
+
+				std::vector<unsigned int> remap(source.VertexCount());
+				vertexCount = MeshOptimizer::OptimizeVertexFetchRemap(remap.data(),
+					indices.data(), indices.size(), source.VertexCount());
+				vertices.resize(vertexCount * BenchMesh::Stride);
+				MeshOptimizer::RemapVertexBuffer(vertices.data(), source.Vertices.data(),
+					source.VertexCount(), VertexBytes, remap.data());
+				MeshOptimizer::RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+			});
+
+		VertexCacheStats cacheAfter = MeshOptimizer::AnalyzeVertexCache(
+			indices.data(), indices.size(), vertexCount);
+		OverdrawStats overdrawAfter = MeshOptimizer::AnalyzeOverdraw(indices.data(),
+			indices.size(), vertices.data(), vertexCount, VertexBytes);
+
+		std::printf("%-18s %9zu %6.3f -> %5.3f %6.3f -> %5.3f %6.3f -> %5.3f %9.2f\n", label,
+			source.Indices.size() / 3, cacheBefore.ACMR, cacheAfter.ACMR, cacheBefore.ATVR, cacheAfter.ATVR,
+			overdrawBefore.Overdraw, overdrawAfter.Overdraw, milliseconds);
+	}
+}
+
+// --------------------------------------------------------
+// ACMR, ATVR and overdraw before and after optimization, for
+// the bundled models (loaded like Mesh loads them) and for
+// synthetic spheres: one in exporter row order, and one with
+// its triangles shuffled (the worst case for the cache).
+// Pass .obj paths to measure those instead.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::printf("FIFO cache of %u, %u overdraw views at %u x %u\n", MeshOptimizer::DefaultCacheSize,
+		MeshOptimizer::DefaultOverdrawViews, MeshOptimizer::DefaultOverdrawResolution,
+		MeshOptimizer::DefaultOverdrawResolution);
+	std::printf("%-18s %9s %15s %15s %15s %9s\n", "", "triangles", "ACMR", "ATVR", "overdraw", "ms");
+
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+		paths.push_back(argv[i]);
+	if (paths.empty())
+		paths = Bench::BundledModels();
+
+	bool ok = true;
+	for (const std::string& path : paths)
+	{
+		BenchMesh mesh;
+		if (!Bench::LoadObj(path.c_str(), mesh))
+		{
+			std::printf("%-18s couldn't be loaded\n", path.c_str());
+			ok = false;
+			continue;
+		}
+		Measure(Bench::ModelName(path).c_str(), mesh);
+	}
+	if (argc > 1)
+		return ok ? 0 : 1;
+
+	BenchMesh sphere = Bench::MakeSphere(512, 1024);
+	Measure("sphere, rows", sphere);
+
+	std::mt19937 random(540);
+	size_t triangles = sphere.Indices.size() / 3;
+	for (size_t t = triangles; t > 1; t--)
+	{
+		size_t other = random() % t;
+		for (int c = 0; c < 3; c++)
+			std::swap(sphere.Indices[(t - 1) * 3 + c], sphere.Indices[other * 3 + c]);
+	}
+	Measure("sphere, shuffled", sphere);
+	return ok ? 0 : 1;
+}
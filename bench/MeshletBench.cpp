@@ -0,0 +1,330 @@
+/*
+William Duprey
+12/10/24
+Meshlet Culling Benchmark
+*/
+
+#include "Meshlets.h"
+#include "Bounds.h"
+#include "MeshOptimizer.h"
+#include "BenchHelpers.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const size_t VertexBytes = sizeof(float) * BenchMesh::Stride;
+	const int FrameCount = 120;
+
+	// Row-vector matrix product, like DirectXMath's
+	void Multiply(const float a[16], const float b[16], float result[16])
+	{
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+			{
+				result[r * 4 + c] = 0.0f;
+				for (int k = 0; k < 4; k++)
+					result[r * 4 + c] += a[r * 4 + k] * b[k * 4 + c];
+			}
+	}
+
+	// --------------------------------------------------------
+	// One frame of a camera path: a left-handed perspective
+	// camera at "Eye" (the mesh's world matrix is identity, so
+	// object space is world space)
+	// --------------------------------------------------------
+	struct Frame
+	{
+		float Eye[3];
+		float ViewProjection[16];
+	};
+
+	Frame MakeFrame(const float eye[3], const float at[3], float nearClip, float farClip)
+	{
+		const float FieldOfView = 3.14159265f / 3.0f;
+		const float Aspect = 16.0f / 9.0f;
+
+		float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+		float length = std::sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+		for (float& v : z)
+			v /= length;
+		float x[3] = { z[2], 0.0f, -z[0] };	// up (0, 1, 0) cross z
+		length = std::sqrt(x[0] * x[0] + x[2] * x[2]);
+		x[0] /= length;
+		x[2] /= length;
+		float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+		auto dot = [&](const float a[3]) { return a[0] * eye[0] + a[1] * eye[1] + a[2] * eye[2]; };
+		float view[16] =
+		{
+			x[0], y[0], z[0], 0.0f,
+			x[1], y[1], z[1], 0.0f,
+			x[2], y[2], z[2], 0.0f,
+			-dot(x), -dot(y), -dot(z), 1.0f
+		};
+
+		float yScale = 1.0f / std::tan(FieldOfView * 0.5f);
+		float range = farClip / (farClip - nearClip);
+		float projection[16] =
+		{
+			yScale / Aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, yScale, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -nearClip * range, 0.0f
+		};
+
+		Frame frame = {};
+		Multiply(view, projection, frame.ViewProjection);
+		std::copy_n(eye, 3, frame.Eye);
+		return frame;
+	}
+
+	// --------------------------------------------------------
+	// A flight around the mesh's bounding sphere: one lap that
+	// swings from far away (all of it on screen, only the back
+	// half culled) to skimming the surface (most of it off
+	// screen), bobbing up and down, and looking a little off
+	// center so the frustum edges cut through it
+	// --------------------------------------------------------
+	std::vector<Frame> MakeCameraPath(const float center[3], float radius)
+	{
+		const float TwoPi = 6.28318531f;
+		std::vector<Frame> path;
+		for (int f = 0; f < FrameCount; f++)
+		{
+			float angle = TwoPi * f / FrameCount;
+			float distance = radius * (2.2f + 1.0f * std::sin(angle * 2.0f));
+			float eye[3] =
+			{
+				center[0] + distance * std::cos(angle),
+				center[1] + radius * 0.8f * std::sin(angle * 3.0f),
+				center[2] + distance * std::sin(angle)
+			};
+			float at[3] =
+			{
+				center[0] + radius * 0.6f * std::cos(angle * 5.0f),
+				center[1],
+				center[2] + radius * 0.6f * std::sin(angle * 5.0f)
+			};
+			path.push_back(MakeFrame(eye, at, radius * 0.01f, radius * 100.0f));
+		}
+		return path;
+	}
+
+	// --------------------------------------------------------
+	// The straightforward way to cull: one meshlet at a time,
+	// straight from the Meshlet structs. Same tests as
+	// Meshlets::Cull(), so they must agree.
+	// --------------------------------------------------------
+	size_t CullOneByOne(const std::vector<Meshlet>& meshlets, const Frame& frame,
+		std::vector<MeshletRange>& ranges)
+	{
+		ranges.clear();
+		float planes[6][4];
+		Bounds::ExtractPlanes(frame.ViewProjection, planes);
+
+		size_t survivors = 0;
+		for (const Meshlet& m : meshlets)
+		{
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++)
+				inside = m.Center[0] * planes[p][0] + m.Center[1] * planes[p][1] +
+					m.Center[2] * planes[p][2] + planes[p][3] >= -m.Radius;
+
+			float d[3] = { m.Center[0] - frame.Eye[0], m.Center[1] - frame.Eye[1], m.Center[2] - frame.Eye[2] };
+			float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			float alongAxis = d[0] * m.ConeAxis[0] + d[1] * m.ConeAxis[1] + d[2] * m.ConeAxis[2];
+			if (!inside || alongAxis >= m.ConeCutoff * length + m.Radius)
+				continue;
+
+			survivors++;
+			if (!ranges.empty() && ranges.back().IndexOffset + ranges.back().IndexCount == m.IndexOffset)
+				ranges.back().IndexCount += m.TriangleCount * 3;
+			else
+				ranges.push_back({ m.IndexOffset, m.TriangleCount * 3 });
+		}
+		return survivors;
+	}
+
+	// --------------------------------------------------------
+	// Triangles the rasterizer would actually keep: facing the
+	// camera (clockwise, so the standard cross product points
+	// at it) and not entirely outside any one frustum plane
+	// --------------------------------------------------------
+	std::vector<char> VisibleTriangles(const BenchMesh& mesh, const Frame& frame)
+	{
+		float planes[6][4];
+		Bounds::ExtractPlanes(frame.ViewProjection, planes);
+
+		std::vector<char> visible(mesh.Indices.size() / 3, 0);
+		for (size_t t = 0; t < visible.size(); t++)
+		{
+			const float* p[3];
+			for (int c = 0; c < 3; c++)
+				p[c] = &mesh.Vertices[mesh.Indices[t * 3 + c] * BenchMesh::Stride];
+
+			float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float toEye[3] = { frame.Eye[0] - p[0][0], frame.Eye[1] - p[0][1], frame.Eye[2] - p[0][2] };
+			if (normal[0] * toEye[0] + normal[1] * toEye[1] + normal[2] * toEye[2] <= 0.0f)
+				continue;
+
+			bool outside = false;
+			for (int plane = 0; plane < 6 && !outside; plane++)
+			{
+				outside = true;
+				for (int c = 0; c < 3; c++)
+					outside = outside && p[c][0] * planes[plane][0] + p[c][1] * planes[plane][1] +
+						p[c][2] * planes[plane][2] + planes[plane][3] < 0.0f;
+			}
+			visible[t] = !outside;
+		}
+		return visible;
+	}
+
+	// --------------------------------------------------------
+	// Optimizes the mesh like Mesh does (optionally without the
+	// overdraw pass, which reorders whole clusters of triangles
+	// and so makes for looser meshlets), splits it into meshlets,
+	// then flies the camera path, timing both culling routines
+	// and checking what gets drawn against what's visible:
+	// culling must never drop a visible triangle, and whatever
+	// it draws that isn't visible is wasted vertex work
+	// --------------------------------------------------------
+	bool Measure(const char* label, BenchMesh mesh, bool optimizeOverdraw = true)
+	{
+		std::vector<unsigned int>& indices = mesh.Indices;
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.data(), indices.size(), mesh.VertexCount());
+		if (optimizeOverdraw)
+			MeshOptimizer::OptimizeOverdraw(indices.data(), indices.data(), indices.size(),
+				mesh.Vertices.data(), mesh.VertexCount(), VertexBytes);
+
+		std::vector<Meshlet> meshlets;
+		MeshletCullData cullData;
+		Meshlets::Build(meshlets, indices.data(), indices.size(), mesh.Vertices.data(),
+			mesh.VertexCount(), VertexBytes);
+		Meshlets::BuildCullData(meshlets, cullData);
+
+		float low[3] = { INFINITY, INFINITY, INFINITY };
+		float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (size_t v = 0; v < mesh.VertexCount(); v++)
+			for (int a = 0; a < 3; a++)
+			{
+				low[a] = std::fmin(low[a], mesh.Vertices[v * BenchMesh::Stride + a]);
+				high[a] = std::fmax(high[a], mesh.Vertices[v * BenchMesh::Stride + a]);
+			}
+		float center[3] = { (low[0] + high[0]) * 0.5f, (low[1] + high[1]) * 0.5f, (low[2] + high[2]) * 0.5f };
+		float radius = 0.5f * std::sqrt((high[0] - low[0]) * (high[0] - low[0]) +
+			(high[1] - low[1]) * (high[1] - low[1]) + (high[2] - low[2]) * (high[2] - low[2]));
+		std::vector<Frame> path = MakeCameraPath(center, radius);
+
+		// Timing, over the whole path
+		std::vector<MeshletRange> ranges;
+		std::vector<MeshletRange> oneByOneRanges;
+		size_t survivors = 0;
+		size_t oneByOneSurvivors = 0;
+		double cullTime = Bench::BestOf(5, [&]()
+			{
+				survivors = 0;
+				for (const Frame& frame : path)
+					survivors += Meshlets::Cull(meshlets, cullData, frame.ViewProjection, frame.Eye, ranges);
+			});
+		double oneByOneTime = Bench::BestOf(5, [&]()
+			{
+				oneByOneSurvivors = 0;
+				for (const Frame& frame : path)
+					oneByOneSurvivors += CullOneByOne(meshlets, frame, oneByOneRanges);
+			});
+
+		// What gets drawn, frame by frame
+		size_t triangleCount = indices.size() / 3;
+		size_t drawn = 0;
+		size_t visible = 0;
+		size_t missed = 0;
+		size_t drawCalls = 0;
+		bool agree = survivors == oneByOneSurvivors;
+		for (const Frame& frame : path)
+		{
+			Meshlets::Cull(meshlets, cullData, frame.ViewProjection, frame.Eye, ranges);
+			CullOneByOne(meshlets, frame, oneByOneRanges);
+			agree = agree && ranges.size() == oneByOneRanges.size();
+			drawCalls += ranges.size();
+
+			std::vector<char> drawnTriangles(triangleCount, 0);
+			for (size_t r = 0; r < ranges.size(); r++)
+			{
+				agree = agree && r < oneByOneRanges.size() &&
+					ranges[r].IndexOffset == oneByOneRanges[r].IndexOffset &&
+					ranges[r].IndexCount == oneByOneRanges[r].IndexCount;
+				std::fill_n(drawnTriangles.begin() + ranges[r].IndexOffset / 3, ranges[r].IndexCount / 3, (char)1);
+				drawn += ranges[r].IndexCount / 3;
+			}
+
+			std::vector<char> visibleTriangles = VisibleTriangles(mesh, frame);
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				visible += visibleTriangles[t];
+				missed += visibleTriangles[t] && !drawnTriangles[t];
+			}
+		}
+
+		double total = (double)triangleCount * FrameCount;
+		std::printf("%-20s %9zu %8zu %9.1f %9.1f %9.1f %8.1f %9.2f %9.2f %8.1fx  %s\n", label,
+			triangleCount, meshlets.size(), 100.0 * survivors / ((double)meshlets.size() * FrameCount),
+			100.0 * drawn / total, 100.0 * visible / total,
+			(double)drawCalls / FrameCount, 1000.0 * cullTime / FrameCount, 1000.0 * oneByOneTime / FrameCount,
+			oneByOneTime / cullTime, agree && missed == 0 ? "ok" : "WRONG");
+		if (missed > 0)
+			std::printf("%-20s %zu visible triangles were culled\n", "", missed);
+		return agree && missed == 0;
+	}
+}
+
+// --------------------------------------------------------
+// Meshlet culling along a synthetic camera path around each
+// of the bundled models and a large synthetic sphere (also
+// in vertex cache order alone, to see what the overdraw
+// pass costs the meshlets' bounds): how
+// many meshlets and triangles survive (next to how many are
+// really visible, so the rest is wasted work), how many draw
+// calls the merged ranges take, and the time per frame of
+// Meshlets::Cull() against culling one meshlet at a time.
+// Pass .obj paths to measure those instead.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::printf("%d frames, at most %u vertices and %u triangles per meshlet\n", FrameCount,
+		Meshlets::MaxVertices, Meshlets::MaxTriangles);
+	std::printf("%-20s %9s %8s %9s %9s %9s %8s %9s %9s %9s\n", "", "triangles", "meshlets", "kept %",
+		"drawn %", "visible %", "draws", "cull us", "1 by 1 us", "speedup");
+
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+		paths.push_back(argv[i]);
+	if (paths.empty())
+		paths = Bench::BundledModels();
+
+	bool ok = true;
+	for (const std::string& path : paths)
+	{
+		BenchMesh mesh;
+		if (!Bench::LoadObj(path.c_str(), mesh))
+		{
+			std::printf("%-20s couldn't be loaded\n", path.c_str());
+			ok = false;
+			continue;
+		}
+		ok &= Measure(Bench::ModelName(path).c_str(), mesh);
+	}
+	if (argc > 1)
+		return ok ? 0 : 1;
+
+	BenchMesh sphere = Bench::MakeSphere(384, 768);
+	ok &= Measure("sphere", sphere);
+	ok &= Measure("sphere, no overdraw", sphere, false);
+	return ok ? 0 : 1;
+}
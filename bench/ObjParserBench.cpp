@@ -0,0 +1,198 @@
+/*
+William Duprey
+12/10/24
+OBJ Parser Benchmark
+*/
+
+#include "ObjParser.h"
+#include "BenchHelpers.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// The loop Mesh used before ObjParser (getline into 100
+	// chars, then sscanf, twice for faces without UVs), cut
+	// off where it has the same raw data ObjParser hands back,
+	// so only the parsing is compared
+	// --------------------------------------------------------
+	bool LegacyParse(const char* path, ObjData& out)
+	{
+		out = ObjData();
+		std::ifstream obj(path);
+		if (!obj.is_open())
+			return false;
+
+		char chars[100];
+		while (obj.good())
+		{
+			obj.getline(chars, 100);
+			if (chars[0] == 'v' && chars[1] == 'n')
+			{
+				float n[3];
+				std::sscanf(chars, "vn %f %f %f", &n[0], &n[1], &n[2]);
+				out.Normals.insert(out.Normals.end(), n, n + 3);
+			}
+			else if (chars[0] == 'v' && chars[1] == 't')
+			{
+				float uv[2];
+				std::sscanf(chars, "vt %f %f", &uv[0], &uv[1]);
+				out.UVs.insert(out.UVs.end(), uv, uv + 2);
+			}
+			else if (chars[0] == 'v')
+			{
+				float p[3];
+				std::sscanf(chars, "v %f %f %f", &p[0], &p[1], &p[2]);
+				out.Positions.insert(out.Positions.end(), p, p + 3);
+			}
+			else if (chars[0] == 'f')
+			{
+				int i[12] = {};
+				int numbersRead = std::sscanf(chars, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+					&i[0], &i[1], &i[2], &i[3], &i[4], &i[5], &i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+				bool hasUVs = true;
+				if (numbersRead == 1)
+				{
+					numbersRead = std::sscanf(chars, "f %d//%d %d//%d %d//%d %d//%d",
+						&i[0], &i[2], &i[3], &i[5], &i[6], &i[8], &i[9], &i[11]);
+					hasUVs = false;
+				}
+
+				auto corner = [&](int c)
+					{
+						return ObjIndex{ i[c * 3] - 1, hasUVs ? i[c * 3 + 1] - 1 : -1, i[c * 3 + 2] - 1 };
+					};
+				out.Corners.push_back(corner(0));
+				out.Corners.push_back(corner(1));
+				out.Corners.push_back(corner(2));
+				if (numbersRead == 12 || numbersRead == 8)
+				{
+					out.Corners.push_back(corner(0));
+					out.Corners.push_back(corner(2));
+					out.Corners.push_back(corner(3));
+				}
+			}
+		}
+		return true;
+	}
+
+	// Largest difference between two attribute arrays, or
+	// infinity if they aren't even the same size
+	float Difference(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		if (a.size() != b.size())
+			return INFINITY;
+		float worst = 0.0f;
+		for (size_t i = 0; i < a.size(); i++)
+			worst = std::fmax(worst, std::fabs(a[i] - b[i]));
+		return worst;
+	}
+
+	bool SameCorners(const std::vector<ObjIndex>& a, const std::vector<ObjIndex>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (a[i].Position != b[i].Position || a[i].UV != b[i].UV || a[i].Normal != b[i].Normal)
+				return false;
+		}
+		return true;
+	}
+
+	size_t FileSize(const char* path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		return file.is_open() ? (size_t)file.tellg() : 0;
+	}
+
+	// --------------------------------------------------------
+	// Times every parser on one file, checks that they agree,
+	// and prints a row. Small files are parsed many times per
+	// run, so the timer has something to measure.
+	// --------------------------------------------------------
+	bool BenchFile(const char* path, const char* label)
+	{
+		size_t bytes = FileSize(path);
+		if (bytes == 0)
+		{
+			std::printf("%-20s couldn't be read\n", label);
+			return false;
+		}
+		int repeats = (int)std::max<size_t>(1, (8 << 20) / bytes);
+		int runs = bytes > (64 << 20) ? 3 : 5;
+
+		ObjData legacy;
+		ObjData single;
+		ObjData threaded;
+		bool ok = true;
+		double legacyTime = Bench::BestOf(runs, [&]()
+			{
+				for (int r = 0; r < repeats; r++)
+					ok &= LegacyParse(path, legacy);
+			}) / repeats;
+		double singleTime = Bench::BestOf(runs, [&]()
+			{
+				for (int r = 0; r < repeats; r++)
+					ok &= ObjParser::ParseFile(path, single, 1);
+			}) / repeats;
+		double threadedTime = Bench::BestOf(runs, [&]()
+			{
+				for (int r = 0; r < repeats; r++)
+					ok &= ObjParser::ParseFile(path, threaded);
+			}) / repeats;
+
+		// Both parsers read floats to the nearest float (or
+		// within a step of it), so they should agree closely
+		float difference = std::fmax(Difference(legacy.Positions, single.Positions),
+			std::fmax(Difference(legacy.UVs, single.UVs), Difference(legacy.Normals, single.Normals)));
+		bool same = ok && difference <= 1e-6f && SameCorners(legacy.Corners, single.Corners) &&
+			SameCorners(single.Corners, threaded.Corners) && single.Positions == threaded.Positions;
+
+		std::printf("%-20s %9.2f %9.3f %9.3f %9.3f %8.0f %8.0f %8.0f  %s\n", label,
+			bytes / 1048576.0, legacyTime, singleTime, threadedTime,
+			Bench::Throughput((double)bytes, legacyTime), Bench::Throughput((double)bytes, singleTime),
+			Bench::Throughput((double)bytes, threadedTime), same ? "same" : "DIFFERENT");
+		return same;
+	}
+}
+
+// --------------------------------------------------------
+// Parse time of the bundled models and of a large synthetic
+// scan-sized .obj, for the old getline/sscanf loop and for
+// ObjParser on one thread and on as many as it picks.
+// Pass .obj paths to time those instead.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::printf("%-20s %9s %9s %9s %9s %8s %8s %8s\n", "", "MB", "sscanf ms", "1 thr ms", "N thr ms",
+		"MB/s", "MB/s", "MB/s");
+
+	bool ok = true;
+	if (argc > 1)
+	{
+		for (int i = 1; i < argc; i++)
+			ok &= BenchFile(argv[i], argv[i]);
+		return ok ? 0 : 1;
+	}
+
+	for (const std::string& path : Bench::BundledModels())
+		ok &= BenchFile(path.c_str(), path.substr(path.find_last_of('/') + 1).c_str());
+
+	const char* largePath = "ObjParserBench.obj";
+	if (Bench::WriteObj(largePath, Bench::MakeSphere(768, 1024)) == 0)
+	{
+		std::printf("Couldn't write %s\n", largePath);
+		return 1;
+	}
+	ok &= BenchFile(largePath, "synthetic sphere");
+	std::remove(largePath);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+/*
+William Duprey
+12/10/24
+Range Allocator Benchmark
+*/
+
+#include "RangeAllocator.h"
+#include "BenchHelpers.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// --------------------------------------------------------
+// Time per Allocate() and Free() once the allocator has
+// reached a steady state of many live ranges, for a few
+// mixes of sizes, along with how fragmented it ends up.
+// Sizes are in vertices, like the geometry arena's.
+// --------------------------------------------------------
+int main()
+{
+	const size_t Capacity = 64 << 20;
+	const int Operations = 1000000;
+
+	struct Mix { const char* Name; size_t MinSize; size_t MaxSize; size_t Live; };
+	const Mix mixes[] =
+	{
+		{ "small meshes", 24, 4096, 4000 },
+		{ "mixed meshes", 24, 1 << 18, 400 },
+		{ "many ranges", 24, 256, 100000 },
+	};
+
+	std::printf("%-14s %10s %10s %12s %14s\n", "", "alloc ns", "free ns", "free ranges", "fragmentation");
+	for (const Mix& mix : mixes)
+	{
+		std::mt19937 random(540);
+		std::uniform_int_distribution<size_t> sizes(mix.MinSize, mix.MaxSize);
+		RangeAllocator allocator(Capacity);
+
+		struct Allocation { size_t Offset; size_t Size; };
+		std::vector<Allocation> live;
+		for (size_t i = 0; i < mix.Live; i++)
+		{
+			size_t size = sizes(random);
+			live.push_back({ allocator.Allocate(size), size });
+		}
+
+		// Batches of frees, then allocations to fill them back in,
+		// so each batch is timed as a whole. Sizes and victims are
+		// decided up front, so the timings are only the allocator.
+		const size_t Batch = std::min<size_t>(1000, mix.Live);
+		std::vector<size_t> order(live.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::vector<size_t> newSizes(Batch);
+
+		double allocateTime = 0.0;
+		double freeTime = 0.0;
+		size_t done = 0;
+		while (done < (size_t)Operations)
+		{
+			std::shuffle(order.begin(), order.end(), random);
+			for (size_t i = 0; i < Batch; i++)
+				newSizes[i] = sizes(random);
+
+			freeTime += Bench::BestOf(1, [&]()
+			{
+				for (size_t i = 0; i < Batch; i++)
+					allocator.Free(live[order[i]].Offset, live[order[i]].Size);
+			});
+			allocateTime += Bench::BestOf(1, [&]()
+			{
+				for (size_t i = 0; i < Batch; i++)
+					live[order[i]] = { allocator.Allocate(newSizes[i]), newSizes[i] };
+			});
+
+			// Anything that didn't fit holds nothing
+			for (size_t i = 0; i < Batch; i++)
+			{
+				if (live[order[i]].Offset == RangeAllocator::InvalidOffset)
+					live[order[i]].Size = 0;
+			}
+			done += Batch;
+		}
+
+		std::printf("%-14s %10.1f %10.1f %12zu %14.3f\n", mix.Name,
+			allocateTime * 1e6 / done, freeTime * 1e6 / done,
+			allocator.GetFreeRangeCount(), allocator.GetFragmentation());
+	}
+	return 0;
+}
@@ -0,0 +1,623 @@
+/*
+William Duprey
+12/10/24
+Transform Store Benchmark
+*/
+
+#include "TransformStore.h"
+#include "BenchHelpers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Rotates v by unit quaternion q:
+	// v + 2w(q.xyz x v) + 2 q.xyz x (q.xyz x v)
+	void RotateVector(const float q[4], const float v[3], float result[3])
+	{
+		float t[3] =
+		{
+			2.0f * (q[1] * v[2] - q[2] * v[1]),
+			2.0f * (q[2] * v[0] - q[0] * v[2]),
+			2.0f * (q[0] * v[1] - q[1] * v[0])
+		};
+		result[0] = v[0] + q[3] * t[0] + (q[1] * t[2] - q[2] * t[1]);
+		result[1] = v[1] + q[3] * t[1] + (q[2] * t[0] - q[0] * t[2]);
+		result[2] = v[2] + q[3] * t[2] + (q[0] * t[1] - q[1] * t[0]);
+	}
+
+	// The rotation a, followed by b (the same order as
+	// XMQuaternionMultiply(a, b), which is b * a)
+	void MultiplyQuaternions(const float a[4], const float b[4], float result[4])
+	{
+		float x = b[3] * a[0] + b[0] * a[3] + b[1] * a[2] - b[2] * a[1];
+		float y = b[3] * a[1] - b[0] * a[2] + b[1] * a[3] + b[2] * a[0];
+		float z = b[3] * a[2] + b[0] * a[1] - b[1] * a[0] + b[2] * a[3];
+		float w = b[3] * a[3] - b[0] * a[0] - b[1] * a[1] - b[2] * a[2];
+		result[0] = x;
+		result[1] = y;
+		result[2] = z;
+		result[3] = w;
+	}
+
+	// --------------------------------------------------------
+	// How Transform used to work: its own heap object per
+	// transform, S * R * T multiplied out in full, and a
+	// general 4x4 inverse of the transpose
+	// --------------------------------------------------------
+	struct ScatteredTransform
+	{
+		float Position[3];
+		float Rotation[3];
+		float Scale[3];
+		float World[16];
+		float WorldInvTranspose[16];
+		bool Dirty;
+	};
+
+	void Multiply(const float* a, const float* b, float* result)
+	{
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				result[r * 4 + c] = a[r * 4 + 0] * b[0 * 4 + c] + a[r * 4 + 1] * b[1 * 4 + c] +
+					a[r * 4 + 2] * b[2 * 4 + c] + a[r * 4 + 3] * b[3 * 4 + c];
+	}
+
+	// Inverse by 2x2 sub-determinants of the top and bottom rows
+	void Inverse(const float* m, float* result)
+	{
+		float s0 = m[0] * m[5] - m[4] * m[1];
+		float s1 = m[0] * m[6] - m[4] * m[2];
+		float s2 = m[0] * m[7] - m[4] * m[3];
+		float s3 = m[1] * m[6] - m[5] * m[2];
+		float s4 = m[1] * m[7] - m[5] * m[3];
+		float s5 = m[2] * m[7] - m[6] * m[3];
+		float c5 = m[10] * m[15] - m[14] * m[11];
+		float c4 = m[9] * m[15] - m[13] * m[11];
+		float c3 = m[9] * m[14] - m[13] * m[10];
+		float c2 = m[8] * m[15] - m[12] * m[11];
+		float c1 = m[8] * m[14] - m[12] * m[10];
+		float c0 = m[8] * m[13] - m[12] * m[9];
+		float invDet = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+		result[0] = (m[5] * c5 - m[6] * c4 + m[7] * c3) * invDet;
+		result[1] = (-m[1] * c5 + m[2] * c4 - m[3] * c3) * invDet;
+		result[2] = (m[13] * s5 - m[14] * s4 + m[15] * s3) * invDet;
+		result[3] = (-m[9] * s5 + m[10] * s4 - m[11] * s3) * invDet;
+		result[4] = (-m[4] * c5 + m[6] * c2 - m[7] * c1) * invDet;
+		result[5] = (m[0] * c5 - m[2] * c2 + m[3] * c1) * invDet;
+		result[6] = (-m[12] * s5 + m[14] * s2 - m[15] * s1) * invDet;
+		result[7] = (m[8] * s5 - m[10] * s2 + m[11] * s1) * invDet;
+		result[8] = (m[4] * c4 - m[5] * c2 + m[7] * c0) * invDet;
+		result[9] = (-m[0] * c4 + m[1] * c2 - m[3] * c0) * invDet;
+		result[10] = (m[12] * s4 - m[13] * s2 + m[15] * s0) * invDet;
+		result[11] = (-m[8] * s4 + m[9] * s2 - m[11] * s0) * invDet;
+		result[12] = (-m[4] * c3 + m[5] * c1 - m[6] * c0) * invDet;
+		result[13] = (m[0] * c3 - m[1] * c1 + m[2] * c0) * invDet;
+		result[14] = (-m[12] * s3 + m[13] * s1 - m[14] * s0) * invDet;
+		result[15] = (m[8] * s3 - m[9] * s1 + m[10] * s0) * invDet;
+	}
+
+	// --------------------------------------------------------
+	// How the store used to make the inverse transpose: the
+	// top 3x3's cofactor rows over its determinant, then the
+	// translation like TransformStore::InverseTranspose()
+	// --------------------------------------------------------
+	void CofactorInverseTranspose(const float* world, float* result)
+	{
+		float c[3][3];
+		for (int r = 0; r < 3; r++)
+		{
+			const float* u = world + ((r + 1) % 3) * 4;
+			const float* v = world + ((r + 2) % 3) * 4;
+			c[r][0] = u[1] * v[2] - u[2] * v[1];
+			c[r][1] = u[2] * v[0] - u[0] * v[2];
+			c[r][2] = u[0] * v[1] - u[1] * v[0];
+		}
+		float invDet = 1.0f / (world[0] * c[0][0] + world[1] * c[0][1] + world[2] * c[0][2]);
+
+		for (int r = 0; r < 3; r++)
+		{
+			float x = c[r][0] * invDet;
+			float y = c[r][1] * invDet;
+			float z = c[r][2] * invDet;
+			result[r * 4 + 0] = x;
+			result[r * 4 + 1] = y;
+			result[r * 4 + 2] = z;
+			result[r * 4 + 3] = -(x * world[12] + y * world[13] + z * world[14]);
+		}
+		result[12] = 0.0f;
+		result[13] = 0.0f;
+		result[14] = 0.0f;
+		result[15] = 1.0f;
+	}
+
+	void UpdateScattered(ScatteredTransform& t)
+	{
+		float sp = sinf(t.Rotation[0]), cp = cosf(t.Rotation[0]);
+		float sy = sinf(t.Rotation[1]), cy = cosf(t.Rotation[1]);
+		float sr = sinf(t.Rotation[2]), cr = cosf(t.Rotation[2]);
+		float roll[16] = { cr, sr, 0, 0, -sr, cr, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+		float pitch[16] = { 1, 0, 0, 0, 0, cp, sp, 0, 0, -sp, cp, 0, 0, 0, 0, 1 };
+		float yaw[16] = { cy, 0, -sy, 0, 0, 1, 0, 0, sy, 0, cy, 0, 0, 0, 0, 1 };
+		float scale[16] = { t.Scale[0], 0, 0, 0, 0, t.Scale[1], 0, 0, 0, 0, t.Scale[2], 0, 0, 0, 0, 1 };
+		float translation[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0,
+			t.Position[0], t.Position[1], t.Position[2], 1 };
+
+		float rollPitch[16], rotation[16], scaled[16], transpose[16];
+		Multiply(roll, pitch, rollPitch);
+		Multiply(rollPitch, yaw, rotation);
+		Multiply(scale, rotation, scaled);
+		Multiply(scaled, translation, t.World);
+
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				transpose[r * 4 + c] = t.World[c * 4 + r];
+		Inverse(transpose, t.WorldInvTranspose);
+		t.Dirty = false;
+	}
+
+	// --------------------------------------------------------
+	// Fills a fresh store and a set of scattered transforms with
+	// the same "count" random transforms, then times rebuilding
+	// them, each the best of a few runs, in milliseconds:
+	//  - Scattered: visited in a shuffled order, one at a time
+	//  - Batched: every transform dirty, rebuilt by one thread
+	//  - Threaded: the same, on threadCount threads
+	//  - Partial: dirtyFraction of them dirty, on threadCount
+	// Also prints the biggest difference between any element of
+	// the scattered and batched matrices.
+	// --------------------------------------------------------
+	void BenchScattered(size_t count, float dirtyFraction = 0.1f, unsigned int threadCount = 0)
+	{
+		const int Runs = 5;
+		if (threadCount == 0)
+			threadCount = std::thread::hardware_concurrency();
+		if (threadCount < 1)
+			threadCount = 1;
+
+		std::mt19937 random(540);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+		std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+		std::vector<std::unique_ptr<ScatteredTransform>> scattered(count);
+		TransformStore store;
+		for (size_t i = 0; i < count; i++)
+		{
+			scattered[i] = std::make_unique<ScatteredTransform>();
+			ScatteredTransform& t = *scattered[i];
+			for (int a = 0; a < 3; a++)
+			{
+				t.Position[a] = position(random);
+				t.Rotation[a] = angle(random);
+				t.Scale[a] = scale(random);
+			}
+			t.Dirty = true;
+
+			uint32_t slot = store.Allocate();
+			store.SetPosition(slot, t.Position[0], t.Position[1], t.Position[2]);
+			float q[4];
+			TransformStore::EulerToQuaternion(t.Rotation[0], t.Rotation[1], t.Rotation[2], q);
+			store.SetRotation(slot, q[0], q[1], q[2], q[3]);
+			store.SetScale(slot, t.Scale[0], t.Scale[1], t.Scale[2]);
+		}
+
+		// Entities are rarely visited in the order they were allocated
+		std::vector<ScatteredTransform*> order(count);
+		for (size_t i = 0; i < count; i++)
+			order[i] = scattered[i].get();
+		std::shuffle(order.begin(), order.end(), random);
+
+		// Marking isn't timed, so each run is its own BestOf()
+		double scatteredTime = 1e30, batchedTime = 1e30, threadedTime = 1e30, partialTime = 1e30;
+		for (int run = 0; run < Runs; run++)
+		{
+			scatteredTime = std::min(scatteredTime, Bench::BestOf(1, [&]()
+				{
+					for (ScatteredTransform* t : order)
+						UpdateScattered(*t);
+				}));
+
+			store.MarkAllDirty();
+			batchedTime = std::min(batchedTime, Bench::BestOf(1, [&]() { store.UpdateDirty(1); }));
+
+			store.MarkAllDirty();
+			threadedTime = std::min(threadedTime, Bench::BestOf(1, [&]() { store.UpdateDirty(threadCount); }));
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (chance(random) < dirtyFraction)
+					store.MarkDirty(i);
+			}
+			partialTime = std::min(partialTime, Bench::BestOf(1, [&]() { store.UpdateDirty(threadCount); }));
+		}
+
+		// Both should have made the same matrices
+		float maxError = 0.0f;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const float* world = store.GetWorldMatrix(i);
+			const float* worldInvTranspose = store.GetWorldInverseTransposeMatrix(i);
+			for (int e = 0; e < 16; e++)
+			{
+				maxError = std::max(maxError, std::fabs(world[e] - scattered[i]->World[e]));
+				maxError = std::max(maxError,
+					std::fabs(worldInvTranspose[e] - scattered[i]->WorldInvTranspose[e]));
+			}
+		}
+
+		std::printf("Transforms: %zu\n", count);
+		std::printf("Scattered: %.3f ms\n", scatteredTime);
+		std::printf("Batched (1 thread): %.3f ms\n", batchedTime);
+		std::printf("Batched (%u threads): %.3f ms\n", threadCount, threadedTime);
+		std::printf("Batched (%.0f%% dirty): %.3f ms\n", dirtyFraction * 100.0f, partialTime);
+		std::printf("Max difference: %g\n", maxError);
+	}
+
+	// --------------------------------------------------------
+	// Builds the same tree of "count" nodes in two stores, where
+	// node i's parent is (i - 1) / branching (so 1 is a single
+	// chain, and bigger is wider and shallower), then runs the
+	// same frames of random changes through both: one updating
+	// just what changed, and one updating everything. Prints
+	// milliseconds per frame, how many world matrices the
+	// incremental update rebuilt per frame, and the biggest
+	// difference between the two in the end (it should be 0).
+	// --------------------------------------------------------
+	void BenchHierarchy(size_t count, unsigned int branching, float dirtyFraction = 0.01f)
+	{
+		const int Frames = 100;
+		if (count == 0)
+			return;
+		if (branching < 1)
+			branching = 1;
+
+		std::mt19937 random(540);
+		std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		std::uniform_int_distribution<size_t> node(0, count - 1);
+
+		TransformStore incremental;
+		TransformStore full;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t slot = incremental.Allocate();
+			full.Allocate();
+			float x = position(random), y = position(random), z = position(random);
+			float q[4];
+			TransformStore::EulerToQuaternion(angle(random), angle(random), angle(random), q);
+			incremental.SetPosition(slot, x, y, z);
+			incremental.SetRotation(slot, q[0], q[1], q[2], q[3]);
+			full.SetPosition(slot, x, y, z);
+			full.SetRotation(slot, q[0], q[1], q[2], q[3]);
+			if (i > 0)
+			{
+				incremental.SetParent(slot, (uint32_t)((i - 1) / branching));
+				full.SetParent(slot, (uint32_t)((i - 1) / branching));
+			}
+		}
+		incremental.UpdateDirty(1);
+		full.UpdateDirty(1);
+
+		unsigned int depth = 0;
+		for (uint32_t s = (uint32_t)count - 1; s != TransformStore::NoParent; s = incremental.GetParent(s))
+			depth++;
+
+		// Same changes to both, with the update timed on one thread
+		size_t changes = (size_t)(count * dirtyFraction);
+		std::vector<uint32_t> slots(changes);
+		std::vector<float> rotations(changes * 4);
+		double incrementalTime = 0.0;
+		double fullTime = 0.0;
+		double updated = 0.0;
+		for (int frame = 0; frame < Frames; frame++)
+		{
+			for (size_t i = 0; i < changes; i++)
+			{
+				slots[i] = (uint32_t)node(random);
+				TransformStore::EulerToQuaternion(0.0f, angle(random), 0.0f, &rotations[i * 4]);
+			}
+
+			incrementalTime += Bench::BestOf(1, [&]()
+				{
+					for (size_t i = 0; i < changes; i++)
+						incremental.SetRotation(slots[i], rotations[i * 4], rotations[i * 4 + 1],
+							rotations[i * 4 + 2], rotations[i * 4 + 3]);
+					incremental.UpdateDirty(1);
+				});
+			updated += (double)incremental.GetLastHierarchyCount();
+
+			fullTime += Bench::BestOf(1, [&]()
+				{
+					for (size_t i = 0; i < changes; i++)
+						full.SetRotation(slots[i], rotations[i * 4], rotations[i * 4 + 1],
+							rotations[i * 4 + 2], rotations[i * 4 + 3]);
+					full.MarkAllDirty();
+					full.UpdateDirty(1);
+				});
+		}
+
+		float maxError = 0.0f;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const float* a = incremental.GetWorldMatrix(i);
+			const float* b = full.GetWorldMatrix(i);
+			for (int e = 0; e < 16; e++)
+				maxError = std::max(maxError, std::fabs(a[e] - b[e]));
+		}
+
+		std::printf("Hierarchy (branching %u, depth %u, %.0f%% dirty): %.3f ms incremental "
+			"(%.0f updated), %.3f ms full, max difference %g\n",
+			branching, depth, dirtyFraction * 100.0f, incrementalTime / Frames,
+			updated / Frames, fullTime / Frames, maxError);
+	}
+
+	// --------------------------------------------------------
+	// Per-transform rotation work, in nanoseconds per operation,
+	// for rotations stored as Euler angles (converted with sin
+	// and cos every time they're used) and as quaternions:
+	//  - Matrix: a rotation matrix
+	//  - Directions: right, up and forward vectors
+	//  - Move: a relative movement rotated into world space
+	//  - Rotate: adding a rotation on top of the current one
+	// Each runs over the same few thousand random rotations,
+	// summing every result so none are skipped. sin and cos are
+	// the C library's, which is slower than DirectXMath's
+	// vectorized XMVectorSinCos, so the Euler side is a little
+	// pessimistic compared to the old Transform.
+	// --------------------------------------------------------
+	void BenchOrientation(size_t operations)
+	{
+		const size_t Count = 4096;
+		if (operations == 0)
+			return;
+
+		std::mt19937 random(540);
+		std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		std::vector<float> eulers(Count * 3);
+		std::vector<float> quaternions(Count * 4);
+		for (size_t i = 0; i < Count; i++)
+		{
+			for (int a = 0; a < 3; a++)
+				eulers[i * 3 + a] = angle(random);
+			TransformStore::EulerToQuaternion(eulers[i * 3], eulers[i * 3 + 1], eulers[i * 3 + 2],
+				&quaternions[i * 4]);
+		}
+
+		volatile float sink = 0.0f;
+		float sum = 0.0f;
+		auto time = [&](auto operation)
+			{
+				double milliseconds = Bench::BestOf(1, [&]()
+					{
+						for (size_t i = 0; i < operations; i++)
+							operation(i % Count);
+					});
+				sink = sink + sum;
+				return milliseconds * 1e6 / (double)operations;
+			};
+
+		// Rotation matrices
+		double eulerMatrix = time([&](size_t i)
+			{
+				const float* e = &eulers[i * 3];
+				float sp = std::sin(e[0]), cp = std::cos(e[0]);
+				float sy = std::sin(e[1]), cy = std::cos(e[1]);
+				float sr = std::sin(e[2]), cr = std::cos(e[2]);
+				sum += (cr * cy + sr * sp * sy) + sr * cp + (sr * sp * cy - cr * sy) +
+					(cr * sp * sy - sr * cy) + cr * cp + (sr * sy + cr * sp * cy) +
+					cp * sy - sp + cp * cy;
+			});
+		double quaternionMatrix = time([&](size_t i)
+			{
+				const float* q = &quaternions[i * 4];
+				float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+				float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+				float xw = q[0] * q[3], yw = q[1] * q[3], zw = q[2] * q[3];
+				sum += (1.0f - 2.0f * (yy + zz)) + 2.0f * (xy + zw) + 2.0f * (xz - yw) +
+					2.0f * (xy - zw) + (1.0f - 2.0f * (xx + zz)) + 2.0f * (yz + xw) +
+					2.0f * (xz + yw) + 2.0f * (yz - xw) + (1.0f - 2.0f * (xx + yy));
+			});
+
+		// Right, up and forward: the old way made a quaternion from
+		// the angles and rotated each axis by it, and now they're
+		// just the rows of the rotation matrix
+		const float axes[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+		double eulerDirections = time([&](size_t i)
+			{
+				const float* e = &eulers[i * 3];
+				float q[4], v[3];
+				TransformStore::EulerToQuaternion(e[0], e[1], e[2], q);
+				for (int a = 0; a < 3; a++)
+				{
+					RotateVector(q, axes[a], v);
+					sum += v[0] + v[1] + v[2];
+				}
+			});
+		double quaternionDirections = time([&](size_t i)
+			{
+				const float* q = &quaternions[i * 4];
+				float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+				float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+				float xw = q[0] * q[3], yw = q[1] * q[3], zw = q[2] * q[3];
+				sum += (1.0f - 2.0f * (yy + zz)) + 2.0f * (xy + zw) + 2.0f * (xz - yw);
+				sum += 2.0f * (xy - zw) + (1.0f - 2.0f * (xx + zz)) + 2.0f * (yz + xw);
+				sum += 2.0f * (xz + yw) + 2.0f * (yz - xw) + (1.0f - 2.0f * (xx + yy));
+			});
+
+		// Relative movement
+		const float move[3] = { 0.1f, 0.0f, 0.2f };
+		double eulerMove = time([&](size_t i)
+			{
+				const float* e = &eulers[i * 3];
+				float q[4], v[3];
+				TransformStore::EulerToQuaternion(e[0], e[1], e[2], q);
+				RotateVector(q, move, v);
+				sum += v[0] + v[1] + v[2];
+			});
+		double quaternionMove = time([&](size_t i)
+			{
+				float v[3];
+				RotateVector(&quaternions[i * 4], move, v);
+				sum += v[0] + v[1] + v[2];
+			});
+
+		// Adding a small rotation, which used to just be adding
+		// angles (and left all the trig for later)
+		double eulerRotate = time([&](size_t i)
+			{
+				float* e = &eulers[i * 3];
+				e[0] += 0.001f;
+				e[1] += 0.002f;
+				e[2] += 0.003f;
+				sum += e[0];
+			});
+		double quaternionRotate = time([&](size_t i)
+			{
+				float* q = &quaternions[i * 4];
+				float delta[4];
+				TransformStore::EulerToQuaternion(0.001f, 0.002f, 0.003f, delta);
+				MultiplyQuaternions(q, delta, q);
+				float invLength = 1.0f / std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+				for (int a = 0; a < 4; a++)
+					q[a] *= invLength;
+				sum += q[0];
+			});
+
+		std::printf("Rotation matrix: %.2f ns Euler, %.2f ns quaternion\n", eulerMatrix, quaternionMatrix);
+		std::printf("Directions: %.2f ns Euler, %.2f ns quaternion\n", eulerDirections, quaternionDirections);
+		std::printf("Relative move: %.2f ns Euler, %.2f ns quaternion\n", eulerMove, quaternionMove);
+		std::printf("Rotate: %.2f ns Euler, %.2f ns quaternion\n", eulerRotate, quaternionRotate);
+	}
+
+	// --------------------------------------------------------
+	// Inverse transposes (normal matrices) of "count" random
+	// translations, rotations and scales, in nanoseconds each:
+	//  - General: a full 4x4 inverse of the transpose (what
+	//    XMMatrixInverse(XMMatrixTranspose(world)) does)
+	//  - Cofactor: the top 3x3's cofactors over its determinant
+	//  - Analytic: the rotation over the scale, like the store
+	//    does (it has the rotation rows from building the world).
+	//    It's a call into the store from here, which the store's
+	//    own updates don't pay, so it's a little pessimistic.
+	// Scales are different on every axis, so none of them get
+	// off easy. The biggest difference between any element of
+	// the analytic and general ones is relative to the
+	// element's size (or 1, if it's smaller than that).
+	// --------------------------------------------------------
+	void BenchNormalMatrix(size_t count)
+	{
+		const int Runs = 10;
+		if (count == 0)
+			return;
+
+		std::mt19937 random(540);
+		std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+		std::vector<float> positions(count * 3);
+		std::vector<float> scales(count * 3);
+		struct Rotation3x3 { float Rows[3][3]; };
+		std::vector<Rotation3x3> rotations(count);
+		std::vector<float> worlds(count * 16);
+		for (size_t i = 0; i < count; i++)
+		{
+			float* p = &positions[i * 3];
+			float* s = &scales[i * 3];
+			float q[4];
+			TransformStore::EulerToQuaternion(angle(random), angle(random), angle(random), q);
+			for (int a = 0; a < 3; a++)
+			{
+				p[a] = position(random);
+				s[a] = scale(random);
+			}
+
+			// The world matrix, by way of a store slot. Its rows
+			// are the rotation's, times the scale.
+			TransformStore store;
+			uint32_t slot = store.Allocate();
+			store.SetPosition(slot, p[0], p[1], p[2]);
+			store.SetRotation(slot, q[0], q[1], q[2], q[3]);
+			store.SetScale(slot, s[0], s[1], s[2]);
+			float* world = &worlds[i * 16];
+			std::copy_n(store.GetWorldMatrix(slot), 16, world);
+			for (int r = 0; r < 3; r++)
+				for (int c = 0; c < 3; c++)
+					rotations[i].Rows[r][c] = world[r * 4 + c] / s[r];
+		}
+
+		std::vector<float> general(count * 16);
+		std::vector<float> output(count * 16);
+		auto time = [&](auto build)
+			{
+				double milliseconds = Bench::BestOf(Runs, [&]()
+					{
+						for (size_t i = 0; i < count; i++)
+							build(i);
+					});
+				return milliseconds * 1e6 / (double)count;
+			};
+
+		double generalTime = time([&](size_t i)
+			{
+				const float* world = &worlds[i * 16];
+				float transpose[16];
+				for (int r = 0; r < 4; r++)
+					for (int c = 0; c < 4; c++)
+						transpose[r * 4 + c] = world[c * 4 + r];
+				Inverse(transpose, &general[i * 16]);
+			});
+		double cofactorTime = time([&](size_t i)
+			{
+				CofactorInverseTranspose(&worlds[i * 16], &output[i * 16]);
+			});
+		double analyticTime = time([&](size_t i)
+			{
+				TransformStore::InverseTranspose(rotations[i].Rows, &positions[i * 3],
+					&scales[i * 3], &output[i * 16]);
+			});
+
+		float maxError = 0.0f;
+		for (size_t e = 0; e < count * 16; e++)
+		{
+			float difference = std::fabs(output[e] - general[e]);
+			maxError = std::max(maxError, difference / std::max(1.0f, std::fabs(general[e])));
+		}
+		std::printf("Normal matrix: %.2f ns general inverse, %.2f ns cofactors, %.2f ns analytic, "
+			"max difference %g\n", generalTime, cofactorTime, analyticTime, maxError);
+	}
+}
+
+// --------------------------------------------------------
+// TransformStore's timings. Pass a transform count to use
+// instead of 100000.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	size_t count = argc > 1 ? (size_t)std::atoll(argv[1]) : 100000;
+
+	// Rebuilding world matrices the old way (one heap object
+	// at a time) against TransformStore's batches
+	BenchScattered(count);
+
+	// Hierarchies of 10k nodes, from one long chain to wide and shallow
+	for (unsigned int branching : { 1u, 2u, 100u })
+		BenchHierarchy(10000, branching);
+
+	// Per-transform rotation work, Euler angles vs. quaternions
+	BenchOrientation(1 << 22);
+
+	// Inverse transposes (normal matrices), general vs. analytic
+	BenchNormalMatrix(count);
+	return 0;
+}
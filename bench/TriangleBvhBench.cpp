@@ -0,0 +1,221 @@
+/*
+William Duprey
+12/10/24
+Triangle BVH Benchmark
+*/
+
+#include "TriangleBvh.h"
+#include "BenchHelpers.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const size_t VertexBytes = sizeof(float) * BenchMesh::Stride;
+
+	// Rays per batch: a 1024 x 576 view, and as many random rays
+	const unsigned int ViewWidth = 1024;
+	const unsigned int ViewHeight = 576;
+	const size_t RayCount = (size_t)ViewWidth * ViewHeight;
+
+	// Bounding sphere of the mesh's vertices (around its box's center)
+	void BoundingSphere(const BenchMesh& mesh, float center[3], float& radius)
+	{
+		float low[3] = { INFINITY, INFINITY, INFINITY };
+		float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (size_t v = 0; v < mesh.VertexCount(); v++)
+			for (int a = 0; a < 3; a++)
+			{
+				low[a] = std::fmin(low[a], mesh.Vertices[v * BenchMesh::Stride + a]);
+				high[a] = std::fmax(high[a], mesh.Vertices[v * BenchMesh::Stride + a]);
+			}
+		radius = 0.0f;
+		for (int a = 0; a < 3; a++)
+		{
+			center[a] = (low[a] + high[a]) * 0.5f;
+			radius += (high[a] - center[a]) * (high[a] - center[a]);
+		}
+		radius = std::fmax(std::sqrt(radius), 1e-6f);
+	}
+
+	// --------------------------------------------------------
+	// Picking rays: one per pixel of a 60 degree view from
+	// outside the mesh, looking at its center. Neighbors take
+	// nearly the same path through the tree (coherent rays).
+	// --------------------------------------------------------
+	std::vector<BvhRay> ViewRays(const float center[3], float radius)
+	{
+		const float Pi = 3.14159265f;
+		float eye[3] = { center[0] + radius * 1.0f, center[1] + radius * 0.6f, center[2] - radius * 1.4f };
+		float forward[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+		float length = std::sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+		for (float& f : forward)
+			f /= length;
+		float right[3] = { forward[2], 0.0f, -forward[0] };	// up (0, 1, 0) cross forward
+		length = std::sqrt(right[0] * right[0] + right[2] * right[2]);
+		right[0] /= length;
+		right[2] /= length;
+		float up[3] =
+		{
+			forward[1] * right[2] - forward[2] * right[1],
+			forward[2] * right[0] - forward[0] * right[2],
+			forward[0] * right[1] - forward[1] * right[0]
+		};
+
+		float halfHeight = std::tan(Pi / 6.0f);
+		float halfWidth = halfHeight * ViewWidth / ViewHeight;
+		std::vector<BvhRay> rays(RayCount);
+		for (unsigned int y = 0; y < ViewHeight; y++)
+			for (unsigned int x = 0; x < ViewWidth; x++)
+			{
+				float sx = ((x + 0.5f) / ViewWidth * 2.0f - 1.0f) * halfWidth;
+				float sy = (1.0f - (y + 0.5f) / ViewHeight * 2.0f) * halfHeight;
+				BvhRay& ray = rays[(size_t)y * ViewWidth + x];
+				for (int a = 0; a < 3; a++)
+				{
+					ray.Origin[a] = eye[a];
+					ray.Direction[a] = forward[a] + sx * right[a] + sy * up[a];
+				}
+				ray.MinT = 0.0f;
+				ray.MaxT = INFINITY;
+			}
+		return rays;
+	}
+
+	// --------------------------------------------------------
+	// Baking-style rays: from random points in and around the
+	// mesh in random directions, so every ray takes its own
+	// path through the tree (incoherent rays). Half of them are
+	// cut short, like ambient occlusion rays.
+	// --------------------------------------------------------
+	std::vector<BvhRay> RandomRays(const float center[3], float radius, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<BvhRay> rays(RayCount);
+		for (size_t i = 0; i < RayCount; i++)
+		{
+			BvhRay& ray = rays[i];
+			float direction[3];
+			float length = 0.0f;
+			do
+			{
+				for (float& d : direction)
+					d = unit(random);
+				length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+			} while (length < 0.1f || length > 1.0f);
+
+			for (int a = 0; a < 3; a++)
+			{
+				ray.Origin[a] = center[a] + unit(random) * radius * 1.2f;
+				ray.Direction[a] = direction[a] / length;
+			}
+			ray.MinT = 0.0f;
+			ray.MaxT = i % 2 == 0 ? INFINITY : radius * 0.25f;
+		}
+		return rays;
+	}
+
+	// --------------------------------------------------------
+	// Builds the BVH on one thread and on as many as it picks,
+	// then times closest hit and occlusion queries for view and
+	// random rays, and prints a row. The two kinds of query must
+	// agree on how many rays hit; checking the hits themselves
+	// is left to TriangleBvhTests.
+	// --------------------------------------------------------
+	bool Measure(const char* label, const BenchMesh& mesh)
+	{
+		TriangleBvh bvh;
+		auto build = [&](unsigned int threads)
+			{
+				return Bench::BestOf(3, [&]()
+					{
+						bvh.Build(mesh.Vertices.data(), mesh.VertexCount(), VertexBytes,
+							mesh.Indices.data(), mesh.Indices.size(), threads);
+					});
+			};
+		double singleBuild = build(1);
+		double threadedBuild = build(0);
+
+		float center[3];
+		float radius;
+		BoundingSphere(mesh, center, radius);
+		std::mt19937 random(540);
+		std::vector<BvhRay> rayBatches[2] = { ViewRays(center, radius), RandomRays(center, radius, random) };
+
+		double raysPerSecond[4] = {};
+		size_t hits[2] = {};
+		size_t wrong = 0;
+		for (int batch = 0; batch < 2; batch++)
+		{
+			const std::vector<BvhRay>& rays = rayBatches[batch];
+			double closestTime = Bench::BestOf(3, [&]()
+				{
+					hits[batch] = 0;
+					BvhHit hit;
+					for (const BvhRay& ray : rays)
+						hits[batch] += bvh.Intersect(ray, hit);
+				});
+			size_t occluded = 0;
+			double anyTime = Bench::BestOf(3, [&]()
+				{
+					occluded = 0;
+					for (const BvhRay& ray : rays)
+						occluded += bvh.Occluded(ray);
+				});
+			raysPerSecond[batch * 2] = rays.size() / (closestTime / 1000.0) / 1e6;
+			raysPerSecond[batch * 2 + 1] = rays.size() / (anyTime / 1000.0) / 1e6;
+			wrong += occluded != hits[batch];
+		}
+
+		std::printf("%-18s %9zu %7zu %8.2f %8.2f %6.1f%% %8.2f %8.2f %6.1f%% %8.2f %8.2f  %s\n", label,
+			bvh.GetTriangleCount(), bvh.GetNodeCount(), singleBuild, threadedBuild,
+			100.0 * hits[0] / RayCount, raysPerSecond[0], raysPerSecond[1],
+			100.0 * hits[1] / RayCount, raysPerSecond[2], raysPerSecond[3], wrong == 0 ? "ok" : "WRONG");
+		return wrong == 0;
+	}
+}
+
+// --------------------------------------------------------
+// Millions of rays per second through TriangleBvh, for the
+// bundled models and a large synthetic sphere (pass .obj
+// paths to measure those instead). View rays are picking
+// style, one per pixel; random rays are baking style. Each
+// is timed for the closest hit (Intersect) and for any hit
+// (Occluded), on one thread. Build times are on one thread
+// and on as many as the builder picks.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::printf("%zu rays per batch\n", RayCount);
+	std::printf("%-18s %9s %7s %8s %8s %7s %8s %8s %7s %8s %8s\n", "", "triangles", "nodes",
+		"1 thr ms", "N thr ms", "view", "Mray/s", "shadow", "random", "Mray/s", "shadow");
+
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+		paths.push_back(argv[i]);
+	if (paths.empty())
+		paths = Bench::BundledModels();
+
+	bool ok = true;
+	for (const std::string& path : paths)
+	{
+		BenchMesh mesh;
+		if (!Bench::LoadObj(path.c_str(), mesh))
+		{
+			std::printf("%-18s couldn't be loaded\n", path.c_str());
+			ok = false;
+			continue;
+		}
+		ok &= Measure(Bench::ModelName(path).c_str(), mesh);
+	}
+	if (argc > 1)
+		return ok ? 0 : 1;
+
+	ok &= Measure("synthetic sphere", Bench::MakeSphere(512, 1024));
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+/*
+William Duprey
+12/10/24
+Bounds Tests
+*/
+
+#include "Bounds.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Positions are 3 floats each, tightly packed
+	typedef std::vector<float> Points;
+
+	// Rounding allowance, relative to how far out the points are
+	float Tolerance(const Points& points)
+	{
+		float largest = 0.0f;
+		for (float f : points)
+			largest = std::fmax(largest, std::fabs(f));
+		return 1e-5f * (1.0f + largest);
+	}
+
+	bool AllFinite(const BoundingVolumes& bounds)
+	{
+		const float* floats = &bounds.BoxMin[0];
+		for (size_t i = 0; i < offsetof(BoundingVolumes, HasOrientedBox) / sizeof(float); i++)
+		{
+			if (!std::isfinite(floats[i]))
+				return false;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Fits every volume, then checks each one holds every
+	// point, the oriented box's axes are unit length and
+	// perpendicular, and it's no bigger than the axis-aligned
+	// box (by volume, then surface area, like Calculate() picks)
+	// --------------------------------------------------------
+	bool CheckPoints(const Points& points)
+	{
+		BoundingVolumes bounds;
+		size_t count = points.size() / 3;
+		Bounds::Calculate(bounds, points.data(), count, sizeof(float) * 3, true);
+		float tolerance = Tolerance(points);
+
+		bool ok = CHECK(AllFinite(bounds)) && CHECK(bounds.HasOrientedBox == 1);
+		size_t outsideBox = 0;
+		size_t outsideSphere = 0;
+		size_t outsideOriented = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* p = &points[i * 3];
+			float distanceSquared = 0.0f;
+			for (int a = 0; a < 3; a++)
+			{
+				outsideBox += p[a] < bounds.BoxMin[a] || p[a] > bounds.BoxMax[a];
+				float d = p[a] - bounds.SphereCenter[a];
+				distanceSquared += d * d;
+			}
+			outsideSphere += std::sqrt(distanceSquared) > bounds.SphereRadius + tolerance;
+
+			for (int k = 0; k < 3; k++)
+			{
+				const float* axis = bounds.OrientedAxes[k];
+				float along = (p[0] - bounds.OrientedCenter[0]) * axis[0] +
+					(p[1] - bounds.OrientedCenter[1]) * axis[1] +
+					(p[2] - bounds.OrientedCenter[2]) * axis[2];
+				outsideOriented += std::fabs(along) > bounds.OrientedExtents[k] + tolerance;
+			}
+		}
+		ok &= CHECK(outsideBox == 0);
+		ok &= CHECK(outsideSphere == 0);
+		ok &= CHECK(outsideOriented == 0);
+
+		for (int j = 0; j < 3; j++)
+			for (int k = 0; k < 3; k++)
+			{
+				const float* a = bounds.OrientedAxes[j];
+				const float* b = bounds.OrientedAxes[k];
+				float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+				ok &= CHECK(std::fabs(dot - (j == k ? 1.0f : 0.0f)) < 1e-4f);
+			}
+
+		// Never bigger than the axis-aligned box, or its sphere
+		float extents[3];
+		float boxRadiusSquared = 0.0f;
+		for (int a = 0; a < 3; a++)
+		{
+			extents[a] = (bounds.BoxMax[a] - bounds.BoxMin[a]) * 0.5f;
+			boxRadiusSquared += extents[a] * extents[a];
+		}
+		const float* oriented = bounds.OrientedExtents;
+		float orientedVolume = oriented[0] * oriented[1] * oriented[2];
+		float boxVolume = extents[0] * extents[1] * extents[2];
+		ok &= CHECK(orientedVolume <= boxVolume * (1.0f + 1e-5f));
+		if (boxVolume == 0.0f)
+		{
+			float orientedArea = oriented[0] * oriented[1] + oriented[1] * oriented[2] + oriented[2] * oriented[0];
+			float boxArea = extents[0] * extents[1] + extents[1] * extents[2] + extents[2] * extents[0];
+			ok &= CHECK(orientedArea <= boxArea * (1.0f + 1e-5f) + tolerance * tolerance);
+		}
+		ok &= CHECK(bounds.SphereRadius <= std::sqrt(boxRadiusSquared) + tolerance);
+		return ok;
+	}
+
+	// Adds a point at base + s * u + t * v
+	void AddPoint(Points& points, const float base[3], const float u[3], const float v[3], float s, float t)
+	{
+		for (int a = 0; a < 3; a++)
+			points.push_back(base[a] + s * u[a] + t * v[a]);
+	}
+
+	// --------------------------------------------------------
+	// Random clouds: uniform in a cube, clustered, a long thin
+	// box at an angle, and far from the origin
+	// --------------------------------------------------------
+	void TestRandom()
+	{
+		std::mt19937 random(540);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::normal_distribution<float> normal;
+		for (int set = 0; set < 20; set++)
+		{
+			Points cube, cluster, slab;
+			float offset[3] = { unit(random) * 1000.0f, unit(random) * 1000.0f, unit(random) * 1000.0f };
+			float u[3] = { normal(random), normal(random), normal(random) };
+			float v[3] = { normal(random), normal(random), normal(random) };
+			for (int i = 0; i < 500; i++)
+			{
+				for (int a = 0; a < 3; a++)
+				{
+					cube.push_back(unit(random) * (1.0f + set));
+					cluster.push_back(normal(random) + (i % 3 == 0 ? 5.0f : 0.0f));
+				}
+
+				// Long along u, thinner along v and thinner still
+				// along their cross product (roughly)
+				float base[3] = { offset[0], offset[1], offset[2] };
+				AddPoint(slab, base, u, v, unit(random) * 20.0f, unit(random) * 4.0f);
+				for (int a = 0; a < 3; a++)
+					slab[slab.size() - 3 + a] += unit(random) * 0.5f;
+			}
+			CHECK(CheckPoints(cube));
+			CHECK(CheckPoints(cluster));
+			CHECK(CheckPoints(slab));
+		}
+
+		// Strided positions, as in a vertex buffer
+		Points vertices;
+		for (int i = 0; i < 100 * 5; i++)
+			vertices.push_back(unit(random));
+		BoundingVolumes strided;
+		Bounds::Calculate(strided, vertices.data(), 100, sizeof(float) * 5, true);
+		size_t outside = 0;
+		for (int i = 0; i < 100; i++)
+			for (int a = 0; a < 3; a++)
+			{
+				float f = vertices[i * 5 + a];
+				outside += f < strided.BoxMin[a] || f > strided.BoxMax[a];
+			}
+		CHECK(outside == 0 && AllFinite(strided));
+	}
+
+	// --------------------------------------------------------
+	// Points that all coincide, lie on one line, or lie in one
+	// plane (lined up with the axes, and not) leave the
+	// covariance without a full set of distinct eigenvalues.
+	// Every volume must still hold them, without NaNs.
+	// --------------------------------------------------------
+	void TestDegenerate()
+	{
+		const float Origin[3] = { 3.0f, -2.0f, 7.0f };
+		const float X[3] = { 1.0f, 0.0f, 0.0f };
+		const float Z[3] = { 0.0f, 0.0f, 1.0f };
+		const float Diagonal[3] = { 0.6f, -0.48f, 0.64f };
+		const float Tilted[3] = { -0.8f, 0.0f, 0.6f };
+
+		std::mt19937 random(541);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		Points single, same, alongX, alongDiagonal, flat, tilted;
+		AddPoint(single, Origin, X, Z, 0.0f, 0.0f);
+		for (int i = 0; i < 200; i++)
+		{
+			float s = unit(random) * 10.0f;
+			float t = unit(random) * 3.0f;
+			AddPoint(same, Origin, X, Z, 0.0f, 0.0f);
+			AddPoint(alongX, Origin, X, Z, s, 0.0f);
+			AddPoint(alongDiagonal, Origin, Diagonal, Z, s, 0.0f);
+			AddPoint(flat, Origin, X, Z, s, t);
+			AddPoint(tilted, Origin, Diagonal, Tilted, s, t);
+		}
+
+		CHECK(CheckPoints(single));
+		CHECK(CheckPoints(same));
+		CHECK(CheckPoints(alongX));
+		CHECK(CheckPoints(alongDiagonal));
+		CHECK(CheckPoints(flat));
+		CHECK(CheckPoints(tilted));
+
+		BoundingVolumes bounds;
+		Bounds::Calculate(bounds, same.data(), same.size() / 3, sizeof(float) * 3, true);
+		CHECK(bounds.SphereRadius == 0.0f);
+		CHECK(bounds.OrientedExtents[0] == 0.0f && bounds.OrientedExtents[1] == 0.0f &&
+			bounds.OrientedExtents[2] == 0.0f);
+
+		// A line at an angle gets a box no thicker than the line,
+		// where the axis-aligned box would be a big diagonal block
+		Bounds::Calculate(bounds, alongDiagonal.data(), alongDiagonal.size() / 3, sizeof(float) * 3, true);
+		const float* extents = bounds.OrientedExtents;
+		float largest = std::fmax(extents[0], std::fmax(extents[1], extents[2]));
+		CHECK(extents[0] + extents[1] + extents[2] - largest < 1e-3f);
+
+		// No points at all leaves everything zeroed
+		Bounds::Calculate(bounds, nullptr, 0, sizeof(float) * 3, true);
+		CHECK(bounds.SphereRadius == 0.0f && bounds.HasOrientedBox == 0);
+	}
+}
+
+int main()
+{
+	TestRandom();
+	TestDegenerate();
+	return Test::Result();
+}
@@ -0,0 +1,265 @@
+/*
+William Duprey
+12/10/24
+Geometry Codec Tests
+*/
+
+#include "GeometryCodec.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const int Iterations = 3000;
+
+	// --------------------------------------------------------
+	// Random vertices, some smooth (small steps from the vertex
+	// before, like quantized attributes of a real mesh) and
+	// some pure noise, so every group width gets used
+	// --------------------------------------------------------
+	std::vector<unsigned char> RandomVertices(std::mt19937& random, size_t count, size_t size)
+	{
+		std::vector<unsigned char> vertices(count * size);
+		bool smooth = random() % 4 != 0;
+		unsigned int step = 1u << (random() % 8);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			if (smooth && i >= size)
+				vertices[i] = (unsigned char)(vertices[i - size] + random() % step - step / 2);
+			else
+				vertices[i] = (unsigned char)random();
+		}
+		return vertices;
+	}
+
+	// --------------------------------------------------------
+	// Random triangles: either strips over a grid (mostly shared
+	// edges, like an optimized mesh) or uniformly random corners
+	// (nothing shared, lots of far deltas), in that order
+	// --------------------------------------------------------
+	std::vector<uint32_t> RandomIndices(std::mt19937& random, size_t triangles, size_t vertexCount)
+	{
+		std::vector<uint32_t> indices(triangles * 3);
+		if (random() % 2 == 0)
+		{
+			for (size_t i = 0; i < indices.size(); i++)
+				indices[i] = (uint32_t)(random() % vertexCount);
+			return indices;
+		}
+
+		size_t width = 2 + random() % 64;
+		for (size_t t = 0; t < triangles; t++)
+		{
+			size_t quad = t / 2;
+			uint32_t a = (uint32_t)((quad / width) * (width + 1) + quad % width);
+			uint32_t b = a + 1;
+			uint32_t c = a + (uint32_t)width + 1;
+			uint32_t d = c + 1;
+			uint32_t corners[3] = { a, c, b };
+			if (t % 2)
+			{
+				corners[0] = b;
+				corners[1] = c;
+				corners[2] = d;
+			}
+			for (int k = 0; k < 3; k++)
+				indices[t * 3 + k] = corners[k] % (uint32_t)vertexCount;
+		}
+		return indices;
+	}
+
+	uint32_t IndexAt(const std::vector<unsigned char>& buffer, size_t i, size_t indexSize)
+	{
+		if (indexSize == 2)
+		{
+			uint16_t value;
+			std::memcpy(&value, &buffer[i * 2], 2);
+			return value;
+		}
+		uint32_t value;
+		std::memcpy(&value, &buffer[i * 4], 4);
+		return value;
+	}
+
+	// --------------------------------------------------------
+	// Triangles may come back rotated (same winding, different
+	// first corner), so each one has to match one of the three
+	// rotations of the original
+	// --------------------------------------------------------
+	bool SameTriangles(const std::vector<uint32_t>& original,
+		const std::vector<unsigned char>& decoded, size_t indexSize)
+	{
+		for (size_t t = 0; t < original.size() / 3; t++)
+		{
+			uint32_t a = IndexAt(decoded, t * 3, indexSize);
+			uint32_t b = IndexAt(decoded, t * 3 + 1, indexSize);
+			uint32_t c = IndexAt(decoded, t * 3 + 2, indexSize);
+			const uint32_t* o = &original[t * 3];
+			bool same = (a == o[0] && b == o[1] && c == o[2]) ||
+				(a == o[1] && b == o[2] && c == o[0]) ||
+				(a == o[2] && b == o[0] && c == o[1]);
+			if (!same)
+				return false;
+		}
+		return true;
+	}
+
+	// Every index a decode that "succeeded" on bad data gives
+	// back must still be in range
+	bool AllBelow(const std::vector<unsigned char>& decoded, size_t indexCount,
+		size_t indexSize, size_t vertexCount)
+	{
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			if (IndexAt(decoded, i, indexSize) >= vertexCount)
+				return false;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Round trips random vertex buffers exactly, then decodes
+	// bit flipped and truncated copies of each. Those may fail
+	// or not, but must never read or write out of bounds (the
+	// sanitizers this test is built with catch it if they do).
+	// --------------------------------------------------------
+	void TestVertices()
+	{
+		std::mt19937 random(540);
+		int mismatched = 0;
+		for (int i = 0; i < Iterations; i++)
+		{
+			size_t count = random() % 1200;
+			size_t size = 4 * (1 + random() % 16);
+			std::vector<unsigned char> vertices = RandomVertices(random, count, size);
+
+			std::vector<unsigned char> encoded;
+			GeometryCodec::EncodeVertices(encoded, vertices.data(), count, size);
+			std::vector<unsigned char> decoded(count * size);
+			if (!GeometryCodec::DecodeVertices(decoded.data(), count, size, encoded.data(), encoded.size()) ||
+				decoded != vertices)
+				mismatched++;
+
+			std::vector<unsigned char> corrupt = encoded;
+			int flips = 1 + (int)(random() % 8);
+			for (int f = 0; f < flips && !corrupt.empty(); f++)
+				corrupt[random() % corrupt.size()] ^= (unsigned char)(1u << (random() % 8));
+			GeometryCodec::DecodeVertices(decoded.data(), count, size, corrupt.data(), corrupt.size());
+
+			// Exactly sized copies, so reading past the end is caught
+			size_t length = encoded.empty() ? 0 : random() % encoded.size();
+			std::vector<unsigned char> truncated(encoded.begin(), encoded.begin() + length);
+			GeometryCodec::DecodeVertices(decoded.data(), count, size,
+				truncated.empty() ? nullptr : truncated.data(), truncated.size());
+		}
+		CHECK(mismatched == 0);
+	}
+
+	// --------------------------------------------------------
+	// Same for indices, 16 and 32 bit, where a decode of bad
+	// data must also never hand back an index out of range
+	// --------------------------------------------------------
+	void TestIndices()
+	{
+		std::mt19937 random(541);
+		int mismatched = 0;
+		int outOfRange = 0;
+		for (int i = 0; i < Iterations; i++)
+		{
+			size_t indexSize = random() % 2 ? 2 : 4;
+			size_t vertexCount = 1 + random() % (indexSize == 2 ? 65535 : 200000);
+			if (random() % 4 == 0)
+				vertexCount = 1 + random() % 300;
+			size_t triangles = random() % 2000;
+			std::vector<uint32_t> indices = RandomIndices(random, triangles, vertexCount);
+
+			std::vector<unsigned char> source(indices.size() * indexSize);
+			for (size_t k = 0; k < indices.size(); k++)
+			{
+				if (indexSize == 2)
+				{
+					uint16_t narrow = (uint16_t)indices[k];
+					std::memcpy(&source[k * 2], &narrow, 2);
+				}
+				else
+					std::memcpy(&source[k * 4], &indices[k], 4);
+			}
+
+			std::vector<unsigned char> encoded;
+			GeometryCodec::EncodeIndices(encoded, source.data(), indices.size(), indexSize);
+			std::vector<unsigned char> decoded(indices.size() * indexSize);
+			if (!GeometryCodec::DecodeIndices(decoded.data(), indices.size(), indexSize, vertexCount,
+				encoded.data(), encoded.size()) || !SameTriangles(indices, decoded, indexSize))
+				mismatched++;
+
+			// Any index past the vertex count fails
+			if (triangles > 0)
+			{
+				uint32_t biggest = *std::max_element(indices.begin(), indices.end());
+				CHECK(!GeometryCodec::DecodeIndices(decoded.data(), indices.size(), indexSize, biggest,
+					encoded.data(), encoded.size()));
+			}
+
+			std::vector<unsigned char> corrupt = encoded;
+			int flips = 1 + (int)(random() % 8);
+			for (int f = 0; f < flips && !corrupt.empty(); f++)
+				corrupt[random() % corrupt.size()] ^= (unsigned char)(1u << (random() % 8));
+			if (GeometryCodec::DecodeIndices(decoded.data(), indices.size(), indexSize, vertexCount,
+				corrupt.data(), corrupt.size()) && !AllBelow(decoded, indices.size(), indexSize, vertexCount))
+				outOfRange++;
+
+			size_t length = encoded.empty() ? 0 : random() % encoded.size();
+			std::vector<unsigned char> truncated(encoded.begin(), encoded.begin() + length);
+			if (GeometryCodec::DecodeIndices(decoded.data(), indices.size(), indexSize, vertexCount,
+				truncated.empty() ? nullptr : truncated.data(), truncated.size()) &&
+				!AllBelow(decoded, indices.size(), indexSize, vertexCount))
+				outOfRange++;
+		}
+		CHECK(mismatched == 0);
+		CHECK(outOfRange == 0);
+	}
+
+	// --------------------------------------------------------
+	// Bytes that were never an encoding at all
+	// --------------------------------------------------------
+	void TestGarbage()
+	{
+		std::mt19937 random(542);
+		int outOfRange = 0;
+		for (int i = 0; i < Iterations; i++)
+		{
+			std::vector<unsigned char> garbage(random() % 4096);
+			for (unsigned char& byte : garbage)
+				byte = (unsigned char)random();
+			const unsigned char* data = garbage.empty() ? nullptr : garbage.data();
+
+			size_t count = random() % 512;
+			size_t size = 4 * (1 + random() % 16);
+			std::vector<unsigned char> vertices(count * size);
+			GeometryCodec::DecodeVertices(vertices.data(), count, size, data, garbage.size());
+
+			size_t indexSize = random() % 2 ? 2 : 4;
+			size_t indexCount = (random() % 512) * 3;
+			size_t vertexCount = 1 + random() % 1000;
+			std::vector<unsigned char> indices(indexCount * indexSize);
+			if (GeometryCodec::DecodeIndices(indices.data(), indexCount, indexSize, vertexCount,
+				data, garbage.size()) && !AllBelow(indices, indexCount, indexSize, vertexCount))
+				outOfRange++;
+		}
+		CHECK(outOfRange == 0);
+	}
+}
+
+int main()
+{
+	TestVertices();
+	TestIndices();
+	TestGarbage();
+	return Test::Result();
+}
@@ -0,0 +1,206 @@
+/*
+William Duprey
+12/10/24
+glTF Parser Tests
+*/
+
+#include "GltfParser.h"
+#include "TestHelpers.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const char* DefaultView = "\"buffer\":0,\"byteLength\":36";
+	const char* DefaultAccessor = "\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"";
+
+	void Append(std::vector<char>& bytes, const void* data, size_t size)
+	{
+		bytes.insert(bytes.end(), (const char*)data, (const char*)data + size);
+	}
+
+	void AppendUint32(std::vector<char>& bytes, uint32_t value)
+	{
+		Append(bytes, &value, sizeof(value));
+	}
+
+	// --------------------------------------------------------
+	// A .glb of one triangle: three float positions, then three
+	// 16-bit indices. The position view and accessor (the JSON
+	// inside their braces) and the mode are what the tests
+	// break.
+	// --------------------------------------------------------
+	std::vector<char> MakeTriangle(const std::string& view, const std::string& accessor,
+		const char* mode = "4")
+	{
+		std::string json =
+			"{\"asset\":{\"version\":\"2.0\"},"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1,\"mode\":" +
+			std::string(mode) + "}]}],"
+			"\"buffers\":[{\"byteLength\":44}],"
+			"\"bufferViews\":[{" + view + "},{\"buffer\":0,\"byteOffset\":36,\"byteLength\":6}],"
+			"\"accessors\":[{" + accessor + "},"
+			"{\"bufferView\":1,\"componentType\":5123,\"count\":3,\"type\":\"SCALAR\"}]}";
+		while (json.size() % 4 != 0)
+			json += ' ';
+
+		const float positions[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+		const uint16_t indices[4] = { 0, 1, 2, 0 };
+
+		std::vector<char> bytes;
+		AppendUint32(bytes, 0x46546C67);
+		AppendUint32(bytes, 2);
+		AppendUint32(bytes, (uint32_t)(12 + 8 + json.size() + 8 + 44));
+		AppendUint32(bytes, (uint32_t)json.size());
+		AppendUint32(bytes, 0x4E4F534A);
+		Append(bytes, json.data(), json.size());
+		AppendUint32(bytes, 44);
+		AppendUint32(bytes, 0x004E4942);
+		Append(bytes, positions, sizeof(positions));
+		Append(bytes, indices, sizeof(indices));
+		return bytes;
+	}
+
+	bool Parses(const std::vector<char>& bytes)
+	{
+		std::vector<GltfPrimitive> primitives;
+		return GltfParser::ParseMemory(bytes.data(), bytes.size(), primitives);
+	}
+
+	// Whether the triangle parses with these view and accessor fields
+	bool Parses(const std::string& view, const std::string& accessor)
+	{
+		return Parses(MakeTriangle(view, accessor));
+	}
+
+	// --------------------------------------------------------
+	// The untouched triangle reads back exactly, as do strides
+	// the file spells out, up to the largest glTF allows
+	// --------------------------------------------------------
+	void TestValid()
+	{
+		std::vector<char> bytes = MakeTriangle(DefaultView, DefaultAccessor);
+		std::vector<GltfPrimitive> primitives;
+		if (!CHECK(GltfParser::ParseMemory(bytes.data(), bytes.size(), primitives)) ||
+			!CHECK(primitives.size() == 1))
+			return;
+
+		const GltfAccessor& positions = primitives[0].Positions;
+		CHECK(positions.Count == 3 && positions.Stride == 12);
+		float position[3];
+		positions.Read(1, position, 3);
+		CHECK(position[0] == 1.0f && position[1] == 0.0f && position[2] == 0.0f);
+
+		std::vector<unsigned int> indices;
+		GltfParser::ReadTriangles(primitives[0], 0, indices);
+		CHECK(indices.size() == 3 && indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+
+		std::string view = DefaultView;
+		CHECK(Parses(view + ",\"byteStride\":12", DefaultAccessor));
+		CHECK(Parses(view + ",\"byteStride\":16",
+			"\"bufferView\":0,\"componentType\":5126,\"count\":2,\"type\":\"VEC3\""));
+		CHECK(Parses(view + ",\"byteStride\":252",
+			"\"bufferView\":0,\"componentType\":5126,\"count\":1,\"type\":\"VEC3\""));
+	}
+
+	// --------------------------------------------------------
+	// Strides that aren't a multiple of 4, are over 252, can't
+	// fit an element, or are so big that stride * (count - 1)
+	// wraps around to something small
+	// --------------------------------------------------------
+	void TestStrides()
+	{
+		std::string view = DefaultView;
+		CHECK(!Parses(view + ",\"byteStride\":9223372036854775808", DefaultAccessor));
+		CHECK(!Parses(view + ",\"byteStride\":4294967296", DefaultAccessor));
+		CHECK(!Parses(view + ",\"byteStride\":14", DefaultAccessor));
+		CHECK(!Parses(view + ",\"byteStride\":8", DefaultAccessor));
+		CHECK(!Parses(view + ",\"byteStride\":0", DefaultAccessor));
+		CHECK(!Parses(view + ",\"byteStride\":-4", DefaultAccessor));
+		CHECK(!Parses(view + ",\"byteStride\":256",
+			"\"bufferView\":0,\"componentType\":5126,\"count\":1,\"type\":\"VEC3\""));
+
+		// One element too many for the view
+		CHECK(!Parses(view + ",\"byteStride\":16", DefaultAccessor));
+	}
+
+	// --------------------------------------------------------
+	// Counts that are negative, too big for the view, or too
+	// big for any integer
+	// --------------------------------------------------------
+	void TestCounts()
+	{
+		const char* counts[] = { "-1", "4", "4294967295", "18446744073709551616", "1e30" };
+		for (const char* count : counts)
+		{
+			CHECK(!Parses(DefaultView, std::string("\"bufferView\":0,\"componentType\":5126,\"count\":") +
+				count + ",\"type\":\"VEC3\""));
+		}
+		CHECK(Parses(DefaultView, "\"bufferView\":0,\"componentType\":5126,\"count\":0,\"type\":\"VEC3\""));
+		CHECK(!Parses(DefaultView, "\"bufferView\":0,\"componentType\":5126,\"type\":\"VEC3\""));
+	}
+
+	// --------------------------------------------------------
+	// Views that run past the binary chunk, accessors that run
+	// past their view, and types that can't be read
+	// --------------------------------------------------------
+	void TestOffsets()
+	{
+		CHECK(!Parses("\"buffer\":0,\"byteLength\":36,\"byteOffset\":-8", DefaultAccessor));
+		CHECK(!Parses("\"buffer\":0,\"byteLength\":36,\"byteOffset\":16", DefaultAccessor));
+		CHECK(!Parses("\"buffer\":0,\"byteLength\":36,\"byteOffset\":1e20", DefaultAccessor));
+		CHECK(!Parses("\"buffer\":0,\"byteLength\":45", DefaultAccessor));
+		CHECK(!Parses("\"buffer\":0,\"byteLength\":-36", DefaultAccessor));
+		CHECK(!Parses("\"buffer\":0", DefaultAccessor));
+
+		const char* offsets[] = { "4", "36", "-12", "9223372036854775808" };
+		for (const char* offset : offsets)
+		{
+			CHECK(!Parses(DefaultView, std::string(DefaultAccessor) + ",\"byteOffset\":" + offset));
+		}
+		CHECK(Parses(DefaultView,
+			"\"bufferView\":0,\"byteOffset\":24,\"componentType\":5126,\"count\":1,\"type\":\"VEC3\""));
+		CHECK(Parses(DefaultView,
+			"\"bufferView\":0,\"byteOffset\":36,\"componentType\":5126,\"count\":0,\"type\":\"VEC3\""));
+
+		CHECK(!Parses(DefaultView, "\"bufferView\":0,\"componentType\":-5126,\"count\":3,\"type\":\"VEC3\""));
+		CHECK(!Parses(DefaultView, "\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC5\""));
+
+		// Modes that aren't triangles are skipped, not failed
+		const char* modes[] = { "-1", "0", "7", "1e30" };
+		for (const char* mode : modes)
+		{
+			std::vector<char> bytes = MakeTriangle(DefaultView, DefaultAccessor, mode);
+			std::vector<GltfPrimitive> primitives;
+			CHECK(GltfParser::ParseMemory(bytes.data(), bytes.size(), primitives) && primitives.empty());
+		}
+	}
+
+	// --------------------------------------------------------
+	// Every shorter piece of a valid file fails (and the
+	// sanitizers catch any read past the end)
+	// --------------------------------------------------------
+	void TestTruncated()
+	{
+		std::vector<char> bytes = MakeTriangle(DefaultView, DefaultAccessor);
+		for (size_t size = 0; size < bytes.size(); size++)
+		{
+			std::vector<char> piece(bytes.begin(), bytes.begin() + size);
+			CHECK(!Parses(piece));
+		}
+	}
+}
+
+int main()
+{
+	TestValid();
+	TestStrides();
+	TestCounts();
+	TestOffsets();
+	TestTruncated();
+	return Test::Result();
+}
@@ -0,0 +1,230 @@
+/*
+William Duprey
+12/10/24
+Mesh Cache Tests
+*/
+
+#include "MeshCache.h"
+#include "TestHelpers.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const char* Path = "MeshCacheTests.meshcache";
+
+	// --------------------------------------------------------
+	// A quad (two triangles) as one LOD and one meshlet, with
+	// 16 or 32-bit indices, compressed or not
+	// --------------------------------------------------------
+	struct Quad
+	{
+		float Vertices[4 * 3] = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0 };
+		uint16_t Indices16[6] = { 0, 1, 2, 0, 2, 3 };
+		uint32_t Indices32[6] = { 0, 1, 2, 0, 2, 3 };
+		Meshlet Cluster = {};
+		LodLevel Lod = { 0, 6, 0.0f, 0.0f };
+	};
+
+	bool WriteQuad(const Quad& quad, uint32_t indexStride, uint32_t compression)
+	{
+		MeshCacheHeader header = {};
+		header.VertexStride = sizeof(float) * 3;
+		header.VertexCount = 4;
+		header.IndexStride = indexStride;
+		header.IndexCount = 6;
+		header.MeshletCount = 1;
+		header.LodCount = 1;
+		header.Compression = compression;
+		const void* indices = indexStride == sizeof(uint16_t) ? (const void*)quad.Indices16 : quad.Indices32;
+		return MeshCache::Write(Path, header, quad.Vertices, indices, &quad.Cluster, &quad.Lod);
+	}
+
+	std::vector<char> Load()
+	{
+		std::ifstream file(Path, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	void Save(const std::vector<char>& bytes)
+	{
+		std::ofstream file(Path, std::ios::binary | std::ios::trunc);
+		file.write(bytes.data(), bytes.size());
+	}
+
+	// Read() and, if that passes, Decompress() on the file
+	bool ReadAndDecompress(bool& readPassed)
+	{
+		MappedFile file(Path);
+		MeshCacheView view;
+		std::vector<char> vertices, indices;
+		readPassed = MeshCache::Read(file, view);
+		return readPassed && MeshCache::Decompress(view, vertices, indices);
+	}
+
+	bool Reads()
+	{
+		bool readPassed = false;
+		return ReadAndDecompress(readPassed);
+	}
+
+	// Overwrites a value at a byte offset of the file
+	template<typename T>
+	void Patch(std::vector<char> bytes, size_t offset, T value)
+	{
+		std::memcpy(bytes.data() + offset, &value, sizeof(T));
+		Save(bytes);
+	}
+
+	template<typename T>
+	T Peek(const std::vector<char>& bytes, size_t offset)
+	{
+		T value;
+		std::memcpy(&value, bytes.data() + offset, sizeof(T));
+		return value;
+	}
+
+	// --------------------------------------------------------
+	// Untouched files read back, for every index size and
+	// compression
+	// --------------------------------------------------------
+	void TestValid()
+	{
+		Quad quad;
+		for (uint32_t stride : { 2u, 4u })
+			for (uint32_t compression : { 0u, MeshCache::CompressVertices | MeshCache::CompressIndices })
+			{
+				CHECK(WriteQuad(quad, stride, compression));
+				CHECK(Reads());
+			}
+	}
+
+	// --------------------------------------------------------
+	// An uncompressed index past the vertex count fails Read(),
+	// for both index sizes. A compressed one gets past Read(),
+	// but Decompress() still catches it.
+	// --------------------------------------------------------
+	void TestIndexRange()
+	{
+		for (uint32_t stride : { 2u, 4u })
+		{
+			Quad quad;
+			quad.Indices16[5] = 4;
+			quad.Indices32[5] = 4;
+			CHECK(WriteQuad(quad, stride, 0));
+			bool readPassed = true;
+			CHECK(!ReadAndDecompress(readPassed) && !readPassed);
+
+			quad.Indices16[5] = 3;
+			quad.Indices32[5] = 3;
+			CHECK(WriteQuad(quad, stride, 0));
+			std::vector<char> bytes = Load();
+			uint64_t indexOffset = Peek<uint64_t>(bytes, offsetof(MeshCacheHeader, IndexOffset));
+			if (stride == sizeof(uint16_t))
+				Patch<uint16_t>(bytes, (size_t)indexOffset + 2, 0xFFFF);
+			else
+				Patch<uint32_t>(bytes, (size_t)indexOffset + 4, 0xFFFFFFFF);
+			CHECK(!Reads());
+		}
+
+		Quad quad;
+		quad.Indices32[5] = 4;
+		CHECK(WriteQuad(quad, 4, MeshCache::CompressIndices));
+		bool readPassed = false;
+		CHECK(!ReadAndDecompress(readPassed) && readPassed);
+	}
+
+	// --------------------------------------------------------
+	// LODs and meshlets that run past the index buffer fail,
+	// whether or not the indices are compressed
+	// --------------------------------------------------------
+	void TestRunRanges()
+	{
+		for (uint32_t compression : { 0u, MeshCache::CompressIndices })
+		{
+			Quad quad;
+			quad.Lod = { 3, 6, 0.0f, 0.0f };
+			CHECK(WriteQuad(quad, 2, compression));
+			CHECK(!Reads());
+
+			quad.Lod = { 0xFFFFFFFF, 2, 0.0f, 0.0f };
+			CHECK(WriteQuad(quad, 2, compression));
+			CHECK(!Reads());
+
+			quad.Lod = { 0, 6, 0.0f, 0.0f };
+			quad.Cluster.IndexOffset = 3;
+			quad.Cluster.TriangleCount = 2;
+			CHECK(WriteQuad(quad, 2, compression));
+			CHECK(!Reads());
+
+			quad.Cluster.IndexOffset = 0;
+			quad.Cluster.TriangleCount = 0x80000000;
+			CHECK(WriteQuad(quad, 2, compression));
+			CHECK(!Reads());
+
+			quad.Cluster.TriangleCount = 2;
+			CHECK(WriteQuad(quad, 2, compression));
+			CHECK(Reads());
+		}
+	}
+
+	// --------------------------------------------------------
+	// Corrupt headers: offsets so big that offset + size wraps
+	// around to something small, an index size that isn't 16
+	// or 32 bits, and a file cut short
+	// --------------------------------------------------------
+	void TestCorruptHeaders()
+	{
+		Quad quad;
+		CHECK(WriteQuad(quad, 2, 0));
+		std::vector<char> bytes = Load();
+
+		const uint64_t Wrapping = 0xFFFFFFFFFFFFFFF0ull;
+		size_t offsets[] =
+		{
+			offsetof(MeshCacheHeader, VertexOffset),
+			offsetof(MeshCacheHeader, IndexOffset),
+			offsetof(MeshCacheHeader, MeshletOffset),
+			offsetof(MeshCacheHeader, LodOffset)
+		};
+		for (size_t offset : offsets)
+		{
+			Patch<uint64_t>(bytes, offset, Wrapping);
+			CHECK(!Reads());
+		}
+
+		// Sizes only matter for compressed blobs (uncompressed ones
+		// must be exactly their raw size)
+		CHECK(WriteQuad(quad, 2, MeshCache::CompressVertices | MeshCache::CompressIndices));
+		std::vector<char> compressed = Load();
+		Patch<uint64_t>(compressed, offsetof(MeshCacheHeader, VertexBytes), Wrapping);
+		CHECK(!Reads());
+		Patch<uint64_t>(compressed, offsetof(MeshCacheHeader, IndexBytes), Wrapping);
+		CHECK(!Reads());
+
+		Patch<uint32_t>(bytes, offsetof(MeshCacheHeader, IndexStride), 3);
+		CHECK(!Reads());
+		Patch<uint32_t>(bytes, offsetof(MeshCacheHeader, IndexStride), 1);
+		CHECK(!Reads());
+
+		bytes.resize(bytes.size() - 1);
+		Save(bytes);
+		CHECK(!Reads());
+	}
+}
+
+int main()
+{
+	TestValid();
+	TestIndexRange();
+	TestRunRanges();
+	TestCorruptHeaders();
+	std::remove(Path);
+	return Test::Result();
+}
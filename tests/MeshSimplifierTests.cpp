@@ -0,0 +1,325 @@
+/*
+William Duprey
+12/10/24
+Mesh Simplifier Tests
+*/
+
+#include "MeshSimplifier.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	struct TestMesh
+	{
+		std::vector<float> Positions;	// xyz per vertex
+		std::vector<unsigned int> Indices;
+
+		size_t VertexCount() const { return Positions.size() / 3; }
+		const float* At(unsigned int i) const { return &Positions[(size_t)i * 3]; }
+	};
+
+	// --------------------------------------------------------
+	// A unit sphere of rings x segments quads, clockwise from
+	// outside, the way exporters write one out: the first and
+	// last column are split (a UV seam), and each pole is a
+	// ring of split vertices at the same spot. The triangles
+	// that would have no area at the poles are left out.
+	// --------------------------------------------------------
+	TestMesh MakeSphere(unsigned int rings, unsigned int segments)
+	{
+		const double Pi = 3.14159265358979;
+		TestMesh mesh;
+		for (unsigned int r = 0; r <= rings; r++)
+			for (unsigned int s = 0; s <= segments; s++)
+			{
+				double theta = Pi * r / rings;
+				double phi = 2.0 * Pi * (s % segments) / segments;
+				mesh.Positions.push_back((float)(std::sin(theta) * std::cos(phi)));
+				mesh.Positions.push_back((float)std::cos(theta));
+				mesh.Positions.push_back((float)(std::sin(theta) * std::sin(phi)));
+			}
+
+		// The poles' rings all sit at exactly the same spot
+		for (unsigned int s = 0; s <= segments; s++)
+		{
+			float* top = &mesh.Positions[s * 3];
+			float* bottom = &mesh.Positions[((size_t)rings * (segments + 1) + s) * 3];
+			top[0] = top[2] = bottom[0] = bottom[2] = 0.0f;
+		}
+
+		for (unsigned int r = 0; r < rings; r++)
+			for (unsigned int s = 0; s < segments; s++)
+			{
+				unsigned int a = r * (segments + 1) + s;
+				unsigned int b = a + 1;
+				unsigned int c = a + segments + 1;
+				unsigned int d = c + 1;
+				if (r > 0)
+					mesh.Indices.insert(mesh.Indices.end(), { a, b, c });
+				if (r + 1 < rings)
+					mesh.Indices.insert(mesh.Indices.end(), { b, d, c });
+			}
+		return mesh;
+	}
+
+	// --------------------------------------------------------
+	// A flat rows x columns grid in the xz plane, facing up,
+	// with a UV seam down the middle column (its vertices are
+	// split, left and right halves each using their own)
+	// --------------------------------------------------------
+	TestMesh MakeGrid(unsigned int rows, unsigned int columns, unsigned int& seamColumn)
+	{
+		TestMesh mesh;
+		seamColumn = columns / 2;
+		unsigned int width = columns + 2;
+		for (unsigned int y = 0; y <= rows; y++)
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned int column = x > seamColumn ? x - 1 : x;
+				mesh.Positions.insert(mesh.Positions.end(), { (float)column, 0.0f, (float)y });
+			}
+
+		for (unsigned int y = 0; y < rows; y++)
+			for (unsigned int x = 0; x < columns; x++)
+			{
+				// Right of the seam uses the second copy of its column
+				unsigned int left = x < seamColumn ? x : x + 1;
+				unsigned int a = y * width + left;
+				unsigned int b = a + 1;
+				unsigned int c = a + width;
+				unsigned int d = c + 1;
+				mesh.Indices.insert(mesh.Indices.end(), { a, c, b, b, c, d });
+			}
+		return mesh;
+	}
+
+	void Normal(const TestMesh& mesh, const unsigned int* tri, double normal[3], double& area)
+	{
+		const float* a = mesh.At(tri[0]);
+		const float* b = mesh.At(tri[1]);
+		const float* c = mesh.At(tri[2]);
+		double e1[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+		double e2[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+		normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		area = 0.5 * std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	}
+
+	// --------------------------------------------------------
+	// The LOD chain the way Mesh::BuildLods makes it: every
+	// level from the full detail triangles, half the triangles
+	// of the level before, twice its error allowance
+	// --------------------------------------------------------
+	std::vector<LodLevel> BuildLods(const TestMesh& mesh, std::vector<unsigned int>& indices, float diagonal)
+	{
+		size_t fullCount = mesh.Indices.size();
+		indices = mesh.Indices;
+		std::vector<LodLevel> lods(1, { 0, (uint32_t)fullCount, 0.0f, 0.0f });
+
+		float targetError = diagonal * MeshSimplifier::FirstLodError;
+		size_t targetCount = fullCount;
+		std::vector<unsigned int> lod(fullCount);
+		for (unsigned int i = 1; i < MeshSimplifier::MaxLods; i++)
+		{
+			targetCount = (size_t)(targetCount * MeshSimplifier::LodTriangleRatio) / 3 * 3;
+			float error = -1.0f;
+			size_t count = MeshSimplifier::Simplify(lod.data(), mesh.Indices.data(), fullCount,
+				mesh.Positions.data(), mesh.VertexCount(), sizeof(float) * 3,
+				targetCount, targetError, &error);
+			if (count == 0 || count > lods.back().IndexCount * 9 / 10)
+				break;
+
+			lods.push_back({ (uint32_t)indices.size(), (uint32_t)count, error, targetError });
+			indices.insert(indices.end(), lod.begin(), lod.begin() + count);
+			targetError *= MeshSimplifier::LodErrorGrowth;
+		}
+		return lods;
+	}
+
+	// --------------------------------------------------------
+	// A sphere's whole LOD chain: each level is smaller than the
+	// last and within its error allowance. The error it reports
+	// is an average over the planes each vertex gathered, so
+	// the real distance from the sphere can be a few times
+	// that, but must stay within the allowance. It's measured
+	// at the middle of every triangle and edge (where flat
+	// triangles stray furthest from the curve). Nothing flips
+	// or disappears, and the seams stay closed.
+	// --------------------------------------------------------
+	void TestSphereLods()
+	{
+		const double DistanceFactor = 4.0;
+		TestMesh mesh = MakeSphere(96, 192);
+		std::vector<unsigned int> indices;
+		std::vector<LodLevel> lods = BuildLods(mesh, indices, 2.0f * std::sqrt(3.0f));
+		CHECK(lods.size() == MeshSimplifier::MaxLods);
+
+		for (size_t l = 1; l < lods.size(); l++)
+		{
+			const LodLevel& lod = lods[l];
+			CHECK(lod.IndexCount % 3 == 0 && lod.IndexCount > 0);
+			CHECK(lod.IndexCount < lods[l - 1].IndexCount);
+			CHECK(lod.Error >= 0.0f && lod.Error <= lod.TargetError);
+
+			int outOfRange = 0;
+			int flipped = 0;
+			double worstDistance = 0.0;
+			double area = 0.0;
+			std::map<std::pair<unsigned int, unsigned int>, int> edges;
+			for (uint32_t i = lod.IndexOffset; i < lod.IndexOffset + lod.IndexCount; i += 3)
+			{
+				const unsigned int* tri = &indices[i];
+				if (tri[0] >= mesh.VertexCount() || tri[1] >= mesh.VertexCount() || tri[2] >= mesh.VertexCount())
+				{
+					outOfRange++;
+					continue;
+				}
+
+				// Clockwise from outside in a left-handed space, so
+				// (b - a) x (c - a) points out
+				double normal[3];
+				double triangleArea;
+				Normal(mesh, tri, normal, triangleArea);
+				area += triangleArea;
+				const float* a = mesh.At(tri[0]);
+				if (normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2] <= 0.0)
+					flipped++;
+
+				// Middle of the triangle and of each edge
+				for (int k = 0; k < 4; k++)
+				{
+					double p[3] = {};
+					for (int c = 0; c < 3; c++)
+					{
+						double weight = k == 3 ? 1.0 / 3.0 : (c == k ? 0.0 : 0.5);
+						for (int axis = 0; axis < 3; axis++)
+							p[axis] += weight * mesh.At(tri[c])[axis];
+					}
+					double length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+					worstDistance = std::max(worstDistance, 1.0 - length);
+				}
+
+				// Edges by position, so split seam vertices match up
+				for (int e = 0; e < 3; e++)
+				{
+					auto key = [&](unsigned int v)
+					{
+						const float* p = mesh.At(v);
+						return (unsigned int)std::lround((p[0] * 7.0 + p[1] * 131.0 + p[2] * 1931.0) * 1e4);
+					};
+					unsigned int from = key(tri[e]);
+					unsigned int to = key(tri[(e + 1) % 3]);
+					edges[{ std::min(from, to), std::max(from, to) }] += from < to ? 1 : -1;
+				}
+			}
+
+			// Every edge has a partner going the other way, so
+			// there are no holes along the seam or anywhere else
+			int openEdges = 0;
+			for (const auto& edge : edges)
+				openEdges += edge.second != 0;
+
+			const double SphereArea = 4.0 * 3.14159265358979;
+			CHECK(outOfRange == 0);
+			CHECK(flipped == 0);
+			CHECK(openEdges == 0);
+			CHECK(worstDistance <= lod.TargetError);
+			CHECK(worstDistance <= DistanceFactor * lod.Error);
+			CHECK(std::fabs(area - SphereArea) < 0.05 * SphereArea);
+			std::printf("LOD %zu: %u triangles, error %.5f of %.5f, distance %.5f\n",
+				l, lod.IndexCount / 3, lod.Error, lod.TargetError, worstDistance);
+		}
+	}
+
+	// --------------------------------------------------------
+	// A flat grid simplifies with no error at all, down to far
+	// fewer triangles, but keeps its outline and its seam: the
+	// area (with nothing flipped) stays exactly the same, and
+	// both sides of the seam use the same points along it
+	// --------------------------------------------------------
+	void TestFlatGrid()
+	{
+		const unsigned int Rows = 40;
+		const unsigned int Columns = 30;
+		unsigned int seamColumn = 0;
+		TestMesh mesh = MakeGrid(Rows, Columns, seamColumn);
+
+		std::vector<unsigned int> lod(mesh.Indices.size());
+		float error = -1.0f;
+		size_t count = MeshSimplifier::Simplify(lod.data(), mesh.Indices.data(), mesh.Indices.size(),
+			mesh.Positions.data(), mesh.VertexCount(), sizeof(float) * 3, 0, 1e-6f, &error);
+		CHECK(count > 0 && count < mesh.Indices.size() / 4);
+		CHECK(error == 0.0f);
+
+		double area = 0.0;
+		int flipped = 0;
+		std::set<float> leftSeam;
+		std::set<float> rightSeam;
+		for (size_t i = 0; i < count; i += 3)
+		{
+			double normal[3];
+			double triangleArea;
+			Normal(mesh, &lod[i], normal, triangleArea);
+			area += triangleArea;
+			if (!(normal[1] > 0.0))
+				flipped++;
+
+			// Which side a triangle is on, from its middle
+			float middle = (mesh.At(lod[i])[0] + mesh.At(lod[i + 1])[0] + mesh.At(lod[i + 2])[0]) / 3.0f;
+			for (int c = 0; c < 3; c++)
+			{
+				const float* p = mesh.At(lod[i + c]);
+				if (p[0] == (float)seamColumn)
+					(middle < seamColumn ? leftSeam : rightSeam).insert(p[2]);
+			}
+		}
+		CHECK(flipped == 0);
+		CHECK(std::fabs(area - (double)Rows * Columns) < 1e-3);
+		CHECK(leftSeam == rightSeam);
+		CHECK(leftSeam.count(0.0f) == 1 && leftSeam.count((float)Rows) == 1);
+	}
+
+	// --------------------------------------------------------
+	// With no error limit, the triangle target is what stops
+	// it, and the result can go right back into its own input
+	// --------------------------------------------------------
+	void TestTargets()
+	{
+		TestMesh mesh = MakeSphere(32, 64);
+		size_t target = mesh.Indices.size() / 10 / 3 * 3;
+		std::vector<unsigned int> lod(mesh.Indices);
+		size_t count = MeshSimplifier::Simplify(lod.data(), lod.data(), lod.size(),
+			mesh.Positions.data(), mesh.VertexCount(), sizeof(float) * 3, target, 1e30f);
+		CHECK(count > 0 && count <= target);
+		CHECK(count % 3 == 0);
+
+		// A target it already meets changes nothing
+		std::vector<unsigned int> same(mesh.Indices.size());
+		float error = -1.0f;
+		CHECK(MeshSimplifier::Simplify(same.data(), mesh.Indices.data(), mesh.Indices.size(),
+			mesh.Positions.data(), mesh.VertexCount(), sizeof(float) * 3,
+			mesh.Indices.size(), 1.0f, &error) == mesh.Indices.size());
+		CHECK(same == mesh.Indices && error == 0.0f);
+
+		// No error allowance on a curved surface: nothing can go
+		CHECK(MeshSimplifier::Simplify(same.data(), mesh.Indices.data(), mesh.Indices.size(),
+			mesh.Positions.data(), mesh.VertexCount(), sizeof(float) * 3, 0, 0.0f) == mesh.Indices.size());
+	}
+}
+
+int main()
+{
+	TestSphereLods();
+	TestFlatGrid();
+	TestTargets();
+	return Test::Result();
+}
@@ -0,0 +1,366 @@
+/*
+William Duprey
+12/10/24
+Meshlets Tests
+*/
+
+#include "Meshlets.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <random>
+#include <set>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Positions are 3 floats each, tightly packed
+	struct TestMesh
+	{
+		std::vector<float> Positions;
+		std::vector<unsigned int> Indices;
+
+		size_t VertexCount() const { return Positions.size() / 3; }
+		const float* Position(unsigned int index) const { return &Positions[index * 3]; }
+	};
+
+	// --------------------------------------------------------
+	// A unit sphere of rings x segments quads, with its poles
+	// squeezed into slivers, in ring order (like an exporter's)
+	// --------------------------------------------------------
+	TestMesh MakeSphere(unsigned int rings, unsigned int segments)
+	{
+		const float Pi = 3.14159265f;
+		TestMesh mesh;
+		for (unsigned int r = 0; r <= rings; r++)
+			for (unsigned int s = 0; s <= segments; s++)
+			{
+				float theta = Pi * r / rings;
+				float phi = 2.0f * Pi * s / segments;
+				mesh.Positions.push_back(std::sin(theta) * std::cos(phi));
+				mesh.Positions.push_back(std::cos(theta));
+				mesh.Positions.push_back(std::sin(theta) * std::sin(phi));
+			}
+
+		for (unsigned int r = 0; r < rings; r++)
+			for (unsigned int s = 0; s < segments; s++)
+			{
+				unsigned int a = r * (segments + 1) + s;
+				unsigned int b = a + 1;
+				unsigned int c = a + segments + 2;
+				unsigned int d = a + segments + 1;
+				unsigned int quad[6] = { a, b, c, a, c, d };
+				mesh.Indices.insert(mesh.Indices.end(), quad, quad + 6);
+			}
+		return mesh;
+	}
+
+	void Build(std::vector<Meshlet>& meshlets, const TestMesh& mesh,
+		unsigned int maxVertices = Meshlets::MaxVertices,
+		unsigned int maxTriangles = Meshlets::MaxTriangles)
+	{
+		Meshlets::Build(meshlets, mesh.Indices.data(), mesh.Indices.size(),
+			mesh.Positions.data(), mesh.VertexCount(), sizeof(float) * 3, maxVertices, maxTriangles);
+	}
+
+	// Unnormalized normal of the triangle starting at index i
+	void TriangleNormal(const TestMesh& mesh, size_t i, double normal[3])
+	{
+		const float* a = mesh.Position(mesh.Indices[i]);
+		const float* b = mesh.Position(mesh.Indices[i + 1]);
+		const float* c = mesh.Position(mesh.Indices[i + 2]);
+		double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+
+	// --------------------------------------------------------
+	// Checks the meshlets split the whole index buffer in order,
+	// each within the limits and with its vertex count right,
+	// and that each one (but the last) only ended because the
+	// next triangle wouldn't have fit. Returns the problems.
+	// --------------------------------------------------------
+	size_t CheckSplit(const std::vector<Meshlet>& meshlets, const TestMesh& mesh,
+		unsigned int maxVertices, unsigned int maxTriangles)
+	{
+		size_t problems = 0;
+		size_t next = 0;
+		for (size_t m = 0; m < meshlets.size(); m++)
+		{
+			const Meshlet& meshlet = meshlets[m];
+			problems += meshlet.IndexOffset != next;
+			problems += meshlet.TriangleCount == 0 || meshlet.TriangleCount > maxTriangles;
+			problems += meshlet.VertexCount > maxVertices;
+
+			std::set<unsigned int> used(mesh.Indices.begin() + meshlet.IndexOffset,
+				mesh.Indices.begin() + meshlet.IndexOffset + meshlet.TriangleCount * 3);
+			problems += used.size() != meshlet.VertexCount;
+			next = meshlet.IndexOffset + meshlet.TriangleCount * 3;
+
+			if (m + 1 < meshlets.size() && meshlet.TriangleCount < maxTriangles)
+			{
+				used.insert(mesh.Indices.begin() + next, mesh.Indices.begin() + next + 3);
+				problems += used.size() <= maxVertices;
+			}
+		}
+		problems += next != mesh.Indices.size();
+		return problems;
+	}
+
+	// --------------------------------------------------------
+	// Neither limit is ever passed, whichever one runs out
+	// first: shared vertices (a sphere), no shared vertices
+	// (the vertex limit, at 21 triangles), the same triangle
+	// over and over (the triangle limit), and smaller limits
+	// --------------------------------------------------------
+	void TestLimits()
+	{
+		std::vector<Meshlet> meshlets;
+		TestMesh sphere = MakeSphere(48, 96);
+		Build(meshlets, sphere);
+		CHECK(CheckSplit(meshlets, sphere, Meshlets::MaxVertices, Meshlets::MaxTriangles) == 0);
+		Build(meshlets, sphere, 16, 10);
+		CHECK(CheckSplit(meshlets, sphere, 16, 10) == 0);
+
+		std::mt19937 random(540);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		TestMesh soup;
+		for (unsigned int i = 0; i < 1000 * 3; i++)
+		{
+			for (int a = 0; a < 3; a++)
+				soup.Positions.push_back(unit(random));
+			soup.Indices.push_back(i);
+		}
+		Build(meshlets, soup);
+		CHECK(CheckSplit(meshlets, soup, Meshlets::MaxVertices, Meshlets::MaxTriangles) == 0);
+		CHECK(meshlets.size() > 1 && meshlets[0].TriangleCount == Meshlets::MaxVertices / 3);
+
+		TestMesh repeated;
+		repeated.Positions = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+		for (int i = 0; i < 1000; i++)
+			repeated.Indices.insert(repeated.Indices.end(), { 0, 1, 2 });
+		Build(meshlets, repeated);
+		CHECK(CheckSplit(meshlets, repeated, Meshlets::MaxVertices, Meshlets::MaxTriangles) == 0);
+		CHECK(meshlets.size() > 1 && meshlets[0].TriangleCount == Meshlets::MaxTriangles &&
+			meshlets[0].VertexCount == 3);
+	}
+
+	// --------------------------------------------------------
+	// Every vertex of every meshlet's triangles is inside its
+	// bounding sphere
+	// --------------------------------------------------------
+	void TestSpheres()
+	{
+		std::vector<Meshlet> meshlets;
+		TestMesh sphere = MakeSphere(48, 96);
+		Build(meshlets, sphere);
+
+		size_t outside = 0;
+		for (const Meshlet& meshlet : meshlets)
+			for (unsigned int i = 0; i < meshlet.TriangleCount * 3; i++)
+			{
+				const float* p = sphere.Position(sphere.Indices[meshlet.IndexOffset + i]);
+				float d[3] = { p[0] - meshlet.Center[0], p[1] - meshlet.Center[1], p[2] - meshlet.Center[2] };
+				float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+				outside += distance > meshlet.Radius * (1.0f + 1e-5f);
+			}
+		CHECK(outside == 0);
+	}
+
+	// --------------------------------------------------------
+	// Every triangle's normal is inside its meshlet's cone, and
+	// a meshlet the cone test culls only has triangles facing
+	// away from the camera. The frustum here holds everything,
+	// so only the cones cull.
+	// --------------------------------------------------------
+	void TestCones()
+	{
+		std::vector<Meshlet> meshlets;
+		TestMesh sphere = MakeSphere(48, 96);
+		Build(meshlets, sphere);
+
+		size_t withCones = 0;
+		size_t outsideCone = 0;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			if (meshlet.ConeCutoff >= 1.0f)
+				continue;
+			withCones++;
+			const float* axis = meshlet.ConeAxis;
+			float minDot = std::sqrt(1.0f - meshlet.ConeCutoff * meshlet.ConeCutoff);
+			for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+			{
+				double normal[3];
+				TriangleNormal(sphere, meshlet.IndexOffset + t * 3, normal);
+				double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				if (length == 0.0)
+					continue;
+				double cosine = (normal[0] * axis[0] + normal[1] * axis[1] + normal[2] * axis[2]) / length;
+				outsideCone += cosine < minDot - 1e-4;
+			}
+		}
+		CHECK(withCones > meshlets.size() / 2);
+		CHECK(outsideCone == 0);
+
+		MeshletCullData cullData;
+		Meshlets::BuildCullData(meshlets, cullData);
+		const float Everything[16] =
+		{
+			1e-3f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1e-3f, 0.0f, 0.0f,
+			0.0f, 0.0f, 5e-4f, 0.0f,
+			0.0f, 0.0f, 0.5f, 1.0f
+		};
+
+		std::mt19937 random(541);
+		std::normal_distribution<float> normal;
+		size_t culled = 0;
+		size_t facingCamera = 0;
+		std::vector<MeshletRange> ranges;
+		for (int c = 0; c < 50; c++)
+		{
+			float camera[3] = { normal(random), normal(random), normal(random) };
+			float length = std::sqrt(camera[0] * camera[0] + camera[1] * camera[1] + camera[2] * camera[2]);
+			for (float& v : camera)
+				v *= (1.5f + c * 0.1f) / length;
+
+			CHECK(Meshlets::Cull(meshlets, cullData, Everything, nullptr, ranges) == meshlets.size());
+			size_t survivors = Meshlets::Cull(meshlets, cullData, Everything, camera, ranges);
+			culled += meshlets.size() - survivors;
+
+			// Anything not in a range was culled
+			std::vector<bool> drawn(sphere.Indices.size(), false);
+			for (const MeshletRange& range : ranges)
+				for (unsigned int i = 0; i < range.IndexCount; i++)
+					drawn[range.IndexOffset + i] = true;
+
+			for (size_t i = 0; i + 2 < sphere.Indices.size(); i += 3)
+			{
+				if (drawn[i])
+					continue;
+				double n[3];
+				TriangleNormal(sphere, i, n);
+				const float* a = sphere.Position(sphere.Indices[i]);
+				double toCamera = n[0] * (camera[0] - a[0]) + n[1] * (camera[1] - a[1]) + n[2] * (camera[2] - a[2]);
+				facingCamera += toCamera > 0.0;
+			}
+		}
+		CHECK(culled > 0);
+		CHECK(facingCamera == 0);
+	}
+
+	// Row-vector matrix product, like DirectXMath's
+	void Multiply(const float a[16], const float b[16], float result[16])
+	{
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+			{
+				result[r * 4 + c] = 0.0f;
+				for (int k = 0; k < 4; k++)
+					result[r * 4 + c] += a[r * 4 + k] * b[k * 4 + c];
+			}
+	}
+
+	// --------------------------------------------------------
+	// A left-handed perspective view * projection, looking from
+	// "eye" at "at" (like XMMatrixLookAtLH and
+	// XMMatrixPerspectiveFovLH)
+	// --------------------------------------------------------
+	void LookAt(const float eye[3], const float at[3], float viewProjection[16])
+	{
+		const float FieldOfView = 3.14159265f / 3.0f;
+		const float Aspect = 16.0f / 9.0f;
+		const float NearClip = 0.05f;
+		const float FarClip = 100.0f;
+
+		float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+		float length = std::sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+		for (float& v : z)
+			v /= length;
+		float x[3] = { z[2], 0.0f, -z[0] };	// up (0, 1, 0) cross z
+		length = std::sqrt(x[0] * x[0] + x[2] * x[2]);
+		x[0] /= length;
+		x[2] /= length;
+		float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+		auto dot = [&](const float a[3]) { return a[0] * eye[0] + a[1] * eye[1] + a[2] * eye[2]; };
+		float view[16] =
+		{
+			x[0], y[0], z[0], 0.0f,
+			x[1], y[1], z[1], 0.0f,
+			x[2], y[2], z[2], 0.0f,
+			-dot(x), -dot(y), -dot(z), 1.0f
+		};
+
+		float yScale = 1.0f / std::tan(FieldOfView * 0.5f);
+		float range = FarClip / (FarClip - NearClip);
+		float projection[16] =
+		{
+			yScale / Aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, yScale, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -NearClip * range, 0.0f
+		};
+		Multiply(view, projection, viewProjection);
+	}
+
+	// --------------------------------------------------------
+	// Cull() (SSE, where there is SSE) and CullScalar() give
+	// the same ranges on every frame of a camera path that
+	// goes from far away to skimming the surface, looking off
+	// center so the frustum's sides cut through the mesh. The
+	// meshlet count isn't a multiple of four, so the padding
+	// gets tested too.
+	// --------------------------------------------------------
+	void TestSseMatchesScalar()
+	{
+		const float TwoPi = 6.28318531f;
+		std::vector<Meshlet> meshlets;
+		TestMesh sphere = MakeSphere(47, 93);
+		Build(meshlets, sphere);
+		if (meshlets.size() % 4 == 0)
+			meshlets.pop_back();
+		MeshletCullData cullData;
+		Meshlets::BuildCullData(meshlets, cullData);
+
+		size_t different = 0;
+		size_t culledSomething = 0;
+		std::vector<MeshletRange> fast;
+		std::vector<MeshletRange> reference;
+		for (int f = 0; f < 120; f++)
+		{
+			float angle = TwoPi * f / 120;
+			float distance = 2.2f + std::sin(angle * 2.0f);
+			float eye[3] = { distance * std::cos(angle), 0.8f * std::sin(angle * 3.0f), distance * std::sin(angle) };
+			float at[3] = { 0.6f * std::cos(angle * 5.0f), 0.0f, 0.6f * std::sin(angle * 5.0f) };
+			float viewProjection[16];
+			LookAt(eye, at, viewProjection);
+
+			for (const float* camera : { (const float*)eye, (const float*)nullptr })
+			{
+				size_t fastCount = Meshlets::Cull(meshlets, cullData, viewProjection, camera, fast);
+				size_t referenceCount = Meshlets::CullScalar(meshlets, cullData, viewProjection, camera, reference);
+				different += fastCount != referenceCount || fast.size() != reference.size();
+				for (size_t i = 0; i < fast.size() && i < reference.size(); i++)
+				{
+					different += fast[i].IndexOffset != reference[i].IndexOffset ||
+						fast[i].IndexCount != reference[i].IndexCount;
+				}
+				culledSomething += referenceCount < meshlets.size();
+			}
+		}
+		CHECK(different == 0);
+		CHECK(culledSomething > 0);
+	}
+}
+
+int main()
+{
+	TestLimits();
+	TestSpheres();
+	TestCones();
+	TestSseMatchesScalar();
+	return Test::Result();
+}
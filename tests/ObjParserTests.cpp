@@ -0,0 +1,95 @@
+/*
+William Duprey
+12/10/24
+OBJ Parser Tests
+*/
+
+#include "ObjParser.h"
+#include "TestHelpers.h"
+
+#include <climits>
+#include <cstring>
+#include <string>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// Parses all of "text" as one int. Returns false if there
+	// was no number, or it didn't use up the whole string.
+	// --------------------------------------------------------
+	bool ParseWhole(const char* text, int& value)
+	{
+		const char* cursor = text;
+		const char* end = text + std::strlen(text);
+		return ObjParser::ParseInt(cursor, end, value) && cursor == end;
+	}
+
+	// --------------------------------------------------------
+	// Ints in range parse exactly, and bigger ones (any number
+	// of digits) stop at INT_MAX without overflowing, which the
+	// undefined behavior sanitizer would catch
+	// --------------------------------------------------------
+	void TestParseInt()
+	{
+		int value = 0;
+		CHECK(ParseWhole("0", value) && value == 0);
+		CHECK(ParseWhole("  42", value) && value == 42);
+		CHECK(ParseWhole("-17", value) && value == -17);
+		CHECK(ParseWhole("+8", value) && value == 8);
+		CHECK(ParseWhole("2147483646", value) && value == INT_MAX - 1);
+		CHECK(ParseWhole("2147483647", value) && value == INT_MAX);
+		CHECK(ParseWhole("2147483648", value) && value == INT_MAX);
+		CHECK(ParseWhole("99999999999999999999", value) && value == INT_MAX);
+		CHECK(ParseWhole("-99999999999999999999", value) && value == -INT_MAX);
+		CHECK(ParseWhole(std::string(4096, '9').c_str(), value) && value == INT_MAX);
+		CHECK(!ParseWhole("", value));
+		CHECK(!ParseWhole("-", value));
+		CHECK(!ParseWhole("x1", value));
+
+		// Stops at the first thing that isn't a digit
+		const char* text = "12/34";
+		const char* cursor = text;
+		CHECK(ObjParser::ParseInt(cursor, text + 5, value) && value == 12 && cursor == text + 2);
+	}
+
+	// --------------------------------------------------------
+	// Faces with indices too big for an int keep their place,
+	// with those corners missing (like any index out of range),
+	// and don't disturb the faces around them
+	// --------------------------------------------------------
+	void TestHugeIndices()
+	{
+		const char* text =
+			"v 0 0 0\n"
+			"v 1 0 0\n"
+			"v 0 1 0\n"
+			"vt 0 0\n"
+			"f 1 2 99999999999999999999\n"
+			"f 1/1 2/99999999999999999999 3/-99999999999999999999\n"
+			"f -1 -2 -99999999999999999999\n"
+			"f 1 2 3\n";
+
+		ObjData data;
+		CHECK(ObjParser::ParseMemory(text, std::strlen(text), data, 1));
+		CHECK(data.Positions.size() == 9);
+		if (!CHECK(data.Corners.size() == 12))
+			return;
+
+		CHECK(data.Corners[0].Position == 0 && data.Corners[1].Position == 1);
+		CHECK(data.Corners[2].Position == -1);
+		CHECK(data.Corners[3].UV == 0 && data.Corners[4].UV == -1 && data.Corners[5].UV == -1);
+		CHECK(data.Corners[5].Position == 2);
+		CHECK(data.Corners[6].Position == 2 && data.Corners[7].Position == 1);
+		CHECK(data.Corners[8].Position == -1);
+		for (int i = 0; i < 3; i++)
+			CHECK(data.Corners[9 + i].Position == i);
+	}
+}
+
+int main()
+{
+	TestParseInt();
+	TestHugeIndices();
+	return Test::Result();
+}
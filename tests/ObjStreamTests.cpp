@@ -0,0 +1,237 @@
+/*
+William Duprey
+12/10/24
+OBJ Stream Tests
+*/
+
+#include "ObjParser.h"
+#include "ObjStreamCache.h"
+#include "MeshCache.h"
+#include "VertexPacking.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Peak bytes the streamed load may use on top of what the
+	// process already had (MeshOptions::StreamingBudget)
+	constexpr size_t StreamingBudget = 256 << 20;
+
+	// Positions per side of the grid every face of the big file
+	// is built on, so the attributes stay small however big the
+	// file gets. The small file's grid has few enough vertices
+	// for 16-bit indices.
+	constexpr unsigned int GridSize = 1024;
+	constexpr unsigned int SmallGridSize = 64;
+
+	// --------------------------------------------------------
+	// Writes an .obj of at least "bytes" bytes: a gridSize
+	// square grid of positions, uvs and normals, then its quads
+	// over and over (with a comment line per pass, like an
+	// exporter's object names) until the file is big enough.
+	// There's always at least one pass. Returns the number of
+	// triangles, or 0 if it couldn't.
+	// --------------------------------------------------------
+	size_t WriteGridObj(const char* path, unsigned int gridSize, unsigned long long bytes)
+	{
+		FILE* file = std::fopen(path, "wb");
+		if (!file)
+			return 0;
+
+		std::vector<char> buffer(1 << 20);
+		size_t used = 0;
+		unsigned long long written = 0;
+		auto append = [&](const char* text, size_t length)
+		{
+			if (used + length > buffer.size())
+			{
+				std::fwrite(buffer.data(), 1, used, file);
+				written += used;
+				used = 0;
+			}
+			std::memcpy(buffer.data() + used, text, length);
+			used += length;
+		};
+
+		char line[256];
+		for (unsigned int y = 0; y < gridSize; y++)
+			for (unsigned int x = 0; x < gridSize; x++)
+			{
+				float height = (float)((x * 7 + y * 13) % 17) * 0.01f;
+				append(line, std::snprintf(line, sizeof(line), "v %u.5 %.2f %u.25\n", x, height, y));
+				append(line, std::snprintf(line, sizeof(line), "vt %.4f %.4f\n",
+					(float)x / gridSize, (float)y / gridSize));
+				append(line, std::snprintf(line, sizeof(line), "vn 0.0 1.0 0.0\n"));
+			}
+
+		size_t triangles = 0;
+		for (unsigned int pass = 0; pass == 0 || written + used < bytes; pass++)
+		{
+			append(line, std::snprintf(line, sizeof(line), "# pass %u\n", pass));
+			for (unsigned int y = 0; y + 1 < gridSize; y++)
+				for (unsigned int x = 0; x + 1 < gridSize; x++)
+				{
+					unsigned int a = y * gridSize + x + 1;
+					unsigned int b = a + 1;
+					unsigned int c = a + gridSize + 1;
+					unsigned int d = a + gridSize;
+					append(line, std::snprintf(line, sizeof(line),
+						"f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, d, d, d));
+					triangles += 2;
+				}
+		}
+
+		std::fwrite(buffer.data(), 1, used, file);
+		bool ok = std::fclose(file) == 0;
+		return ok ? triangles : 0;
+	}
+
+	// --------------------------------------------------------
+	// Resident and peak resident bytes of this process, from
+	// /proc (Linux only, where the peak can also be reset)
+	// --------------------------------------------------------
+	size_t ReadStatus(const char* field)
+	{
+		FILE* file = std::fopen("/proc/self/status", "r");
+		if (!file)
+			return 0;
+		char line[256];
+		size_t kilobytes = 0;
+		size_t length = std::strlen(field);
+		while (std::fgets(line, sizeof(line), file))
+		{
+			if (std::strncmp(line, field, length) == 0)
+				kilobytes = std::strtoull(line + length, nullptr, 10);
+		}
+		std::fclose(file);
+		return kilobytes * 1024;
+	}
+
+	bool ResetPeak()
+	{
+		FILE* file = std::fopen("/proc/self/clear_refs", "w");
+		if (!file)
+			return false;
+		bool ok = std::fputs("5", file) >= 0;
+		return std::fclose(file) == 0 && ok;
+	}
+
+	// --------------------------------------------------------
+	// A few passes over a small grid, under a budget that only
+	// leaves room for the smallest blocks, so the cache gets
+	// 16-bit indices (narrowed by MeshCacheStream::Finish())
+	// built from several blocks. Every triangle must still be
+	// half of one grid cell seen from above, in the same
+	// winding, which a wrong index or block offset would break.
+	// --------------------------------------------------------
+	void TestSmallBlocks()
+	{
+		const char* objPath = "ObjStreamTests.small.obj";
+		std::string cachePath = std::string(objPath) + MeshCache::Extension;
+		size_t expectedTriangles = WriteGridObj(objPath, SmallGridSize, 1 << 20);
+		if (!CHECK(expectedTriangles > ObjParser::MinStreamingBlockTriangles))
+			return;
+
+		size_t attributeBytes = sizeof(float) * 8 * SmallGridSize * SmallGridSize;
+		ObjStreamSettings settings;
+		settings.Budget = attributeBytes + ObjParser::StreamWindowBytes +
+			ObjParser::MinStreamingBlockTriangles * ObjParser::StreamingBytesPerTriangle;
+		size_t blockTriangles = 0;
+		CHECK(ObjStreamCache::Write(objPath, cachePath.c_str(), settings, &blockTriangles));
+		CHECK(blockTriangles == ObjParser::MinStreamingBlockTriangles);
+
+		MappedFile file(cachePath.c_str());
+		MeshCacheView view = {};
+		if (CHECK(file.IsOpen() && MeshCache::Read(file, view)))
+		{
+			const MeshCacheHeader& header = *view.Header;
+			CHECK(header.IndexStride == sizeof(uint16_t));
+			CHECK(header.IndexCount == expectedTriangles * 3);
+			CHECK(header.VertexStride == sizeof(StreamedVertex));
+
+			const StreamedVertex* vertices = (const StreamedVertex*)view.Vertices;
+			const uint16_t* indices = (const uint16_t*)view.Indices;
+			size_t wrong = 0;
+			for (size_t i = 0; i + 2 < header.IndexCount; i += 3)
+			{
+				const float* a = vertices[indices[i]].Position;
+				const float* b = vertices[indices[i + 1]].Position;
+				const float* c = vertices[indices[i + 2]].Position;
+				float area = ((b[0] - a[0]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[0] - a[0])) * 0.5f;
+				wrong += std::fabs(area - 0.5f) > 1e-4f;
+			}
+			CHECK(wrong == 0);
+		}
+		file.Close();
+
+		std::remove(objPath);
+		std::remove(cachePath.c_str());
+	}
+}
+
+// --------------------------------------------------------
+// Checks the small file, then streams a synthetic .obj of
+// argv[1] gigabytes (default 2, 0 to skip it) through the
+// same pipeline under StreamingBudget, checking that the
+// peak resident memory stays under the budget, and that the
+// cache it writes holds every triangle
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	TestSmallBlocks();
+
+	double gigabytes = argc > 1 ? std::atof(argv[1]) : 2.0;
+	if (gigabytes <= 0.0)
+		return Test::Result();
+
+	const char* objPath = "ObjStreamTests.obj";
+	std::string cachePath = std::string(objPath) + MeshCache::Extension;
+	size_t expectedTriangles = WriteGridObj(objPath, GridSize,
+		(unsigned long long)(gigabytes * (1ull << 30)));
+	if (!CHECK(expectedTriangles > 0))
+		return Test::Result();
+
+	// Packed, with meshlets, like a streamed Mesh load would be
+	ObjStreamSettings settings;
+	settings.Budget = StreamingBudget;
+	settings.PackVertices = true;
+	settings.BuildMeshlets = true;
+
+	bool measured = ResetPeak();
+	size_t before = ReadStatus("VmRSS:");
+	size_t blockTriangles = 0;
+	CHECK(ObjStreamCache::Write(objPath, cachePath.c_str(), settings, &blockTriangles));
+	size_t peak = ReadStatus("VmHWM:");
+
+	if (measured && peak > 0)
+	{
+		size_t used = peak > before ? peak - before : 0;
+		std::printf("%zu triangles in blocks of %zu, peak %.1f MB over a %.1f MB budget\n",
+			expectedTriangles, blockTriangles, used / 1048576.0, StreamingBudget / 1048576.0);
+		CHECK(used <= StreamingBudget);
+	}
+	else
+	{
+		std::printf("Peak resident memory isn't available here, so only the output was checked\n");
+	}
+
+	// The finished cache must be readable, and the right size
+	MappedFile file(cachePath.c_str());
+	MeshCacheView view = {};
+	CHECK(file.IsOpen() && MeshCache::Read(file, view));
+	CHECK(view.Header && view.Header->IndexCount == expectedTriangles * 3);
+	CHECK(view.Header && view.Header->IndexStride == sizeof(uint32_t));
+	CHECK(view.Header && view.Header->VertexStride == sizeof(PackedVertex));
+	file.Close();
+
+	std::remove(objPath);
+	std::remove(cachePath.c_str());
+	return Test::Result();
+}
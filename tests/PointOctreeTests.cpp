@@ -0,0 +1,476 @@
+/*
+William Duprey
+12/10/24
+Point Octree Tests
+*/
+
+#include "PointOctree.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const char* PlyPath = "PointOctreeTests.ply";
+	const char* OctreePath = "PointOctreeTests.ply.octree";
+
+	// Far from the world's origin, like a real scan
+	const double Offset[3] = { 512345.25, 1830.5, -301234.75 };
+
+	struct SourcePoint
+	{
+		double Position[3];
+		uint8_t Color[3];
+	};
+
+	// --------------------------------------------------------
+	// A scan-like cloud: a bumpy ground plane, a few dense
+	// blobs, a thin scatter everywhere, a pile of points all at
+	// the same spot (which can never be split apart) and a
+	// handful with NaN coordinates (which must be dropped)
+	// --------------------------------------------------------
+	std::vector<SourcePoint> MakeCloud(size_t& validCount)
+	{
+		std::mt19937 random(540);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+		std::normal_distribution<double> gaussian;
+		std::vector<SourcePoint> points;
+		auto add = [&](double x, double y, double z)
+			{
+				SourcePoint p = { { Offset[0] + x, Offset[1] + y, Offset[2] + z },
+					{ (uint8_t)random(), (uint8_t)random(), (uint8_t)random() } };
+				points.push_back(p);
+			};
+
+		for (int i = 0; i < 150000; i++)
+		{
+			double x = unit(random) * 200.0;
+			double z = unit(random) * 120.0;
+			add(x, std::sin(x * 0.1) * std::cos(z * 0.07) * 3.0, z);
+		}
+		for (int blob = 0; blob < 4; blob++)
+		{
+			double center[3] = { 30.0 + blob * 40.0, 10.0, 60.0 };
+			for (int i = 0; i < 15000; i++)
+				add(center[0] + gaussian(random), center[1] + gaussian(random), center[2] + gaussian(random));
+		}
+		for (int i = 0; i < 5000; i++)
+			add(unit(random) * 200.0, unit(random) * 40.0 - 5.0, unit(random) * 120.0);
+		for (int i = 0; i < 3000; i++)
+			add(77.0, 1.0, 33.0);
+		validCount = points.size();
+
+		for (int i = 0; i < 10; i++)
+		{
+			add(1.0, 2.0, 3.0);
+			points.back().Position[i % 3] = NAN;
+		}
+		return points;
+	}
+
+	bool WritePly(const char* path, const std::vector<SourcePoint>& points)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file << "ply\nformat binary_little_endian 1.0\ncomment PointOctreeTests\n"
+			<< "element vertex " << points.size() << "\n"
+			<< "property double x\nproperty double y\nproperty double z\n"
+			<< "property uchar red\nproperty uchar green\nproperty uchar blue\nend_header\n";
+		for (const SourcePoint& p : points)
+		{
+			file.write((const char*)p.Position, sizeof(p.Position));
+			file.write((const char*)p.Color, sizeof(p.Color));
+		}
+		return file.good();
+	}
+
+	// Where the builder puts a source point (relative to the
+	// origin, z flipped to left-handed), as exact float bits
+	std::tuple<float, float, float> OctreePosition(const SourcePoint& p, const double origin[3])
+	{
+		return { (float)(p.Position[0] - origin[0]), (float)(p.Position[1] - origin[1]),
+			(float)(origin[2] - p.Position[2]) };
+	}
+
+	// Row-vector matrix product, like DirectXMath's
+	void Multiply(const float a[16], const float b[16], float result[16])
+	{
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+			{
+				result[r * 4 + c] = 0.0f;
+				for (int k = 0; k < 4; k++)
+					result[r * 4 + c] += a[r * 4 + k] * b[k * 4 + c];
+			}
+	}
+
+	// --------------------------------------------------------
+	// A left-handed perspective camera at "eye" looking at "at",
+	// set up the way PointCloud::Draw() hands it to the octree
+	// --------------------------------------------------------
+	PointOctreeCamera MakeCamera(const float eye[3], const float at[3], float fieldOfView,
+		float targetSpacing, uint64_t budget)
+	{
+		const float ScreenHeight = 1080.0f;
+		const float Aspect = 16.0f / 9.0f;
+		const float Near = 0.1f;
+		const float Far = 2000.0f;
+
+		float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+		float length = std::sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+		for (float& v : z)
+			v /= length;
+		float x[3] = { z[2], 0.0f, -z[0] };	// up (0, 1, 0) cross z
+		length = std::sqrt(x[0] * x[0] + x[2] * x[2]);
+		x[0] /= length;
+		x[2] /= length;
+		float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+		auto dot = [&](const float a[3]) { return a[0] * eye[0] + a[1] * eye[1] + a[2] * eye[2]; };
+		float view[16] =
+		{
+			x[0], y[0], z[0], 0.0f,
+			x[1], y[1], z[1], 0.0f,
+			x[2], y[2], z[2], 0.0f,
+			-dot(x), -dot(y), -dot(z), 1.0f
+		};
+
+		float yScale = 1.0f / std::tan(fieldOfView * 0.5f);
+		float range = Far / (Far - Near);
+		float projection[16] =
+		{
+			yScale / Aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, yScale, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -Near * range, 0.0f
+		};
+
+		PointOctreeCamera camera = {};
+		Multiply(view, projection, camera.ViewProjection);
+		std::memcpy(camera.Position, eye, sizeof(camera.Position));
+		camera.Perspective = true;
+		camera.PixelsPerUnit = ScreenHeight / (2.0f * std::tan(fieldOfView * 0.5f));
+		camera.TargetSpacing = targetSpacing;
+		camera.PointBudget = budget;
+		return camera;
+	}
+
+	// --------------------------------------------------------
+	// The built file: every valid point is in it with its
+	// color, every node's points are inside its cube, nodes
+	// that were split keep one point per sampling cell, leaves
+	// are small (except the pile that can't split), and the
+	// tree is a proper tree of halving cubes
+	// --------------------------------------------------------
+	void TestBuild(const PointOctreeView& view, const std::vector<SourcePoint>& source,
+		size_t validCount, const PointOctreeSettings& settings)
+	{
+		const PointOctreeHeader& header = *view.Header;
+		CHECK(header.SourcePointCount == source.size());
+		CHECK(header.PointCount >= validCount);
+		CHECK(header.SourceHash == 540);
+
+		// Every valid source point, with its color, by position
+		std::map<std::tuple<float, float, float>, std::pair<int, std::set<uint32_t>>> expected;
+		for (size_t i = 0; i < validCount; i++)
+		{
+			uint32_t color = source[i].Color[0] | (source[i].Color[1] << 8) |
+				(source[i].Color[2] << 16) | (0xFFu << 24);
+			auto& entry = expected[OctreePosition(source[i], header.Origin)];
+			entry.first++;
+			entry.second.insert(color);
+		}
+
+		std::vector<int> parents(header.NodeCount, 0);
+		uint64_t pointTotal = 0;
+		int outside = 0;
+		int sharedCells = 0;
+		int bigLeaves = 0;
+		int badChildren = 0;
+		int unknownPoints = 0;
+		std::map<std::tuple<float, float, float>, int> found;
+		for (uint32_t n = 0; n < header.NodeCount; n++)
+		{
+			const PointOctreeNode& node = view.Nodes[n];
+			pointTotal += node.PointCount;
+			if (node.ChildCount == 0 && node.PointCount > settings.MaxLeafPoints && node.Level < PointOctree::MaxLevel)
+				bigLeaves++;
+
+			std::set<std::tuple<uint32_t, uint32_t, uint32_t>> cells;
+			// Deep nodes far from the origin are only as exact as
+			// the floats their corners are stored in
+			float slack = node.Size * 1e-5f + 4.0f * FLT_EPSILON *
+				std::max({ std::fabs(node.Min[0]), std::fabs(node.Min[1]), std::fabs(node.Min[2]) });
+			for (uint64_t p = node.FirstPoint; p < node.FirstPoint + node.PointCount; p++)
+			{
+				const OctreePoint& point = view.Points[p];
+				uint32_t cell[3];
+				for (int a = 0; a < 3; a++)
+				{
+					float t = point.Position[a] - node.Min[a];
+					if (t < -slack || t > node.Size + slack)
+						outside++;
+					cell[a] = std::min((uint32_t)std::max(t / node.Spacing, 0.0f), settings.SampleGrid - 1);
+				}
+				if (node.ChildCount > 0 && !cells.insert({ cell[0], cell[1], cell[2] }).second)
+					sharedCells++;
+
+				auto key = std::make_tuple(point.Position[0], point.Position[1], point.Position[2]);
+				auto match = expected.find(key);
+				uint32_t color;
+				std::memcpy(&color, point.Color, sizeof(color));
+				if (match == expected.end() || !match->second.second.count(color))
+					unknownPoints++;
+				found[key]++;
+			}
+
+			for (uint32_t c = 0; c < node.ChildCount; c++)
+			{
+				const PointOctreeNode& child = view.Nodes[node.FirstChild + c];
+				parents[node.FirstChild + c]++;
+				bool corner = true;
+				for (int a = 0; a < 3; a++)
+				{
+					float offset = child.Min[a] - node.Min[a];
+					corner &= std::fabs(offset) <= slack || std::fabs(offset - child.Size) <= slack;
+				}
+				if (child.Level != node.Level + 1 || child.Size != node.Size * 0.5f || !corner ||
+					child.Spacing != child.Size / settings.SampleGrid)
+					badChildren++;
+			}
+		}
+
+		// Repeats (copies kept by the nodes above the chunks)
+		// are fine, but every point must be there
+		int missing = 0;
+		for (const auto& entry : expected)
+		{
+			auto match = found.find(entry.first);
+			if (match == found.end() || match->second < entry.second.first)
+				missing++;
+		}
+
+		int orphans = 0;
+		for (uint32_t n = 1; n < header.NodeCount; n++)
+			orphans += parents[n] != 1;
+
+		CHECK(pointTotal == header.PointCount);
+		CHECK(view.Nodes[0].Level == 0 && parents[0] == 0);
+		CHECK(orphans == 0);
+		CHECK(badChildren == 0);
+		CHECK(outside == 0);
+		CHECK(sharedCells == 0);
+		CHECK(bigLeaves == 0);
+		CHECK(unknownPoints == 0);
+		CHECK(missing == 0);
+		CHECK(header.MaxLevel == PointOctree::MaxLevel);
+		std::printf("%u nodes, %llu points stored for %zu\n", header.NodeCount,
+			(unsigned long long)header.PointCount, validCount);
+	}
+
+	uint32_t ParentOf(const PointOctreeView& view, uint32_t index)
+	{
+		for (uint32_t n = 0; n < view.Header->NodeCount; n++)
+		{
+			const PointOctreeNode& node = view.Nodes[n];
+			if (node.ChildCount > 0 && index >= node.FirstChild && index < node.FirstChild + node.ChildCount)
+				return n;
+		}
+		return ~0u;
+	}
+
+	// --------------------------------------------------------
+	// Selection: parents always come before their children,
+	// the budget is never exceeded, a smaller budget picks a
+	// prefix of what a bigger one does, nodes behind the camera
+	// are never picked, and the camera's surroundings get
+	// refined further than what's far away
+	// --------------------------------------------------------
+	void TestSelection(const PointOctreeView& view)
+	{
+		uint32_t nodeCount = view.Header->NodeCount;
+		const PointOctreeNode& root = view.Nodes[0];
+		float center[3];
+		for (int a = 0; a < 3; a++)
+			center[a] = root.Min[a] + root.Size * 0.5f;
+
+		// Far enough away to see everything: enough budget and
+		// no spacing target means every node
+		float far[3] = { center[0], center[1] + root.Size * 4.0f, center[2] - root.Size * 4.0f };
+		std::vector<uint32_t> selected;
+		uint64_t total = PointOctree::SelectNodes(view.Nodes, nodeCount,
+			MakeCamera(far, center, 1.0f, 0.0f, ~0ull), selected);
+		CHECK(selected.size() == nodeCount);
+		CHECK(total == view.Header->PointCount);
+
+		// A spacing target the root already meets: just the root
+		PointOctree::SelectNodes(view.Nodes, nodeCount, MakeCamera(far, center, 1.0f, 1e9f, ~0ull), selected);
+		CHECK(selected.size() == 1 && selected[0] == 0);
+
+		// Down at the ground, looking along it
+		float eye[3] = { root.Min[0] + root.Size * 0.3f, center[1], center[2] };
+		float at[3] = { root.Min[0] + root.Size, center[1], center[2] };
+		PointOctreeCamera camera = MakeCamera(eye, at, 1.2f, 1.5f, 200000);
+		std::vector<uint32_t> big;
+		total = PointOctree::SelectNodes(view.Nodes, nodeCount, camera, big);
+
+		uint64_t sum = 0;
+		int orderErrors = 0;
+		int behind = 0;
+		std::set<uint32_t> seen;
+		float nearLevel = 0.0f;
+		float farLevel = 0.0f;
+		int nearCount = 0;
+		int farCount = 0;
+		for (uint32_t index : big)
+		{
+			const PointOctreeNode& node = view.Nodes[index];
+			sum += node.PointCount;
+			if (index != 0 && !seen.count(ParentOf(view, index)))
+				orderErrors++;
+			seen.insert(index);
+
+			// Nodes whose bounding sphere is wholly behind the
+			// camera are outside the frustum
+			float half = node.Size * 0.5f;
+			if (node.Min[0] + half + half * std::sqrt(3.0f) < eye[0])
+				behind++;
+
+			// Average depth of deep-enough nodes near and far
+			float distance = node.Min[0] + node.Size * 0.5f - eye[0];
+			if (node.Level >= 3 && distance < root.Size * 0.15f)
+			{
+				nearLevel += node.Level;
+				nearCount++;
+			}
+			else if (node.Level >= 3 && distance > root.Size * 0.45f)
+			{
+				farLevel += node.Level;
+				farCount++;
+			}
+		}
+		CHECK(total == sum);
+		CHECK(total <= camera.PointBudget);
+		CHECK(big.size() == seen.size());
+		CHECK(orderErrors == 0);
+		CHECK(behind == 0);
+		CHECK(nearCount > 0 && farCount > 0 &&
+			nearLevel / nearCount > farLevel / farCount);
+
+		// Less budget: the same walk, stopped sooner
+		camera.PointBudget = total / 3;
+		std::vector<uint32_t> small;
+		CHECK(PointOctree::SelectNodes(view.Nodes, nodeCount, camera, small) <= camera.PointBudget);
+		CHECK(!small.empty() && small.size() < big.size());
+		CHECK(std::equal(small.begin(), small.end(), big.begin()));
+
+		// Outside the cloud, looking away from it: nothing
+		float away[3] = { root.Min[0] - root.Size, center[1], center[2] };
+		float awayAt[3] = { away[0] - root.Size, center[1], center[2] };
+		PointOctree::SelectNodes(view.Nodes, nodeCount, MakeCamera(away, awayAt, 1.0f, 1.0f, ~0ull), selected);
+		CHECK(selected.empty());
+	}
+
+	// --------------------------------------------------------
+	// Read() rejects files that are cut short or whose node
+	// table would send SelectNodes() somewhere it shouldn't go
+	// --------------------------------------------------------
+	void TestCorruptFiles(const std::vector<char>& bytes)
+	{
+		const char* path = "PointOctreeTests.bad.octree";
+		auto readsBack = [&](const std::vector<char>& data)
+			{
+				{
+					std::ofstream file(path, std::ios::binary);
+					file.write(data.data(), (std::streamsize)data.size());
+				}
+				MappedFile file(path);
+				PointOctreeView view = {};
+				bool ok = PointOctree::Read(file, view);
+				file.Close();
+				return ok;
+			};
+
+		CHECK(readsBack(bytes));
+
+		std::vector<char> bad(bytes.begin(), bytes.end() - 1);
+		CHECK(!readsBack(bad));
+		bad.assign(bytes.begin(), bytes.begin() + sizeof(PointOctreeHeader) - 1);
+		CHECK(!readsBack(bad));
+
+		bad = bytes;
+		bad[0] = 'X';
+		CHECK(!readsBack(bad));
+
+		PointOctreeHeader header;
+		std::memcpy(&header, bytes.data(), sizeof(header));
+		auto withNode = [&](uint32_t index, auto change)
+			{
+				std::vector<char> data = bytes;
+				PointOctreeNode node;
+				char* at = &data[header.NodeOffset + sizeof(PointOctreeNode) * index];
+				std::memcpy(&node, at, sizeof(node));
+				change(node);
+				std::memcpy(at, &node, sizeof(node));
+				return data;
+			};
+
+		// A loop back to the root, children past the end, too
+		// many children and points past the end all fail
+		CHECK(!readsBack(withNode(0, [](PointOctreeNode& node) { node.FirstChild = 0; })));
+		CHECK(!readsBack(withNode(0, [&](PointOctreeNode& node) { node.FirstChild = header.NodeCount - 1; })));
+		CHECK(!readsBack(withNode(0, [](PointOctreeNode& node) { node.ChildCount = 9; })));
+		CHECK(!readsBack(withNode(header.NodeCount - 1, [&](PointOctreeNode& node)
+			{
+				node.FirstPoint = header.PointCount - node.PointCount + 1;
+			})));
+		std::remove(path);
+	}
+}
+
+// --------------------------------------------------------
+// Builds an octree from a synthetic scan with a small memory
+// budget (so it's split into chunks), then checks the file
+// and the node selection on it
+// --------------------------------------------------------
+int main()
+{
+	size_t validCount = 0;
+	std::vector<SourcePoint> source = MakeCloud(validCount);
+	if (!CHECK(WritePly(PlyPath, source)))
+		return Test::Result();
+
+	PointOctreeSettings settings;
+	settings.MaxLeafPoints = 2000;
+	settings.SampleGrid = 32;
+	settings.MemoryBudget = 1 << 20;
+	if (!CHECK(PointOctree::Build(PlyPath, OctreePath, 540, settings)))
+		return Test::Result();
+
+	MappedFile file(OctreePath);
+	PointOctreeView view = {};
+	if (CHECK(file.IsOpen() && PointOctree::Read(file, view)))
+	{
+		TestBuild(view, source, validCount, settings);
+		TestSelection(view);
+
+		std::vector<char> bytes(file.GetData(), file.GetData() + file.GetSize());
+		file.Close();
+		TestCorruptFiles(bytes);
+	}
+
+	file.Close();
+	std::remove(PlyPath);
+	std::remove(OctreePath);
+	return Test::Result();
+}
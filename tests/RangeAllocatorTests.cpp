@@ -0,0 +1,233 @@
+/*
+William Duprey
+12/10/24
+Range Allocator Tests
+*/
+
+#include "RangeAllocator.h"
+#include "TestHelpers.h"
+
+#include <random>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// The smallest free range that fits wins, and the lowest
+	// offset wins between ranges of the same size
+	// --------------------------------------------------------
+	void TestBestFit()
+	{
+		RangeAllocator allocator(100);
+		size_t a = allocator.Allocate(10);	// [0, 10)
+		size_t b = allocator.Allocate(30);	// [10, 40)
+		size_t c = allocator.Allocate(5);	// [40, 45)
+		size_t d = allocator.Allocate(20);	// [45, 65)
+		size_t e = allocator.Allocate(10);	// [65, 75)
+		CHECK(a == 0 && b == 10 && c == 40 && d == 45 && e == 65);
+
+		// Free: [10, 40) is 30, [45, 65) is 20, [75, 100) is 25
+		allocator.Free(b, 30);
+		allocator.Free(d, 20);
+		CHECK(allocator.GetFreeRangeCount() == 3);
+		CHECK(allocator.Allocate(18) == 45);
+		CHECK(allocator.Allocate(24) == 75);
+		CHECK(allocator.Allocate(31) == RangeAllocator::InvalidOffset);
+		CHECK(allocator.Allocate(30) == 10);
+
+		// Two free ranges of the same size
+		RangeAllocator ties(40);
+		size_t first = ties.Allocate(10);
+		ties.Allocate(10);
+		size_t third = ties.Allocate(10);
+		ties.Allocate(10);
+		ties.Free(third, 10);
+		ties.Free(first, 10);
+		CHECK(ties.Allocate(10) == first);
+		CHECK(ties.Allocate(10) == third);
+
+		CHECK(allocator.Allocate(0) == RangeAllocator::InvalidOffset);
+	}
+
+	// --------------------------------------------------------
+	// A freed range merges with free neighbors on either side
+	// --------------------------------------------------------
+	void TestCoalescing()
+	{
+		RangeAllocator allocator(40);
+		size_t a = allocator.Allocate(10);
+		size_t b = allocator.Allocate(10);
+		size_t c = allocator.Allocate(10);
+		size_t d = allocator.Allocate(10);
+		CHECK(allocator.GetFreeRangeCount() == 0);
+		CHECK(allocator.GetLargestFree() == 0);
+
+		allocator.Free(a, 10);
+		allocator.Free(c, 10);
+		CHECK(allocator.GetFreeRangeCount() == 2);
+		CHECK(allocator.GetFragmentation() == 0.5f);
+
+		// Between two free ranges: all three become one
+		allocator.Free(b, 10);
+		CHECK(allocator.GetFreeRangeCount() == 1);
+		CHECK(allocator.GetLargestFree() == 30);
+		CHECK(allocator.GetFragmentation() == 0.0f);
+
+		// After a free range
+		allocator.Free(d, 10);
+		CHECK(allocator.GetFreeRangeCount() == 1);
+		CHECK(allocator.GetLargestFree() == 40);
+
+		// Before a free range
+		a = allocator.Allocate(20);
+		b = allocator.Allocate(20);
+		allocator.Free(b, 20);
+		allocator.Free(a, 20);
+		CHECK(allocator.GetFreeRangeCount() == 1);
+		CHECK(allocator.Allocate(40) == 0);
+	}
+
+	// --------------------------------------------------------
+	// Growing adds free space at the end, which joins a free
+	// range already there, and never shrinks anything
+	// --------------------------------------------------------
+	void TestGrow()
+	{
+		RangeAllocator empty;
+		CHECK(empty.GetCapacity() == 0);
+		CHECK(empty.Allocate(1) == RangeAllocator::InvalidOffset);
+		empty.Grow(8);
+		CHECK(empty.Allocate(8) == 0);
+
+		RangeAllocator allocator(30);
+		size_t a = allocator.Allocate(20);
+		CHECK(allocator.Allocate(20) == RangeAllocator::InvalidOffset);
+		allocator.Grow(50);
+		CHECK(allocator.GetCapacity() == 50);
+		CHECK(allocator.GetUsed() == 20);
+		CHECK(allocator.GetFreeRangeCount() == 1);
+		CHECK(allocator.GetLargestFree() == 30);
+		CHECK(allocator.Allocate(30) == 20);
+
+		allocator.Grow(40);
+		CHECK(allocator.GetCapacity() == 50);
+		allocator.Grow(60);
+		CHECK(allocator.GetUsed() == 50);
+		CHECK(allocator.GetLargestFree() == 10);
+		allocator.Free(a, 20);
+		CHECK(allocator.GetUsed() == 30);
+		CHECK(allocator.GetFreeRangeCount() == 2);
+	}
+
+	// --------------------------------------------------------
+	// 200k random allocations and frees, checked against a
+	// unit-by-unit map of the same space: no overlaps, nothing
+	// outside the capacity, used adds up, and every allocation
+	// lands where a brute force best fit would put it
+	// --------------------------------------------------------
+	void TestRandomOperations()
+	{
+		const int Operations = 200000;
+		const size_t Capacity = 2048;
+
+		struct Allocation { size_t Offset; size_t Size; };
+		std::vector<Allocation> live;
+		std::vector<bool> taken(Capacity, false);
+		size_t used = 0;
+
+		std::mt19937 random(540);
+		RangeAllocator allocator(Capacity);
+		int wrongPlace = 0;
+		int overlaps = 0;
+		int wrongUsed = 0;
+		int grows = 0;
+		for (int op = 0; op < Operations; op++)
+		{
+			if (live.empty() || random() % 2 == 0)
+			{
+				size_t size = 1 + random() % (random() % 8 == 0 ? 256 : 16);
+
+				// Smallest free run that fits, lowest offset first
+				size_t expected = RangeAllocator::InvalidOffset;
+				size_t expectedSize = (size_t)-1;
+				for (size_t i = 0; i < taken.size();)
+				{
+					if (taken[i])
+					{
+						i++;
+						continue;
+					}
+					size_t start = i;
+					while (i < taken.size() && !taken[i])
+						i++;
+					size_t run = i - start;
+					if (run >= size && run < expectedSize)
+					{
+						expected = start;
+						expectedSize = run;
+					}
+				}
+
+				size_t offset = allocator.Allocate(size);
+				if (offset != expected)
+					wrongPlace++;
+				if (offset == RangeAllocator::InvalidOffset)
+				{
+					// Out of room now and then, so grow a little
+					if (grows < 4)
+					{
+						allocator.Grow(taken.size() + 512);
+						taken.resize(taken.size() + 512, false);
+						grows++;
+					}
+					continue;
+				}
+
+				for (size_t i = offset; i < offset + size; i++)
+				{
+					if (i >= taken.size() || taken[i])
+						overlaps++;
+					else
+						taken[i] = true;
+				}
+				live.push_back({ offset, size });
+				used += size;
+			}
+			else
+			{
+				size_t index = random() % live.size();
+				Allocation freed = live[index];
+				live[index] = live.back();
+				live.pop_back();
+				allocator.Free(freed.Offset, freed.Size);
+				for (size_t i = freed.Offset; i < freed.Offset + freed.Size; i++)
+					taken[i] = false;
+				used -= freed.Size;
+			}
+
+			if (allocator.GetUsed() != used)
+				wrongUsed++;
+		}
+		CHECK(wrongPlace == 0);
+		CHECK(overlaps == 0);
+		CHECK(wrongUsed == 0);
+		CHECK(allocator.GetCapacity() == taken.size());
+
+		// Everything freed is one range again
+		for (const Allocation& allocation : live)
+			allocator.Free(allocation.Offset, allocation.Size);
+		CHECK(allocator.GetUsed() == 0);
+		CHECK(allocator.GetFreeRangeCount() == 1);
+		CHECK(allocator.GetLargestFree() == allocator.GetCapacity());
+	}
+}
+
+int main()
+{
+	TestBestFit();
+	TestCoalescing();
+	TestGrow();
+	TestRandomOperations();
+	return Test::Result();
+}
@@ -0,0 +1,226 @@
+/*
+William Duprey
+12/10/24
+Tangent Generator Tests
+*/
+
+#include "TangentGenerator.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Same layout as Mesh's Vertex, without DirectXMath
+	// (11 floats), optionally padded out to "Stride" floats
+	struct TestMesh
+	{
+		size_t Stride = 11;
+		std::vector<float> Vertices;
+		std::vector<unsigned int> Indices;
+
+		size_t VertexCount() const { return Vertices.size() / Stride; }
+		float* Position() { return &Vertices[0]; }
+		float* Normal() { return &Vertices[3]; }
+		float* Tangent() { return &Vertices[6]; }
+		float* UV() { return &Vertices[9]; }
+	};
+
+	// --------------------------------------------------------
+	// A bumpy grid of rows x columns quads, in random triangle
+	// order, with a vertex no triangle uses on the end. With
+	// "seams", it also gets the trouble spots real meshes have
+	// sprinkled in: triangles with no UV area, triangles that
+	// reuse a vertex, and mirrored UVs (tangents that nearly
+	// cancel out). Garbage is left in the tangents, since they
+	// must be overwritten.
+	// --------------------------------------------------------
+	TestMesh MakeGrid(std::mt19937& random, unsigned int rows, unsigned int columns,
+		size_t stride, bool seams)
+	{
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		TestMesh mesh;
+		mesh.Stride = stride;
+		for (unsigned int y = 0; y <= rows; y++)
+			for (unsigned int x = 0; x <= columns; x++)
+			{
+				float height = 0.2f * std::sin(x * 0.3f) * std::cos(y * 0.2f);
+				float normal[3] = { unit(random) - 0.5f, 1.0f, unit(random) - 0.5f };
+				float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				float u = (float)x / columns;
+				float v = (float)y / rows;
+
+				// Every 7th column's UVs mirror, and every 13th row's are flat
+				if (seams && x % 7 == 0)
+					u = -u;
+				if (seams && y % 13 == 0)
+					v = 0.5f;
+
+				std::vector<float> vertex(stride, 123.0f);
+				float values[11] =
+				{
+					(float)x, height, (float)y,
+					normal[0] / length, normal[1] / length, normal[2] / length,
+					unit(random), unit(random), unit(random),
+					u, v
+				};
+				std::memcpy(vertex.data(), values, sizeof(values));
+				mesh.Vertices.insert(mesh.Vertices.end(), vertex.begin(), vertex.end());
+			}
+
+		std::vector<unsigned int> triangles;
+		for (unsigned int y = 0; y < rows; y++)
+			for (unsigned int x = 0; x < columns; x++)
+			{
+				unsigned int a = y * (columns + 1) + x;
+				unsigned int b = a + 1;
+				unsigned int c = a + columns + 1;
+				unsigned int d = c + 1;
+				if (seams && random() % 97 == 0)
+					b = a;
+				unsigned int quad[6] = { a, b, c, b, d, c };
+				triangles.insert(triangles.end(), quad, quad + 6);
+			}
+
+		// Shuffle whole triangles, so the SSE groups of four
+		// don't line up with anything in the grid
+		size_t triangleCount = triangles.size() / 3;
+		std::vector<size_t> order(triangleCount);
+		for (size_t i = 0; i < triangleCount; i++)
+			order[i] = i;
+		for (size_t i = triangleCount; i > 1; i--)
+			std::swap(order[i - 1], order[random() % i]);
+		for (size_t t : order)
+			mesh.Indices.insert(mesh.Indices.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+
+		// One vertex on the end that nothing uses
+		std::vector<float> unused(stride, 0.0f);
+		unused[4] = 1.0f;
+		mesh.Vertices.insert(mesh.Vertices.end(), unused.begin(), unused.end());
+		return mesh;
+	}
+
+	std::vector<float> ScalarTangents(TestMesh mesh)
+	{
+		TangentGenerator::CalculateScalar(mesh.Position(), mesh.Normal(), mesh.UV(), mesh.Tangent(),
+			sizeof(float) * mesh.Stride, mesh.VertexCount(), mesh.Indices.data(), mesh.Indices.size());
+		return mesh.Vertices;
+	}
+
+	std::vector<float> Tangents(TestMesh mesh, size_t indexCount, unsigned int threads)
+	{
+		TangentGenerator::Calculate(mesh.Position(), mesh.Normal(), mesh.UV(), mesh.Tangent(),
+			sizeof(float) * mesh.Stride, mesh.VertexCount(), mesh.Indices.data(), indexCount, threads);
+		return mesh.Vertices;
+	}
+
+	// Largest difference between two meshes' tangents (NaN
+	// if either has one), and whether the rest is untouched
+	float TangentDifference(const std::vector<float>& a, const std::vector<float>& b,
+		size_t stride, bool& othersMatch)
+	{
+		float worst = 0.0f;
+		othersMatch = true;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			size_t member = i % stride;
+			if (member >= 6 && member < 9)
+				worst = std::isnan(a[i]) || std::isnan(b[i]) ? NAN : std::fmax(worst, std::fabs(a[i] - b[i]));
+			else
+				othersMatch &= a[i] == b[i];
+		}
+		return worst;
+	}
+
+	// --------------------------------------------------------
+	// One thread takes the SSE path but adds in the same order
+	// as the scalar version, so it must match it bit for bit,
+	// for any triangle count (the groups of four have tails)
+	// and for padded vertices as well as tight ones
+	// --------------------------------------------------------
+	void TestOneThreadExact()
+	{
+		std::mt19937 random(540);
+		for (size_t stride : { (size_t)11, (size_t)12, (size_t)16 })
+		{
+			TestMesh mesh = MakeGrid(random, 40, 37, stride, true);
+			int mismatched = 0;
+			for (size_t triangles : { (size_t)0, (size_t)1, (size_t)2, (size_t)3, (size_t)5, (size_t)1001,
+				mesh.Indices.size() / 3 })
+			{
+				TestMesh part = mesh;
+				part.Indices.resize(triangles * 3);
+				std::vector<float> expected = ScalarTangents(part);
+				std::vector<float> actual = Tangents(part, part.Indices.size(), 1);
+				if (std::memcmp(expected.data(), actual.data(), sizeof(float) * expected.size()) != 0)
+					mismatched++;
+			}
+			CHECK(mismatched == 0);
+		}
+
+		// Leftover indices that aren't a whole triangle are ignored
+		TestMesh mesh = MakeGrid(random, 4, 4, 11, true);
+		std::vector<float> expected = Tangents(mesh, mesh.Indices.size(), 1);
+		mesh.Indices.push_back(0);
+		mesh.Indices.push_back(1);
+		std::vector<float> actual = Tangents(mesh, mesh.Indices.size(), 1);
+		CHECK(std::memcmp(expected.data(), actual.data(), sizeof(float) * expected.size()) == 0);
+	}
+
+	// --------------------------------------------------------
+	// More threads only change the order the sums are added in.
+	// Where the sums are well conditioned, each tangent lands
+	// within a few float steps of the scalar one. Where they
+	// nearly cancel (mirrored UV seams), order can move them a
+	// bit more, but they're still never NaN, always unit length
+	// and orthogonal to their normal as far as one pass of Gram-
+	// Schmidt gets them (the scalar version does no better).
+	// The same thread count must also give the same bits.
+	// --------------------------------------------------------
+	void TestThreadsClose()
+	{
+		const float Tolerance = 1e-6f;
+		const float SeamTolerance = 1e-3f;
+		const float OrthogonalTolerance = 1e-4f;
+		std::mt19937 random(541);
+		for (bool seams : { false, true })
+		{
+			TestMesh mesh = MakeGrid(random, 400, 300, 11, seams);
+			std::vector<float> expected = ScalarTangents(mesh);
+			for (unsigned int threads : { 0u, 2u, 3u, 4u, 7u, 16u })
+			{
+				std::vector<float> actual = Tangents(mesh, mesh.Indices.size(), threads);
+				bool othersMatch = false;
+				float difference = TangentDifference(expected, actual, mesh.Stride, othersMatch);
+				CHECK(difference <= (seams ? SeamTolerance : Tolerance));
+				CHECK(othersMatch);
+
+				std::vector<float> again = Tangents(mesh, mesh.Indices.size(), threads);
+				CHECK(std::memcmp(actual.data(), again.data(), sizeof(float) * actual.size()) == 0);
+
+				int badTangents = 0;
+				for (size_t v = 0; v < mesh.VertexCount(); v++)
+				{
+					const float* n = &actual[v * mesh.Stride + 3];
+					const float* t = &actual[v * mesh.Stride + 6];
+					float length = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+					float dot = n[0] * t[0] + n[1] * t[1] + n[2] * t[2];
+					if (!(std::fabs(length - 1.0f) <= 1e-5f && std::fabs(dot) <= OrthogonalTolerance))
+						badTangents++;
+				}
+				CHECK(badTangents == 0);
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestOneThreadExact();
+	TestThreadsClose();
+	return Test::Result();
+}
@@ -0,0 +1,38 @@
+/*
+William Duprey
+12/10/24
+Test Helpers Header
+*/
+
+#pragma once
+#include <cstdio>
+
+// --------------------------------------------------------
+// Bare-bones checks for the portable module tests. A failed
+// check prints where it was and what failed, and the test
+// keeps going, so one run shows every failure. Each test's
+// main() returns Test::Result().
+// --------------------------------------------------------
+namespace Test
+{
+	inline int Failures = 0;
+
+	inline bool Check(bool passed, const char* expression, const char* file, int line)
+	{
+		if (!passed)
+		{
+			std::printf("%s(%d): check failed: %s\n", file, line, expression);
+			Failures++;
+		}
+		return passed;
+	}
+
+	inline int Result()
+	{
+		if (Failures > 0)
+			std::printf("%d check(s) failed\n", Failures);
+		return Failures > 0 ? 1 : 0;
+	}
+}
+
+#define CHECK(expression) Test::Check((expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,383 @@
+/*
+William Duprey
+12/10/24
+Transform Store Tests
+*/
+
+#include "TransformStore.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// What a slot should hold, kept on the side in doubles
+	// --------------------------------------------------------
+	struct Expected
+	{
+		float Position[3];
+		float Rotation[4];
+		float Scale[3];
+		int Parent;
+	};
+
+	void Multiply(const double* a, const double* b, double* result)
+	{
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+			{
+				double sum = 0.0;
+				for (int k = 0; k < 4; k++)
+					sum += a[r * 4 + k] * b[k * 4 + c];
+				result[r * 4 + c] = sum;
+			}
+	}
+
+	// --------------------------------------------------------
+	// A general 4x4 inverse (Gauss-Jordan, partial pivoting),
+	// which knows nothing about how the matrix was made
+	// --------------------------------------------------------
+	void Inverse(const double* m, double* result)
+	{
+		double a[4][8];
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+			{
+				a[r][c] = m[r * 4 + c];
+				a[r][4 + c] = r == c ? 1.0 : 0.0;
+			}
+
+		for (int c = 0; c < 4; c++)
+		{
+			int pivot = c;
+			for (int r = c + 1; r < 4; r++)
+				if (std::fabs(a[r][c]) > std::fabs(a[pivot][c]))
+					pivot = r;
+			std::swap(a[c], a[pivot]);
+
+			double d = a[c][c];
+			for (int k = 0; k < 8; k++)
+				a[c][k] /= d;
+			for (int r = 0; r < 4; r++)
+			{
+				if (r == c)
+					continue;
+				double f = a[r][c];
+				for (int k = 0; k < 8; k++)
+					a[r][k] -= f * a[c][k];
+			}
+		}
+
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				result[r * 4 + c] = a[r][4 + c];
+	}
+
+	// The inverse of the transpose, the long way
+	void InverseTranspose(const float* world, double* result)
+	{
+		double transpose[16];
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				transpose[r * 4 + c] = world[c * 4 + r];
+		Inverse(transpose, result);
+	}
+
+	// --------------------------------------------------------
+	// Scale, then rotation, then translation, multiplied out
+	// in full, then the parents' world matrices on top
+	// --------------------------------------------------------
+	void ExpectedWorld(const std::vector<Expected>& slots, int slot, double* world)
+	{
+		const Expected& e = slots[slot];
+		double x = e.Rotation[0], y = e.Rotation[1], z = e.Rotation[2], w = e.Rotation[3];
+		double rotation[16] =
+		{
+			1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0,
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0,
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0,
+			0, 0, 0, 1
+		};
+		double scale[16] = { e.Scale[0], 0, 0, 0, 0, e.Scale[1], 0, 0, 0, 0, e.Scale[2], 0, 0, 0, 0, 1 };
+		double translation[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0,
+			e.Position[0], e.Position[1], e.Position[2], 1 };
+
+		double scaled[16], local[16];
+		Multiply(scale, rotation, scaled);
+		Multiply(scaled, translation, local);
+		if (e.Parent < 0)
+		{
+			std::copy(local, local + 16, world);
+			return;
+		}
+		double parent[16];
+		ExpectedWorld(slots, e.Parent, parent);
+		Multiply(local, parent, world);
+	}
+
+	// Biggest difference, relative to the biggest element in
+	// the same row (or 1, if that's smaller), since floats can
+	// only be so close to 0 after adding up big numbers
+	double RelativeError(const float* actual, const double* expected)
+	{
+		double worst = 0.0;
+		for (int r = 0; r < 4; r++)
+		{
+			double size = 1.0;
+			for (int c = 0; c < 4; c++)
+				size = std::max(size, std::fabs(expected[r * 4 + c]));
+			for (int c = 0; c < 4; c++)
+				worst = std::max(worst, std::fabs(actual[r * 4 + c] - expected[r * 4 + c]) / size);
+		}
+		return worst;
+	}
+
+	// --------------------------------------------------------
+	// Random translations, rotations and scales, a third of
+	// them uniform and some mirrored, with every fifth slot
+	// under a random earlier one. Every world matrix must match
+	// the long way, and every inverse transpose must match a
+	// general inverse of it, whether it was built in the batch
+	// or skipped and built when asked for.
+	// --------------------------------------------------------
+	void TestRandomTransforms()
+	{
+		const int Count = 20000;
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+
+		TransformStore store;
+		std::vector<Expected> expected(Count);
+		auto randomize = [&](int i)
+		{
+			Expected& e = expected[i];
+			TransformStore::EulerToQuaternion(angle(random), angle(random), angle(random), e.Rotation);
+			for (int a = 0; a < 3; a++)
+				e.Position[a] = position(random);
+			if (random() % 3 == 0)
+				e.Scale[0] = e.Scale[1] = e.Scale[2] = scale(random);
+			else
+			{
+				for (int a = 0; a < 3; a++)
+					e.Scale[a] = scale(random);
+				if (random() % 8 == 0)
+					e.Scale[0] = -e.Scale[0];
+			}
+			store.SetPosition(i, e.Position[0], e.Position[1], e.Position[2]);
+			store.SetRotation(i, e.Rotation[0], e.Rotation[1], e.Rotation[2], e.Rotation[3]);
+			store.SetScale(i, e.Scale[0], e.Scale[1], e.Scale[2]);
+		};
+
+		for (int i = 0; i < Count; i++)
+		{
+			CHECK(store.Allocate() == (uint32_t)i);
+			randomize(i);
+			expected[i].Parent = -1;
+			if (i % 5 == 4)
+			{
+				expected[i].Parent = (int)(random() % i);
+				store.SetParent(i, expected[i].Parent);
+			}
+		}
+
+		auto checkAll = [&]()
+		{
+			double worldError = 0.0;
+			double inverseError = 0.0;
+			int uniformWrong = 0;
+			for (int i = 0; i < Count; i++)
+			{
+				double world[16], inverseTranspose[16];
+				ExpectedWorld(expected, i, world);
+				const float* actual = store.GetWorldMatrix(i);
+				worldError = std::max(worldError, RelativeError(actual, world));
+				InverseTranspose(actual, inverseTranspose);
+				inverseError = std::max(inverseError,
+					RelativeError(store.GetWorldInverseTransposeMatrix(i), inverseTranspose));
+
+				// Uniform means the rows are orthogonal and the same
+				// length, so normals can skip the inverse transpose
+				if (store.HasUniformScale(i))
+				{
+					double lengths[3], dots[3];
+					for (int r = 0; r < 3; r++)
+					{
+						const float* u = actual + r * 4;
+						const float* v = actual + ((r + 1) % 3) * 4;
+						lengths[r] = (double)u[0] * u[0] + (double)u[1] * u[1] + (double)u[2] * u[2];
+						dots[r] = (double)u[0] * v[0] + (double)u[1] * v[1] + (double)u[2] * v[2];
+					}
+					for (int r = 0; r < 3; r++)
+					{
+						if (std::fabs(lengths[r] - lengths[0]) > lengths[0] * 1e-4 ||
+							std::fabs(dots[r]) > lengths[0] * 1e-4)
+							uniformWrong++;
+					}
+				}
+			}
+			std::printf("world error %g, inverse transpose error %g\n", worldError, inverseError);
+			CHECK(worldError < 1e-4);
+			CHECK(inverseError < 1e-3);
+			CHECK(uniformWrong == 0);
+		};
+
+		store.UpdateDirty(1);
+		CHECK(store.GetDirtyCount() == 0);
+		checkAll();
+
+		// Change some slots (switching between uniform and not),
+		// ask for a few of them before the next batch, then update
+		// the rest on several threads
+		for (int round = 0; round < 3; round++)
+		{
+			for (int i = 0; i < Count; i += 1 + (int)(random() % 7))
+				randomize(i);
+			for (int i = 0; i < Count; i += 97)
+			{
+				double world[16], inverseTranspose[16];
+				ExpectedWorld(expected, i, world);
+				const float* actual = store.GetWorldMatrix(i);
+				CHECK(RelativeError(actual, world) < 1e-4);
+				InverseTranspose(actual, inverseTranspose);
+				CHECK(RelativeError(store.GetWorldInverseTransposeMatrix(i), inverseTranspose) < 1e-3);
+			}
+			store.UpdateDirty(4);
+			CHECK(store.GetDirtyCount() == 0);
+			checkAll();
+		}
+	}
+
+	// --------------------------------------------------------
+	// Splitting the batch across threads must not change a bit
+	// --------------------------------------------------------
+	void TestThreadsMatch()
+	{
+		const int Count = 100000;
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> value(-5.0f, 5.0f);
+
+		TransformStore one, several;
+		for (int i = 0; i < Count; i++)
+		{
+			one.Allocate();
+			several.Allocate();
+			float q[4];
+			TransformStore::EulerToQuaternion(value(random), value(random), value(random), q);
+			float x = value(random), y = value(random), z = value(random);
+			one.SetRotation(i, q[0], q[1], q[2], q[3]);
+			several.SetRotation(i, q[0], q[1], q[2], q[3]);
+			one.SetPosition(i, x, y, z);
+			several.SetPosition(i, x, y, z);
+			if (i % 2)
+			{
+				one.SetScale(i, 1.0f, 2.0f, 3.0f);
+				several.SetScale(i, 1.0f, 2.0f, 3.0f);
+			}
+		}
+		one.UpdateDirty(1);
+		several.UpdateDirty(7);
+
+		int different = 0;
+		for (int i = 0; i < Count; i++)
+		{
+			different += std::memcmp(one.GetWorldMatrix(i), several.GetWorldMatrix(i), 64) != 0;
+			different += std::memcmp(one.GetWorldInverseTransposeMatrix(i),
+				several.GetWorldInverseTransposeMatrix(i), 64) != 0;
+		}
+		CHECK(different == 0);
+	}
+
+	// --------------------------------------------------------
+	// Parents can't be their own descendants, released slots
+	// come back as identity, and a parent's change reaches its
+	// descendants' versions and matrices
+	// --------------------------------------------------------
+	void TestHierarchy()
+	{
+		TransformStore store;
+		uint32_t a = store.Allocate();
+		uint32_t b = store.Allocate();
+		uint32_t c = store.Allocate();
+		CHECK(store.SetParent(b, a));
+		CHECK(store.SetParent(c, b));
+		CHECK(!store.SetParent(a, c));
+		CHECK(!store.SetParent(a, a));
+		store.UpdateDirty();
+
+		uint64_t version = store.GetVersion(c);
+		store.SetPosition(a, 1.0f, 2.0f, 3.0f);
+		CHECK(store.GetVersion(c) != version);
+		const float* world = store.GetWorldMatrix(c);
+		CHECK(world[12] == 1.0f && world[13] == 2.0f && world[14] == 3.0f);
+
+		store.SetScale(b, 2.0f, 2.0f, 2.0f);
+		CHECK(store.HasUniformScale(c));
+		store.SetScale(a, 1.0f, 2.0f, 1.0f);
+		CHECK(!store.HasUniformScale(c));
+
+		store.SetPosition(b, 5.0f, 5.0f, 5.0f);
+		store.Release(b);
+		CHECK(store.GetParent(c) == TransformStore::NoParent);
+		CHECK(store.GetCount() == 2);
+		uint32_t reused = store.Allocate();
+		CHECK(reused == b);
+		const float* identity = store.GetWorldMatrix(reused);
+		const float* identityInverse = store.GetWorldInverseTransposeMatrix(reused);
+		for (int e = 0; e < 16; e++)
+		{
+			float expected = e % 5 == 0 ? 1.0f : 0.0f;
+			CHECK(identity[e] == expected);
+			CHECK(identityInverse[e] == expected);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Euler angles survive a round trip through a quaternion,
+	// as the same rotation (angles may differ at the poles)
+	// --------------------------------------------------------
+	void TestEulerRoundTrip()
+	{
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		std::uniform_real_distribution<float> pitch(-1.4f, 1.4f);
+
+		double worst = 0.0;
+		for (int i = 0; i < 100000; i++)
+		{
+			float p = pitch(random), y = angle(random), r = angle(random);
+			float q[4];
+			TransformStore::EulerToQuaternion(p, y, r, q);
+			float p2, y2, r2;
+			TransformStore::QuaternionToEuler(q, p2, y2, r2);
+			worst = std::max(worst, (double)std::fabs(p2 - p));
+			worst = std::max(worst, std::fabs(std::remainder((double)y2 - y, 6.283185307)));
+			worst = std::max(worst, std::fabs(std::remainder((double)r2 - r, 6.283185307)));
+		}
+		CHECK(worst < 1e-3);
+
+		// All zeroes can't be normalized, so it's the identity
+		TransformStore store;
+		uint32_t slot = store.Allocate();
+		store.SetRotation(slot, 0.0f, 0.0f, 0.0f, 0.0f);
+		float x, y, z, w;
+		store.GetRotation(slot, x, y, z, w);
+		CHECK(x == 0.0f && y == 0.0f && z == 0.0f && w == 1.0f);
+	}
+}
+
+int main()
+{
+	TestRandomTransforms();
+	TestThreadsMatch();
+	TestHierarchy();
+	TestEulerRoundTrip();
+	return Test::Result();
+}
@@ -0,0 +1,382 @@
+/*
+William Duprey
+12/10/24
+Triangle BVH Tests
+*/
+
+#include "TriangleBvh.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// Positions are 3 floats each, tightly packed
+	struct TestMesh
+	{
+		std::vector<float> Positions;
+		std::vector<unsigned int> Indices;
+	};
+
+	// --------------------------------------------------------
+	// A size x size grid of unit cells in the XZ plane, two
+	// triangles per cell split along the cell's diagonal, at
+	// random heights (or flat, with a height range of 0)
+	// --------------------------------------------------------
+	TestMesh MakeGrid(unsigned int size, float heightRange, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> height(0.0f, heightRange);
+		TestMesh mesh;
+		for (unsigned int z = 0; z <= size; z++)
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				mesh.Positions.push_back((float)x);
+				mesh.Positions.push_back(heightRange > 0.0f ? height(random) : 0.0f);
+				mesh.Positions.push_back((float)z);
+			}
+
+		for (unsigned int z = 0; z < size; z++)
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int a = z * (size + 1) + x;
+				unsigned int b = a + 1;
+				unsigned int c = a + size + 2;
+				unsigned int d = a + size + 1;
+				unsigned int cell[6] = { a, b, c, a, c, d };
+				mesh.Indices.insert(mesh.Indices.end(), cell, cell + 6);
+			}
+		return mesh;
+	}
+
+	// --------------------------------------------------------
+	// Small triangles scattered through a 10 unit cube, many of
+	// them overlapping, so rays often have several to choose from
+	// --------------------------------------------------------
+	TestMesh MakeSoup(unsigned int count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> place(0.0f, 10.0f);
+		std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+		TestMesh mesh;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float center[3] = { place(random), place(random), place(random) };
+			for (int corner = 0; corner < 3; corner++)
+			{
+				for (int a = 0; a < 3; a++)
+					mesh.Positions.push_back(center[a] + offset(random));
+				mesh.Indices.push_back(i * 3 + corner);
+			}
+		}
+		return mesh;
+	}
+
+	void Build(TriangleBvh& bvh, const TestMesh& mesh, unsigned int threadCount = 0)
+	{
+		bvh.Build(mesh.Positions.data(), mesh.Positions.size() / 3, sizeof(float) * 3,
+			mesh.Indices.data(), mesh.Indices.size(), threadCount);
+	}
+
+	BvhRay MakeRay(const float origin[3], const float direction[3])
+	{
+		BvhRay ray;
+		for (int a = 0; a < 3; a++)
+		{
+			ray.Origin[a] = origin[a];
+			ray.Direction[a] = direction[a];
+		}
+		ray.MinT = 0.0f;
+		ray.MaxT = INFINITY;
+		return ray;
+	}
+
+	// --------------------------------------------------------
+	// Closest hit by testing every triangle (Moller-Trumbore,
+	// in double). Also says how close the hit is to its
+	// triangle's edges, since a ray through an edge can fairly
+	// be given to either triangle, or (for this test, which
+	// isn't watertight) to neither.
+	// --------------------------------------------------------
+	bool BruteForce(const TestMesh& mesh, const BvhRay& ray, float& closest, float& edgeDistance)
+	{
+		closest = ray.MaxT;
+		edgeDistance = 1.0f;
+		bool found = false;
+		for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+		{
+			const float* a = &mesh.Positions[mesh.Indices[i] * 3];
+			const float* b = &mesh.Positions[mesh.Indices[i + 1] * 3];
+			const float* c = &mesh.Positions[mesh.Indices[i + 2] * 3];
+			double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			const float* d = ray.Direction;
+			double p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+			double determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+			if (determinant == 0.0)
+				continue;
+
+			double s[3] = { ray.Origin[0] - a[0], ray.Origin[1] - a[1], ray.Origin[2] - a[2] };
+			double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / determinant;
+			double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+			double v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) / determinant;
+			double t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / determinant;
+			if (u < 0.0 || v < 0.0 || u + v > 1.0 || t < ray.MinT || t > closest)
+				continue;
+
+			found = true;
+			closest = (float)t;
+			edgeDistance = (float)std::fmin(std::fmin(u, v), 1.0 - u - v);
+		}
+		return found;
+	}
+
+	// --------------------------------------------------------
+	// Every ray against BruteForce(): the same rays must hit,
+	// at the same distance, except right on an edge, and
+	// Occluded() must agree with Intersect(). Returns how many
+	// didn't agree.
+	// --------------------------------------------------------
+	size_t CheckRays(const TestMesh& mesh, const TriangleBvh& bvh, const std::vector<BvhRay>& rays)
+	{
+		size_t wrong = 0;
+		for (const BvhRay& ray : rays)
+		{
+			BvhHit hit;
+			float closest = 0.0f;
+			float edgeDistance = 0.0f;
+			bool expected = BruteForce(mesh, ray, closest, edgeDistance);
+			bool actual = bvh.Intersect(ray, hit);
+			if (bvh.Occluded(ray) != actual)
+				wrong++;
+			else if (expected != actual || (expected && std::fabs(hit.T - closest) > 1e-4f * (1.0f + closest)))
+				wrong += edgeDistance > 1e-4f;
+		}
+		return wrong;
+	}
+
+	// Rays from random points in and around the soup's cube,
+	// in random directions, half of them cut short
+	std::vector<BvhRay> RandomRays(size_t count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> place(-2.0f, 12.0f);
+		std::normal_distribution<float> normal;
+		std::vector<BvhRay> rays;
+		for (size_t i = 0; i < count; i++)
+		{
+			float origin[3] = { place(random), place(random), place(random) };
+			float direction[3] = { normal(random), normal(random), normal(random) };
+			BvhRay ray = MakeRay(origin, direction);
+			ray.MaxT = i % 2 == 0 ? INFINITY : 3.0f;
+			rays.push_back(ray);
+		}
+		return rays;
+	}
+
+	// --------------------------------------------------------
+	// Closest hits and occlusion against brute force, for
+	// rays in every direction through overlapping triangles
+	// --------------------------------------------------------
+	void TestAgainstBruteForce()
+	{
+		std::mt19937 random(540);
+		TestMesh mesh = MakeSoup(2000, random);
+		TriangleBvh bvh;
+		Build(bvh, mesh);
+		CHECK(bvh.IsBuilt() && bvh.GetTriangleCount() == 2000);
+
+		std::vector<BvhRay> rays = RandomRays(2000, random);
+		CHECK(CheckRays(mesh, bvh, rays) == 0);
+
+		// The hit's barycentrics land on the hit point
+		size_t misplaced = 0;
+		for (const BvhRay& ray : rays)
+		{
+			BvhHit hit;
+			if (!bvh.Intersect(ray, hit))
+				continue;
+			const unsigned int* corners = &mesh.Indices[hit.Triangle * 3];
+			for (int a = 0; a < 3; a++)
+			{
+				float onTriangle = mesh.Positions[corners[0] * 3 + a] * (1.0f - hit.U - hit.V) +
+					mesh.Positions[corners[1] * 3 + a] * hit.U + mesh.Positions[corners[2] * 3 + a] * hit.V;
+				float onRay = ray.Origin[a] + ray.Direction[a] * hit.T;
+				misplaced += std::fabs(onTriangle - onRay) > 1e-3f;
+			}
+		}
+		CHECK(misplaced == 0);
+	}
+
+	// --------------------------------------------------------
+	// Rays along each axis, both ways, where a direction with
+	// zero components would make NaNs in the box tests without
+	// the nudge toward 1e-20. Some start exactly on the soup's
+	// box planes.
+	// --------------------------------------------------------
+	void TestAxisParallel()
+	{
+		std::mt19937 random(541);
+		TestMesh mesh = MakeSoup(2000, random);
+		TriangleBvh bvh;
+		Build(bvh, mesh);
+
+		std::uniform_real_distribution<float> place(0.0f, 10.0f);
+		std::vector<BvhRay> rays;
+		for (int axis = 0; axis < 3; axis++)
+			for (float sign : { 1.0f, -1.0f })
+				for (int i = 0; i < 200; i++)
+				{
+					float origin[3] = { place(random), place(random), place(random) };
+					origin[axis] = sign > 0.0f ? -1.0f : 11.0f;
+
+					// Sometimes right on a triangle corner's plane
+					if (i % 4 == 0)
+						origin[(axis + 1) % 3] = mesh.Positions[(i * 3 + axis) % mesh.Positions.size()];
+
+					float direction[3] = { 0.0f, 0.0f, 0.0f };
+					direction[axis] = sign;
+					rays.push_back(MakeRay(origin, direction));
+				}
+		CHECK(CheckRays(mesh, bvh, rays) == 0);
+
+		// A negative zero is still nudged the right way
+		float origin[3] = { 5.0f, 5.0f, -1.0f };
+		float direction[3] = { -0.0f, -0.0f, 1.0f };
+		BvhRay ray = MakeRay(origin, direction);
+		BvhHit hit;
+		float closest, edgeDistance;
+		CHECK(bvh.Intersect(ray, hit) == BruteForce(mesh, ray, closest, edgeDistance));
+	}
+
+	// --------------------------------------------------------
+	// Rays aimed exactly at shared edges and corners of a
+	// grid, straight down (axis-parallel, and on the leaf boxes'
+	// own planes) and at a slant. The intersector is watertight,
+	// so none of them may slip between two triangles.
+	// --------------------------------------------------------
+	void TestSharedEdges()
+	{
+		std::mt19937 random(542);
+		const unsigned int Size = 16;
+		for (float heightRange : { 0.0f, 2.0f })
+		{
+			TestMesh mesh = MakeGrid(Size, heightRange, random);
+			TriangleBvh bvh;
+			Build(bvh, mesh);
+
+			size_t missed = 0;
+			size_t misplaced = 0;
+			for (unsigned int z = 1; z < Size; z++)
+				for (unsigned int x = 1; x < Size; x++)
+				{
+					// A corner, the middle of an x edge, a z edge and a diagonal
+					float targets[4][2] =
+					{
+						{ (float)x, (float)z },
+						{ x + 0.5f, (float)z },
+						{ (float)x, z + 0.5f },
+						{ x + 0.5f, z + 0.5f }
+					};
+					for (const float* target : targets)
+					{
+						float down[3] = { 0.0f, -1.0f, 0.0f };
+						float above[3] = { target[0], 10.0f, target[1] };
+						BvhRay ray = MakeRay(above, down);
+						BvhHit hit;
+						missed += !bvh.Intersect(ray, hit) || !bvh.Occluded(ray);
+						misplaced += heightRange == 0.0f && hit.T != 10.0f;
+
+						float slanted[3] = { target[0] - 3.0f, 10.0f, target[1] - 2.0f };
+						float toward[3] = { 3.0f, -10.0f, 2.0f };
+						ray = MakeRay(slanted, toward);
+						missed += !bvh.Intersect(ray, hit) || !bvh.Occluded(ray);
+						misplaced += heightRange == 0.0f && std::fabs(hit.T - 1.0f) > 1e-5f;
+					}
+				}
+			CHECK(missed == 0);
+			CHECK(misplaced == 0);
+		}
+	}
+
+	// --------------------------------------------------------
+	// A grid big enough to be built on several threads gives
+	// the same answers as one built on a single thread, and
+	// both match brute force
+	// --------------------------------------------------------
+	void TestThreads()
+	{
+		std::mt19937 random(543);
+		TestMesh mesh = MakeGrid(256, 4.0f, random);
+		size_t triangleCount = mesh.Indices.size() / 3;
+		CHECK(triangleCount >= TriangleBvh::MinTrianglesPerThread * 4);
+
+		TriangleBvh single;
+		TriangleBvh threaded;
+		Build(single, mesh, 1);
+		Build(threaded, mesh, 4);
+		CHECK(single.GetTriangleCount() == triangleCount && threaded.GetTriangleCount() == triangleCount);
+
+		// Down onto the grid from random points above it, at a slant
+		std::uniform_real_distribution<float> place(0.0f, 256.0f);
+		std::uniform_real_distribution<float> slant(-0.5f, 0.5f);
+		std::vector<BvhRay> rays;
+		for (int i = 0; i < 4000; i++)
+		{
+			float origin[3] = { place(random), 8.0f, place(random) };
+			float direction[3] = { slant(random), -1.0f, slant(random) };
+			rays.push_back(MakeRay(origin, direction));
+		}
+
+		size_t different = 0;
+		for (const BvhRay& ray : rays)
+		{
+			BvhHit a, b;
+			bool hitA = single.Intersect(ray, a);
+			bool hitB = threaded.Intersect(ray, b);
+			different += hitA != hitB || (hitA && std::fabs(a.T - b.T) > 1e-5f);
+			different += single.Occluded(ray) != threaded.Occluded(ray);
+		}
+		CHECK(different == 0);
+
+		std::vector<BvhRay> sample(rays.begin(), rays.begin() + 100);
+		CHECK(CheckRays(mesh, single, sample) == 0);
+		CHECK(CheckRays(mesh, threaded, sample) == 0);
+	}
+
+	// --------------------------------------------------------
+	// Nothing to hit: no triangles, and ranges that end before
+	// (or start after) the only triangle
+	// --------------------------------------------------------
+	void TestEmptyAndRanges()
+	{
+		TriangleBvh bvh;
+		TestMesh empty;
+		Build(bvh, empty);
+		float origin[3] = { 0.25f, 5.0f, 0.25f };
+		float down[3] = { 0.0f, -1.0f, 0.0f };
+		BvhRay ray = MakeRay(origin, down);
+		BvhHit hit;
+		CHECK(!bvh.Intersect(ray, hit) && !bvh.Occluded(ray));
+
+		std::mt19937 random(544);
+		TestMesh cell = MakeGrid(1, 0.0f, random);
+		Build(bvh, cell);
+		CHECK(bvh.Intersect(ray, hit) && hit.T == 5.0f);
+		ray.MaxT = 4.0f;
+		CHECK(!bvh.Intersect(ray, hit) && !bvh.Occluded(ray));
+		ray.MaxT = INFINITY;
+		ray.MinT = 6.0f;
+		CHECK(!bvh.Intersect(ray, hit) && !bvh.Occluded(ray));
+	}
+}
+
+int main()
+{
+	TestAgainstBruteForce();
+	TestAxisParallel();
+	TestSharedEdges();
+	TestThreads();
+	TestEmptyAndRanges();
+	return Test::Result();
+}
@@ -0,0 +1,211 @@
+/*
+William Duprey
+12/10/24
+Upload Stamp Tests
+*/
+
+#include "UploadStamp.h"
+#include "TransformStore.h"
+#include "TestHelpers.h"
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// --------------------------------------------------------
+	// The parts of a scene that Material::PrepareMaterial()
+	// stamps uploads with: transforms in a store, a camera
+	// (its own id and version, plus a transform) and a mesh
+	// --------------------------------------------------------
+	struct Scene
+	{
+		TransformStore Store;
+		uint64_t TransformIds[2];
+		uint32_t Slots[2];
+		uint64_t CameraId;
+		unsigned int CameraVersion;
+		uint64_t CameraTransformId;
+		uint32_t CameraSlot;
+		uint64_t MeshId;
+	};
+
+	// A material: its id and version, and the shaders it uses
+	struct FakeMaterial
+	{
+		uint64_t Id;
+		unsigned int Version;
+		uint64_t VertexShader;
+		uint64_t PixelShader;
+	};
+
+	Scene MakeScene()
+	{
+		Scene scene;
+		for (int i = 0; i < 2; i++)
+		{
+			scene.Slots[i] = scene.Store.Allocate();
+			scene.TransformIds[i] = UploadStamps::NextId();
+		}
+		scene.CameraId = UploadStamps::NextId();
+		scene.CameraVersion = 0;
+		scene.CameraSlot = scene.Store.Allocate();
+		scene.CameraTransformId = UploadStamps::NextId();
+		scene.MeshId = UploadStamps::NextId();
+		return scene;
+	}
+
+	// --------------------------------------------------------
+	// The same stamps PrepareMaterial() makes for drawing an
+	// entity (one of the scene's transforms) with a material.
+	// Returns whether each shader's values would be set.
+	// --------------------------------------------------------
+	void Draw(UploadStamps& uploads, Scene& scene, int entity, const FakeMaterial& material,
+		bool& vertexSet, bool& pixelSet)
+	{
+		vertexSet = uploads.Restamp(material.VertexShader, {
+			{ scene.TransformIds[entity], scene.CameraId, scene.MeshId },
+			{ scene.Store.GetVersion(scene.Slots[entity]), scene.CameraVersion, 0 } });
+		pixelSet = uploads.Restamp(material.PixelShader, {
+			{ material.Id, scene.CameraTransformId, 0 },
+			{ material.Version, scene.Store.GetVersion(scene.CameraSlot), 0 } });
+	}
+
+	// --------------------------------------------------------
+	// Two materials sharing both shaders: drawing the same
+	// thing again skips everything, switching materials sets
+	// just the pixel shader's values, and switching back sets
+	// them again (the other material overwrote them)
+	// --------------------------------------------------------
+	void TestSharedShaders()
+	{
+		UploadStamps uploads;
+		Scene scene = MakeScene();
+		uint64_t vs = UploadStamps::NextId();
+		uint64_t ps = UploadStamps::NextId();
+		FakeMaterial a = { UploadStamps::NextId(), 0, vs, ps };
+		FakeMaterial b = { UploadStamps::NextId(), 0, vs, ps };
+
+		bool vertexSet, pixelSet;
+		Draw(uploads, scene, 0, a, vertexSet, pixelSet);
+		CHECK(vertexSet && pixelSet);
+		Draw(uploads, scene, 0, a, vertexSet, pixelSet);
+		CHECK(!vertexSet && !pixelSet);
+		CHECK(uploads.GetSkippedCount() == 2);
+
+		Draw(uploads, scene, 0, b, vertexSet, pixelSet);
+		CHECK(!vertexSet && pixelSet);
+		Draw(uploads, scene, 0, a, vertexSet, pixelSet);
+		CHECK(!vertexSet && pixelSet);
+
+		// Another entity with the same material needs its own world
+		Draw(uploads, scene, 1, a, vertexSet, pixelSet);
+		CHECK(vertexSet && !pixelSet);
+
+		// A material change (a setter) is set even for the same entity
+		a.Version++;
+		Draw(uploads, scene, 1, a, vertexSet, pixelSet);
+		CHECK(!vertexSet && pixelSet);
+
+		uploads.ResetSkippedCount();
+		CHECK(uploads.GetSkippedCount() == 0);
+	}
+
+	// --------------------------------------------------------
+	// Moving the entity sets the vertex shader's values again,
+	// but not the pixel shader's
+	// --------------------------------------------------------
+	void TestTransformChange()
+	{
+		UploadStamps uploads;
+		Scene scene = MakeScene();
+		FakeMaterial material = { UploadStamps::NextId(), 0, UploadStamps::NextId(), UploadStamps::NextId() };
+
+		bool vertexSet, pixelSet;
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		scene.Store.SetPosition(scene.Slots[0], 1.0f, 2.0f, 3.0f);
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		CHECK(vertexSet && !pixelSet);
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		CHECK(!vertexSet && !pixelSet);
+
+		// Moving a parent moves the child in the world too
+		scene.Store.SetParent(scene.Slots[0], scene.Slots[1]);
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		CHECK(vertexSet);
+		scene.Store.UpdateDirty(1);
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		CHECK(!vertexSet);
+		scene.Store.SetScale(scene.Slots[1], 2.0f, 2.0f, 2.0f);
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		CHECK(vertexSet && !pixelSet);
+	}
+
+	// --------------------------------------------------------
+	// A new view or projection sets the vertex shader's values
+	// again, and moving the camera sets the pixel shader's too
+	// (it gets the camera's position)
+	// --------------------------------------------------------
+	void TestCameraChange()
+	{
+		UploadStamps uploads;
+		Scene scene = MakeScene();
+		FakeMaterial material = { UploadStamps::NextId(), 0, UploadStamps::NextId(), UploadStamps::NextId() };
+
+		bool vertexSet, pixelSet;
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		scene.CameraVersion++;
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		CHECK(vertexSet && !pixelSet);
+
+		scene.Store.SetPosition(scene.CameraSlot, 0.0f, 0.0f, -5.0f);
+		scene.CameraVersion++;
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		CHECK(vertexSet && pixelSet);
+		Draw(uploads, scene, 0, material, vertexSet, pixelSet);
+		CHECK(!vertexSet && !pixelSet);
+	}
+
+	// --------------------------------------------------------
+	// A released slot that's reused starts on a version it's
+	// never had, and versions only go up, so an upload stamped
+	// before can't match the new transform. Neither can a new
+	// shader that would have had a freed one's address.
+	// --------------------------------------------------------
+	void TestReuse()
+	{
+		UploadStamps uploads;
+		TransformStore store;
+		uint32_t slot = store.Allocate();
+		uint64_t first = store.GetVersion(slot);
+		store.SetPosition(slot, 1.0f, 0.0f, 0.0f);
+		uint64_t moved = store.GetVersion(slot);
+		CHECK(moved > first);
+
+		// The same source (as by address) and its versions
+		uint64_t shader = UploadStamps::NextId();
+		uint64_t source = UploadStamps::NextId();
+		CHECK(uploads.Restamp(shader, { { source, 0, 0 }, { moved, 0, 0 } }));
+
+		store.Release(slot);
+		uint32_t reused = store.Allocate();
+		CHECK(reused == slot);
+		CHECK(store.GetVersion(reused) > moved);
+		CHECK(uploads.Restamp(shader, { { source, 0, 0 }, { store.GetVersion(reused), 0, 0 } }));
+
+		// Versions aren't shared between slots either
+		uint32_t other = store.Allocate();
+		CHECK(store.GetVersion(other) != store.GetVersion(reused));
+
+		// A new shader never has a stamp yet
+		CHECK(uploads.Restamp(UploadStamps::NextId(), { { source, 0, 0 }, { store.GetVersion(reused), 0, 0 } }));
+		CHECK(UploadStamps::NextId() != UploadStamps::NextId());
+	}
+}
+
+int main()
+{
+	TestSharedShaders();
+	TestTransformChange();
+	TestCameraChange();
+	TestReuse();
+	return Test::Result();
+}
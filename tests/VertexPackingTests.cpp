@@ -0,0 +1,370 @@
+/*
+William Duprey
+12/10/24
+Vertex Packing Tests
+*/
+
+#include "VertexPacking.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	const int Iterations = 200000;
+
+	// Same layout as Mesh's Vertex, without DirectXMath
+	struct TestVertex
+	{
+		float Position[3];
+		float Normal[3];
+		float Tangent[3];
+		float UV[2];
+	};
+
+	float Bits(uint32_t bits)
+	{
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	void RandomDirection(std::mt19937& random, float direction[3])
+	{
+		std::normal_distribution<float> gaussian;
+		float length = 0.0f;
+		while (length < 1e-6f)
+		{
+			for (int i = 0; i < 3; i++)
+				direction[i] = gaussian(random);
+			length = std::sqrt(direction[0] * direction[0] +
+				direction[1] * direction[1] + direction[2] * direction[2]);
+		}
+		for (int i = 0; i < 3; i++)
+			direction[i] /= length;
+	}
+
+	// Angle between two unit vectors, in degrees. Done with
+	// atan2 of the cross and dot products, since acos of the
+	// dot product alone has no precision this close to 0.
+	double AngleDegrees(const float a[3], const float b[3])
+	{
+		double cross[3] =
+		{
+			(double)a[1] * b[2] - (double)a[2] * b[1],
+			(double)a[2] * b[0] - (double)a[0] * b[2],
+			(double)a[0] * b[1] - (double)a[1] * b[0]
+		};
+		double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+		double cosine = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+		return std::atan2(sine, cosine) * 180.0 / 3.14159265358979;
+	}
+
+	// --------------------------------------------------------
+	// Every half converts to a float and back to the same bits
+	// (NaNs just have to stay NaN), and the special cases
+	// around the edges of the range land where hardware would
+	// --------------------------------------------------------
+	void TestHalfExact()
+	{
+		int mismatched = 0;
+		for (uint32_t bits = 0; bits <= 0xFFFF; bits++)
+		{
+			float value = VertexPacking::HalfToFloat((uint16_t)bits);
+			bool isNan = (bits & 0x7C00) == 0x7C00 && (bits & 0x3FF) != 0;
+			if (isNan)
+			{
+				if (!std::isnan(value) || !std::isnan(VertexPacking::HalfToFloat(VertexPacking::FloatToHalf(value))))
+					mismatched++;
+			}
+			else if (VertexPacking::FloatToHalf(value) != bits)
+				mismatched++;
+		}
+		CHECK(mismatched == 0);
+
+		CHECK(VertexPacking::FloatToHalf(0.0f) == 0x0000);
+		CHECK(VertexPacking::FloatToHalf(-0.0f) == 0x8000);
+		CHECK(VertexPacking::FloatToHalf(1.0f) == 0x3C00);
+		CHECK(VertexPacking::FloatToHalf(65504.0f) == 0x7BFF);
+		CHECK(VertexPacking::FloatToHalf(65520.0f) == 0x7C00);		// Rounds up to infinity
+		CHECK(VertexPacking::FloatToHalf(1e10f) == 0x7C00);
+		CHECK(VertexPacking::FloatToHalf(-1e10f) == 0xFC00);
+		CHECK(VertexPacking::FloatToHalf(INFINITY) == 0x7C00);
+		CHECK((VertexPacking::FloatToHalf(NAN) & 0x7FFF) > 0x7C00);
+		CHECK(VertexPacking::FloatToHalf(Bits(0x33800000)) == 0x0001);	// 2^-24, smallest subnormal
+		CHECK(VertexPacking::FloatToHalf(Bits(0x33000000)) == 0x0000);	// 2^-25 ties to even (zero)
+		CHECK(VertexPacking::FloatToHalf(Bits(0x33000001)) == 0x0001);	// Just past the tie rounds up
+		CHECK(VertexPacking::FloatToHalf(Bits(0x387FE000)) == 0x0400);	// Largest subnormal rounds up to normal
+		CHECK(VertexPacking::FloatToHalf(1.0f + 1.0f / 2048.0f) == 0x3C00);	// Tie to even, down
+		CHECK(VertexPacking::FloatToHalf(1.0f + 3.0f / 2048.0f) == 0x3C02);	// Tie to even, up
+	}
+
+	// --------------------------------------------------------
+	// Floats across the normal half range come back within
+	// HalfRelativeError, and smaller ones within half of the
+	// subnormal step (an absolute error, since that's all they
+	// have)
+	// --------------------------------------------------------
+	void TestHalfError()
+	{
+		std::mt19937 random(540);
+		std::uniform_real_distribution<float> exponents(-30.0f, 15.99f);
+		const float SmallestNormal = 6.103515625e-05f;
+		const float SubnormalStep = 5.9604644775390625e-08f;
+		int outOfBounds = 0;
+		for (int i = 0; i < Iterations; i++)
+		{
+			float value = std::exp2(exponents(random)) * (random() % 2 ? 1.0f : -1.0f);
+			float decoded = VertexPacking::HalfToFloat(VertexPacking::FloatToHalf(value));
+			float error = std::fabs(decoded - value);
+			float bound = std::fabs(value) >= SmallestNormal
+				? std::fabs(value) * VertexPacking::HalfRelativeError
+				: SubnormalStep * 0.5f;
+			if (!(error <= bound))
+				outOfBounds++;
+		}
+		CHECK(outOfBounds == 0);
+	}
+
+	// --------------------------------------------------------
+	// Random unit vectors, plus the axes and the places the
+	// octahedron folds, all decode within DirectionErrorDegrees
+	// --------------------------------------------------------
+	void TestOctahedral()
+	{
+		std::mt19937 random(541);
+		double worst = 0.0;
+		int notUnit = 0;
+		auto check = [&](const float direction[3])
+		{
+			int16_t encoded[2];
+			float decoded[3];
+			VertexPacking::EncodeOctahedral(direction, encoded);
+			VertexPacking::DecodeOctahedral(encoded, decoded);
+			worst = std::fmax(worst, AngleDegrees(direction, decoded));
+			float length = std::sqrt(decoded[0] * decoded[0] + decoded[1] * decoded[1] + decoded[2] * decoded[2]);
+			if (std::fabs(length - 1.0f) > 1e-5f)
+				notUnit++;
+		};
+
+		for (int i = 0; i < Iterations; i++)
+		{
+			float direction[3];
+			RandomDirection(random, direction);
+			check(direction);
+
+			// Right on (or just across) the z = 0 fold
+			direction[2] = (random() % 3 == 0) ? 0.0f : direction[2] * 1e-4f;
+			float length = std::sqrt(direction[0] * direction[0] +
+				direction[1] * direction[1] + direction[2] * direction[2]);
+			for (int k = 0; k < 3; k++)
+				direction[k] /= length;
+			check(direction);
+		}
+
+		const float axes[6][3] =
+		{
+			{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+		};
+		for (const float* axis : axes)
+			check(axis);
+
+		CHECK(worst <= VertexPacking::DirectionErrorDegrees);
+		CHECK(notUnit == 0);
+		std::printf("Worst octahedral error: %.5f degrees\n", worst);
+
+		// A zero vector (a degenerate tangent) decodes to +Z
+		const float zero[3] = { 0, 0, 0 };
+		int16_t encoded[2];
+		float decoded[3];
+		VertexPacking::EncodeOctahedral(zero, encoded);
+		VertexPacking::DecodeOctahedral(encoded, decoded);
+		CHECK(encoded[0] == 0 && encoded[1] == 0);
+		CHECK(decoded[0] == 0.0f && decoded[1] == 0.0f && decoded[2] == 1.0f);
+	}
+
+	// --------------------------------------------------------
+	// Whole vertices within random bounds (including flat ones,
+	// like a quad's) come back within every bound at once, and
+	// the corners of the bounds come back exactly
+	// --------------------------------------------------------
+	void TestPackUnpack()
+	{
+		std::mt19937 random(542);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		int positionErrors = 0;
+		int directionErrors = 0;
+		int uvErrors = 0;
+		for (int i = 0; i < Iterations; i++)
+		{
+			float boundsMin[3];
+			float boundsMax[3];
+			float position[3];
+			float scale = std::exp2(unit(random) * 20.0f - 10.0f);
+			for (int k = 0; k < 3; k++)
+			{
+				boundsMin[k] = (unit(random) - 0.5f) * scale * 4.0f;
+				float extent = (random() % 16 == 0) ? 0.0f : unit(random) * scale;
+				boundsMax[k] = boundsMin[k] + extent;
+				position[k] = (random() % 8 == 0)
+					? (random() % 2 ? boundsMin[k] : boundsMax[k])
+					: std::fmin(boundsMin[k] + unit(random) * extent, boundsMax[k]);
+			}
+
+			float normal[3];
+			float tangent[3];
+			RandomDirection(random, normal);
+			RandomDirection(random, tangent);
+			float uv[2] = { (unit(random) - 0.25f) * 8.0f, unit(random) };
+
+			PackedVertex packed = VertexPacking::Pack(position, normal, tangent, uv, boundsMin, boundsMax);
+			float outPosition[3];
+			float outNormal[3];
+			float outTangent[3];
+			float outUV[2];
+			VertexPacking::Unpack(packed, boundsMin, boundsMax, outPosition, outNormal, outTangent, outUV);
+
+			for (int k = 0; k < 3; k++)
+			{
+				float extent = boundsMax[k] - boundsMin[k];
+				float error = std::fabs(outPosition[k] - position[k]);
+				if (error > VertexPacking::PositionError * extent)
+					positionErrors++;
+			}
+			if (AngleDegrees(normal, outNormal) > VertexPacking::DirectionErrorDegrees ||
+				AngleDegrees(tangent, outTangent) > VertexPacking::DirectionErrorDegrees)
+				directionErrors++;
+			for (int k = 0; k < 2; k++)
+			{
+				if (std::fabs(outUV[k] - uv[k]) > std::fmax(std::fabs(uv[k]) * VertexPacking::HalfRelativeError, 3e-8f))
+					uvErrors++;
+			}
+		}
+		CHECK(positionErrors == 0);
+		CHECK(directionErrors == 0);
+		CHECK(uvErrors == 0);
+
+		// The bounds' own corners are exact
+		float boundsMin[3] = { -3.5f, 0.25f, 10.0f };
+		float boundsMax[3] = { 7.0f, 0.5f, 10.0f };
+		float direction[3] = { 0, 0, 1 };
+		float uv[2] = { 0.5f, 1.0f };
+		float out[3];
+		float ignored[3];
+		float outUV[2];
+		PackedVertex low = VertexPacking::Pack(boundsMin, direction, direction, uv, boundsMin, boundsMax);
+		VertexPacking::Unpack(low, boundsMin, boundsMax, out, ignored, ignored, outUV);
+		CHECK(out[0] == boundsMin[0] && out[1] == boundsMin[1] && out[2] == boundsMin[2]);
+		CHECK(outUV[0] == 0.5f && outUV[1] == 1.0f);
+		PackedVertex high = VertexPacking::Pack(boundsMax, direction, direction, uv, boundsMin, boundsMax);
+		CHECK(high.Position[0] == 65535 && high.Position[1] == 65535 && high.Position[2] == 0);
+	}
+
+	// --------------------------------------------------------
+	// The HLSL inputs read a PackedVertex as uint2 + 3 uints,
+	// so every field must sit where those land, and a value
+	// written to each field must come out of the right bytes
+	// --------------------------------------------------------
+	void TestLayout()
+	{
+		CHECK(sizeof(PackedVertex) == 20);
+		CHECK(offsetof(PackedVertex, Position) == 0);
+		CHECK(offsetof(PackedVertex, Normal) == 8);
+		CHECK(offsetof(PackedVertex, Tangent) == 12);
+		CHECK(offsetof(PackedVertex, UV) == 16);
+
+		PackedVertex packed = {};
+		packed.Position[0] = 0x1111;
+		packed.Position[2] = 0x3333;
+		packed.Normal[1] = 0x2222;
+		packed.Tangent[0] = 0x4444;
+		packed.UV[1] = 0x5555;
+		uint32_t words[5];
+		std::memcpy(words, &packed, sizeof(words));
+		CHECK(words[0] == 0x00001111 && words[1] == 0x00003333);
+		CHECK(words[2] == 0x22220000 && words[3] == 0x00004444 && words[4] == 0x55550000);
+	}
+
+	// --------------------------------------------------------
+	// The position stream of both vertex formats: each entry
+	// is exactly the front of its vertex, so it decodes to the
+	// same position the full vertex does, and nothing past the
+	// last entry is touched
+	// --------------------------------------------------------
+	void TestPositionStream()
+	{
+		std::mt19937 random(543);
+		std::uniform_real_distribution<float> coordinate(-5.0f, 5.0f);
+		const size_t Count = 1000;
+		float boundsMin[3] = { -5.0f, -5.0f, -5.0f };
+		float boundsMax[3] = { 5.0f, 5.0f, 5.0f };
+
+		std::vector<TestVertex> vertices(Count);
+		std::vector<PackedVertex> packed(Count);
+		for (size_t i = 0; i < Count; i++)
+		{
+			TestVertex& v = vertices[i];
+			for (int k = 0; k < 3; k++)
+				v.Position[k] = coordinate(random);
+			RandomDirection(random, v.Normal);
+			RandomDirection(random, v.Tangent);
+			v.UV[0] = coordinate(random);
+			v.UV[1] = coordinate(random);
+			packed[i] = VertexPacking::Pack(v.Position, v.Normal, v.Tangent, v.UV, boundsMin, boundsMax);
+		}
+
+		// One extra entry of each, which must stay untouched
+		const size_t FloatStride = sizeof(TestVertex::Position);
+		const size_t PackedStride = sizeof(PackedVertex::Position);
+		CHECK(FloatStride == 12 && PackedStride == 8);
+		std::vector<unsigned char> floatStream((Count + 1) * FloatStride, 0xCD);
+		std::vector<unsigned char> packedStream((Count + 1) * PackedStride, 0xCD);
+		VertexPacking::ExtractPositions(floatStream.data(), vertices.data(), Count, sizeof(TestVertex), FloatStride);
+		VertexPacking::ExtractPositions(packedStream.data(), packed.data(), Count, sizeof(PackedVertex), PackedStride);
+
+		int mismatched = 0;
+		for (size_t i = 0; i < Count; i++)
+		{
+			float position[3];
+			std::memcpy(position, &floatStream[i * FloatStride], FloatStride);
+			if (std::memcmp(position, vertices[i].Position, FloatStride) != 0)
+				mismatched++;
+
+			// Decoded the way PackedPositionOnlyVertexShaderInput is
+			PackedVertex front = {};
+			std::memcpy(front.Position, &packedStream[i * PackedStride], PackedStride);
+			float fromStream[3];
+			float fromVertex[3];
+			float ignored[3];
+			float ignoredUV[2];
+			VertexPacking::Unpack(front, boundsMin, boundsMax, fromStream, ignored, ignored, ignoredUV);
+			VertexPacking::Unpack(packed[i], boundsMin, boundsMax, fromVertex, ignored, ignored, ignoredUV);
+			if (std::memcmp(fromStream, fromVertex, sizeof(fromStream)) != 0)
+				mismatched++;
+		}
+		CHECK(mismatched == 0);
+
+		bool untouched = true;
+		for (size_t i = Count * FloatStride; i < floatStream.size(); i++)
+			untouched &= floatStream[i] == 0xCD;
+		for (size_t i = Count * PackedStride; i < packedStream.size(); i++)
+			untouched &= packedStream[i] == 0xCD;
+		CHECK(untouched);
+	}
+}
+
+int main()
+{
+	TestHalfExact();
+	TestHalfError();
+	TestOctahedral();
+	TestPackUnpack();
+	TestLayout();
+	TestPositionStream();
+	return Test::Result();
+}
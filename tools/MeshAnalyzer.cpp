@@ -0,0 +1,55 @@
+/*
+William Duprey
+12/10/24
+Mesh Analyzer
+*/
+
+#include "MeshAnalysis.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Anonymous namespace for helpers only used in this file
+namespace
+{
+	// The size of the game's Vertex (position, normal, tangent
+	// and UV), for the bytes per triangle. Vertex.h needs
+	// DirectXMath, so it's spelled out here instead.
+	const size_t VertexBytes = sizeof(float) * 11;
+}
+
+// --------------------------------------------------------
+// Analyzes meshes without the renderer, for checking assets
+// from scripts, writing the results as JSON (see
+// MeshAnalysis.h):
+//   MeshAnalyzer <output.json> [mesh files or folders...]
+// With no paths, the bundled models are analyzed.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::printf("Usage: %s <output.json> [mesh files or folders...]\n", argv[0]);
+		return 1;
+	}
+
+	const char* outputPath = argv[1];
+	std::vector<std::string> paths(argv + 2, argv + argc);
+	if (paths.empty())
+		paths.push_back(std::string(MESHANALYZER_ASSETS) + "/Models/");
+
+	std::vector<MeshReport> reports;
+	MeshAnalysis::AnalyzeFiles(paths, VertexBytes, reports);
+
+	std::ofstream out(outputPath);
+	if (!out.is_open())
+	{
+		std::printf("Couldn't write %s\n", outputPath);
+		return 1;
+	}
+	MeshAnalysis::WriteJson(out, reports);
+	std::printf("Analyzed %d meshes into %s\n", (int)reports.size(), outputPath);
+	return out.good() ? 0 : 1;
+}